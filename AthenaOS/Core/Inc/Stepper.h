@@ -8,8 +8,26 @@
 #ifndef INC_STEPPER_H_
 #define INC_STEPPER_H_
 
-#include "main.h"
+#include <stdint.h>
+#include "motion.h"
+#include "home.h"
 
+#define STEPPER_TICK_HZ		1000000		/* TIM3 counts microseconds */
+#define STEPPER_PULSE_TICKS	10			/* Step_PWM low time */
+#define STEPPER_MAX_SPEED	5000.0f		/* steps/s */
+#define STEPPER_ACCEL		20000.0f	/* steps/s^2 */
+#define STEPPER_INDEX		0			/* index sensor fitted on Extra_out (PC7) */
+
+extern struct motion stepper_motion;
+extern struct home stepper_home;
+
+void stepper_Init(void);
+void stepper_Home(void);
 void stepper_Step (int dir, int step);
+void stepper_MoveTo(int32_t position);
+void stepper_Retarget(int32_t position);
+int32_t stepper_Position(void);
+int stepper_Busy(void);
+void stepper_IRQ(void);
 
 #endif /* INC_STEPPER_H_ */
@@ -0,0 +1,62 @@
+/*
+ * beep.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_BEEP_H_
+#define INC_BEEP_H_
+
+#include <stdint.h>
+
+#define BEEP_QUEUE		64		/* notes, power of two */
+#define BEEP_TICK_HZ	1000000	/* TIM2 counts microseconds */
+#define BEEP_REST_HZ	1000	/* rests tick at this rate with the output held low */
+
+/* The tones startup() always used, ~4 kHz around the piezo's resonance */
+#define BEEP_LOW		3900
+#define BEEP_MID		4000
+#define BEEP_HIGH		4300
+
+struct beep_note {
+	uint16_t	hz;		/* 0 for a rest */
+	uint16_t	ms;
+};
+
+/* How the timer plays one note: count PWM periods of period ticks */
+struct beep_timing {
+	uint32_t	period;		/* ARR + 1 */
+	uint32_t	pulse;		/* CCR, 0 for silence */
+	uint32_t	count;		/* update events until the next note */
+};
+
+/*
+ * Notes are queued from the main loop and played from the timer's
+ * update interrupt: head only moves in the main loop, tail only in
+ * the interrupt.
+ */
+struct beep {
+	struct beep_note	q[BEEP_QUEUE];
+	volatile uint16_t	head;
+	volatile uint16_t	tail;
+	volatile uint8_t	playing;
+	uint32_t			left;		/* update events left in the current note */
+};
+
+/* beep_tim.c */
+extern struct beep beep;
+
+void beep_Start(void);
+void beep_Kick(void);
+void beep_IRQ(void);
+
+/* beep.c */
+void beep_Init(struct beep *b);
+int beep_Queue(struct beep *b, uint16_t hz, uint16_t ms);
+int beep_Tune(struct beep *b, const struct beep_note *notes, int n);
+int beep_Battery(struct beep *b, uint32_t millivolts);
+int beep_Next(struct beep *b, uint32_t tick_hz, struct beep_timing *t);
+int beep_Busy(const struct beep *b);
+
+#endif /* INC_BEEP_H_ */
@@ -0,0 +1,25 @@
+/*
+ * cdc_link.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_CDC_LINK_H_
+#define INC_CDC_LINK_H_
+
+#include <stdint.h>
+
+#define CDC_RX_SIZE		2048	/* power of two */
+#define CDC_TX_SIZE		4096	/* power of two */
+#define CDC_TX_CHUNK	1024	/* most handed to the stack at once */
+#define CDC_PACKET		64		/* full speed bulk packet */
+
+void cdc_Reset(void);
+int cdc_Receive(const uint8_t *buf, uint32_t len);
+uint32_t cdc_Read(uint8_t *buf, uint32_t max);
+void cdc_Transmitted(void);
+int cdc_Send(const uint8_t *buf, uint16_t len);
+int cdc_Write(const uint8_t *buf, uint16_t len);
+
+#endif /* INC_CDC_LINK_H_ */
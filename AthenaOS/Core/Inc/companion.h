@@ -0,0 +1,133 @@
+/*
+ * companion.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_COMPANION_H_
+#define INC_COMPANION_H_
+
+#include <stdint.h>
+
+/*
+ * TeleMega companion protocol, see altos/src/kernel/ao_companion.h
+ * and altos/src/drivers/ao_companion.c. Every transaction is one
+ * chip select: a 16 byte struct ao_companion_command from the
+ * TeleMega followed by the reply clocked back out of us.
+ */
+#define COMPANION_SETUP			1
+#define COMPANION_FETCH			2
+#define COMPANION_NOTIFY		3
+
+#define COMPANION_COMMAND_SIZE	16	/* sizeof (struct ao_companion_command) */
+#define COMPANION_SETUP_SIZE	6	/* sizeof (struct ao_companion_setup) */
+#define COMPANION_MAX_CHANNELS	12	/* AO_COMPANION_MAX_CHANNELS */
+
+#define COMPANION_BOARD_ID		0x00A7
+#define COMPANION_UPDATE_PERIOD	1	/* TeleMega ticks (10 ms) between FETCHes */
+#define COMPANION_HZ			(100 / COMPANION_UPDATE_PERIOD)
+
+/* enum ao_flight_state */
+#define COMPANION_STATE_STARTUP	0
+#define COMPANION_STATE_IDLE	1
+#define COMPANION_STATE_PAD		2
+#define COMPANION_STATE_BOOST	3
+#define COMPANION_STATE_FAST	4
+#define COMPANION_STATE_COAST	5
+#define COMPANION_STATE_DROGUE	6
+#define COMPANION_STATE_MAIN	7
+#define COMPANION_STATE_LANDED	8
+#define COMPANION_STATE_INVALID	9
+#define COMPANION_STATE_TEST	10
+
+/*
+ * Our FETCH reply, one uint16_t per channel, little endian. The
+ * TeleMega keeps them in ao_companion_data[] and sends them down in
+ * its companion telemetry packets.
+ */
+#define COMPANION_CH_STATUS		0	/* control mode | COMPANION_RETURN_x << 8 */
+#define COMPANION_CH_POSITION	1	/* int16_t stepper steps */
+#define COMPANION_CH_TARGET		2	/* int16_t commanded stepper steps */
+#define COMPANION_CH_EXTENSION	3	/* commanded, 1/10000 of full */
+#define COMPANION_CH_PREDICTED	4	/* apogee with the brakes where they are, m */
+#define COMPANION_CH_ERROR		5	/* int16_t predicted - target, dm */
+#define COMPANION_CH_CD			6	/* from the table, 1/10000 */
+#define COMPANION_CH_OVERRUNS	7	/* control ticks that ran into the next */
+#define COMPANION_CH_EXEC		8	/* longest control tick, us */
+#define COMPANION_CH_SLIPS		9	/* lost steps the index caught */
+#define COMPANION_CHANNELS		10
+
+#define COMPANION_RETURN_HOMED	0x01
+#define COMPANION_RETURN_COAST	0x02	/* clock governor at full speed */
+#define COMPANION_RETURN_SD		0x04	/* SD log open */
+#define COMPANION_RETURN_LOCAL	0x08	/* controlling on Athena's own sensors */
+
+/* Which reply to load into the TX DMA for the next transaction */
+#define COMPANION_REPLY_SETUP	0
+#define COMPANION_REPLY_DATA	1
+
+struct companion_state {
+	uint8_t		command;
+	uint8_t		flight_state;
+	uint16_t	tick;			/* TeleMega ao_time(), 100 Hz */
+	uint16_t	serial;
+	uint16_t	flight;
+	int16_t		accel;			/* m/s^2 * 16 */
+	int16_t		speed;			/* m/s * 16 */
+	int16_t		height;			/* m above pad */
+	uint16_t	motor_number;
+	uint32_t	rx_tick;		/* HAL_GetTick() when the frame landed */
+};
+
+/* What goes back on FETCH, before it's packed into channels */
+struct companion_return {
+	uint8_t		mode;			/* CONTROL_x */
+	uint8_t		flags;			/* COMPANION_RETURN_x */
+	int32_t		position;		/* steps */
+	int32_t		target;
+	float		extension;		/* 0 to 1 */
+	float		predicted;		/* m */
+	float		error;			/* m */
+	float		cd;
+	uint32_t	overruns;
+	uint32_t	exec_us;
+	uint32_t	slips;
+};
+
+struct companion_decoder {
+	struct companion_state	state[2];
+	volatile uint8_t		latest;		/* index of the newest complete state */
+	volatile uint8_t		reply;		/* COMPANION_REPLY_x for the next transaction */
+	uint8_t					channels;	/* data channels advertised in our setup reply */
+	volatile uint32_t		frames;		/* frames accepted */
+	volatile uint32_t		errors;		/* transactions rejected */
+};
+
+/* companion_spi.c */
+extern struct companion_decoder companion;
+extern volatile uint32_t companion_cycles;
+extern volatile uint8_t companion_hil;
+
+void companion_Start(void);
+void companion_NSS(void);
+void companion_Return(const struct companion_return *r);
+int companion_Hil(uint8_t on);
+int companion_Inject(const uint8_t *data, uint16_t len);
+
+/* companion.c */
+void companion_Reset(struct companion_decoder *c, uint8_t channels);
+int companion_Decode(struct companion_decoder *c, const uint8_t *ring, uint16_t mask,
+		uint16_t start, uint16_t len, uint32_t now);
+void companion_Encode(const struct companion_state *s, uint8_t *command);
+void companion_EncodeReturn(const struct companion_return *r, uint8_t *data);
+
+/*
+ * Newest flight state. The decoder only ever writes the other slot,
+ * so this stays stable for a whole update period.
+ */
+static inline const struct companion_state *companion_Latest(const struct companion_decoder *c){
+	return &c->state[c->latest];
+}
+
+#endif /* INC_COMPANION_H_ */
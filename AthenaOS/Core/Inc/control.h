@@ -0,0 +1,97 @@
+/*
+ * control.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_CONTROL_H_
+#define INC_CONTROL_H_
+
+#include <stdint.h>
+#include "companion.h"
+#include "lut.h"
+#include "predict.h"
+
+#define CONTROL_HZ			200		/* two ticks per TeleMega FETCH, the second extrapolated */
+#define CONTROL_RECORD_EVERY	(CONTROL_HZ / COMPANION_HZ)	/* ticks per tick in the recorder and telemetry */
+#define CONTROL_TICK_HZ		1000000	/* TIM4 counts microseconds */
+
+/*
+ * Airframe and controller constants. The airframe numbers are the
+ * competition rocket's; gains are starting points for tuning on the
+ * bench with Test/control_test.
+ */
+struct control_config {
+	float		target;			/* apogee, m above pad */
+	float		mass;			/* kg, after burnout */
+	float		area;			/* reference area, m^2 */
+	float		brake_cda;		/* extra Cd * area with the brakes all the way out, m^2 */
+	float		cd_default;		/* when the table isn't there */
+	float		rho0;			/* air density at the pad, kg/m^3 */
+	float		kp;				/* extension per m of predicted overshoot */
+	float		ki;				/* extension per m s */
+	int32_t		brake_steps;	/* stepper steps from retracted to fully out */
+	uint32_t	stale_ms;		/* companion data older than this retracts the brakes */
+	float		hz;				/* control rate */
+	uint8_t		method;			/* PREDICT_x */
+	float		dt;				/* predictor step, s */
+};
+
+#define CONTROL_CONFIG_DEFAULT {		\
+	.target = 3048.0f,					\
+	.mass = 20.0f,						\
+	.area = 0.0182f,					\
+	.brake_cda = 0.012f,				\
+	.cd_default = 0.45f,				\
+	.rho0 = 1.05f,						\
+	.kp = 0.004f,						\
+	.ki = 0.002f,						\
+	.brake_steps = 2000,				\
+	.stale_ms = 100,					\
+	.hz = CONTROL_HZ,					\
+	.method = PREDICT_RK4,				\
+	.dt = 0.5f,							\
+}
+
+#define CONTROL_IDLE		0	/* on the pad or under power: stay retracted */
+#define CONTROL_ACTIVE		1	/* coasting: fly the brakes */
+#define CONTROL_DONE		2	/* past apogee: retracted for good */
+#define CONTROL_STALE		3	/* no companion data: retracted until it comes back */
+
+struct control {
+	struct control_config	cfg;
+	struct lut				*lut;
+	struct predict_model	model;
+	uint8_t					mode;
+	float					cd;			/* from the table at the last tick */
+	float					predicted;	/* apogee with the brakes where they are, m */
+	float					error;		/* predicted - target, m */
+	float					integral;	/* extension */
+	float					extension;	/* commanded, 0 to 1 */
+	int32_t					output;		/* commanded stepper position */
+	uint32_t				ticks;
+};
+
+/* Timing of the control interrupt, in CPU cycles */
+struct control_timing {
+	uint32_t	period_min;
+	uint32_t	period_max;
+	uint32_t	exec_max;		/* worst case execution */
+	uint32_t	exec_last;
+	uint32_t	overruns;		/* ticks that started after the next was due */
+};
+
+/* control_tim.c */
+extern struct control control;
+extern volatile struct control_timing control_timing;
+
+void control_Start(void);
+void control_IRQ(void);
+void control_ResetTiming(void);
+
+/* control.c */
+void control_Init(struct control *c, const struct control_config *cfg, struct lut *lut);
+int32_t control_Step(struct control *c, const struct companion_state *s, int32_t position, uint32_t now);
+
+#endif /* INC_CONTROL_H_ */
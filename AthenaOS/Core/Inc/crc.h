@@ -0,0 +1,22 @@
+/*
+ * crc.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_CRC_H_
+#define INC_CRC_H_
+
+#include <stdint.h>
+
+/* CRC-16/CCITT-FALSE, for frames */
+#define CRC16_INIT	0xffff
+
+/* CRC-32 as zlib computes it, for whole tables */
+#define CRC32_INIT	0
+
+uint16_t crc16(uint16_t crc, const uint8_t *buf, uint32_t len);
+uint32_t crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif /* INC_CRC_H_ */
@@ -0,0 +1,46 @@
+/*
+ * erase.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_ERASE_H_
+#define INC_ERASE_H_
+
+#include <stdint.h>
+
+#define ERASE_SECTOR_SIZE	4096
+#define ERASE_MAX_SECTORS	4096	/* 16 MB */
+#define ERASE_AHEAD			8		/* sectors kept ready past the write head, 10 s of log */
+
+/*
+ * Keeps the sectors just ahead of a sequential writer erased, one 4K
+ * sector erase at a time from the main loop, so clearing the log costs
+ * nothing up front. The map has a bit per sector that's been erased
+ * since it was last written; everything starts out unknown. start()
+ * issues a sector erase and returns without waiting, busy() is polled
+ * until it finishes.
+ */
+struct erase {
+	uint32_t	base;			/* address of sector 0 */
+	uint16_t	sectors;
+	uint16_t	head;			/* sector the writer is in */
+	int32_t		erasing;		/* sector being erased, -1 for none */
+	uint32_t	erases;
+	uint8_t		map[ERASE_MAX_SECTORS / 8];
+	int			(*start)(uint32_t addr);
+	int			(*busy)(void);
+};
+
+/* recorder_flash.c */
+extern struct erase erase;
+
+/* erase.c */
+void erase_Init(struct erase *e, uint32_t base, uint32_t len,
+		int (*start)(uint32_t addr), int (*busy)(void));
+void erase_Restart(struct erase *e, uint32_t head);
+int erase_Ready(struct erase *e, uint32_t addr, uint32_t len);
+void erase_Poll(struct erase *e);
+
+#endif /* INC_ERASE_H_ */
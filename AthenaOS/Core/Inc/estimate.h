@@ -0,0 +1,57 @@
+/*
+ * estimate.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_ESTIMATE_H_
+#define INC_ESTIMATE_H_
+
+#include <stdint.h>
+#include "companion.h"
+
+/*
+ * Height and speed between companion frames. Each frame is stamped
+ * with when it arrived, in microseconds, and carried forward at its
+ * acceleration (or the local IMU's, when that's fresh) to whenever the
+ * control loop asks. A new frame doesn't jump the height: the gap
+ * between where the old one had got to and the new one fades out over
+ * blend_us instead. Speed is taken as it comes; the TeleMega's is
+ * already filtered, and a gap there is a change in acceleration the
+ * old frame couldn't know about.
+ */
+struct estimate_config {
+	uint32_t	latency_us;		/* TeleMega sample to frame arriving */
+	uint32_t	max_us;			/* never carried further than this past a frame */
+	uint32_t	blend_us;		/* a new frame's correction is taken over this */
+	float		snap;			/* m, corrections bigger than this are taken at once */
+};
+
+#define ESTIMATE_CONFIG_DEFAULT {		\
+	.latency_us = 0,					\
+	.max_us = 50000,					\
+	.blend_us = 20000,					\
+	.snap = 20.0f,						\
+}
+
+struct estimate {
+	struct estimate_config	cfg;
+	uint8_t					valid;
+	uint16_t				tick;		/* TeleMega's, of the last frame */
+	uint32_t				frame_us;	/* when it arrived */
+	uint32_t				base_us;	/* the track below is at this time */
+	float					height;		/* m */
+	float					speed;		/* m/s */
+	float					accel;		/* m/s^2 */
+	float					offset;		/* m, what's left of the last correction */
+	uint32_t				frames;
+	uint32_t				snaps;
+};
+
+void estimate_Init(struct estimate *e, const struct estimate_config *cfg);
+void estimate_Frame(struct estimate *e, const struct companion_state *s, uint32_t stamp);
+void estimate_Accel(struct estimate *e, float accel, uint32_t now);
+int estimate_Step(struct estimate *e, struct companion_state *s, uint32_t now);
+
+#endif /* INC_ESTIMATE_H_ */
@@ -0,0 +1,57 @@
+/*
+ * fat.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_FAT_H_
+#define INC_FAT_H_
+
+#include <stdint.h>
+
+/*
+ * Just enough FAT16/FAT32 to leave a log file on a card that any
+ * computer can read, along the lines of altos/src/drivers/ao_fat.c:
+ * the first partition (or an unpartitioned card), 512 byte sectors,
+ * 8.3 names in the root directory. Files are created at their full
+ * size in one contiguous run of clusters, so after fat_Create() the
+ * data can go straight to sectors lba on with no further FAT updates.
+ */
+#define FAT_SECTOR_SIZE		512
+#define FAT_DIRENT_SIZE		32
+#define FAT_NONE			0xffffffff
+
+#define FAT_OK				0
+#define FAT_IO				-1		/* read or write failed */
+#define FAT_NOFS			-2		/* no FAT16/FAT32 filesystem found */
+#define FAT_FULL			-3		/* no run of free clusters that long */
+#define FAT_DIR_FULL		-4		/* no free root directory entry */
+#define FAT_EXISTS			-5
+
+struct fat {
+	int			(*read)(uint32_t lba, uint8_t *data);
+	int			(*write)(uint32_t lba, const uint8_t *data);
+	uint8_t		fat32;
+	uint8_t		number_fat;
+	uint8_t		sectors_per_cluster;
+	uint32_t	fat_start;			/* first FAT */
+	uint32_t	sectors_per_fat;
+	uint32_t	root_start;			/* FAT16 root directory */
+	uint32_t	root_entries;
+	uint32_t	root_cluster;		/* FAT32 root directory */
+	uint32_t	data_start;			/* cluster 2 */
+	uint32_t	clusters;			/* data clusters */
+	uint32_t	fsinfo;				/* FAT32 FSInfo sector, 0 if none */
+	uint32_t	cached;				/* sector in buf, FAT_NONE for nothing */
+	uint8_t		buf[FAT_SECTOR_SIZE];
+};
+
+/* fat.c */
+int fat_Mount(struct fat *f, int (*read)(uint32_t lba, uint8_t *data),
+		int (*write)(uint32_t lba, const uint8_t *data));
+int fat_Create(struct fat *f, const char name[11], uint32_t size, uint32_t *lba);
+int fat_NextNumber(struct fat *f, const char prefix[4], const char ext[3]);
+void fat_Name(char name[11], const char prefix[4], const char ext[3], int number);
+
+#endif /* INC_FAT_H_ */
@@ -0,0 +1,92 @@
+/*
+ * fault.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_FAULT_H_
+#define INC_FAULT_H_
+
+#include <stdint.h>
+#include "profile.h"
+
+/*
+ * What a fault handler leaves in the fault sector of the W25Q on its
+ * way to a reset: up to FAULT_SLOTS records, first come first kept,
+ * until the host reads them off and erases the sector. All fields
+ * little endian; an empty slot is all 0xff.
+ *
+ *	  0	magic			FAULT_MAGIC
+ *	  4	version			FAULT_VERSION
+ *	  5	type			exception number, FAULT_x
+ *	  6	stack_words		valid words in stack
+ *	  7	trace_count		valid events in trace
+ *	  8	tick			HAL_GetTick(), ms
+ *	 12	frame			r0 r1 r2 r3 r12 lr pc xpsr as stacked
+ *	 44	exc_return		lr on entry to the handler
+ *	 48	sp				where the frame was stacked
+ *	 52	cfsr
+ *	 56	hfsr
+ *	 60	mmfar
+ *	 64	bfar
+ *	 68	cycles			DWT->CYCCNT at the fault
+ *	 72	trace_head		probe events ever traced
+ *	 76	stack			FAULT_STACK words from just past the frame
+ *	204	trace			FAULT_TRACE profile_events, oldest first
+ *	460	reserved
+ *	508	crc32			of bytes 0 to 507
+ */
+#define FAULT_RECORD_SIZE	512
+#define FAULT_SLOTS			8		/* to a 4K sector */
+#define FAULT_MAGIC			0x544C5546	/* "FULT" */
+#define FAULT_VERSION		1
+#define FAULT_FRAME			8
+#define FAULT_STACK			32
+#define FAULT_TRACE			PROFILE_TRACE
+
+/* Stacked frame */
+#define FAULT_R0			0
+#define FAULT_R12			4
+#define FAULT_LR			5
+#define FAULT_PC			6
+#define FAULT_XPSR			7
+
+/* Exception numbers */
+#define FAULT_NMI			2
+#define FAULT_HARD			3
+#define FAULT_MEMMANAGE		4
+#define FAULT_BUS			5
+#define FAULT_USAGE			6
+
+#define FAULT_EMPTY			1
+#define FAULT_BAD			(-1)
+
+struct fault {
+	uint8_t					type;
+	uint8_t					stack_words;
+	uint8_t					trace_count;
+	uint32_t				tick;
+	uint32_t				frame[FAULT_FRAME];
+	uint32_t				exc_return;
+	uint32_t				sp;
+	uint32_t				cfsr;
+	uint32_t				hfsr;
+	uint32_t				mmfar;
+	uint32_t				bfar;
+	uint32_t				cycles;
+	uint32_t				trace_head;
+	uint32_t				stack[FAULT_STACK];
+	struct profile_event	trace[FAULT_TRACE];
+};
+
+/* fault_flash.c */
+void fault_Start(void);
+
+/* fault.c */
+void fault_SetTrace(struct fault *f, const struct profile_event *trace, uint32_t head);
+void fault_Encode(uint8_t *rec, const struct fault *f);
+int fault_Decode(const uint8_t *rec, struct fault *f);
+const char *fault_Name(uint8_t type);
+
+#endif /* INC_FAULT_H_ */
@@ -8,24 +8,50 @@
 #ifndef INC_FLASH_H_
 #define INC_FLASH_H_
 
-#include "main.h"
+#include <stdint.h>
 
-uint8_t flash_readID(void);
+/* W25Q128JV */
+#define FLASH_SIZE			0x1000000
+#define FLASH_PAGE_SIZE		256
+#define FLASH_SECTOR_SIZE	4096
+#define FLASH_BLOCK_SIZE	65536
 
-void writeEnable(void);
+#define FLASH_LOOKUP_ADDR	0x000000
+#define FLASH_FAULT_ADDR	0x7EF000	/* one sector of fault records, fault.h */
+#define FLASH_STORAGE_ADDR	0x7F0000
 
-void writeDisable(void);
-
-uint8_t flashRead(uint8_t addr3, uint8_t addr2, uint8_t addr1);
+#define FLASH_SR1_BUSY		0x01
+#define FLASH_SR1_WEL		0x02
 
-void flashClearLookup(void);
+/* SPI2 SCK, as near as PCLK1 divides down to without going over */
+#define FLASH_SPI_HZ		12000000
 
-void flashClearStorage(void);
+/* Transfers shorter than this aren't worth setting up the DMA for */
+#define FLASH_DMA_MIN		16
 
-void flashClearAll(void);
+/* Writes waiting on the chip */
+#define FLASH_WRITE_QUEUE	8
 
+void flashInit(void);
+uint8_t W25Q_Spi(uint8_t Data);
+uint8_t flash_readID(void);
+void writeEnable(void);
+void writeDisable(void);
+uint8_t flashReadStatus(void);
+void flashWaitReady(void);
+int flashBusy(void);
+int flashReadStart(uint32_t addr, uint8_t *buf, uint32_t len, void (*done)(void));
+void flashReadBlock(uint32_t addr, uint8_t *buf, uint32_t len);
+uint8_t flashRead(uint8_t addr3, uint8_t addr2, uint8_t addr1);
+void flashErase(uint32_t addr, uint32_t len);
+int flashEraseStart(uint32_t addr);
+int flashEraseBusy(void);
 void flashWriteSingle(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data);
-
 void flashWriteArray(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data[], int dataSize);
+int flashWriteQueue(uint32_t addr, const uint8_t *data, uint32_t len, void (*done)(void));
+void flashWrite(uint32_t addr, const uint8_t *data, uint32_t len);
+void flashPoll(void);
+void flashSync(void);
+void flashDMADone(void);
 
 #endif /* INC_FLASH_H_ */
@@ -0,0 +1,43 @@
+/*
+ * frame.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_FRAME_H_
+#define INC_FRAME_H_
+
+#include <stdint.h>
+
+/*
+ * Binary frames over the USB CDC link, both directions:
+ *
+ *	sync0 sync1 type len_lo len_hi payload[len] crc_lo crc_hi
+ *
+ * The CRC is crc16() over type, len and payload.
+ */
+#define FRAME_SYNC0			0xA5
+#define FRAME_SYNC1			0x5A
+#define FRAME_HEADER_SIZE	5
+#define FRAME_CRC_SIZE		2
+#define FRAME_OVERHEAD		(FRAME_HEADER_SIZE + FRAME_CRC_SIZE)
+#define FRAME_MAX_PAYLOAD	512
+#define FRAME_MAX			(FRAME_OVERHEAD + FRAME_MAX_PAYLOAD)
+
+struct frame_rx {
+	uint8_t		state;
+	uint8_t		type;
+	uint16_t	len;
+	uint16_t	pos;
+	uint16_t	crc;
+	uint32_t	frames;
+	uint32_t	errors;
+	uint8_t		payload[FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE];
+};
+
+uint16_t frame_Encode(uint8_t *out, uint8_t type, const uint8_t *payload, uint16_t len);
+void frame_Reset(struct frame_rx *rx);
+int frame_Input(struct frame_rx *rx, uint8_t c);
+
+#endif /* INC_FRAME_H_ */
@@ -0,0 +1,60 @@
+/*
+ * governor.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_GOVERNOR_H_
+#define INC_GOVERNOR_H_
+
+#include <stdint.h>
+
+#define GOVERNOR_PAD		0	/* 48 MHz, scale 3: an hour on the pad */
+#define GOVERNOR_COAST		1	/* 180 MHz, scale 1 with over-drive: the predictor */
+#define GOVERNOR_PROFILES	2
+
+#define GOVERNOR_HSE_HZ		16000000
+#define GOVERNOR_HOLD_MS	2000	/* wanted this long before slowing down */
+
+/*
+ * One way of running the clock tree off the 16 MHz crystal. APB1 is
+ * always divided, so its timers see twice PCLK1 as they always have.
+ */
+struct governor_profile {
+	uint32_t	hz;			/* SYSCLK = HCLK */
+	uint16_t	pll_n;		/* VCO = 2 MHz * n */
+	uint8_t		pll_p;		/* SYSCLK = VCO / p */
+	uint8_t		pll_q;		/* unused, USB runs off PLLSAI */
+	uint8_t		apb1_div;
+	uint8_t		apb2_div;
+	uint8_t		scale;		/* regulator voltage scale, 1 to 3 */
+	uint8_t		overdrive;
+	uint8_t		latency;	/* flash wait states at 3.3 V */
+};
+
+extern const struct governor_profile governor_profiles[GOVERNOR_PROFILES];
+
+struct governor {
+	uint8_t		profile;	/* running now */
+	uint8_t		want;
+	uint32_t	want_since;	/* ms */
+	uint32_t	switches;
+	uint32_t	deferred;	/* polls that wanted a switch with the buses busy */
+};
+
+/* governor_rcc.c */
+extern struct governor governor;
+
+void governor_Start(void);
+void governor_Poll(void);
+
+/* governor.c */
+void governor_Init(struct governor *g, uint8_t profile, uint32_t now);
+int governor_Want(uint8_t flight_state);
+int governor_Step(struct governor *g, uint8_t flight_state, uint32_t now);
+uint32_t governor_TimerHz(uint32_t hclk, uint8_t apb_div);
+uint32_t governor_SpiDivider(uint32_t pclk, uint32_t max_hz);
+void governor_Period(uint32_t timer_hz, uint32_t hz, uint32_t *psc, uint32_t *arr);
+
+#endif /* INC_GOVERNOR_H_ */
@@ -0,0 +1,61 @@
+/*
+ * home.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_HOME_H_
+#define INC_HOME_H_
+
+#include <stdint.h>
+#include "motion.h"
+
+/*
+ * Homing drives the brakes into the retracted hard stop from wherever
+ * they are, so the seek has to cover more than the full travel and be
+ * slow enough that the motor just slips once it gets there.
+ */
+struct home_config {
+	int32_t		seek_steps;		/* toward retracted, more than full travel */
+	int32_t		backoff;		/* steps from the stop to position 0 */
+	float		seek_speed;		/* steps/s */
+	float		seek_accel;		/* steps/s^2 */
+	int32_t		tolerance;		/* index error taken as lost steps */
+};
+
+#define HOME_CONFIG_DEFAULT {			\
+	.seek_steps = 2500,					\
+	.backoff = 20,						\
+	.seek_speed = 800.0f,				\
+	.seek_accel = 4000.0f,				\
+	.tolerance = 4,						\
+}
+
+#define HOME_IDLE		0	/* never homed: the count means nothing */
+#define HOME_SEEK		1	/* running into the stop */
+#define HOME_BACKOFF	2	/* stop found, easing off it to 0 */
+#define HOME_DONE		3
+
+struct home {
+	struct home_config	cfg;
+	uint8_t				state;
+	float				vmax2;		/* planner limits to put back afterwards */
+	float				accel2;
+
+	/* Index sensor, if there is one. Where its edge fell each way once homed */
+	int32_t				index[2];	/* [0] retracting, [1] extending */
+	uint8_t				learned;	/* bit per direction */
+	uint32_t			edges;
+	uint32_t			slips;		/* edges off by more than tolerance */
+	int32_t				error_last;	/* steps, counted - true */
+	int32_t				error_max;	/* largest |error| */
+};
+
+/* home.c */
+void home_Init(struct home *h, const struct home_config *cfg);
+void home_Start(struct home *h, struct motion *m);
+int home_Poll(struct home *h, struct motion *m);
+int32_t home_Edge(struct home *h, int32_t position, int dir);
+
+#endif /* INC_HOME_H_ */
@@ -0,0 +1,99 @@
+/*
+ * lut.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_LUT_H_
+#define INC_LUT_H_
+
+#include <stdint.h>
+
+/*
+ * Drag lookup table as stored on the flash at FLASH_LOOKUP_ADDR. All
+ * fields little endian. Cells are int16 in rows along the y axis,
+ * each row holding nx cells along x; a cell is value * 2^frac_bits.
+ * Axes are in whatever integer units the caller looks up with, for
+ * the airbrake x is speed (1/16 m/s) and y is height (m).
+ *
+ *	 0	magic		"ALUT"
+ *	 4	version		LUT_VERSION
+ *	 6	header_size	LUT_HEADER_SIZE
+ *	 8	x0, dx		first x and spacing
+ *	16	nx, ny		cells along each axis
+ *	20	y0, dy
+ *	28	row_stride	bytes from one row to the next
+ *	32	data_offset	first row, from the start of the header
+ *	36	cell_size	2
+ *	37	frac_bits
+ *	38	reserved
+ *	40	data_size	ny * row_stride
+ *	44	crc32		of the data_size bytes of cells
+ */
+#define LUT_MAGIC		0x54554C41	/* "ALUT" */
+#define LUT_VERSION		1
+#define LUT_HEADER_SIZE	48
+
+/* Two of these in RAM; a window holds as many whole rows as fit */
+#define LUT_WINDOW_BYTES	4096
+
+struct lut_header {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	header_size;
+	int32_t		x0, dx;
+	uint16_t	nx, ny;
+	int32_t		y0, dy;
+	uint32_t	row_stride;
+	uint32_t	data_offset;
+	uint8_t		cell_size;
+	uint8_t		frac_bits;
+	uint32_t	data_size;
+	uint32_t	crc32;
+};
+
+/*
+ * Rows around the current flight state live in one of two RAM
+ * windows. Lookups only ever touch the active window and ask for the
+ * other one to be refilled as they near its edge; lut_Poll() starts
+ * that read from the main loop and lut_FetchDone() swaps it in.
+ * lut_Open() reads the whole table through once first, synchronously,
+ * and won't use one whose cells don't match the header's crc32.
+ */
+struct lut {
+	struct lut_header	h;
+	uint32_t			addr;			/* flash address of the header */
+	uint16_t			rows;			/* rows per window */
+	uint8_t				win[2][LUT_WINDOW_BYTES] __attribute__((aligned(4)));
+	volatile int32_t	win_base[2];	/* first row, -1 when empty */
+	volatile uint8_t	active;
+	volatile uint8_t	fetching;
+	volatile int32_t	want;			/* first row to fetch, -1 for none */
+	int32_t				fetch_base;		/* first row of the read in flight */
+	volatile uint32_t	lookups;
+	volatile uint32_t	misses;
+	volatile uint32_t	fetches;
+	int					(*fetch)(uint32_t addr, uint8_t *buf, uint32_t len);
+};
+
+/* Lookup results */
+#define LUT_HIT			0
+#define LUT_APPROX		1	/* row outside the window, nearest cached rows used */
+#define LUT_NONE		(-1)
+
+extern struct lut lut;
+
+void lut_Start(void);
+int lut_FlashOpen(struct lut *l);
+
+int lut_ParseHeader(struct lut_header *h, const uint8_t *buf, uint32_t len);
+int lut_Open(struct lut *l, const uint8_t *header, uint32_t len, uint32_t addr,
+		int (*read)(uint32_t addr, uint8_t *buf, uint32_t len),
+		int (*fetch)(uint32_t addr, uint8_t *buf, uint32_t len));
+int lut_Lookup(struct lut *l, int32_t x, int32_t y, int32_t *value);
+int lut_Peek(struct lut *l, int32_t x, int32_t y, int32_t *value);
+void lut_Poll(struct lut *l);
+void lut_FetchDone(struct lut *l);
+
+#endif /* INC_LUT_H_ */
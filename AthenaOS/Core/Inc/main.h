@@ -104,7 +104,6 @@ void Error_Handler(void);
 #define Extra_SDA_Pin GPIO_PIN_7
 #define Extra_SDA_GPIO_Port GPIOB
 /* USER CODE BEGIN Private defines */
-void delay (uint16_t us);
 
 /* USER CODE END Private defines */
 
@@ -0,0 +1,66 @@
+/*
+ * monitor.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_MONITOR_H_
+#define INC_MONITOR_H_
+
+#include <stdint.h>
+
+/* ADC1 scan order */
+enum monitor_channel {
+	MONITOR_BATTERY,		/* ADC_Batt (PA1), through a 1:2 divider */
+	MONITOR_TEMP,			/* internal sensor */
+	MONITOR_VREF,			/* VREFINT, gives us VDDA */
+	MONITOR_CHANNELS
+};
+
+#define MONITOR_SCAN_HZ		2000	/* TIM8 triggers a scan of all channels */
+#define MONITOR_BLOCK		32		/* scans averaged per reading, half the DMA buffer */
+#define MONITOR_OVERSAMPLE	16		/* averages keep 4 extra bits */
+
+#define MONITOR_VDDA_CAL	3300	/* factory calibration is taken at VDDA = 3.3 V */
+#define MONITOR_DIVIDER		2
+
+/* Single cell LiPo (the divider tops out at 6.6 V): 3.3 V under load is empty */
+#define MONITOR_BROWNOUT_MV	3300
+#define MONITOR_HYSTERESIS	100
+
+/* Factory calibration from system memory, raw counts */
+struct monitor_cal {
+	uint16_t	vrefint;	/* VREFINT at 30 C */
+	uint16_t	ts30;		/* temperature sensor at 30 C */
+	uint16_t	ts110;		/* and at 110 C */
+};
+
+/*
+ * Everything is worked out in the DMA interrupt once per block, so a
+ * reading is a single aligned load from anywhere.
+ */
+struct monitor {
+	struct monitor_cal	cal;
+	volatile uint16_t	avg[MONITOR_CHANNELS];	/* counts * MONITOR_OVERSAMPLE */
+	volatile uint32_t	vdda_mv;
+	volatile uint32_t	battery_mv;
+	volatile uint32_t	battery_min_mv;
+	volatile int32_t	temp;					/* tenths of a degree C */
+	volatile uint8_t	low;					/* battery below MONITOR_BROWNOUT_MV */
+	volatile uint32_t	brownouts;				/* times it went low */
+	volatile uint32_t	blocks;
+	volatile uint32_t	overruns;				/* ADC restarts */
+};
+
+/* monitor_adc.c */
+extern struct monitor monitor;
+
+void monitor_Start(void);
+void monitor_Poll(void);
+
+/* monitor.c */
+void monitor_Init(struct monitor *m, const struct monitor_cal *cal);
+void monitor_Block(struct monitor *m, const uint16_t *samples, uint32_t scans);
+
+#endif /* INC_MONITOR_H_ */
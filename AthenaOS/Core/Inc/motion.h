@@ -0,0 +1,44 @@
+/*
+ * motion.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_MOTION_H_
+#define INC_MOTION_H_
+
+#include <stdint.h>
+
+#define MOTION_QUEUE	8
+
+/*
+ * Trapezoidal step planner. Works one step at a time so the target can
+ * move under it: each call picks the fastest speed from which we can
+ * still stop on the target and returns how long the step takes.
+ */
+struct motion {
+	volatile int32_t	position;	/* steps, committed to the timer */
+	volatile int32_t	target;
+	int32_t				queue[MOTION_QUEUE];
+	volatile uint8_t	queue_head;
+	volatile uint8_t	queue_count;
+	int8_t				dir;		/* direction of travel, 0 at rest */
+	float				v2;			/* (steps/s)^2 at position */
+	float				accel2;		/* 2 * acceleration, steps/s^2 */
+	float				vmax2;		/* (steps/s)^2 */
+	float				frac;		/* tick fraction carried to the next step */
+	float				tick_hz;	/* step timer clock */
+	uint32_t			max_ticks;	/* longest interval the timer can count */
+};
+
+void motion_Init(struct motion *m, float tick_hz, uint32_t max_ticks, float max_speed, float accel);
+void motion_SetLimits(struct motion *m, float max_speed, float accel);
+void motion_Retarget(struct motion *m, int32_t target);
+int motion_Queue(struct motion *m, int32_t target);
+void motion_SetPosition(struct motion *m, int32_t position);
+void motion_Shift(struct motion *m, int32_t delta);
+int motion_Next(struct motion *m, uint32_t *ticks);
+int motion_Busy(const struct motion *m);
+
+#endif /* INC_MOTION_H_ */
@@ -0,0 +1,36 @@
+/*
+ * predict.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_PREDICT_H_
+#define INC_PREDICT_H_
+
+#include <stdint.h>
+
+#define PREDICT_CLOSED		0	/* one shot closed form, k held constant */
+#define PREDICT_RK2			1	/* midpoint */
+#define PREDICT_RK4			2
+
+#define PREDICT_MAX_STEPS	256
+
+#define PREDICT_G			9.80665f
+#define PREDICT_H_RHO		8500.0f		/* density scale height, m */
+
+/* What the rocket looks like in coast */
+struct predict_model {
+	float	mass;			/* kg */
+	float	area;			/* reference area, m^2 */
+	float	brake_cda;		/* extra Cd * area with the brakes all the way out, m^2 */
+	float	rho0;			/* air density at the pad, kg/m^3 */
+	float	(*cd)(void *arg, float speed, float height);
+	void	*arg;
+};
+
+float predict_Apogee(const struct predict_model *m, uint8_t method, float dt,
+		float height, float speed, float extension);
+float predict_Closed(const struct predict_model *m, float height, float speed, float extension);
+
+#endif /* INC_PREDICT_H_ */
@@ -0,0 +1,99 @@
+/*
+ * profile.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_PROFILE_H_
+#define INC_PROFILE_H_
+
+#include <stdint.h>
+
+#define PROFILE_BINS		32		/* bin n counts times of 2^(n-1) to 2^n - 1 cycles */
+#define PROFILE_NAME		12
+#define PROFILE_RESET		0x01	/* UPLOAD_PROFILE flag: start the probe over after reading it */
+#define PROFILE_TRACE		32		/* latest probe events kept, power of two */
+
+/* Payload of an UPLOAD_PROFILE reply after the status byte */
+#define PROFILE_SIZE		(1 + 4 + PROFILE_NAME + 4 * 3 + 8 + 4 * PROFILE_BINS)
+
+enum profile_id {
+	PROFILE_CONTROL,		/* whole control tick */
+	PROFILE_LUT,			/* Cd lookup at the current state */
+	PROFILE_PREDICT,		/* apogee prediction */
+	PROFILE_LATENCY,		/* companion frame in to stepper retarget */
+	PROFILE_COMPANION,		/* frame decode on Altus_CS */
+	PROFILE_STEPPER,		/* step interrupt */
+	PROFILE_MONITOR,		/* ADC block */
+	PROFILE_PROBES
+};
+
+/*
+ * One writer per probe: every probe is only ever added to from one
+ * interrupt. A reset is a request the writer carries out on its next
+ * add, so the main loop never races it.
+ */
+struct profile_probe {
+	uint32_t			count;
+	uint32_t			min;
+	uint32_t			max;
+	uint64_t			sum;
+	uint32_t			hist[PROFILE_BINS];
+	volatile uint8_t	reset;
+};
+
+/* One probe event, for seeing what ran just before a fault */
+struct profile_event {
+	uint32_t	at;			/* cycle counter when it ended */
+	uint32_t	cycles;		/* probe id in the top 8 bits, cycles (saturated) below */
+};
+
+#define PROFILE_EVENT_ID(e)		((e)->cycles >> 24)
+#define PROFILE_EVENT_CYCLES(e)	((e)->cycles & 0xffffff)
+
+/*
+ * The trace is shared by every probe, so its slots are claimed with an
+ * atomic add; trace_head counts every event ever traced.
+ */
+struct profile {
+	struct profile_probe	probe[PROFILE_PROBES];
+	struct profile_event	trace[PROFILE_TRACE];
+	volatile uint32_t		trace_head;
+};
+
+extern const char profile_names[PROFILE_PROBES][PROFILE_NAME];
+
+/*
+ * Probe points. On the target they read the DWT cycle counter; in the
+ * host builds of the core code they go away.
+ */
+#ifdef STM32F446xx
+#include "stm32f4xx.h"
+
+#define PROFILE_BEGIN(t)	uint32_t t = DWT->CYCCNT
+#define PROFILE_END(id, t)	do {									\
+		uint32_t t##_end = DWT->CYCCNT;								\
+		profile_Add(&profile.probe[id], t##_end - (t));				\
+		profile_Trace(&profile, id, t##_end, t##_end - (t));		\
+	} while (0)
+#else
+#define PROFILE_BEGIN(t)
+#define PROFILE_END(id, t)
+#endif
+
+/* profile_dwt.c */
+extern struct profile profile;
+
+void profile_Start(void);
+
+/* profile.c */
+void profile_Init(struct profile *p);
+void profile_Add(struct profile_probe *p, uint32_t cycles);
+void profile_Trace(struct profile *p, uint8_t id, uint32_t at, uint32_t cycles);
+void profile_Read(const struct profile_probe *p, struct profile_probe *copy);
+uint16_t profile_Encode(uint8_t *out, uint8_t id, uint32_t hz, const struct profile_probe *p);
+int profile_Decode(const uint8_t *in, uint16_t len, uint8_t *id, uint32_t *hz, char *name,
+		struct profile_probe *p);
+
+#endif /* INC_PROFILE_H_ */
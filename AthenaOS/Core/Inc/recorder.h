@@ -0,0 +1,214 @@
+/*
+ * recorder.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_RECORDER_H_
+#define INC_RECORDER_H_
+
+#include <stdint.h>
+
+/*
+ * Flight log in the storage region of the W25Q. Fixed size records,
+ * RECORDER_PER_PAGE to a flash page and never split across pages, so
+ * a torn page write loses at most that page. All fields little endian.
+ * Like AltOS's ao_log records, the bytes of a good record sum to
+ * RECORDER_CHECKSUM; an erased record is all 0xff.
+ *
+ * Every record:
+ *	 0	type		RECORDER_x
+ *	 1	checksum
+ *	 2	type specific
+ *	 4	tick		HAL_GetTick(), ms
+ *
+ * RECORDER_BOOT, once per power up:
+ *	 2	version		RECORDER_VERSION
+ *	 3	method		predictor, PREDICT_x
+ *	 8	lut_crc		crc32 of the drag table cells, 0 if none
+ *	12	target		apogee, m
+ *	14	brake_steps
+ *	16	kp			float
+ *	20	ki			float
+ *	24	dt			predictor step, ms
+ *	26	reserved
+ *
+ * RECORDER_CONTROL, every control tick in flight:
+ *	 2	flight_state	TeleMega's
+ *	 3	mode			CONTROL_x
+ *	 8	companion_tick	TeleMega ao_time()
+ *	10	height			m
+ *	12	speed			m/s * 16
+ *	14	accel			m/s^2 * 16
+ *	16	cd				* 10000
+ *	18	predicted		apogee, m
+ *	20	commanded		stepper steps
+ *	22	position		stepper steps
+ *	24	exec			control tick before this one, us
+ *	26	period			between the last two ticks, us
+ *	28	overruns
+ *	30	drops			records the ring had no room for
+ *
+ * RECORDER_FRAME, each companion frame the control tick sees, SD only:
+ *	 2	reserved
+ *	 4	tick			rx_tick, when the frame landed
+ *	 8	command			struct ao_companion_command as sent, 16 bytes
+ *	24	frames			accepted so far, gaps are frames missed
+ *	28	errors			transactions rejected so far
+ *	30	reserved
+ *
+ * RECORDER_HIL, every control tick while frames come over USB, telemetry only:
+ *	 2	mode			CONTROL_x
+ *	 3	flags			RECORDER_HIL_x
+ *	 8	companion_tick	of the frame behind it
+ *	10	height			m, as the controller saw it
+ *	12	speed			m/s * 16, likewise
+ *	14	commanded		stepper steps
+ *	16	frame_cycles	DWT when the frame was decoded
+ *	20	start_cycles	DWT at the start of the tick
+ *	24	done_cycles		DWT once the stepper was retargeted
+ *	28	position		stepper steps
+ *	30	mhz				core clock the cycles count
+ *	31	reserved
+ *
+ * RECORDER_BLOCK, first record of every SD block (sdlog.h):
+ *	 2	version			RECORDER_VERSION
+ *	 3	reserved
+ *	 4	tick			of the first record in the block
+ *	 8	session			different every boot
+ *	12	seq				block number in the file, from 0
+ *	16	drops			records the ring had no room for
+ *	20	reserved
+ */
+#define RECORDER_RECORD_SIZE	32
+#define RECORDER_PAGE_SIZE		256
+#define RECORDER_PER_PAGE		(RECORDER_PAGE_SIZE / RECORDER_RECORD_SIZE)
+#define RECORDER_PAGES			8		/* RAM ring, 2 KB */
+#define RECORDER_SECTOR_SIZE	4096	/* flash erase unit */
+#define RECORDER_COMMAND_SIZE	16		/* COMPANION_COMMAND_SIZE */
+
+#define RECORDER_VERSION		1
+#define RECORDER_CHECKSUM		0x5a
+
+#define RECORDER_BOOT			'B'
+#define RECORDER_CONTROL		'C'
+#define RECORDER_FRAME			'F'
+#define RECORDER_BLOCK			'S'
+#define RECORDER_HIL			'H'
+#define RECORDER_EMPTY			0xff
+#define RECORDER_BAD			-1
+
+struct recorder_boot {
+	uint32_t	tick;
+	uint8_t		method;
+	uint32_t	lut_crc;
+	int16_t		target;
+	int16_t		brake_steps;
+	float		kp;
+	float		ki;
+	uint16_t	dt;
+};
+
+struct recorder_control {
+	uint32_t	tick;
+	uint8_t		flight_state;
+	uint8_t		mode;
+	uint16_t	companion_tick;
+	int16_t		height;
+	int16_t		speed;
+	int16_t		accel;
+	float		cd;
+	float		predicted;
+	int32_t		commanded;
+	int32_t		position;
+	uint32_t	exec;
+	uint32_t	period;
+	uint32_t	overruns;
+	uint32_t	drops;
+};
+
+struct recorder_frame {
+	uint32_t	tick;
+	uint8_t		command[RECORDER_COMMAND_SIZE];
+	uint32_t	frames;
+	uint32_t	errors;
+};
+
+#define RECORDER_HIL_FRAME		0x01	/* first tick on a new frame */
+#define RECORDER_HIL_LOCAL		0x02	/* on Athena's own sensors */
+
+struct recorder_hil {
+	uint32_t	tick;
+	uint8_t		mode;
+	uint8_t		flags;
+	uint16_t	companion_tick;
+	int16_t		height;
+	int16_t		speed;
+	int32_t		commanded;
+	int32_t		position;
+	uint32_t	frame_cycles;
+	uint32_t	start_cycles;
+	uint32_t	done_cycles;
+	uint8_t		mhz;
+};
+
+struct recorder_block {
+	uint32_t	tick;
+	uint32_t	session;
+	uint32_t	seq;
+	uint32_t	drops;
+};
+
+/*
+ * Records are staged by one context (the control interrupt) into RAM
+ * pages; recorder_Poll() hands each page to write() as it fills, from
+ * the main loop, and recorder_WriteDone() frees it once the page has
+ * left RAM. Nothing on the producer side ever waits: with every page
+ * full the record is dropped and counted.
+ */
+struct recorder {
+	uint8_t				page[RECORDER_PAGES][RECORDER_PAGE_SIZE];
+	volatile uint8_t	head;		/* page being filled */
+	uint8_t				fill;		/* records in it */
+	volatile uint8_t	tail;		/* oldest full page */
+	volatile uint8_t	writing;
+	uint32_t			addr;		/* where the tail page goes */
+	uint32_t			end;
+	volatile uint32_t	drops;
+	uint32_t			records;	/* staged */
+	uint32_t			pages;		/* written */
+	uint32_t			lost;		/* with nowhere left to write them */
+	int					(*write)(uint32_t addr, const uint8_t *data, uint32_t len);
+};
+
+/* recorder_flash.c */
+extern struct recorder recorder;
+
+void recorder_Start(void);
+void recorder_Erase(uint32_t addr);
+void recorder_Boot(uint8_t *rec);
+
+/* recorder.c */
+void recorder_Init(struct recorder *r, uint32_t addr, uint32_t end,
+		int (*write)(uint32_t addr, const uint8_t *data, uint32_t len));
+int recorder_Add(struct recorder *r, const uint8_t *rec);
+void recorder_Pad(struct recorder *r);
+void recorder_Poll(struct recorder *r);
+void recorder_WriteDone(struct recorder *r);
+uint32_t recorder_FindEnd(uint32_t start, uint32_t end,
+		int (*read)(uint32_t addr, uint8_t *data, uint32_t len));
+
+int recorder_Check(const uint8_t *rec);
+void recorder_EncodeBoot(uint8_t *rec, const struct recorder_boot *b);
+void recorder_DecodeBoot(const uint8_t *rec, struct recorder_boot *b);
+void recorder_EncodeControl(uint8_t *rec, const struct recorder_control *c);
+void recorder_DecodeControl(const uint8_t *rec, struct recorder_control *c);
+void recorder_EncodeFrame(uint8_t *rec, const struct recorder_frame *f);
+void recorder_DecodeFrame(const uint8_t *rec, struct recorder_frame *f);
+void recorder_EncodeHil(uint8_t *rec, const struct recorder_hil *h);
+void recorder_DecodeHil(const uint8_t *rec, struct recorder_hil *h);
+void recorder_EncodeBlock(uint8_t *rec, const struct recorder_block *b);
+void recorder_DecodeBlock(const uint8_t *rec, struct recorder_block *b);
+
+#endif /* INC_RECORDER_H_ */
@@ -0,0 +1,44 @@
+/*
+ * sd.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_SD_H_
+#define INC_SD_H_
+
+#include <stdint.h>
+
+/*
+ * microSD card on SPI3, SD_CS on PD2. The board routes the socket to
+ * SPI rather than SDIO, so this is the card's SPI mode: as near 25 MHz
+ * as PCLK1 divides down to once it is up, one bit wide.
+ */
+#define SD_BLOCK_SIZE		512
+#define SD_SPI_HZ			25000000	/* SPI mode's limit */
+
+#define SD_INIT_TIMEOUT		1000	/* ms for ACMD41 to bring the card up */
+#define SD_READ_TIMEOUT		100		/* ms for a read's data token */
+#define SD_WRITE_TIMEOUT	500		/* ms busy after a block, SDXC's limit */
+
+struct sd_card {
+	uint8_t				ready;		/* up and at full speed */
+	uint8_t				sdhc;		/* block rather than byte addressed */
+	volatile uint32_t	errors;		/* blocks the card turned down */
+	uint32_t			busy_max;	/* longest it took over a block, ms */
+};
+
+/* sd_spi.c */
+extern struct sd_card sd;
+
+int sd_Init(void);
+int sd_ReadBlock(uint32_t lba, uint8_t *data);
+int sd_WriteBlock(uint32_t lba, const uint8_t *data);
+int sd_WriteStart(uint32_t lba, const uint8_t *data, uint32_t count, void (*done)(void));
+void sd_Poll(void);
+int sd_Busy(void);
+void sd_Close(void);
+void sd_DMADone(void);
+
+#endif /* INC_SD_H_ */
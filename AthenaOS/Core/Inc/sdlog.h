@@ -0,0 +1,70 @@
+/*
+ * sdlog.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_SDLOG_H_
+#define INC_SDLOG_H_
+
+#include <stdint.h>
+#include "recorder.h"
+
+/*
+ * Log on the microSD card: the same records as the flash log, 512
+ * byte blocks of them written straight into a file that fat_Create()
+ * laid out at boot, one block after another. A new file every boot,
+ * ATHNnnnn.LOG, at its full size, so past the end of the log is
+ * whatever the card held before. Each block starts with a
+ * RECORDER_BLOCK record carrying the boot's session and the block's
+ * number in the file; the log ends at the first block that doesn't
+ * carry the next one.
+ */
+#define SDLOG_BLOCK_SIZE	512
+#define SDLOG_PER_BLOCK		(SDLOG_BLOCK_SIZE / RECORDER_RECORD_SIZE)
+#define SDLOG_BLOCKS		16		/* RAM ring, 8 KB, over a second of logging */
+#define SDLOG_FILE_SIZE		(256ul << 20)	/* hours of pad and flight */
+
+#define SDLOG_PREFIX		"ATHN"
+#define SDLOG_EXT			"LOG"
+
+/*
+ * Same shape as struct recorder: the control interrupt stages records,
+ * sdlog_Poll() hands every full block it can to write() in one go from
+ * the main loop, and sdlog_WriteDone() frees them one at a time as the
+ * card takes them. The file being contiguous is what lets write() keep
+ * a single multi-block write running for the whole flight.
+ */
+struct sdlog {
+	uint8_t				block[SDLOG_BLOCKS][SDLOG_BLOCK_SIZE];
+	volatile uint8_t	head;		/* block being filled */
+	uint8_t				fill;		/* records in it, header included */
+	volatile uint8_t	tail;		/* oldest full block */
+	volatile uint8_t	writing;	/* blocks handed to write() and not done */
+	uint32_t			lba;		/* where the next block handed out goes */
+	uint32_t			end;
+	uint32_t			session;
+	uint32_t			seq;		/* of the head block */
+	volatile uint32_t	drops;
+	uint32_t			records;	/* staged */
+	uint32_t			blocks;		/* written */
+	uint32_t			lost;		/* with nowhere left to write them */
+	int					(*write)(uint32_t lba, const uint8_t *data, uint32_t count);
+};
+
+/* sdlog_sd.c */
+extern struct sdlog sdlog;
+
+void sdlog_Start(void);
+
+/* sdlog.c */
+void sdlog_Init(struct sdlog *s, uint32_t lba, uint32_t end, uint32_t session,
+		int (*write)(uint32_t lba, const uint8_t *data, uint32_t count));
+int sdlog_Add(struct sdlog *s, const uint8_t *rec);
+void sdlog_Pad(struct sdlog *s);
+void sdlog_Poll(struct sdlog *s);
+void sdlog_WriteDone(struct sdlog *s);
+int sdlog_Check(const uint8_t *block, uint32_t *session, uint32_t seq);
+
+#endif /* INC_SDLOG_H_ */
@@ -0,0 +1,175 @@
+/*
+ * sensor.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_SENSOR_H_
+#define INC_SENSOR_H_
+
+#include <stdint.h>
+#include "companion.h"
+
+/*
+ * Athena's own barometer and IMU on I2C1 (PB6/PB7): an MS5607, same
+ * as the TeleMega's, and an InvenSense MPU-6050 class IMU. Neither
+ * needs the TeleMega, so the brakes still have height and speed if
+ * the companion link goes quiet.
+ */
+#define SENSOR_I2C_HZ		400000	/* fast mode, I2C1's limit */
+#define SENSOR_READ_MAX		14		/* longest burst: the IMU's accel, temp and gyro */
+#define SENSOR_TIMEOUT_MS	5		/* a transaction this old has hung the bus */
+#define SENSOR_RETRY_MS		500		/* between attempts to bring a part back */
+#define SENSOR_FRESH_MS		50		/* a sample this old no longer counts */
+
+/* MS5607 */
+#define SENSOR_BARO_ADDR	0x77	/* CSB low */
+#define SENSOR_BARO_RESET	0x1E
+#define SENSOR_BARO_D1		0x46	/* pressure, OSR 2048 */
+#define SENSOR_BARO_D2		0x56	/* temperature, OSR 2048 */
+#define SENSOR_BARO_ADC		0x00
+#define SENSOR_BARO_PROM	0xA0	/* eight words, the last with the CRC */
+#define SENSOR_BARO_WAIT_MS	6		/* OSR 2048 takes 4.54 ms; ticks are up to 1 ms short */
+
+/* MPU-6050 */
+#define SENSOR_IMU_ADDR		0x68	/* AD0 low */
+#define SENSOR_IMU_ID		0x68	/* WHO_AM_I */
+#define SENSOR_IMU_WHO_AM_I	0x75
+#define SENSOR_IMU_PWR_MGMT	0x6B
+#define SENSOR_IMU_DATA		0x3B	/* ACCEL_XOUT_H, 14 bytes big endian */
+#define SENSOR_IMU_LSB_G	2048	/* at +/-16 g */
+
+#define SENSOR_G			9.80665f
+
+struct sensor_config {
+	uint8_t		baro_addr;
+	uint8_t		imu_addr;
+	uint8_t		axis;			/* IMU axis along the airframe, 0 to 2 */
+	int8_t		sign;			/* 1 if it points at the nose, -1 at the motor */
+	uint16_t	imu_ms;			/* between IMU reads */
+	uint8_t		temp_every;		/* pressure conversions per temperature */
+	float		baro_height;	/* per second, how hard the baro pulls on height */
+	float		baro_speed;		/* and on speed */
+	float		baro_max_speed;	/* m/s, past this the baro is ignored (transonic) */
+	float		companion_height;	/* fraction of a companion frame's error taken */
+	float		companion_speed;
+	float		ground_rate;	/* fraction per sample the pad references follow */
+};
+
+#define SENSOR_CONFIG_DEFAULT {			\
+	.baro_addr = SENSOR_BARO_ADDR,		\
+	.imu_addr = SENSOR_IMU_ADDR,		\
+	.axis = 2,							\
+	.sign = 1,							\
+	.imu_ms = 2,						\
+	.temp_every = 16,					\
+	.baro_height = 2.8f,				\
+	.baro_speed = 4.0f,					\
+	.baro_max_speed = 200.0f,			\
+	.companion_height = 0.5f,			\
+	.companion_speed = 0.5f,			\
+	.ground_rate = 0.01f,				\
+}
+
+/* Each part works its way up to SENSOR_x_RUN, and back to the start on any error */
+#define SENSOR_BARO_START	0
+#define SENSOR_BARO_LOAD	1	/* reading the PROM */
+#define SENSOR_BARO_RUN		2
+
+#define SENSOR_IMU_START	0
+#define SENSOR_IMU_WAKE		1
+#define SENSOR_IMU_CHECK	2	/* WHO_AM_I */
+#define SENSOR_IMU_SETUP	3
+#define SENSOR_IMU_RUN		4
+
+#define SENSOR_NONE			0
+#define SENSOR_BARO			1
+#define SENSOR_IMU			2
+
+/*
+ * One bus transaction: reg and then write bytes of data, and if read
+ * isn't 0, a repeated start and that many bytes back. MS5607 commands
+ * are just a reg with nothing after.
+ */
+struct sensor_op {
+	uint8_t		addr;			/* 7 bit */
+	uint8_t		reg;
+	uint8_t		write;
+	uint8_t		data;
+	uint8_t		read;
+};
+
+/* Vertical state from the local sensors, up from the pad */
+struct sensor_estimate {
+	float		height;			/* m */
+	float		speed;			/* m/s */
+	float		accel;			/* m/s^2, less gravity */
+	uint32_t	tick;			/* ms, last sample in it */
+	uint8_t		valid;			/* a part running and the pad references taken */
+};
+
+struct sensor {
+	struct sensor_config	cfg;
+	uint8_t					pending;		/* SENSOR_x the bus is busy for */
+	uint8_t					flight_state;	/* from the last companion frame */
+
+	uint8_t					baro_state;
+	uint8_t					baro_step;		/* PROM word, or conversion count */
+	uint8_t					baro_converting;	/* SENSOR_BARO_D1 or D2 */
+	uint32_t				baro_due;
+	uint16_t				prom[8];
+	uint32_t				d2;
+	int32_t					temp;			/* hundredths of a degree C */
+	int32_t					pressure;		/* Pa */
+	uint32_t				baro_tick;
+
+	uint8_t					imu_state;
+	uint8_t					imu_step;
+	uint32_t				imu_due;
+	int16_t					raw[7];			/* accel xyz, temp, gyro xyz */
+	uint32_t				imu_tick;
+
+	/* Pad references, and the filter */
+	float					ground_alt;		/* m, standard atmosphere */
+	float					ground_accel;	/* counts at rest */
+	uint8_t					grounded;		/* bit per part */
+	float					height;
+	float					speed;
+	float					accel;
+
+	struct sensor_estimate	est[2];
+	volatile uint8_t		latest;
+
+	uint32_t				ops;
+	uint32_t				errors;
+	uint32_t				baro_samples;
+	uint32_t				imu_samples;
+	uint32_t				restarts;
+};
+
+/* sensor_i2c.c */
+extern struct sensor sensor;
+
+void sensor_Start(void);
+void sensor_Poll(void);
+int sensor_Busy(void);
+void sensor_Event(void);
+void sensor_Error(void);
+
+/* sensor.c */
+void sensor_Init(struct sensor *s, const struct sensor_config *cfg, uint32_t now);
+int sensor_Next(struct sensor *s, uint32_t now, struct sensor_op *op);
+void sensor_Done(struct sensor *s, const uint8_t *data, int ok, uint32_t now);
+void sensor_Companion(struct sensor *s, const struct companion_state *c);
+int sensor_Cover(const struct sensor_estimate *e, struct companion_state *c, uint32_t now, uint32_t stale_ms);
+int sensor_BaroCrc(const uint16_t *prom);
+int32_t sensor_BaroConvert(const uint16_t *prom, uint32_t d1, uint32_t d2, int32_t *temp);
+float sensor_Altitude(float pa);
+
+/* Newest estimate; like companion_Latest(), the other slot is the one written */
+static inline const struct sensor_estimate *sensor_Latest(const struct sensor *s){
+	return &s->est[s->latest];
+}
+
+#endif /* INC_SENSOR_H_ */
@@ -57,6 +57,17 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void OTG_FS_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void EXTI4_IRQHandler(void);
+void TIM3_IRQHandler(void);
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream4_IRQHandler(void);
+void DMA1_Stream5_IRQHandler(void);
+void TIM4_IRQHandler(void);
+void TIM2_IRQHandler(void);
+void DMA2_Stream0_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
 
 /* USER CODE END EFP */
 
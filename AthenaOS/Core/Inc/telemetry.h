@@ -0,0 +1,81 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include <stdint.h>
+#include "frame.h"
+#include "recorder.h"
+
+/*
+ * Unsolicited frames from the board, in the frame.h format on the same
+ * CDC link as the upload protocol; the host turns them on with
+ * UPLOAD_TELEMETRY. Types stay clear of upload commands and replies.
+ *
+ *	CONTROL		one RECORDER_CONTROL record per control tick (or every
+ *				divisor ticks), same bytes the recorder logs
+ *	STATUS		once a second, TELEMETRY_STATUS_WORDS little endian
+ *				uint32s in struct telemetry_status order
+ */
+#define TELEMETRY_CONTROL		0x40
+#define TELEMETRY_STATUS		0x41
+
+#define TELEMETRY_QUEUE			16		/* records between the control tick and the main loop */
+#define TELEMETRY_STATUS_WORDS	18
+#define TELEMETRY_STATUS_MS		1000
+
+struct telemetry_status {
+	uint32_t	tick;
+	uint32_t	companion_frames;
+	uint32_t	companion_errors;
+	uint32_t	period_min;		/* us */
+	uint32_t	period_max;
+	uint32_t	exec_max;
+	uint32_t	overruns;
+	uint32_t	lut_lookups;
+	uint32_t	lut_misses;
+	uint32_t	lut_fetches;
+	uint32_t	recorder_addr;
+	uint32_t	recorder_drops;
+	uint32_t	recorder_pages;
+	uint32_t	telemetry_drops;
+	uint32_t	battery_mv;
+	uint32_t	battery_min_mv;
+	uint32_t	brownouts;
+	uint32_t	temp;			/* int32, tenths of a degree C */
+};
+
+/*
+ * Records come in from the control interrupt and go out as frames from
+ * the main loop; one writer per index, like the recorder's ring.
+ */
+struct telemetry {
+	uint8_t				rec[TELEMETRY_QUEUE][RECORDER_RECORD_SIZE];
+	volatile uint8_t	head;
+	volatile uint8_t	tail;
+	volatile uint8_t	divisor;	/* send every nth tick, 0 for none */
+	uint8_t				count;
+	volatile uint32_t	drops;
+	uint32_t			sent;
+	uint8_t				frame[FRAME_OVERHEAD + TELEMETRY_STATUS_WORDS * 4];
+};
+
+/* telemetry_cdc.c */
+extern struct telemetry telemetry;
+
+void telemetry_Poll(void);
+
+/* telemetry.c */
+void telemetry_Init(struct telemetry *t);
+void telemetry_Rate(struct telemetry *t, uint8_t divisor);
+void telemetry_Add(struct telemetry *t, const uint8_t *rec);
+void telemetry_Send(struct telemetry *t, int (*send)(const uint8_t *frame, uint16_t len));
+uint16_t telemetry_EncodeStatus(uint8_t *out, const struct telemetry_status *s);
+void telemetry_DecodeStatus(const uint8_t *payload, struct telemetry_status *s);
+
+#endif /* INC_TELEMETRY_H_ */
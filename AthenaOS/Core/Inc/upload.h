@@ -0,0 +1,86 @@
+/*
+ * upload.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef INC_UPLOAD_H_
+#define INC_UPLOAD_H_
+
+#include <stdint.h>
+#include "frame.h"
+
+/*
+ * Flash access over the CDC link, one frame per command. Every
+ * command gets one reply of type command | UPLOAD_REPLY whose first
+ * payload byte is a status. All fields little endian.
+ *
+ *	PING						-> status version size[4] page[2] sector[2] max_data[2]
+ *	ERASE	addr[4] len[4]		-> status			(sector aligned)
+ *	WRITE	addr[4] data[n]		-> status addr[4]
+ *	READ	addr[4] len[2]		-> status addr[4] data[len]
+ *	CRC		addr[4] len[4]		-> status crc32[4]
+ *	RELOAD						-> status			(reopen the drag table)
+ *	TELEMETRY	divisor[1]		-> status			(every nth control tick, 0 off)
+ *	PROFILE	probe[1] flags[1]	-> status probe[1] hz[4] name[12] count[4] min[4]
+ *								   max[4] sum[8] hist[128]	(profile.h, cycles)
+ *	HIL		on[1]				-> status			(companion frames from INJECT, not SPI1)
+ *	INJECT	bytes[n]			-> status command[1]	(one SPI1 transaction as the TeleMega
+ *														 clocks it; UPLOAD_FAILED if rejected)
+ *
+ * WRITE anywhere in the ops' reserved range, and ERASE over any of it
+ * but exactly all of it (faultdump --erase), come back
+ * UPLOAD_BAD_ADDRESS. It can still be read. The board may refuse
+ * ERASE, WRITE, RELOAD and HIL with UPLOAD_FAILED while it's flying.
+ */
+#define UPLOAD_PING			0x01
+#define UPLOAD_ERASE		0x02
+#define UPLOAD_WRITE		0x03
+#define UPLOAD_READ			0x04
+#define UPLOAD_CRC			0x05
+#define UPLOAD_RELOAD		0x06
+#define UPLOAD_TELEMETRY	0x07
+#define UPLOAD_PROFILE		0x08
+#define UPLOAD_HIL			0x09
+#define UPLOAD_INJECT		0x0A
+#define UPLOAD_REPLY		0x80
+
+#define UPLOAD_OK			0
+#define UPLOAD_BAD_LENGTH	1
+#define UPLOAD_BAD_ADDRESS	2
+#define UPLOAD_BAD_COMMAND	3
+#define UPLOAD_FAILED		4
+
+#define UPLOAD_VERSION		1
+#define UPLOAD_MAX_DATA		256
+#define UPLOAD_SECTOR		4096
+
+struct upload_ops {
+	uint32_t	size;
+	uint16_t	page;			/* program page, for PING */
+	uint32_t	reserved;		/* first byte the host can't erase or write */
+	uint32_t	reserved_len;	/* 0 for none */
+	int			(*erase)(uint32_t addr, uint32_t len);
+	int			(*write)(uint32_t addr, const uint8_t *data, uint32_t len);
+	int			(*read)(uint32_t addr, uint8_t *data, uint32_t len);
+	int			(*reload)(void);
+	int			(*telemetry)(uint8_t divisor);
+	int			(*profile)(uint8_t probe, uint8_t flags, uint8_t *out);	/* length, or -1 */
+	int			(*hil)(uint8_t on);
+	int			(*inject)(const uint8_t *data, uint16_t len);	/* command, or -1 */
+	void		(*send)(const uint8_t *frame, uint16_t len);
+};
+
+struct upload {
+	const struct upload_ops	*ops;
+	struct frame_rx			rx;
+	uint8_t					tx[FRAME_OVERHEAD + 5 + UPLOAD_MAX_DATA];
+};
+
+void upload_Init(struct upload *u, const struct upload_ops *ops);
+void upload_Input(struct upload *u, const uint8_t *buf, uint32_t len);
+
+void upload_Poll(void);
+
+#endif /* INC_UPLOAD_H_ */
@@ -3,27 +3,232 @@
  *
  *  Created on: May 10, 2022
  *      Author: Dylan
+ *
+ * Step_PWM (PB4) is TIM3_CH1. Each timer period is one step: the update
+ * interrupt asks motion.c for the next step, sets Step_DIR and the new
+ * period, and the low pulse at the end of the period ends with the
+ * rising edge the driver steps on. Nothing here waits on the motor.
+ *
+ * With STEPPER_INDEX set, Extra_out (PC7) becomes TIM3_CH2 and captures
+ * the index sensor in the same interrupt, so the count it's checked
+ * against can't move underneath it.
  */
 
-#include "stm32f4xx_hal.h"
-#include "stepper.h"
+#include "main.h"
+#include "Stepper.h"
+#include "profile.h"
 
-void stepper_Step (int dir, int step){
-	HAL_GPIO_WritePin(GPIOC, Step_EN_Pin, GPIO_PIN_RESET);
+TIM_HandleTypeDef htim3;
 
-	if (dir == 1){
+struct motion stepper_motion;
+struct home stepper_home;
+
+static int32_t stepper_end;		/* where the last queued move finishes */
+static int8_t stepper_dir;		/* of the last step taken */
+
+static int stepper_Update(void){
+	uint32_t ticks;
+	int dir = motion_Next(&stepper_motion, &ticks);
+
+	if (dir == 0){
+		__HAL_TIM_DISABLE(&htim3);
+		__HAL_TIM_SET_COUNTER(&htim3, 0);
+		HAL_GPIO_WritePin(GPIOC, Step_EN_Pin, GPIO_PIN_SET);
+		return 0;
+	}
+
+	if (ticks < 2 * STEPPER_PULSE_TICKS)
+		ticks = 2 * STEPPER_PULSE_TICKS;
+
+	stepper_dir = dir;
+	if (dir > 0){
 		HAL_GPIO_WritePin(GPIOB, Step_DIR_Pin, GPIO_PIN_RESET);
 	}
 	else{
 		HAL_GPIO_WritePin(GPIOB, Step_DIR_Pin, GPIO_PIN_SET);
 	}
 
-	for(int i = 0; i < step; i++){
-		HAL_GPIO_WritePin(GPIOB, Step_PWM_Pin, GPIO_PIN_RESET);
-		delay(500);
-		HAL_GPIO_WritePin(GPIOB, Step_PWM_Pin, GPIO_PIN_SET);
-		delay(500);
+	__HAL_TIM_SET_AUTORELOAD(&htim3, ticks - 1);
+	__HAL_TIM_SET_COMPARE(&htim3, TIM_CHANNEL_1, ticks - STEPPER_PULSE_TICKS);
+	/*
+	 * No ARR preload: if the IRQ ran late and the counter is already
+	 * past the new compare, it would cut the pulse short or run round
+	 * through 0xffff. Put it back at the start of a whole pulse.
+	 */
+	if (__HAL_TIM_GET_COUNTER(&htim3) >= ticks - STEPPER_PULSE_TICKS)
+		__HAL_TIM_SET_COUNTER(&htim3, ticks - STEPPER_PULSE_TICKS);
+	return dir;
+}
+
+/* Start the timer if it went idle; call with TIM3_IRQn masked */
+static void stepper_Kick(void){
+	if (htim3.Instance->CR1 & TIM_CR1_CEN)
+		return;
+	HAL_GPIO_WritePin(GPIOC, Step_EN_Pin, GPIO_PIN_RESET);
+	if (stepper_Update()){
+		__HAL_TIM_SET_COUNTER(&htim3, 0);
+		__HAL_TIM_ENABLE(&htim3);
+	}
+}
+
+/* Both edges of the index sensor on TIM3_CH2, filtered well under a step */
+static void stepper_IndexInit(void){
+	TIM_IC_InitTypeDef sConfigIC = {0};
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	GPIO_InitStruct.Pin = Extra_out_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF2_TIM3;
+	HAL_GPIO_Init(Extra_out_GPIO_Port, &GPIO_InitStruct);
+
+	sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_BOTHEDGE;
+	sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+	sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+	sConfigIC.ICFilter = 0xf;
+	if (HAL_TIM_IC_ConfigChannel(&htim3, &sConfigIC, TIM_CHANNEL_2) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	TIM_CCxChannelCmd(htim3.Instance, TIM_CHANNEL_2, TIM_CCx_ENABLE);
+	__HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_CC2);
+	__HAL_TIM_ENABLE_IT(&htim3, TIM_IT_CC2);
+}
+
+void stepper_Init(void){
+	static const struct home_config home_cfg = HOME_CONFIG_DEFAULT;
+	TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+	TIM_OC_InitTypeDef sConfigOC = {0};
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	motion_Init(&stepper_motion, STEPPER_TICK_HZ, 0x10000, STEPPER_MAX_SPEED, STEPPER_ACCEL);
+	home_Init(&stepper_home, &home_cfg);
+	stepper_end = 0;
+	stepper_dir = 0;
+
+	__HAL_RCC_TIM3_CLK_ENABLE();
+
+	htim3.Instance = TIM3;
+	htim3.Init.Prescaler = HAL_RCC_GetPCLK1Freq() * 2 / STEPPER_TICK_HZ - 1;
+	htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim3.Init.Period = 0xffff;
+	htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_Base_Init(&htim3) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+	if (HAL_TIM_ConfigClockSource(&htim3, &sClockSourceConfig) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	if (HAL_TIM_PWM_Init(&htim3) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	/* Low once the counter passes CCR1, high again at the update */
+	sConfigOC.OCMode = TIM_OCMODE_PWM2;
+	sConfigOC.Pulse = 0xffff;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_LOW;
+	sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+	if (HAL_TIM_PWM_ConfigChannel(&htim3, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+	{
+		Error_Handler();
 	}
+	/* Period and compare are rewritten right after each update, so no preload */
+	htim3.Instance->CCMR1 &= ~TIM_CCMR1_OC1PE;
 
-	HAL_GPIO_WritePin(GPIOC, Step_EN_Pin, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(GPIOB, Step_PWM_Pin, GPIO_PIN_SET);
+	GPIO_InitStruct.Pin = Step_PWM_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF2_TIM3;
+	HAL_GPIO_Init(Step_PWM_GPIO_Port, &GPIO_InitStruct);
+
+	TIM_CCxChannelCmd(htim3.Instance, TIM_CHANNEL_1, TIM_CCx_ENABLE);
+	__HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE);
+	__HAL_TIM_ENABLE_IT(&htim3, TIM_IT_UPDATE);
+
+	if (STEPPER_INDEX)
+		stepper_IndexInit();
+
+	HAL_NVIC_SetPriority(TIM3_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+/*
+ * Find the retracted stop and make it position -backoff. Takes a few
+ * seconds, and has to be done before the control loop starts moving
+ * the brakes.
+ */
+void stepper_Home(void){
+	int state;
+
+	HAL_NVIC_DisableIRQ(TIM3_IRQn);
+	home_Start(&stepper_home, &stepper_motion);
+	stepper_Kick();
+	HAL_NVIC_EnableIRQ(TIM3_IRQn);
+
+	do {
+		HAL_NVIC_DisableIRQ(TIM3_IRQn);
+		state = home_Poll(&stepper_home, &stepper_motion);
+		stepper_Kick();
+		HAL_NVIC_EnableIRQ(TIM3_IRQn);
+	} while (state != HOME_DONE);
+	stepper_end = 0;
+}
+
+/* Relative move after everything already queued, as before */
+void stepper_Step (int dir, int step){
+	if (dir == 1){
+		stepper_MoveTo(stepper_end + step);
+	}
+	else{
+		stepper_MoveTo(stepper_end - step);
+	}
+}
+
+/* Absolute move once the queued moves are done */
+void stepper_MoveTo(int32_t position){
+	HAL_NVIC_DisableIRQ(TIM3_IRQn);
+	if (motion_Queue(&stepper_motion, position) == 0)
+		stepper_end = position;
+	stepper_Kick();
+	HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+/* Drop the queue and head for position from wherever we are, mid-move or not */
+void stepper_Retarget(int32_t position){
+	HAL_NVIC_DisableIRQ(TIM3_IRQn);
+	motion_Retarget(&stepper_motion, position);
+	stepper_end = position;
+	stepper_Kick();
+	HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+int32_t stepper_Position(void){
+	return stepper_motion.position;
+}
+
+int stepper_Busy(void){
+	return motion_Busy(&stepper_motion);
+}
+
+/* TIM3 update and index capture */
+void stepper_IRQ(void){
+	PROFILE_BEGIN(start);
+
+	if (STEPPER_INDEX && __HAL_TIM_GET_FLAG(&htim3, TIM_FLAG_CC2)){
+		__HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_CC2);
+		motion_Shift(&stepper_motion, home_Edge(&stepper_home, stepper_motion.position, stepper_dir));
+	}
+	if (__HAL_TIM_GET_FLAG(&htim3, TIM_FLAG_UPDATE)){
+		__HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE);
+		stepper_Update();
+		PROFILE_END(PROFILE_STEPPER, start);
+	}
 }
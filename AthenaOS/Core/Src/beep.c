@@ -0,0 +1,100 @@
+/*
+ * beep.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Note queue for the piezo. The timer generates the tone itself as a
+ * 50% PWM on Buzz_PWM, so the only CPU cost is one short interrupt per
+ * tone period to count the note out, and the next note is ready
+ * before the last one ends so there are no gaps or clicks between.
+ */
+
+#include "beep.h"
+
+void beep_Init(struct beep *b){
+	b->head = 0;
+	b->tail = 0;
+	b->playing = 0;
+	b->left = 0;
+}
+
+/* Returns -1 if the queue is full */
+int beep_Queue(struct beep *b, uint16_t hz, uint16_t ms){
+	uint16_t head = b->head;
+
+	if (((head - b->tail) & 0xffff) >= BEEP_QUEUE)
+		return -1;
+	b->q[head & (BEEP_QUEUE - 1)].hz = hz;
+	b->q[head & (BEEP_QUEUE - 1)].ms = ms;
+	b->head = head + 1;
+	return 0;
+}
+
+int beep_Tune(struct beep *b, const struct beep_note *notes, int n){
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (beep_Queue(b, notes[i].hz, notes[i].ms) != 0)
+			return -1;
+	return 0;
+}
+
+/*
+ * Battery voltage in beeps, the way startup() has always read it out:
+ * a beep per volt, a pause, then a beep per tenth. A zero digit is one
+ * long low beep so it can't be mistaken for the end.
+ */
+int beep_Battery(struct beep *b, uint32_t millivolts){
+	uint32_t digits[2], d, i;
+	int ret = 0;
+
+	millivolts += 50;
+	digits[0] = millivolts / 1000;
+	digits[1] = millivolts / 100 % 10;
+	if (digits[0] > 9)
+		digits[0] = 9;
+
+	for (d = 0; d < 2; d++){
+		if (digits[d] == 0)
+			ret |= beep_Queue(b, BEEP_LOW, 500) | beep_Queue(b, 0, 400);
+		for (i = 0; i < digits[d]; i++)
+			ret |= beep_Queue(b, BEEP_MID, 175) | beep_Queue(b, 0, 400);
+		if (d == 0)
+			ret |= beep_Queue(b, 0, 600);
+	}
+	return ret;
+}
+
+/*
+ * Interrupt side: pop the next note and work out the timer settings
+ * for it. Returns 0 when the queue is empty.
+ */
+int beep_Next(struct beep *b, uint32_t tick_hz, struct beep_timing *t){
+	struct beep_note n;
+	uint16_t tail = b->tail;
+
+	if (tail == b->head)
+		return 0;
+	n = b->q[tail & (BEEP_QUEUE - 1)];
+	b->tail = tail + 1;
+
+	if (n.hz == 0){
+		t->period = tick_hz / BEEP_REST_HZ;
+		t->pulse = 0;
+		t->count = (uint32_t) n.ms * BEEP_REST_HZ / 1000;
+	}
+	else{
+		t->period = (tick_hz + n.hz / 2) / n.hz;
+		t->pulse = t->period / 2;
+		/* Count from the rounded period so long notes keep their length */
+		t->count = ((uint64_t) n.ms * tick_hz / 1000 + t->period / 2) / t->period;
+	}
+	if (t->count == 0)
+		t->count = 1;
+	return 1;
+}
+
+int beep_Busy(const struct beep *b){
+	return b->playing || b->head != b->tail;
+}
@@ -0,0 +1,100 @@
+/*
+ * beep_tim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Buzz_PWM (PA15) is TIM2_CH1. The timer runs PWM at the note's pitch
+ * with ARR and CCR preloaded, and the update interrupt counts periods:
+ * one period before a note ends the next note's settings go into the
+ * preload registers, so the switch lands exactly on the update. The
+ * interrupt is the lowest priority in the system.
+ */
+
+#include "main.h"
+#include "beep.h"
+
+extern TIM_HandleTypeDef htim2;
+
+struct beep beep;
+
+static struct beep_timing beep_next;
+static uint8_t beep_have_next;
+
+void beep_Start(void){
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	beep_Init(&beep);
+
+	__HAL_TIM_DISABLE(&htim2);
+	__HAL_TIM_SET_PRESCALER(&htim2, HAL_RCC_GetPCLK1Freq() * 2 / BEEP_TICK_HZ - 1);
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, 0);
+	htim2.Instance->CR1 |= TIM_CR1_ARPE;
+	htim2.Instance->CCER |= TIM_CCER_CC1E;
+	__HAL_TIM_ENABLE_IT(&htim2, TIM_IT_UPDATE);
+
+	GPIO_InitStruct.Pin = Buzz_PWM_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF1_TIM2;
+	HAL_GPIO_Init(Buzz_PWM_GPIO_Port, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(TIM2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/* The note after this one goes into the preload registers */
+static void beep_Preload(void){
+	beep_have_next = beep_Next(&beep, BEEP_TICK_HZ, &beep_next);
+	if (beep_have_next){
+		__HAL_TIM_SET_AUTORELOAD(&htim2, beep_next.period - 1);
+		__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, beep_next.pulse);
+	}
+	else
+		__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, 0);
+}
+
+/* Start playing whatever has been queued, if the timer is idle */
+void beep_Kick(void){
+	struct beep_timing t;
+
+	HAL_NVIC_DisableIRQ(TIM2_IRQn);
+	if (!beep.playing && beep_Next(&beep, BEEP_TICK_HZ, &t)){
+		__HAL_TIM_SET_AUTORELOAD(&htim2, t.period - 1);
+		__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, t.pulse);
+		__HAL_TIM_SET_COUNTER(&htim2, 0);
+		htim2.Instance->EGR = TIM_EGR_UG;
+		__HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+		beep.left = t.count;
+		beep.playing = 1;
+		if (beep.left == 1)
+			beep_Preload();
+		__HAL_TIM_ENABLE(&htim2);
+	}
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/* TIM2 update: one tone period has gone by */
+void beep_IRQ(void){
+	if (!__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE))
+		return;
+	__HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+
+	if (--beep.left > 1)
+		return;
+	if (beep.left == 1){
+		beep_Preload();
+		return;
+	}
+
+	/* The preloaded note has just started, or there wasn't one */
+	if (!beep_have_next){
+		__HAL_TIM_DISABLE(&htim2);
+		beep.playing = 0;
+		return;
+	}
+	beep.left = beep_next.count;
+	if (beep.left == 1)
+		beep_Preload();
+}
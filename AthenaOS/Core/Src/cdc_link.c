@@ -0,0 +1,142 @@
+/*
+ * cdc_link.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Byte stream over the USB CDC interface. OUT packets are copied into
+ * a ring from the USB interrupt; when the ring can't take another
+ * packet the endpoint is left NAKing until the main loop drains it,
+ * which is all the flow control the host needs.
+ *
+ * IN goes through a ring the other way: the main loop appends whole
+ * frames, and the transmit complete callback hands the stack the next
+ * run of bytes. Each index has one writer, so neither side ever locks
+ * the other out; cdc_tx_len is only ever set nonzero by whoever finds
+ * the endpoint idle, and only a completion can clear it.
+ */
+
+#include <string.h>
+#include "main.h"
+#include "usb_device.h"
+#include "usbd_cdc_if.h"
+#include "cdc_link.h"
+
+#define CDC_RX_MASK	(CDC_RX_SIZE - 1)
+#define CDC_TX_MASK	(CDC_TX_SIZE - 1)
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static uint8_t cdc_rx[CDC_RX_SIZE];
+static volatile uint16_t cdc_rx_head;
+static volatile uint16_t cdc_rx_tail;
+static volatile uint8_t cdc_rx_stalled;
+
+static uint8_t cdc_tx[CDC_TX_SIZE];
+static volatile uint16_t cdc_tx_head;		/* main loop */
+static volatile uint16_t cdc_tx_tail;		/* USB interrupt */
+static volatile uint16_t cdc_tx_len;		/* in flight, 0 when idle */
+
+/* From CDC_Init_FS: a new host, nothing in flight, nothing owed */
+void cdc_Reset(void){
+	cdc_tx_len = 0;
+	cdc_tx_tail = cdc_tx_head;
+}
+
+static uint16_t cdc_RxSpace(void){
+	return CDC_RX_SIZE - 1 - ((cdc_rx_head - cdc_rx_tail) & CDC_RX_MASK);
+}
+
+/* From CDC_Receive_FS. Returns whether to ask for the next packet */
+int cdc_Receive(const uint8_t *buf, uint32_t len){
+	uint16_t head = cdc_rx_head;
+
+	if (len > cdc_RxSpace())
+		len = cdc_RxSpace();
+	while (len--){
+		cdc_rx[head] = *buf++;
+		head = (head + 1) & CDC_RX_MASK;
+	}
+	cdc_rx_head = head;
+
+	if (cdc_RxSpace() < CDC_PACKET){
+		cdc_rx_stalled = 1;
+		return 0;
+	}
+	return 1;
+}
+
+uint32_t cdc_Read(uint8_t *buf, uint32_t max){
+	uint16_t tail = cdc_rx_tail;
+	uint32_t n = 0;
+
+	while (n < max && tail != cdc_rx_head){
+		buf[n++] = cdc_rx[tail];
+		tail = (tail + 1) & CDC_RX_MASK;
+	}
+	cdc_rx_tail = tail;
+
+	if (cdc_rx_stalled && cdc_RxSpace() >= CDC_PACKET){
+		HAL_NVIC_DisableIRQ(OTG_FS_IRQn);
+		cdc_rx_stalled = 0;
+		USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+		HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+	}
+	return n;
+}
+
+static uint16_t cdc_TxSpace(void){
+	return CDC_TX_SIZE - 1 - ((cdc_tx_head - cdc_tx_tail) & CDC_TX_MASK);
+}
+
+/* Hand the stack the next contiguous run of the ring, if there is one */
+static void cdc_TxStart(void){
+	uint16_t tail = cdc_tx_tail, head = cdc_tx_head, n;
+
+	n = head >= tail ? head - tail : CDC_TX_SIZE - tail;
+	if (n > CDC_TX_CHUNK)
+		n = CDC_TX_CHUNK;
+	if (n == 0)
+		return;
+	cdc_tx_len = n;
+	if (CDC_Transmit_FS(cdc_tx + tail, n) != USBD_OK)
+		cdc_tx_len = 0;
+}
+
+/* From CDC_TransmitCplt_FS */
+void cdc_Transmitted(void){
+	cdc_tx_tail = (cdc_tx_tail + cdc_tx_len) & CDC_TX_MASK;
+	cdc_tx_len = 0;
+	cdc_TxStart();
+}
+
+/*
+ * Queue all of buf or none of it, so frames never go out torn, and
+ * start it moving if the endpoint is idle. Main loop only. Returns
+ * -1 if there's no room or no host.
+ */
+int cdc_Send(const uint8_t *buf, uint16_t len){
+	uint16_t head = cdc_tx_head, n;
+
+	if (hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED || len > cdc_TxSpace())
+		return -1;
+	n = CDC_TX_SIZE - head;
+	if (n > len)
+		n = len;
+	memcpy(cdc_tx + head, buf, n);
+	memcpy(cdc_tx, buf + n, len - n);
+	cdc_tx_head = (head + len) & CDC_TX_MASK;
+	if (cdc_tx_len == 0)
+		cdc_TxStart();
+	return 0;
+}
+
+/* Queue len bytes, waiting for room; drops them if nobody is listening */
+int cdc_Write(const uint8_t *buf, uint16_t len){
+	if (len >= CDC_TX_SIZE)
+		return -1;
+	while (cdc_Send(buf, len) != 0)
+		if (hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED)
+			return -1;
+	return 0;
+}
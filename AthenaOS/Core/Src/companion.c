@@ -0,0 +1,145 @@
+/*
+ * companion.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Decoder for TeleMega companion transactions. No HAL in here so the
+ * same code runs on the bench (AthenaOS/Test).
+ */
+
+#include <stdatomic.h>
+#include "companion.h"
+
+static uint16_t companion_U16(const uint8_t *ring, uint16_t mask, uint16_t pos){
+	return (uint16_t) (ring[pos & mask] | (ring[(pos + 1) & mask] << 8));
+}
+
+static void companion_Put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+/* Round to the nearest, pinned to what the channel holds */
+static uint16_t companion_Scale(float v, float scale, float lo, float hi){
+	v = v * scale;
+	if (!(v >= lo))
+		v = lo;
+	if (v > hi)
+		v = hi;
+	return (uint16_t) (int32_t) (v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static uint16_t companion_Count(uint32_t v){
+	return v > UINT16_MAX ? UINT16_MAX : (uint16_t) v;
+}
+
+void companion_Reset(struct companion_decoder *c, uint8_t channels){
+	c->state[0] = (struct companion_state) {0};
+	c->state[1] = (struct companion_state) {0};
+	c->latest = 0;
+	c->reply = COMPANION_REPLY_SETUP;
+	c->channels = channels;
+	c->frames = 0;
+	c->errors = 0;
+}
+
+/*
+ * Decode one chip-select delimited transaction of len bytes starting at
+ * ring[start & mask]. The length must match what the TeleMega clocks for
+ * that command, which is the only framing the protocol gives us.
+ * Returns the command or -1 if the transaction was rejected.
+ */
+int companion_Decode(struct companion_decoder *c, const uint8_t *ring, uint16_t mask,
+		uint16_t start, uint16_t len, uint32_t now){
+	uint8_t command = ring[start & mask];
+	uint8_t flight_state = ring[(start + 1) & mask];
+	uint16_t expect;
+	struct companion_state *s;
+
+	switch (command){
+	case COMPANION_SETUP:
+		expect = COMPANION_COMMAND_SIZE + COMPANION_SETUP_SIZE;
+		break;
+	case COMPANION_FETCH:
+		expect = COMPANION_COMMAND_SIZE + 2 * c->channels;
+		break;
+	case COMPANION_NOTIFY:
+		expect = COMPANION_COMMAND_SIZE;
+		break;
+	default:
+		c->errors++;
+		return -1;
+	}
+
+	if (len != expect || flight_state > COMPANION_STATE_TEST){
+		c->errors++;
+		return -1;
+	}
+
+	s = &c->state[c->latest ^ 1];
+	s->command = command;
+	s->flight_state = flight_state;
+	s->tick = companion_U16(ring, mask, start + 2);
+	s->serial = companion_U16(ring, mask, start + 4);
+	s->flight = companion_U16(ring, mask, start + 6);
+	s->accel = (int16_t) companion_U16(ring, mask, start + 8);
+	s->speed = (int16_t) companion_U16(ring, mask, start + 10);
+	s->height = (int16_t) companion_U16(ring, mask, start + 12);
+	s->motor_number = companion_U16(ring, mask, start + 14);
+	s->rx_tick = now;
+
+	/* Slot must be complete before readers can see it */
+	atomic_signal_fence(memory_order_release);
+	c->latest ^= 1;
+	c->frames++;
+
+	/*
+	 * The reply has to be in the TX DMA before the TeleMega selects us,
+	 * so guess from history: it only sends SETUP until it gets a good
+	 * one back, then FETCH/NOTIFY forever.
+	 */
+	if (command == COMPANION_SETUP)
+		c->reply = c->reply == COMPANION_REPLY_SETUP ? COMPANION_REPLY_DATA : COMPANION_REPLY_SETUP;
+	else
+		c->reply = COMPANION_REPLY_DATA;
+
+	return command;
+}
+
+/* The command bytes as the TeleMega sent them; the decoder keeps every field */
+void companion_Encode(const struct companion_state *s, uint8_t *command){
+	command[0] = s->command;
+	command[1] = s->flight_state;
+	companion_Put16(command + 2, s->tick);
+	companion_Put16(command + 4, s->serial);
+	companion_Put16(command + 6, s->flight);
+	companion_Put16(command + 8, (uint16_t) s->accel);
+	companion_Put16(command + 10, (uint16_t) s->speed);
+	companion_Put16(command + 12, (uint16_t) s->height);
+	companion_Put16(command + 14, s->motor_number);
+}
+
+/*
+ * Pack the FETCH reply, 2 * COMPANION_CHANNELS bytes. Counters stick
+ * at the top rather than wrapping, so a big number on the ground
+ * never reads as a small one.
+ */
+void companion_EncodeReturn(const struct companion_return *r, uint8_t *data){
+	uint16_t ch[COMPANION_CHANNELS];
+	int i;
+
+	ch[COMPANION_CH_STATUS] = (uint16_t) (r->mode | (r->flags << 8));
+	ch[COMPANION_CH_POSITION] = companion_Scale((float) r->position, 1, INT16_MIN, INT16_MAX);
+	ch[COMPANION_CH_TARGET] = companion_Scale((float) r->target, 1, INT16_MIN, INT16_MAX);
+	ch[COMPANION_CH_EXTENSION] = companion_Scale(r->extension, 10000, 0, 10000);
+	ch[COMPANION_CH_PREDICTED] = companion_Scale(r->predicted, 1, 0, UINT16_MAX);
+	ch[COMPANION_CH_ERROR] = companion_Scale(r->error, 10, INT16_MIN, INT16_MAX);
+	ch[COMPANION_CH_CD] = companion_Scale(r->cd, 10000, 0, UINT16_MAX);
+	ch[COMPANION_CH_OVERRUNS] = companion_Count(r->overruns);
+	ch[COMPANION_CH_EXEC] = companion_Count(r->exec_us);
+	ch[COMPANION_CH_SLIPS] = companion_Count(r->slips);
+
+	for (i = 0; i < COMPANION_CHANNELS; i++)
+		companion_Put16(data + 2 * i, ch[i]);
+}
@@ -0,0 +1,210 @@
+/*
+ * companion_spi.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * SPI1 slave link to the TeleMega. RX runs forever as a circular DMA
+ * into companion_ring, TX is reloaded with the next reply between
+ * transactions. Altus_CS (PC4) is the only framing we get, so each
+ * edge lands in companion_NSS() and the rising edge decodes the
+ * transaction straight out of the ring.
+ *
+ * FETCH replies are built by the control loop in one of three buffers:
+ * never the one the DMA is sending, never the newest complete one, so
+ * the TeleMega never gets half of one tick and half of the next.
+ *
+ * On the bench the host can take over with UPLOAD_HIL: SPI1 keeps
+ * running but its transactions are dropped, and the ones the host
+ * sends with UPLOAD_INJECT go through companion_Decode() instead, from
+ * the main loop, stamped the same way.
+ */
+
+#include "main.h"
+#include "companion.h"
+#include "profile.h"
+
+#define COMPANION_RING_SIZE	256	/* power of two */
+#define COMPANION_RING_MASK	(COMPANION_RING_SIZE - 1)
+#define COMPANION_TX_SIZE	(COMPANION_COMMAND_SIZE + 2 * COMPANION_CHANNELS)
+
+extern SPI_HandleTypeDef hspi1;
+
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+
+struct companion_decoder companion;
+volatile uint32_t companion_cycles;	/* DWT when the last good frame ended */
+volatile uint8_t companion_hil;		/* frames from USB, not SPI1 */
+
+static uint8_t companion_ring[COMPANION_RING_SIZE];
+static uint16_t companion_start;
+static uint32_t companion_cr1;
+
+/* Replies are clocked out while the TeleMega is still sending its command */
+static uint8_t companion_setup_tx[COMPANION_COMMAND_SIZE + COMPANION_SETUP_SIZE];
+static uint8_t companion_data_tx[3][COMPANION_TX_SIZE];
+static volatile uint8_t companion_data_latest;
+static volatile uint8_t companion_data_armed;
+
+static uint16_t companion_Head(void){
+	return (uint16_t) (COMPANION_RING_SIZE - __HAL_DMA_GET_COUNTER(&hdma_spi1_rx));
+}
+
+static void companion_ArmReply(void){
+	if (companion.reply == COMPANION_REPLY_SETUP)
+		HAL_DMA_Start(&hdma_spi1_tx, (uint32_t) companion_setup_tx, (uint32_t) &SPI1->DR,
+				sizeof (companion_setup_tx));
+	else {
+		companion_data_armed = companion_data_latest;
+		HAL_DMA_Start(&hdma_spi1_tx, (uint32_t) companion_data_tx[companion_data_armed], (uint32_t) &SPI1->DR,
+				COMPANION_COMMAND_SIZE + 2 * companion.channels);
+	}
+}
+
+/*
+ * Slave mode with software NSS never resets the shift register, so a
+ * glitch on SCK would leave every later byte misaligned. Reset the
+ * peripheral after each transaction; the RX stream keeps running.
+ */
+static void companion_Resync(void){
+	CLEAR_BIT(SPI1->CR2, SPI_CR2_TXDMAEN);
+	HAL_DMA_Abort(&hdma_spi1_tx);
+
+	__HAL_RCC_SPI1_FORCE_RESET();
+	__HAL_RCC_SPI1_RELEASE_RESET();
+
+	WRITE_REG(SPI1->CR1, companion_cr1);
+	companion_ArmReply();
+	WRITE_REG(SPI1->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+	SET_BIT(SPI1->CR1, SPI_CR1_SPE);
+}
+
+void companion_Start(void){
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	uint8_t *setup = &companion_setup_tx[COMPANION_COMMAND_SIZE];
+
+	companion_Reset(&companion, COMPANION_CHANNELS);
+
+	setup[0] = COMPANION_BOARD_ID & 0xff;
+	setup[1] = COMPANION_BOARD_ID >> 8;
+	setup[2] = ~COMPANION_BOARD_ID & 0xff;
+	setup[3] = (~COMPANION_BOARD_ID >> 8) & 0xff;
+	setup[4] = COMPANION_UPDATE_PERIOD;
+	setup[5] = companion.channels;
+
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hdma_spi1_rx.Instance = DMA2_Stream2;
+	hdma_spi1_rx.Init.Channel = DMA_CHANNEL_3;
+	hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi1_rx.Init.Mode = DMA_CIRCULAR;
+	hdma_spi1_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	hdma_spi1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+
+	hdma_spi1_tx.Instance = DMA2_Stream3;
+	hdma_spi1_tx.Init.Channel = DMA_CHANNEL_3;
+	hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+	hdma_spi1_tx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi1, hdmatx, hdma_spi1_tx);
+
+	companion_cr1 = READ_REG(SPI1->CR1) & ~SPI_CR1_SPE;
+
+	HAL_DMA_Start(&hdma_spi1_rx, (uint32_t) &SPI1->DR, (uint32_t) companion_ring, COMPANION_RING_SIZE);
+	companion_start = companion_Head();
+	companion_Resync();
+
+	/* Altus_CS both edges */
+	GPIO_InitStruct.Pin = Altus_CS_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	HAL_GPIO_Init(Altus_CS_GPIO_Port, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(EXTI4_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(EXTI4_IRQn);
+}
+
+/* Altus_CS edge, from HAL_GPIO_EXTI_Callback */
+void companion_NSS(void){
+	PROFILE_BEGIN(start);
+	uint16_t head = companion_Head();
+	uint32_t frames = companion.frames;
+
+	if (HAL_GPIO_ReadPin(Altus_CS_GPIO_Port, Altus_CS_Pin) == GPIO_PIN_RESET){
+		companion_start = head;
+		return;
+	}
+
+	if (!companion_hil)
+		companion_Decode(&companion, companion_ring, COMPANION_RING_MASK, companion_start,
+				(head - companion_start) & COMPANION_RING_MASK, HAL_GetTick());
+	companion_start = head;
+	companion_Resync();
+	if (companion.frames != frames)
+		companion_cycles = start;
+	PROFILE_END(PROFILE_COMPANION, start);
+}
+
+/*
+ * Control loop: the reply for the next FETCH. Only companion_NSS() can
+ * get in while it's written, and that only ever arms the latest.
+ */
+void companion_Return(const struct companion_return *r){
+	uint8_t slot = 0;
+
+	while (slot == companion_data_latest || slot == companion_data_armed)
+		slot++;
+	companion_EncodeReturn(r, &companion_data_tx[slot][COMPANION_COMMAND_SIZE]);
+	__DMB();
+	companion_data_latest = slot;
+}
+
+/*
+ * Hand the decoder to the host, or back. Either way it starts over
+ * from SETUP, so the two never mix. Not while the TeleMega says we're
+ * flying.
+ */
+int companion_Hil(uint8_t on){
+	uint8_t state = companion_Latest(&companion)->flight_state;
+
+	if (on && !companion_hil && state >= COMPANION_STATE_BOOST && state <= COMPANION_STATE_MAIN)
+		return -1;
+	HAL_NVIC_DisableIRQ(EXTI4_IRQn);
+	companion_Reset(&companion, COMPANION_CHANNELS);
+	companion_hil = on != 0;
+	HAL_NVIC_EnableIRQ(EXTI4_IRQn);
+	return 0;
+}
+
+/* Main loop: one transaction from the host. Returns the command, or -1 */
+int companion_Inject(const uint8_t *data, uint16_t len){
+	uint32_t start = DWT->CYCCNT;
+	uint32_t frames = companion.frames;
+	int command;
+
+	if (!companion_hil)
+		return -1;
+	command = companion_Decode(&companion, data, 0xffff, 0, len, HAL_GetTick());
+	if (companion.frames != frames)
+		companion_cycles = start;
+	return command;
+}
@@ -0,0 +1,113 @@
+/*
+ * control.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Airbrake control law, run once per control tick from the timer
+ * interrupt. Predicts apogee from the latest companion state with the
+ * brakes where they are now (predict.c) and drives the extension with
+ * a PI loop on the predicted overshoot. The brakes only ever come out
+ * during coast; anything else, including stale data, pulls them in.
+ */
+
+#include <math.h>
+#include "control.h"
+#include "profile.h"
+
+static float control_Scale(const struct control *c, int32_t v){
+	return (float) v / (float) (1 << c->lut->h.frac_bits);
+}
+
+/* Cd where the rocket is now; this is what keeps the table window moving */
+static float control_Cd(struct control *c, const struct companion_state *s){
+	PROFILE_BEGIN(start);
+	int32_t v;
+	int found;
+
+	found = c->lut && lut_Lookup(c->lut, s->speed, s->height, &v) != LUT_NONE;
+	PROFILE_END(PROFILE_LUT, start);
+	if (!found)
+		return c->cfg.cd_default;
+	return control_Scale(c, v);
+}
+
+/* Cd further up the predicted coast, from whatever rows are cached */
+static float control_PredictCd(void *arg, float speed, float height){
+	struct control *c = arg;
+	int32_t v;
+
+	if (!c->lut || lut_Peek(c->lut, (int32_t) (speed * 16), (int32_t) height, &v) == LUT_NONE)
+		return c->cd;
+	return control_Scale(c, v);
+}
+
+void control_Init(struct control *c, const struct control_config *cfg, struct lut *lut){
+	c->cfg = *cfg;
+	c->lut = lut;
+	c->mode = CONTROL_IDLE;
+	c->cd = cfg->cd_default;
+	c->predicted = 0;
+	c->error = 0;
+	c->integral = 0;
+	c->extension = 0;
+	c->output = 0;
+	c->ticks = 0;
+	c->model.mass = cfg->mass;
+	c->model.area = cfg->area;
+	c->model.brake_cda = cfg->brake_cda;
+	c->model.rho0 = cfg->rho0;
+	c->model.cd = control_PredictCd;
+	c->model.arg = c;
+}
+
+static float control_Clamp(float v, float lo, float hi){
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static int32_t control_Retract(struct control *c, uint8_t mode){
+	c->mode = mode;
+	c->integral = 0;
+	c->extension = 0;
+	c->output = 0;
+	return 0;
+}
+
+/*
+ * One control tick. position is where the stepper is now and now is
+ * in the same ms clock as s->rx_tick. Returns the stepper target.
+ */
+int32_t control_Step(struct control *c, const struct companion_state *s, int32_t position, uint32_t now){
+	float speed, height, extension;
+
+	c->ticks++;
+
+	if (c->mode == CONTROL_DONE)
+		return c->output;
+	if (s->rx_tick == 0 || now - s->rx_tick > c->cfg.stale_ms)
+		return control_Retract(c, CONTROL_STALE);
+	if (s->flight_state >= COMPANION_STATE_DROGUE && s->flight_state <= COMPANION_STATE_LANDED)
+		return control_Retract(c, CONTROL_DONE);
+	if (s->flight_state != COMPANION_STATE_COAST)
+		return control_Retract(c, CONTROL_IDLE);
+
+	speed = s->speed / 16.0f;
+	height = s->height;
+	if (speed <= 0)
+		return control_Retract(c, CONTROL_DONE);
+	c->mode = CONTROL_ACTIVE;
+
+	extension = control_Clamp((float) position / (float) c->cfg.brake_steps, 0, 1);
+	c->cd = control_Cd(c, s);
+	{
+		PROFILE_BEGIN(start);
+		c->predicted = predict_Apogee(&c->model, c->cfg.method, c->cfg.dt, height, speed, extension);
+		PROFILE_END(PROFILE_PREDICT, start);
+	}
+	c->error = c->predicted - c->cfg.target;
+
+	c->integral = control_Clamp(c->integral + c->cfg.ki * c->error / c->cfg.hz, 0, 1);
+	c->extension = control_Clamp(c->cfg.kp * c->error + c->integral, 0, 1);
+	c->output = (int32_t) lrintf(c->extension * c->cfg.brake_steps);
+	return c->output;
+}
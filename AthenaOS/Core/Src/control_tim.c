@@ -0,0 +1,305 @@
+/*
+ * control_tim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * TIM4 runs the control law at CONTROL_HZ. The update interrupt sits
+ * below the companion and stepper interrupts so it can never delay a
+ * transaction or a step, and above everything the main loop does so
+ * nothing there can delay it. The DWT cycle counter timestamps every
+ * tick to keep track of jitter and worst case execution time. Each
+ * tick is logged to the recorder in flight, to the SD card whenever
+ * there is one, and to telemetry on the bench. The tick, and the time
+ * from a companion frame arriving to the stepper being retargeted for
+ * it, also go to the profiler. If the companion data goes stale,
+ * Athena's own sensors stand in for it.
+ *
+ * The loop runs CONTROL_RECORD_EVERY times per FETCH. Each frame is
+ * stamped with when it arrived and estimate.c carries it forward to
+ * the tick, on the local IMU's acceleration while that's fresh, so the
+ * ticks in between aren't flying on data up to a frame old. The SD
+ * card still logs every tick; the recorder, whose page budget on the
+ * W25Q was sized for one tick per frame, and telemetry keep to that
+ * rate. With the host injecting frames, telemetry also gets a
+ * RECORDER_HIL record with its cycle timestamps on every tick, for the
+ * bench to measure frame to stepper latency, though control records
+ * still only go one tick in CONTROL_RECORD_EVERY.
+ */
+
+#include "main.h"
+#include "Stepper.h"
+#include "control.h"
+#include "recorder.h"
+#include "sdlog.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "governor.h"
+#include "sensor.h"
+#include "estimate.h"
+
+TIM_HandleTypeDef htim4;
+
+struct control control;
+struct estimate estimate;
+volatile struct control_timing control_timing;
+
+static uint32_t control_last;
+static uint8_t control_started;
+static uint8_t control_landed;
+static uint32_t control_frames;
+static uint32_t control_logged;	/* companion frames put on the SD card */
+static uint8_t control_local;	/* flying on our own sensors this tick */
+static uint32_t control_us;		/* this tick, on TIM4's microsecond clock */
+static uint32_t control_stamped;	/* companion frames handed to the estimate */
+static uint8_t control_skip;	/* ticks until the next goes to the recorder */
+
+void control_ResetTiming(void){
+	control_timing.period_min = UINT32_MAX;
+	control_timing.period_max = 0;
+	control_timing.exec_max = 0;
+	control_timing.exec_last = 0;
+	control_timing.overruns = 0;
+	control_started = 0;
+}
+
+void control_Start(void){
+	static const struct control_config cfg = CONTROL_CONFIG_DEFAULT;
+	static const struct estimate_config est = ESTIMATE_CONFIG_DEFAULT;
+
+	control_Init(&control, &cfg, &lut);
+	estimate_Init(&estimate, &est);
+	control_ResetTiming();
+
+	__HAL_RCC_TIM4_CLK_ENABLE();
+
+	htim4.Instance = TIM4;
+	htim4.Init.Prescaler = HAL_RCC_GetPCLK1Freq() * 2 / CONTROL_TICK_HZ - 1;
+	htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim4.Init.Period = CONTROL_TICK_HZ / CONTROL_HZ - 1;
+	htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	if (HAL_TIM_Base_Init(&htim4) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(TIM4_IRQn, 4, 0);
+	HAL_NVIC_EnableIRQ(TIM4_IRQn);
+	if (HAL_TIM_Base_Start_IT(&htim4) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+/* Latest companion state, retrying if a new frame lands while we copy it */
+static void control_Snapshot(struct companion_state *s){
+	uint8_t i;
+
+	do {
+		i = companion.latest;
+		*s = companion.state[i];
+	} while (i != companion.latest);
+}
+
+/*
+ * The companion frame behind this tick, as it came in, for the SD log.
+ * Only the newest is kept, so if two land between ticks the frame
+ * count shows the gap.
+ */
+static void control_Frame(const struct companion_state *s){
+	struct recorder_frame f;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+	uint32_t frames = companion.frames;
+
+	if (frames == control_logged)
+		return;
+	control_logged = frames;
+	f.tick = s->rx_tick;
+	companion_Encode(s, f.command);
+	f.frames = frames;
+	f.errors = companion.errors;
+	recorder_EncodeFrame(rec, &f);
+	sdlog_Add(&sdlog, rec);
+}
+
+/*
+ * Encode this tick once for the bench and both logs: the SD card gets
+ * every tick, telemetry one in CONTROL_RECORD_EVERY, and the recorder
+ * one in CONTROL_RECORD_EVERY from launch to landing, after which the
+ * last page (and SD block) is closed off.
+ */
+static void control_Record(const struct companion_state *s, int32_t position, int32_t target, uint32_t period){
+	struct recorder_control r;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+	uint32_t mhz = SystemCoreClock / 1000000;
+	uint8_t flying = s->flight_state >= COMPANION_STATE_BOOST && s->flight_state <= COMPANION_STATE_LANDED;
+	uint8_t every = control_skip == 0;
+
+	if (!flying)
+		control_landed = 0;
+	control_skip = every ? CONTROL_RECORD_EVERY - 1 : control_skip - 1;
+	if (!sdlog.write && !(every && (telemetry.divisor || (flying && !control_landed))))
+		return;
+
+	r.tick = HAL_GetTick();
+	r.flight_state = s->flight_state;
+	r.mode = control.mode;
+	r.companion_tick = s->tick;
+	r.height = s->height;
+	r.speed = s->speed;
+	r.accel = s->accel;
+	r.cd = control.cd;
+	r.predicted = control.predicted;
+	r.commanded = target;
+	r.position = position;
+	r.exec = control_timing.exec_last / mhz;
+	r.period = period / mhz;
+	r.overruns = control_timing.overruns;
+	r.drops = recorder.drops;
+	recorder_EncodeControl(rec, &r);
+	if (every)
+		telemetry_Add(&telemetry, rec);
+	control_Frame(s);
+	sdlog_Add(&sdlog, rec);
+
+	if (!flying || control_landed)
+		return;
+	if (every)
+		recorder_Add(&recorder, rec);
+	if (s->flight_state == COMPANION_STATE_LANDED){
+		recorder_Pad(&recorder);
+		sdlog_Pad(&sdlog);
+		control_landed = 1;
+	}
+}
+
+/* This tick as the TeleMega will see it at its next FETCH */
+static void control_Return(int32_t position, int32_t target){
+	struct companion_return r;
+
+	r.mode = control.mode;
+	r.flags = 0;
+	if (stepper_home.state == HOME_DONE)
+		r.flags |= COMPANION_RETURN_HOMED;
+	if (governor.profile == GOVERNOR_COAST)
+		r.flags |= COMPANION_RETURN_COAST;
+	if (sdlog.write)
+		r.flags |= COMPANION_RETURN_SD;
+	if (control_local)
+		r.flags |= COMPANION_RETURN_LOCAL;
+	r.position = position;
+	r.target = target;
+	r.extension = control.extension;
+	r.predicted = control.predicted;
+	r.error = control.error;
+	r.cd = control.cd;
+	r.overruns = control_timing.overruns;
+	r.exec_us = control_timing.exec_max / (SystemCoreClock / 1000000);
+	r.slips = stepper_home.slips;
+	companion_Return(&r);
+}
+
+/*
+ * Bring s up to this tick. A new frame is stamped back from now by
+ * however long ago the companion interrupt saw it end; if the IMU is
+ * running and fresh its acceleration takes over from the frame's. If
+ * the frames have gone stale our own estimate stands in instead, and
+ * that's returned.
+ */
+static uint8_t control_Estimate(struct companion_state *s, uint32_t frames, uint32_t tick, uint32_t start){
+	const struct sensor_estimate *e = sensor_Latest(&sensor);
+	uint32_t mhz = SystemCoreClock / 1000000;
+
+	if (frames != control_stamped){
+		control_stamped = frames;
+		estimate_Frame(&estimate, s, control_us - (start - companion_cycles) / mhz);
+	}
+	if (sensor.imu_state == SENSOR_IMU_RUN && tick - sensor.imu_tick <= SENSOR_FRESH_MS)
+		estimate_Accel(&estimate, e->accel, control_us);
+	if (sensor_Cover(e, s, tick, control.cfg.stale_ms))
+		return 1;
+	estimate_Step(&estimate, s, control_us);
+	return 0;
+}
+
+/* Every tick while the host is injecting frames, with when it saw them */
+static void control_Hil(const struct companion_state *s, int32_t position, int32_t target,
+		uint32_t start, uint32_t done){
+	struct recorder_hil h;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	h.tick = HAL_GetTick();
+	h.mode = control.mode;
+	h.flags = 0;
+	if (companion.frames != control_frames)
+		h.flags |= RECORDER_HIL_FRAME;
+	if (control_local)
+		h.flags |= RECORDER_HIL_LOCAL;
+	h.companion_tick = s->tick;
+	h.height = s->height;
+	h.speed = s->speed;
+	h.commanded = target;
+	h.position = position;
+	h.frame_cycles = companion_cycles;
+	h.start_cycles = start;
+	h.done_cycles = done;
+	h.mhz = (uint8_t) (SystemCoreClock / 1000000);
+	recorder_EncodeHil(rec, &h);
+	telemetry_Add(&telemetry, rec);
+}
+
+/* TIM4 update */
+void control_IRQ(void){
+	uint32_t start = DWT->CYCCNT;
+	struct companion_state s;
+	int32_t target, position;
+	uint32_t period = 0, exec, tick, frames;
+
+	if (!__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_UPDATE))
+		return;
+	__HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE);
+
+	if (control_started){
+		period = start - control_last;
+		if (period < control_timing.period_min)
+			control_timing.period_min = period;
+		if (period > control_timing.period_max)
+			control_timing.period_max = period;
+	}
+	control_last = start;
+	control_started = 1;
+	control_us += CONTROL_TICK_HZ / CONTROL_HZ;
+
+	/* Counted before the copy: a frame landing in between is only seen twice, never missed */
+	frames = companion.frames;
+	control_Snapshot(&s);
+	tick = HAL_GetTick();
+	control_local = control_Estimate(&s, frames, tick, start);
+	position = stepper_Position();
+	target = control_Step(&control, &s, position, tick);
+	if (target != stepper_motion.target)
+		stepper_Retarget(target);
+	if (companion_hil)
+		control_Hil(&s, position, target, start, DWT->CYCCNT);
+	if (companion.frames != control_frames){
+		uint32_t now = DWT->CYCCNT;
+
+		control_frames = companion.frames;
+		profile_Add(&profile.probe[PROFILE_LATENCY], now - companion_cycles);
+		profile_Trace(&profile, PROFILE_LATENCY, now, now - companion_cycles);
+	}
+	control_Record(&s, position, target, period);
+	control_Return(position, target);
+
+	/* Still running when the next tick came due */
+	if (__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_UPDATE))
+		control_timing.overruns++;
+
+	exec = DWT->CYCCNT - start;
+	control_timing.exec_last = exec;
+	if (exec > control_timing.exec_max)
+		control_timing.exec_max = exec;
+	profile_Add(&profile.probe[PROFILE_CONTROL], exec);
+	profile_Trace(&profile, PROFILE_CONTROL, start + exec, exec);
+}
@@ -0,0 +1,46 @@
+/*
+ * crc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Shared with the host tools, so both ends agree on every check.
+ * crc32 is table driven because it runs over whole drag tables.
+ */
+
+#include "crc.h"
+
+uint16_t crc16(uint16_t crc, const uint8_t *buf, uint32_t len){
+	int i;
+
+	while (len--){
+		crc ^= (uint16_t) *buf++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static uint32_t crc32_table[256];
+
+static void crc32_init(void){
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++){
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = c & 1 ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+		crc32_table[i] = c;
+	}
+}
+
+/* Pass the previous return value to continue a running CRC */
+uint32_t crc32(uint32_t crc, const uint8_t *buf, uint32_t len){
+	if (crc32_table[1] == 0)
+		crc32_init();
+	crc = ~crc;
+	while (len--)
+		crc = crc32_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
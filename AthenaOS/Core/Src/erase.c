@@ -0,0 +1,101 @@
+/*
+ * erase.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Background erase ahead of the flight log. A 64K block erase holds
+ * the chip for the best part of a second and a chip erase for most of
+ * a minute; a 4K sector takes 45 ms or so, and the log only needs the
+ * few just ahead of where it's writing. Between status polls the main
+ * loop carries on as usual.
+ */
+
+#include <string.h>
+#include "erase.h"
+
+static int erase_IsReady(const struct erase *e, uint32_t s){
+	return (e->map[s >> 3] >> (s & 7)) & 1;
+}
+
+static void erase_SetReady(struct erase *e, uint32_t s){
+	e->map[s >> 3] |= 1 << (s & 7);
+}
+
+void erase_Init(struct erase *e, uint32_t base, uint32_t len,
+		int (*start)(uint32_t addr), int (*busy)(void)){
+	e->base = base;
+	e->sectors = len / ERASE_SECTOR_SIZE;
+	if (e->sectors > ERASE_MAX_SECTORS)
+		e->sectors = ERASE_MAX_SECTORS;
+	e->head = 0;
+	e->erasing = -1;
+	e->erases = 0;
+	e->start = start;
+	e->busy = busy;
+	memset(e->map, 0, sizeof (e->map));
+}
+
+/*
+ * The writer starts over at head; nothing past it is known to be
+ * erased any more. The rest of a part written sector was left erased
+ * by whoever stopped writing it, so that sector is good to carry on in.
+ * An erase already running still counts when it finishes.
+ */
+void erase_Restart(struct erase *e, uint32_t head){
+	uint32_t off = head - e->base;
+
+	memset(e->map, 0, sizeof (e->map));
+	e->head = off / ERASE_SECTOR_SIZE;
+	if (off % ERASE_SECTOR_SIZE && e->head < e->sectors)
+		erase_SetReady(e, e->head);
+}
+
+/*
+ * Can [addr, addr + len) be programmed yet? Moves the head along to
+ * addr. Nothing goes into a sector until the one after it has been
+ * erased as well, so wherever the power goes there's a blank sector
+ * just past the log for the boot scan to stop at, and never old data.
+ */
+int erase_Ready(struct erase *e, uint32_t addr, uint32_t len){
+	uint32_t s = (addr - e->base) / ERASE_SECTOR_SIZE;
+	uint32_t last = (addr + (len ? len : 1) - 1 - e->base) / ERASE_SECTOR_SIZE + 1;
+
+	if (s >= e->sectors)
+		return 1;
+	e->head = s;
+	if (last >= e->sectors)
+		last = e->sectors - 1;
+	for (; s <= last; s++)
+		if (!erase_IsReady(e, s))
+			return 0;
+	return 1;
+}
+
+/*
+ * Main loop: see to the erase in progress, or start the next one
+ * needed. A page held back for the sector just finished gets the chip
+ * before the next erase does.
+ */
+void erase_Poll(struct erase *e){
+	uint32_t s, last;
+
+	if (e->erasing >= 0){
+		if (e->busy())
+			return;
+		erase_SetReady(e, e->erasing);
+		e->erasing = -1;
+		e->erases++;
+		return;
+	}
+
+	last = e->head + ERASE_AHEAD;
+	if (last > e->sectors)
+		last = e->sectors;
+	for (s = e->head; s < last; s++)
+		if (!erase_IsReady(e, s)){
+			if (e->start(e->base + s * ERASE_SECTOR_SIZE) == 0)
+				e->erasing = s;
+			return;
+		}
+}
@@ -0,0 +1,111 @@
+/*
+ * estimate.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Carries the TeleMega's height and speed from one companion frame to
+ * the next so the control loop can tick faster than the link. The
+ * track is a constant acceleration segment from the last frame, or
+ * from the last time the local IMU said otherwise, and stops moving
+ * max_us past the frame so a link that's gone quiet isn't flown on
+ * for long (control.c retracts the brakes once it's stale anyway).
+ * When a frame lands the difference between its height and where the
+ * track had got to is kept and faded out linearly, so the controller
+ * never sees the height step by a metre of quantization. Times are
+ * microseconds; everything is differences, so the wrap doesn't matter.
+ */
+
+#include <math.h>
+#include "estimate.h"
+
+static int16_t estimate_Clamp16(float v){
+	return v >= 32767.0f ? 32767 : v <= -32768.0f ? -32768 : (int16_t) lrintf(v);
+}
+
+void estimate_Init(struct estimate *e, const struct estimate_config *cfg){
+	e->cfg = *cfg;
+	e->valid = 0;
+	e->tick = 0;
+	e->frame_us = 0;
+	e->base_us = 0;
+	e->height = 0;
+	e->speed = 0;
+	e->accel = 0;
+	e->offset = 0;
+	e->frames = 0;
+	e->snaps = 0;
+}
+
+/* Move the track up to now, but not past max_us after the frame */
+static void estimate_Advance(struct estimate *e, uint32_t now){
+	uint32_t to = now;
+	float dt;
+
+	if ((int32_t) (now - e->base_us) <= 0)
+		return;
+	if ((int32_t) (now - (e->frame_us + e->cfg.max_us)) > 0)
+		to = e->frame_us + e->cfg.max_us;
+	if ((int32_t) (to - e->base_us) > 0){
+		dt = (to - e->base_us) * 1e-6f;
+		e->height += e->speed * dt + 0.5f * e->accel * dt * dt;
+		e->speed += e->accel * dt;
+	}
+	e->base_us = now;
+}
+
+/* How much of the correction is still to come, 1 when the frame lands */
+static float estimate_Fade(const struct estimate *e, uint32_t now){
+	int32_t since = (int32_t) (now - e->frame_us);
+
+	if (since <= 0)
+		return 1;
+	if (e->cfg.blend_us == 0 || (uint32_t) since >= e->cfg.blend_us)
+		return 0;
+	return 1 - (float) since / e->cfg.blend_us;
+}
+
+/* A frame that arrived at stamp. NOTIFYs repeat the last tick's data and are skipped */
+void estimate_Frame(struct estimate *e, const struct companion_state *s, uint32_t stamp){
+	float height;
+
+	if (e->valid && s->tick == e->tick)
+		return;
+	estimate_Advance(e, stamp);
+	height = e->height + e->offset * estimate_Fade(e, stamp);
+
+	e->height = s->height;
+	e->speed = s->speed / 16.0f;
+	e->accel = s->accel / 16.0f;
+	e->frame_us = stamp;
+	e->base_us = stamp - e->cfg.latency_us;
+	estimate_Advance(e, stamp);
+
+	e->offset = e->valid ? height - e->height : 0;
+	if (fabsf(e->offset) > e->cfg.snap){
+		e->offset = 0;
+		e->snaps++;
+	}
+	e->valid = 1;
+	e->tick = s->tick;
+	e->frames++;
+}
+
+/* The local IMU's acceleration, for the rest of the way to the next frame */
+void estimate_Accel(struct estimate *e, float accel, uint32_t now){
+	if (!e->valid)
+		return;
+	estimate_Advance(e, now);
+	e->accel = accel;
+}
+
+/* Height, speed and accel in s brought up to now. Returns 0 before the first frame */
+int estimate_Step(struct estimate *e, struct companion_state *s, uint32_t now){
+	if (!e->valid)
+		return 0;
+	estimate_Advance(e, now);
+	s->height = estimate_Clamp16(e->height + e->offset * estimate_Fade(e, now));
+	s->speed = estimate_Clamp16(e->speed * 16.0f);
+	s->accel = estimate_Clamp16(e->accel * 16.0f);
+	return 1;
+}
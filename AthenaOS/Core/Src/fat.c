@@ -0,0 +1,346 @@
+/*
+ * fat.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Creates preallocated files on a FAT16 or FAT32 card. Everything goes
+ * through one sector buffer and the read/write hooks, so it runs the
+ * same against the card at boot and against a RAM image on the bench.
+ * Only used before flight: finding a long free run can mean reading
+ * most of the FAT.
+ */
+
+#include <string.h>
+#include "fat.h"
+
+#define FAT_ATTR_ARCHIVE	0x20
+#define FAT_ATTR_VOLUME		0x08	/* also set in long name entries */
+#define FAT_DATE_NONE		0x0021	/* 1980-01-01, we've no clock */
+
+#define FAT_FSINFO_LEAD		0x41615252
+#define FAT_FSINFO_STRUCT	0x61417272
+
+static uint16_t get16(const uint8_t *p){
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v & 0xffff);
+	put16(p + 2, v >> 16);
+}
+
+static int fat_Get(struct fat *f, uint32_t lba){
+	if (f->cached == lba)
+		return FAT_OK;
+	f->cached = FAT_NONE;
+	if (f->read(lba, f->buf) != 0)
+		return FAT_IO;
+	f->cached = lba;
+	return FAT_OK;
+}
+
+static uint32_t fat_ClusterSector(const struct fat *f, uint32_t cluster){
+	return f->data_start + (cluster - 2) * f->sectors_per_cluster;
+}
+
+static uint32_t fat_EntrySize(const struct fat *f){
+	return f->fat32 ? 4 : 2;
+}
+
+static int fat_Entry(struct fat *f, uint32_t cluster, uint32_t *v){
+	uint32_t off = cluster * fat_EntrySize(f);
+
+	if (fat_Get(f, f->fat_start + off / FAT_SECTOR_SIZE) != 0)
+		return FAT_IO;
+	off %= FAT_SECTOR_SIZE;
+	*v = f->fat32 ? get32(f->buf + off) & 0x0fffffff : get16(f->buf + off);
+	return FAT_OK;
+}
+
+int fat_Mount(struct fat *f, int (*read)(uint32_t lba, uint8_t *data),
+		int (*write)(uint32_t lba, const uint8_t *data)){
+	const uint8_t *b = f->buf;
+	uint32_t start = 0, total, reserved, root_sectors;
+
+	f->read = read;
+	f->write = write;
+	f->cached = FAT_NONE;
+
+	if (fat_Get(f, 0) != 0)
+		return FAT_IO;
+	if (get16(b + 510) != 0xaa55)
+		return FAT_NOFS;
+
+	/* A boot sector up front means the card was never partitioned */
+	if (b[0] != 0xeb && b[0] != 0xe9){
+		switch (b[0x1be + 4]){
+		case 0x04:	/* FAT16 up to 32M */
+		case 0x06:	/* FAT16 over 32M */
+		case 0x0e:	/* FAT16 LBA */
+		case 0x0b:	/* FAT32 */
+		case 0x0c:	/* FAT32 LBA */
+			break;
+		default:
+			return FAT_NOFS;
+		}
+		start = get32(b + 0x1be + 8);
+		if (fat_Get(f, start) != 0)
+			return FAT_IO;
+		if (get16(b + 510) != 0xaa55)
+			return FAT_NOFS;
+	}
+
+	if (get16(b + 11) != FAT_SECTOR_SIZE || b[13] == 0 || b[16] == 0)
+		return FAT_NOFS;
+	f->sectors_per_cluster = b[13];
+	reserved = get16(b + 14);
+	f->number_fat = b[16];
+	f->root_entries = get16(b + 17);
+	total = get16(b + 19);
+	if (total == 0)
+		total = get32(b + 32);
+	f->sectors_per_fat = get16(b + 22);
+	if (f->sectors_per_fat == 0)
+		f->sectors_per_fat = get32(b + 36);
+
+	root_sectors = (f->root_entries * FAT_DIRENT_SIZE + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+	f->fat_start = start + reserved;
+	f->root_start = f->fat_start + f->number_fat * f->sectors_per_fat;
+	f->data_start = f->root_start + root_sectors;
+	if (start + total <= f->data_start)
+		return FAT_NOFS;
+	f->clusters = (start + total - f->data_start) / f->sectors_per_cluster;
+
+	/* The cluster count alone says which FAT it is; FAT12 isn't worth it */
+	if (f->clusters < 4085)
+		return FAT_NOFS;
+	f->fat32 = f->clusters >= 65525;
+	f->root_cluster = 0;
+	f->fsinfo = 0;
+	if (f->fat32){
+		if (f->root_entries != 0)
+			return FAT_NOFS;
+		f->root_cluster = get32(b + 44);
+		if (get16(b + 48) != 0 && get16(b + 48) != 0xffff)
+			f->fsinfo = start + get16(b + 48);
+	}
+	if (f->sectors_per_fat * (FAT_SECTOR_SIZE / fat_EntrySize(f)) < f->clusters + 2)
+		return FAT_NOFS;
+	return FAT_OK;
+}
+
+/*
+ * Call look() with each root directory entry that names a file, until
+ * it returns nonzero, and leave the first free entry in *free_lba and
+ * *free_off (*free_lba 0 if there isn't one). The FAT32 root directory
+ * is never grown.
+ */
+static int fat_Scan(struct fat *f, int (*look)(const uint8_t *dent, void *arg), void *arg,
+		uint32_t *free_lba, uint16_t *free_off){
+	uint32_t cluster = f->root_cluster, lba, left, next;
+	const uint8_t *d;
+	uint16_t off;
+	int r;
+
+	*free_lba = 0;
+	if (f->fat32){
+		lba = fat_ClusterSector(f, cluster);
+		left = f->sectors_per_cluster;
+	}
+	else {
+		lba = f->root_start;
+		left = f->data_start - f->root_start;
+	}
+
+	while (left){
+		if (fat_Get(f, lba) != 0)
+			return FAT_IO;
+		for (off = 0; off < FAT_SECTOR_SIZE; off += FAT_DIRENT_SIZE){
+			d = f->buf + off;
+			if (d[0] == 0x00 || d[0] == 0xe5){
+				if (!*free_lba){
+					*free_lba = lba;
+					*free_off = off;
+				}
+				/* Nothing past the first entry never used */
+				if (d[0] == 0x00)
+					return FAT_OK;
+				continue;
+			}
+			if (d[11] & FAT_ATTR_VOLUME)
+				continue;
+			if ((r = look(d, arg)) != 0)
+				return r;
+		}
+		lba++;
+		if (--left || !f->fat32)
+			continue;
+		if (fat_Entry(f, cluster, &next) != 0)
+			return FAT_IO;
+		if (next < 2 || next >= f->clusters + 2)
+			break;
+		cluster = next;
+		lba = fat_ClusterSector(f, cluster);
+		left = f->sectors_per_cluster;
+	}
+	return FAT_OK;
+}
+
+/* First fit: the lowest run of need free clusters */
+static int fat_FindRun(struct fat *f, uint32_t need, uint32_t *first){
+	uint32_t c, v, run = 0;
+
+	for (c = 2; c < f->clusters + 2; c++){
+		if (fat_Entry(f, c, &v) != 0)
+			return FAT_IO;
+		if (v != 0){
+			run = 0;
+			continue;
+		}
+		if (++run == need){
+			*first = c - need + 1;
+			return FAT_OK;
+		}
+	}
+	return FAT_FULL;
+}
+
+/* Link count clusters from first into one chain, a FAT sector at a time, in every FAT */
+static int fat_Chain(struct fat *f, uint32_t first, uint32_t count){
+	uint32_t per = FAT_SECTOR_SIZE / fat_EntrySize(f);
+	uint32_t last = first + count - 1, c = first, sector, v, i;
+	uint8_t *p;
+
+	while (c <= last){
+		sector = f->fat_start + c / per;
+		if (fat_Get(f, sector) != 0)
+			return FAT_IO;
+		do {
+			p = f->buf + (c % per) * fat_EntrySize(f);
+			v = c == last ? 0x0fffffff : c + 1;
+			if (f->fat32)
+				put32(p, (get32(p) & 0xf0000000) | v);
+			else
+				put16(p, (uint16_t) v);
+			c++;
+		} while (c <= last && c % per);
+		for (i = 0; i < f->number_fat; i++)
+			if (f->write(sector + i * f->sectors_per_fat, f->buf) != 0)
+				return FAT_IO;
+	}
+	return FAT_OK;
+}
+
+static int fat_Same(const uint8_t *dent, void *arg){
+	return memcmp(dent, arg, 11) == 0 ? FAT_EXISTS : 0;
+}
+
+/*
+ * Create name (space padded 8.3, upper case) size bytes long, in one
+ * run of clusters, and say where its first sector is. The FAT goes
+ * out before the directory entry, so losing power part way leaves at
+ * worst some lost clusters. FSInfo's free count is marked unknown for
+ * the host to work out again rather than kept up to date.
+ */
+int fat_Create(struct fat *f, const char name[11], uint32_t size, uint32_t *lba){
+	uint32_t cluster_size = (uint32_t) f->sectors_per_cluster * FAT_SECTOR_SIZE;
+	uint32_t need = size ? (size - 1) / cluster_size + 1 : 0;
+	uint32_t first = 0, dir_lba;
+	uint16_t dir_off;
+	uint8_t *d;
+	int r;
+
+	if ((r = fat_Scan(f, fat_Same, (void *) name, &dir_lba, &dir_off)) != 0)
+		return r;
+	if (!dir_lba)
+		return FAT_DIR_FULL;
+	if (need){
+		if ((r = fat_FindRun(f, need, &first)) != 0)
+			return r;
+		if ((r = fat_Chain(f, first, need)) != 0)
+			return r;
+	}
+
+	if (fat_Get(f, dir_lba) != 0)
+		return FAT_IO;
+	d = f->buf + dir_off;
+	memset(d, 0, FAT_DIRENT_SIZE);
+	memcpy(d, name, 11);
+	d[11] = FAT_ATTR_ARCHIVE;
+	put16(d + 16, FAT_DATE_NONE);
+	put16(d + 18, FAT_DATE_NONE);
+	put16(d + 20, (uint16_t) (first >> 16));
+	put16(d + 24, FAT_DATE_NONE);
+	put16(d + 26, (uint16_t) first);
+	put32(d + 28, size);
+	if (f->write(dir_lba, f->buf) != 0)
+		return FAT_IO;
+
+	if (f->fsinfo && fat_Get(f, f->fsinfo) == 0 &&
+			get32(f->buf) == FAT_FSINFO_LEAD && get32(f->buf + 484) == FAT_FSINFO_STRUCT){
+		put32(f->buf + 488, 0xffffffff);
+		put32(f->buf + 492, first + need);
+		if (f->write(f->fsinfo, f->buf) != 0)
+			return FAT_IO;
+	}
+
+	*lba = fat_ClusterSector(f, first);
+	return FAT_OK;
+}
+
+struct fat_number {
+	const char	*prefix;
+	const char	*ext;
+	int			max;
+};
+
+static int fat_Number(const uint8_t *dent, void *arg){
+	struct fat_number *n = arg;
+	int i, v = 0;
+
+	if (memcmp(dent, n->prefix, 4) != 0 || memcmp(dent + 8, n->ext, 3) != 0)
+		return 0;
+	for (i = 4; i < 8; i++){
+		if (dent[i] < '0' || dent[i] > '9')
+			return 0;
+		v = v * 10 + dent[i] - '0';
+	}
+	if (v > n->max)
+		n->max = v;
+	return 0;
+}
+
+/* One past the highest PPPPnnnn.EXT in the root directory, 0 for none yet */
+int fat_NextNumber(struct fat *f, const char prefix[4], const char ext[3]){
+	struct fat_number n = { prefix, ext, -1 };
+	uint32_t dir_lba;
+	uint16_t dir_off;
+	int r;
+
+	if ((r = fat_Scan(f, fat_Number, &n, &dir_lba, &dir_off)) != 0)
+		return r;
+	if (n.max == 9999)
+		return FAT_DIR_FULL;
+	return n.max + 1;
+}
+
+void fat_Name(char name[11], const char prefix[4], const char ext[3], int number){
+	int i;
+
+	memcpy(name, prefix, 4);
+	for (i = 7; i >= 4; i--){
+		name[i] = (char) ('0' + number % 10);
+		number /= 10;
+	}
+	memcpy(name + 8, ext, 3);
+}
@@ -0,0 +1,115 @@
+/*
+ * fault.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Fault records, as written by the fault handlers and read back by
+ * Tools/faultdump. Encoding only copies words about, so it's safe
+ * to run from a handler with the rest of the system in pieces.
+ */
+
+#include <string.h>
+#include "crc.h"
+#include "fault.h"
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+/* Unroll the profiler's trace ring, head events in, oldest first */
+void fault_SetTrace(struct fault *f, const struct profile_event *trace, uint32_t head){
+	uint32_t n = head < FAULT_TRACE ? head : FAULT_TRACE;
+	uint32_t i;
+
+	f->trace_head = head;
+	f->trace_count = (uint8_t) n;
+	for (i = 0; i < n; i++)
+		f->trace[i] = trace[(head - n + i) & (PROFILE_TRACE - 1)];
+}
+
+void fault_Encode(uint8_t *rec, const struct fault *f){
+	int i;
+
+	memset(rec, 0, FAULT_RECORD_SIZE);
+	put32(rec, FAULT_MAGIC);
+	rec[4] = FAULT_VERSION;
+	rec[5] = f->type;
+	rec[6] = f->stack_words;
+	rec[7] = f->trace_count;
+	put32(rec + 8, f->tick);
+	for (i = 0; i < FAULT_FRAME; i++)
+		put32(rec + 12 + 4 * i, f->frame[i]);
+	put32(rec + 44, f->exc_return);
+	put32(rec + 48, f->sp);
+	put32(rec + 52, f->cfsr);
+	put32(rec + 56, f->hfsr);
+	put32(rec + 60, f->mmfar);
+	put32(rec + 64, f->bfar);
+	put32(rec + 68, f->cycles);
+	put32(rec + 72, f->trace_head);
+	for (i = 0; i < FAULT_STACK; i++)
+		put32(rec + 76 + 4 * i, f->stack[i]);
+	for (i = 0; i < FAULT_TRACE; i++){
+		put32(rec + 204 + 8 * i, f->trace[i].at);
+		put32(rec + 208 + 8 * i, f->trace[i].cycles);
+	}
+	put32(rec + FAULT_RECORD_SIZE - 4, crc32(CRC32_INIT, rec, FAULT_RECORD_SIZE - 4));
+}
+
+/* 0 for a good record, FAULT_EMPTY for an unused slot or FAULT_BAD */
+int fault_Decode(const uint8_t *rec, struct fault *f){
+	int i;
+
+	if (get32(rec) == 0xffffffff)
+		return FAULT_EMPTY;
+	if (get32(rec) != FAULT_MAGIC || rec[4] != FAULT_VERSION)
+		return FAULT_BAD;
+	if (get32(rec + FAULT_RECORD_SIZE - 4) != crc32(CRC32_INIT, rec, FAULT_RECORD_SIZE - 4))
+		return FAULT_BAD;
+
+	f->type = rec[5];
+	f->stack_words = rec[6] < FAULT_STACK ? rec[6] : FAULT_STACK;
+	f->trace_count = rec[7] < FAULT_TRACE ? rec[7] : FAULT_TRACE;
+	f->tick = get32(rec + 8);
+	for (i = 0; i < FAULT_FRAME; i++)
+		f->frame[i] = get32(rec + 12 + 4 * i);
+	f->exc_return = get32(rec + 44);
+	f->sp = get32(rec + 48);
+	f->cfsr = get32(rec + 52);
+	f->hfsr = get32(rec + 56);
+	f->mmfar = get32(rec + 60);
+	f->bfar = get32(rec + 64);
+	f->cycles = get32(rec + 68);
+	f->trace_head = get32(rec + 72);
+	for (i = 0; i < FAULT_STACK; i++)
+		f->stack[i] = get32(rec + 76 + 4 * i);
+	for (i = 0; i < FAULT_TRACE; i++){
+		f->trace[i].at = get32(rec + 204 + 8 * i);
+		f->trace[i].cycles = get32(rec + 208 + 8 * i);
+	}
+	return 0;
+}
+
+const char *fault_Name(uint8_t type){
+	switch (type){
+	case FAULT_NMI:
+		return "NMI";
+	case FAULT_HARD:
+		return "HardFault";
+	case FAULT_MEMMANAGE:
+		return "MemManage";
+	case FAULT_BUS:
+		return "BusFault";
+	case FAULT_USAGE:
+		return "UsageFault";
+	}
+	return "unknown";
+}
@@ -0,0 +1,195 @@
+/*
+ * fault_flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Hard, MemManage, Bus and Usage faults land here instead of the
+ * CubeMX spin loops in stm32f4xx_it.c: the vector table is copied to
+ * RAM with those four entries pointing at fault_Entry. The handler
+ * stops the stepper, writes a fault record to the first free slot of
+ * the fault sector and resets, so the board is back in the air in
+ * milliseconds with the evidence kept for Tools/faultdump.
+ *
+ * Nothing here trusts the state the fault left behind: the record is
+ * built on a stack of its own, and the flash is driven straight from
+ * the SPI2 registers with the DMA stopped, not through HAL or flash.c.
+ */
+
+#include <string.h>
+#include "main.h"
+#include "flash.h"
+#include "profile.h"
+#include "fault.h"
+
+#define FAULT_VECTORS		128		/* 16 + 97 on the F446, rounded up to the VTOR alignment */
+#define FAULT_STACK_WORDS	256		/* fault_Entry knows this too */
+
+extern uint32_t _estack;
+
+static uint32_t fault_vectors[FAULT_VECTORS] __attribute__((aligned(4 * FAULT_VECTORS)));
+static uint32_t fault_stack[FAULT_STACK_WORDS] __attribute__((used));
+static uint8_t fault_rec[FAULT_RECORD_SIZE];
+
+void fault_Entry(void);
+void fault_Capture(uint32_t *frame, uint32_t exc_return) __attribute__((noreturn, used));
+
+/*
+ * Find the stacked frame from EXC_RETURN, then carry on in C on the
+ * fault stack in case it was a stack overflow that got us here.
+ */
+__attribute__((naked)) void fault_Entry(void){
+	__asm volatile(
+		"tst	lr, #4\n"
+		"ite	eq\n"
+		"mrseq	r0, msp\n"
+		"mrsne	r0, psp\n"
+		"mov	r1, lr\n"
+		"movw	r2, #:lower16:fault_stack + 4 * 256\n"
+		"movt	r2, #:upper16:fault_stack + 4 * 256\n"
+		"mov	sp, r2\n"
+		"b		fault_Capture\n");
+}
+
+static uint8_t fault_Spi(uint8_t data){
+	while (!(SPI2->SR & SPI_SR_TXE)){}
+	*(volatile uint8_t *) &SPI2->DR = data;
+	while (!(SPI2->SR & SPI_SR_RXNE)){}
+	return *(volatile uint8_t *) &SPI2->DR;
+}
+
+static void fault_Select(void){
+	Flash_CS_GPIO_Port->BSRR = (uint32_t) Flash_CS_Pin << 16;
+}
+
+static void fault_Deselect(void){
+	while (SPI2->SR & SPI_SR_BSY){}
+	Flash_CS_GPIO_Port->BSRR = Flash_CS_Pin;
+}
+
+static void fault_Command(uint8_t command, uint32_t addr){
+	fault_Select();
+	fault_Spi(command);
+	fault_Spi((addr >> 16) & 0xff);
+	fault_Spi((addr >> 8) & 0xff);
+	fault_Spi(addr & 0xff);
+}
+
+static void fault_WaitReady(void){
+	uint8_t status;
+
+	do {
+		fault_Select();
+		fault_Spi(0x05);
+		status = fault_Spi(0x00);
+		fault_Deselect();
+	} while (status & FLASH_SR1_BUSY);
+}
+
+/* Take SPI2 back from whatever DMA transfer the fault interrupted */
+static void fault_FlashTake(void){
+	DMA1_Stream3->CR &= ~DMA_SxCR_EN;
+	DMA1_Stream4->CR &= ~DMA_SxCR_EN;
+	SPI2->CR2 &= ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+	fault_Deselect();
+	SPI2->CR1 |= SPI_CR1_SPE;
+	(void) SPI2->DR;
+	(void) SPI2->SR;
+
+	/* A background erase may be suspended under a read; let it finish */
+	fault_Select();
+	fault_Spi(0x7A);
+	fault_Deselect();
+	fault_WaitReady();
+}
+
+static void fault_Save(const uint8_t *rec){
+	uint32_t addr, magic;
+	int slot, i, page;
+
+	fault_FlashTake();
+	for (slot = 0; slot < FAULT_SLOTS; slot++){
+		addr = FLASH_FAULT_ADDR + slot * FAULT_RECORD_SIZE;
+		fault_Command(0x03, addr);
+		magic = 0;
+		for (i = 0; i < 4; i++)
+			magic |= (uint32_t) fault_Spi(0x00) << (8 * i);
+		fault_Deselect();
+		if (magic != 0xffffffff)
+			continue;
+
+		for (page = 0; page < FAULT_RECORD_SIZE; page += FLASH_PAGE_SIZE){
+			fault_Select();
+			fault_Spi(0x06);
+			fault_Deselect();
+			fault_Command(0x02, addr + page);
+			for (i = 0; i < FLASH_PAGE_SIZE; i++)
+				fault_Spi(rec[page + i]);
+			fault_Deselect();
+			fault_WaitReady();
+		}
+		return;
+	}
+}
+
+static int fault_InRam(uint32_t addr, uint32_t len){
+	return addr >= SRAM1_BASE && addr <= (uint32_t) &_estack - len;
+}
+
+void fault_Capture(uint32_t *frame, uint32_t exc_return){
+	struct fault f;
+	uint32_t sp = (uint32_t) frame;
+	uint32_t past;
+	int i;
+
+	__disable_irq();
+
+	/* Brakes stay where they are; the timer would otherwise keep stepping */
+	TIM3->CR1 &= ~TIM_CR1_CEN;
+	Step_EN_GPIO_Port->BSRR = Step_EN_Pin;
+
+	memset(&f, 0, sizeof (f));
+	f.type = SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk;
+	f.tick = HAL_GetTick();
+	f.exc_return = exc_return;
+	f.sp = sp;
+	f.cfsr = SCB->CFSR;
+	f.hfsr = SCB->HFSR;
+	f.mmfar = SCB->MMFAR;
+	f.bfar = SCB->BFAR;
+	f.cycles = DWT->CYCCNT;
+
+	if (fault_InRam(sp, 4 * FAULT_FRAME))
+		for (i = 0; i < FAULT_FRAME; i++)
+			f.frame[i] = frame[i];
+
+	/* The caller's stack starts past the frame, and past the FPU state if that was stacked too */
+	past = sp + 4 * ((exc_return & 0x10) ? FAULT_FRAME : FAULT_FRAME + 18);
+	for (i = 0; i < FAULT_STACK && fault_InRam(past + 4 * i, 4); i++)
+		f.stack[i] = ((uint32_t *) past)[i];
+	f.stack_words = i;
+
+	fault_SetTrace(&f, profile.trace, profile.trace_head);
+
+	fault_Encode(fault_rec, &f);
+	fault_Save(fault_rec);
+	NVIC_SystemReset();
+}
+
+void fault_Start(void){
+	const uint32_t *vectors = (const uint32_t *) SCB->VTOR;
+
+	memcpy(fault_vectors, vectors, sizeof (fault_vectors));
+	fault_vectors[FAULT_HARD] = (uint32_t) fault_Entry;
+	fault_vectors[FAULT_MEMMANAGE] = (uint32_t) fault_Entry;
+	fault_vectors[FAULT_BUS] = (uint32_t) fault_Entry;
+	fault_vectors[FAULT_USAGE] = (uint32_t) fault_Entry;
+
+	__disable_irq();
+	SCB->VTOR = (uint32_t) fault_vectors;
+	__DSB();
+	__enable_irq();
+
+	/* Their own handlers rather than all escalating to HardFault, so CFSR says which */
+	SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+}
@@ -5,30 +5,113 @@
  *      Author: Dylan
  */
 
-#include "stm32f4xx_hal.h"
-#include "stepper.h"
+#include "main.h"
+#include "flash.h"
+
+extern SPI_HandleTypeDef hspi2;
+
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
+
+static volatile uint8_t flash_dma_busy;
+static void (*flash_dma_done)(void);
+
+/* Sector erase running in the background, and whether a read has it suspended */
+static uint8_t flash_erasing;
+static uint8_t flash_suspended;
+
+struct flash_write {
+	uint32_t		addr;
+	const uint8_t	*data;
+	uint32_t		len;
+	void			(*done)(void);
+};
+
+static struct flash_write flash_queue[FLASH_WRITE_QUEUE];
+static uint8_t flash_queue_head;
+static uint8_t flash_queue_count;
+
+void flashInit(void){
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hdma_spi2_rx.Instance = DMA1_Stream3;
+	hdma_spi2_rx.Init.Channel = DMA_CHANNEL_0;
+	hdma_spi2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.Mode = DMA_NORMAL;
+	hdma_spi2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi2_rx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi2, hdmarx, hdma_spi2_rx);
+
+	hdma_spi2_tx.Instance = DMA1_Stream4;
+	hdma_spi2_tx.Init.Channel = DMA_CHANNEL_0;
+	hdma_spi2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi2_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi2_tx.Init.Mode = DMA_NORMAL;
+	hdma_spi2_tx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi2_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi2, hdmatx, hdma_spi2_tx);
 
-void checkBusyRead(){
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
+	HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 3, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+	HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 3, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
 
-	W25Q_Spi(0x05);
+	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+}
 
-	while(W25Q_Spi(0x00) != 0x00){}
+uint8_t W25Q_Spi(uint8_t Data)
+{
+	uint8_t ret;
+	HAL_SPI_TransmitReceive(&hspi2, &Data, &ret, 1, HAL_MAX_DELAY);
+	return ret;
+}
 
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+/* Anything that wants the bus waits out a DMA read first */
+static void flashIdle(void){
+	while (flash_dma_busy){}
+}
+
+int flashBusy(void){
+	return flash_dma_busy;
 }
 
-void checkBusyWrite(){
+uint8_t flashReadStatus(void){
+	uint8_t status;
+
+	flashIdle();
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
-	W25Q_Spi(0x01);
+	W25Q_Spi(0x05);
 
-	while(W25Q_Spi(0x00) != 0x00){}
+	status = W25Q_Spi(0x00);
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+
+	return status;
+}
+
+/* Spin on SR1 BUSY; only ever long while a program or erase is running */
+void flashWaitReady(void){
+	while (flashReadStatus() & FLASH_SR1_BUSY){}
 }
 
 void writeEnable(){
+	flashIdle();
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
 	W25Q_Spi(0x06);
@@ -37,6 +120,7 @@ void writeEnable(){
 }
 
 void writeDisable(){
+	flashIdle();
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
 	W25Q_Spi(0x04);
@@ -47,6 +131,7 @@ void writeDisable(){
 uint8_t flash_readID()
 {
 	uint8_t Temp = 0;
+	flashIdle();
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
 	W25Q_Spi(0x90);
@@ -66,138 +151,289 @@ uint8_t flash_readID()
 	return Temp;
 }
 
-uint8_t flashRead(uint8_t addr3, uint8_t addr2, uint8_t addr1){
-	uint8_t Temp = 0;
-
+static void flashCommand(uint8_t command){
+	flashIdle();
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
-	W25Q_Spi(0x03);
-
-	W25Q_Spi(addr3);
-
-	W25Q_Spi(addr2);
-
-	W25Q_Spi(addr1);
-
-	Temp = W25Q_Spi(0x00);
+	W25Q_Spi(command);
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+}
 
-	HAL_Delay(25);
-
-	checkBusyRead();
+/*
+ * Reads don't wait out a background erase: Erase Suspend (0x75) frees
+ * the array within 20 us, and the erase picks up again from the next
+ * flashPoll() or flashEraseBusy().
+ */
+static void flashSuspend(void){
+	if (!flash_erasing || flash_suspended)
+		return;
+	flashCommand(0x75);
+	flash_suspended = 1;
+}
 
-	return Temp;
+static void flashResume(void){
+	if (!flash_suspended)
+		return;
+	flash_suspended = 0;
+	flashCommand(0x7A);
 }
 
-void flashWriteSingle(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data){
-	checkBusyWrite();
-	checkBusyRead();
-	writeEnable();
+static void flashFastReadHeader(uint32_t addr){
+	uint8_t header[5] = { 0x0B, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff, 0x00 };
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
+	HAL_SPI_Transmit(&hspi2, header, sizeof (header), HAL_MAX_DELAY);
+}
 
-	W25Q_Spi(0x02);
+/*
+ * Fast read (0x0B) of len bytes into buf. Long reads stream in on the
+ * SPI2 DMA and done() runs from the DMA interrupt once Flash_CS is
+ * back up; short ones are just clocked in here. Returns 0 once the
+ * transfer is going.
+ */
+int flashReadStart(uint32_t addr, uint8_t *buf, uint32_t len, void (*done)(void)){
+	flashSuspend();
+	flashWaitReady();
+
+	flashFastReadHeader(addr);
+
+	if (len < FLASH_DMA_MIN){
+		if (len)
+			HAL_SPI_Receive(&hspi2, buf, len, HAL_MAX_DELAY);
+		HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+		if (done)
+			done();
+		return 0;
+	}
 
-	W25Q_Spi(addr3);
+	flash_dma_done = done;
+	flash_dma_busy = 1;
+	if (HAL_SPI_Receive_DMA(&hspi2, buf, len) != HAL_OK){
+		HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+		flash_dma_busy = 0;
+		return -1;
+	}
+	return 0;
+}
 
-	W25Q_Spi(addr2);
+/* From HAL_SPI_RxCpltCallback and HAL_SPI_TxCpltCallback */
+void flashDMADone(void){
+	void (*done)(void) = flash_dma_done;
 
-	W25Q_Spi(addr1);
+	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+	flash_dma_done = NULL;
+	flash_dma_busy = 0;
+	if (done)
+		done();
+}
 
-	W25Q_Spi(data);
+/* Fast read that returns with the data in buf */
+void flashReadBlock(uint32_t addr, uint8_t *buf, uint32_t len){
+	if (flashReadStart(addr, buf, len, NULL) == 0)
+		flashIdle();
+}
 
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+uint8_t flashRead(uint8_t addr3, uint8_t addr2, uint8_t addr1){
+	uint8_t Temp = 0;
 
-	HAL_Delay(25);
+	flashReadBlock(((uint32_t) addr3 << 16) | ((uint32_t) addr2 << 8) | addr1, &Temp, 1);
 
-	checkBusyWrite();
-	checkBusyRead();
+	return Temp;
 }
 
-void flashWriteArray(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data[], int dataSize){
-	checkBusyWrite();
-	checkBusyRead();
-	writeEnable();
+/*
+ * Start programming the next page of the oldest queued write if the
+ * chip has finished the last one. Never waits, so the main loop can
+ * call it as often as it likes; the page goes out the first time it
+ * finds WIP clear.
+ */
+void flashPoll(void){
+	struct flash_write *w;
+	const uint8_t *data;
+	void (*done)(void);
+	uint32_t chunk;
+	uint8_t header[4];
+
+	if (flash_dma_busy)
+		return;
+	flashResume();
+	if (flash_queue_count == 0)
+		return;
+	if (flashReadStatus() & FLASH_SR1_BUSY)
+		return;
+
+	w = &flash_queue[flash_queue_head];
+	chunk = FLASH_PAGE_SIZE - (w->addr & (FLASH_PAGE_SIZE - 1));
+	if (chunk > w->len)
+		chunk = w->len;
 
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
+	writeEnable();
 
-	W25Q_Spi(0x02);
+	header[0] = 0x02;
+	header[1] = (w->addr >> 16) & 0xff;
+	header[2] = (w->addr >> 8) & 0xff;
+	header[3] = w->addr & 0xff;
 
-	W25Q_Spi(addr3);
+	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
+	HAL_SPI_Transmit(&hspi2, header, sizeof (header), HAL_MAX_DELAY);
+
+	data = w->data;
+	w->addr += chunk;
+	w->data += chunk;
+	w->len -= chunk;
+
+	/* Last page: the slot is free as soon as it's on its way */
+	done = NULL;
+	if (w->len == 0){
+		done = w->done;
+		flash_queue_head = (flash_queue_head + 1) % FLASH_WRITE_QUEUE;
+		flash_queue_count--;
+	}
 
-	W25Q_Spi(addr2);
+	if (chunk < FLASH_DMA_MIN){
+		HAL_SPI_Transmit(&hspi2, (uint8_t *) data, chunk, HAL_MAX_DELAY);
+		HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+		if (done)
+			done();
+		return;
+	}
 
-	W25Q_Spi(addr1);
+	flash_dma_done = done;
+	flash_dma_busy = 1;
+	if (HAL_SPI_Transmit_DMA(&hspi2, (uint8_t *) data, chunk) != HAL_OK){
+		HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+		flash_dma_done = NULL;
+		flash_dma_busy = 0;
+		if (done)
+			done();
+	}
+}
 
-	for(int i = 0; i < dataSize; i++){
-		W25Q_Spi(data[i]);
+/*
+ * Queue len bytes at addr for programming, split on page boundaries.
+ * data has to stay put until done() runs, which is once the last page
+ * has been clocked out (the chip may still be programming it). Returns
+ * -1 if the queue is full.
+ */
+int flashWriteQueue(uint32_t addr, const uint8_t *data, uint32_t len, void (*done)(void)){
+	struct flash_write *w;
+
+	if (flash_queue_count == FLASH_WRITE_QUEUE)
+		return -1;
+	if (len == 0){
+		if (done)
+			done();
+		return 0;
 	}
+	w = &flash_queue[(flash_queue_head + flash_queue_count) % FLASH_WRITE_QUEUE];
+	w->addr = addr;
+	w->data = data;
+	w->len = len;
+	w->done = done;
+	flash_queue_count++;
+	flashPoll();
+	return 0;
+}
 
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
+/* Wait for every queued write, and any background erase, to finish */
+void flashSync(void){
+	while (flash_queue_count)
+		flashPoll();
+	flashIdle();
+	flashResume();
+	flashWaitReady();
+	flash_erasing = 0;
+}
 
-	HAL_Delay(25);
+void flashWrite(uint32_t addr, const uint8_t *data, uint32_t len){
+	while (flashWriteQueue(addr, data, len, NULL) != 0)
+		flashPoll();
+	flashSync();
+}
+
+void flashWriteSingle(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data){
+	flashWrite(((uint32_t) addr3 << 16) | ((uint32_t) addr2 << 8) | addr1, &data, 1);
+}
 
-	checkBusyRead();
-	checkBusyWrite();
+void flashWriteArray(uint8_t addr3, uint8_t addr2, uint8_t addr1, uint8_t data[], int dataSize){
+	flashWrite(((uint32_t) addr3 << 16) | ((uint32_t) addr2 << 8) | addr1, data, dataSize);
 }
 
-void flashClearLookup(){
-	checkBusyWrite();
-	checkBusyRead();
+static void flashEraseCommand(uint8_t command, uint32_t addr){
+	flashSync();
 	writeEnable();
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
-	W25Q_Spi(0xD8);
+	W25Q_Spi(command);
 
-	W25Q_Spi(0x00);
+	W25Q_Spi((addr >> 16) & 0xff);
 
-	W25Q_Spi(0x00);
+	W25Q_Spi((addr >> 8) & 0xff);
 
-	W25Q_Spi(0x00);
+	W25Q_Spi(addr & 0xff);
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
 
-	HAL_Delay(25);
+	flashWaitReady();
+}
 
-	checkBusyWrite();
+/* Erase the sectors covering [addr, addr + len), 64K blocks where they fit */
+void flashErase(uint32_t addr, uint32_t len){
+	uint32_t end = addr + len;
+
+	addr &= ~(FLASH_SECTOR_SIZE - 1);
+	while (addr < end){
+		if ((addr & (FLASH_BLOCK_SIZE - 1)) == 0 && end - addr >= FLASH_BLOCK_SIZE){
+			flashEraseCommand(0xD8, addr);
+			addr += FLASH_BLOCK_SIZE;
+		}
+		else{
+			flashEraseCommand(0x20, addr);
+			addr += FLASH_SECTOR_SIZE;
+		}
+	}
 }
 
-void flashClearStorage(){
-	checkBusyWrite();
-	checkBusyRead();
+/*
+ * Start erasing the 4K sector at addr and return; flashEraseBusy()
+ * says when it's done. Queued writes go first. Returns -1 if the chip
+ * isn't free to take it.
+ */
+int flashEraseStart(uint32_t addr){
+	if (flash_dma_busy || flash_queue_count || flash_erasing)
+		return -1;
+	if (flashReadStatus() & FLASH_SR1_BUSY)
+		return -1;
+
 	writeEnable();
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
 
-	W25Q_Spi(0xD8);
+	W25Q_Spi(0x20);
 
-	W25Q_Spi(0x7F);
+	W25Q_Spi((addr >> 16) & 0xff);
 
-	W25Q_Spi(0x00);
+	W25Q_Spi((addr >> 8) & 0xff);
 
-	W25Q_Spi(0x00);
+	W25Q_Spi(addr & 0xff);
 
 	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
 
-	HAL_Delay(25);
-
-	checkBusyWrite();
+	flash_erasing = 1;
+	return 0;
 }
 
-void flashClearAll(){
-	checkBusyWrite();
-	checkBusyRead();
-	writeEnable();
-
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_RESET);
-
-	W25Q_Spi(0xC7);
-
-	HAL_GPIO_WritePin(GPIOC, Flash_CS_Pin, GPIO_PIN_SET);
-
-	HAL_Delay(50);
-
-	checkBusyWrite();
+/* One status poll: is the background erase still going? */
+int flashEraseBusy(void){
+	if (!flash_erasing)
+		return 0;
+	if (flash_dma_busy)
+		return 1;
+	flashResume();
+	if (flashReadStatus() & FLASH_SR1_BUSY)
+		return 1;
+	flash_erasing = 0;
+	return 0;
 }
@@ -0,0 +1,100 @@
+/*
+ * frame.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Frame encoder and a byte at a time decoder. A bad length or CRC
+ * just drops the decoder back to hunting for sync, so a host can
+ * always recover by sending its next frame.
+ */
+
+#include <string.h>
+#include "crc.h"
+#include "frame.h"
+
+enum {
+	FRAME_HUNT,
+	FRAME_SYNC,
+	FRAME_TYPE,
+	FRAME_LEN0,
+	FRAME_LEN1,
+	FRAME_BODY,
+};
+
+/* out needs room for len + FRAME_OVERHEAD bytes. Returns the frame length */
+uint16_t frame_Encode(uint8_t *out, uint8_t type, const uint8_t *payload, uint16_t len){
+	uint16_t crc;
+
+	out[0] = FRAME_SYNC0;
+	out[1] = FRAME_SYNC1;
+	out[2] = type;
+	out[3] = len & 0xff;
+	out[4] = len >> 8;
+	if (len && out + FRAME_HEADER_SIZE != payload)
+		memmove(out + FRAME_HEADER_SIZE, payload, len);
+	crc = crc16(CRC16_INIT, out + 2, len + 3);
+	out[FRAME_HEADER_SIZE + len] = crc & 0xff;
+	out[FRAME_HEADER_SIZE + len + 1] = crc >> 8;
+	return len + FRAME_OVERHEAD;
+}
+
+void frame_Reset(struct frame_rx *rx){
+	rx->state = FRAME_HUNT;
+	rx->frames = 0;
+	rx->errors = 0;
+}
+
+/*
+ * Feed one byte. Returns 1 when it completes a good frame, which is
+ * then in rx->type, rx->len and rx->payload until the next call.
+ */
+int frame_Input(struct frame_rx *rx, uint8_t c){
+	switch (rx->state){
+	case FRAME_HUNT:
+		if (c == FRAME_SYNC0)
+			rx->state = FRAME_SYNC;
+		return 0;
+	case FRAME_SYNC:
+		if (c == FRAME_SYNC1)
+			rx->state = FRAME_TYPE;
+		else if (c != FRAME_SYNC0)
+			rx->state = FRAME_HUNT;
+		return 0;
+	case FRAME_TYPE:
+		rx->type = c;
+		rx->crc = crc16(CRC16_INIT, &c, 1);
+		rx->state = FRAME_LEN0;
+		return 0;
+	case FRAME_LEN0:
+		rx->len = c;
+		rx->crc = crc16(rx->crc, &c, 1);
+		rx->state = FRAME_LEN1;
+		return 0;
+	case FRAME_LEN1:
+		rx->len |= (uint16_t) c << 8;
+		rx->crc = crc16(rx->crc, &c, 1);
+		if (rx->len > FRAME_MAX_PAYLOAD){
+			rx->errors++;
+			rx->state = FRAME_HUNT;
+			return 0;
+		}
+		rx->pos = 0;
+		rx->state = FRAME_BODY;
+		return 0;
+	case FRAME_BODY:
+		rx->payload[rx->pos++] = c;
+		if (rx->pos < rx->len + FRAME_CRC_SIZE)
+			return 0;
+		rx->state = FRAME_HUNT;
+		rx->crc = crc16(rx->crc, rx->payload, rx->len);
+		if ((rx->payload[rx->len] | (rx->payload[rx->len + 1] << 8)) != rx->crc){
+			rx->errors++;
+			return 0;
+		}
+		rx->frames++;
+		return 1;
+	}
+	rx->state = FRAME_HUNT;
+	return 0;
+}
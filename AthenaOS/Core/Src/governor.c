@@ -0,0 +1,108 @@
+/*
+ * governor.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Picks the clock for the flight phase. The pad can last an hour and
+ * wants the least current. From launch to apogee the predictor wants
+ * every cycle. Speeding up happens as soon as the TeleMega says boost,
+ * while the brakes are still held in. Slowing down waits until the
+ * state has settled, so one odd frame can't bounce the clock.
+ *
+ * The rest works out prescalers from whichever clocks are running, so
+ * the same code serves both profiles.
+ */
+
+#include "governor.h"
+#include "companion.h"
+
+/*
+ * Both off HSE / 8 = 2 MHz into the PLL. Flash needs a wait state per
+ * 30 MHz at 3.3 V; scale 3 is good to 120 MHz, and 180 MHz needs scale
+ * 1 with over-drive. APB1 stays under 45 MHz and APB2 under 90 MHz.
+ */
+const struct governor_profile governor_profiles[GOVERNOR_PROFILES] = {
+	[GOVERNOR_PAD] = {
+		.hz = 48000000,
+		.pll_n = 96,
+		.pll_p = 4,
+		.pll_q = 4,
+		.apb1_div = 2,
+		.apb2_div = 1,
+		.scale = 3,
+		.overdrive = 0,
+		.latency = 1,
+	},
+	[GOVERNOR_COAST] = {
+		.hz = 180000000,
+		.pll_n = 180,
+		.pll_p = 2,
+		.pll_q = 8,
+		.apb1_div = 4,
+		.apb2_div = 2,
+		.scale = 1,
+		.overdrive = 1,
+		.latency = 5,
+	},
+};
+
+void governor_Init(struct governor *g, uint8_t profile, uint32_t now){
+	g->profile = profile;
+	g->want = profile;
+	g->want_since = now;
+	g->switches = 0;
+	g->deferred = 0;
+}
+
+/* Launch to apogee runs flat out, everything else saves power */
+int governor_Want(uint8_t flight_state){
+	switch (flight_state){
+	case COMPANION_STATE_BOOST:
+	case COMPANION_STATE_FAST:
+	case COMPANION_STATE_COAST:
+		return GOVERNOR_COAST;
+	default:
+		return GOVERNOR_PAD;
+	}
+}
+
+/*
+ * Returns the profile to switch to now, or -1 to stay put. Switching
+ * is up to the caller, which sets g->profile once it's done.
+ */
+int governor_Step(struct governor *g, uint8_t flight_state, uint32_t now){
+	int want = governor_Want(flight_state);
+
+	if (want != g->want){
+		g->want = want;
+		g->want_since = now;
+	}
+	if (want == g->profile)
+		return -1;
+	if (want < g->profile && now - g->want_since < GOVERNOR_HOLD_MS)
+		return -1;
+	return want;
+}
+
+/* What a timer on this bus counts at: twice PCLK whenever the bus is divided */
+uint32_t governor_TimerHz(uint32_t hclk, uint8_t apb_div){
+	return apb_div == 1 ? hclk : hclk / apb_div * 2;
+}
+
+/* SPI_CR1 BR for the fastest SCK no faster than max_hz, PCLK / 256 at the slowest */
+uint32_t governor_SpiDivider(uint32_t pclk, uint32_t max_hz){
+	uint32_t br = 0;
+
+	while (br < 7 && pclk >> (br + 1) > max_hz)
+		br++;
+	return br;
+}
+
+/* Prescaler and reload for a 16 bit timer to overflow at hz */
+void governor_Period(uint32_t timer_hz, uint32_t hz, uint32_t *psc, uint32_t *arr){
+	uint32_t ticks = timer_hz / hz;
+
+	*psc = (ticks - 1) / 0x10000;
+	*arr = ticks / (*psc + 1) - 1;
+}
@@ -0,0 +1,210 @@
+/*
+ * governor_rcc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Changes the clock tree, then redoes everything that divides down
+ * from a bus clock. To change the PLL and the regulator, the system
+ * clock first drops to the crystal for the PLL to relock, which takes
+ * a few hundred microseconds. Only switches with the stepper, the
+ * flash DMA, the SD DMA and the sensor bus idle, so no prescaler
+ * changes mid-transfer or mid-step. USB runs off PLLSAI and doesn't
+ * notice.
+ */
+
+#include "main.h"
+#include "governor.h"
+#include "companion.h"
+#include "control.h"
+#include "Stepper.h"
+#include "beep.h"
+#include "monitor.h"
+#include "profile.h"
+#include "flash.h"
+#include "sd.h"
+#include "sensor.h"
+
+extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim4;
+extern TIM_HandleTypeDef htim8;
+extern SPI_HandleTypeDef hspi2;
+extern SPI_HandleTypeDef hspi3;
+extern I2C_HandleTypeDef hi2c1;
+
+struct governor governor;
+
+static uint32_t governor_Apb(uint8_t div){
+	switch (div){
+	case 2:
+		return RCC_HCLK_DIV2;
+	case 4:
+		return RCC_HCLK_DIV4;
+	case 8:
+		return RCC_HCLK_DIV8;
+	case 16:
+		return RCC_HCLK_DIV16;
+	default:
+		return RCC_HCLK_DIV1;
+	}
+}
+
+static uint32_t governor_Scale(uint8_t scale){
+	switch (scale){
+	case 1:
+		return PWR_REGULATOR_VOLTAGE_SCALE1;
+	case 2:
+		return PWR_REGULATOR_VOLTAGE_SCALE2;
+	default:
+		return PWR_REGULATOR_VOLTAGE_SCALE3;
+	}
+}
+
+static void governor_Switch(const struct governor_profile *p){
+	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+	RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+	/* Onto the crystal. The wait states only come down once it's there */
+	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+	                            |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+	RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSE;
+	RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+	RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
+	RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+	if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_5) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	/* The regulator scale only changes with the PLL off */
+	if (__HAL_PWR_GET_FLAG(PWR_FLAG_ODRDY) && HAL_PWREx_DisableOverDrive() != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_RCC_PLL_DISABLE();
+	while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY))
+		;
+	__HAL_PWR_VOLTAGESCALING_CONFIG(governor_Scale(p->scale));
+
+	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+	RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+	RCC_OscInitStruct.PLL.PLLM = GOVERNOR_HSE_HZ / 2000000;
+	RCC_OscInitStruct.PLL.PLLN = p->pll_n;
+	RCC_OscInitStruct.PLL.PLLP = p->pll_p;
+	RCC_OscInitStruct.PLL.PLLQ = p->pll_q;
+	RCC_OscInitStruct.PLL.PLLR = 2;
+	if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	if (p->overdrive && HAL_PWREx_EnableOverDrive() != HAL_OK)
+	{
+		Error_Handler();
+	}
+	while (!__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY))
+		;
+
+	RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+	RCC_ClkInitStruct.APB1CLKDivider = governor_Apb(p->apb1_div);
+	RCC_ClkInitStruct.APB2CLKDivider = governor_Apb(p->apb2_div);
+	if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, p->latency) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+/*
+ * New prescaler and reload now rather than at the next update. URS
+ * keeps the forced update from raising an interrupt, and the count
+ * carries on from where it was unless that's past the new reload.
+ */
+static void governor_Timer(TIM_HandleTypeDef *htim, uint32_t psc, uint32_t arr){
+	TIM_TypeDef *tim = htim->Instance;
+	uint32_t cnt = tim->CNT;
+
+	htim->Init.Prescaler = psc;
+	htim->Init.Period = arr;
+	tim->PSC = psc;
+	tim->ARR = arr;
+	tim->CR1 |= TIM_CR1_URS;
+	tim->EGR = TIM_EGR_UG;
+	tim->CR1 &= ~TIM_CR1_URS;
+	tim->CNT = cnt > arr ? 0 : cnt;
+}
+
+/* SPI2 and SPI3 are both on APB1 */
+static void governor_Spi(SPI_HandleTypeDef *hspi, uint32_t max_hz){
+	uint32_t br = governor_SpiDivider(HAL_RCC_GetPCLK1Freq(), max_hz) << SPI_CR1_BR_Pos;
+
+	__HAL_SPI_DISABLE(hspi);
+	MODIFY_REG(hspi->Instance->CR1, SPI_CR1_BR, br);
+	hspi->Init.BaudRatePrescaler = br;
+}
+
+/* Everything that counts or clocks off PCLK1 or PCLK2 */
+static void governor_Retime(const struct governor_profile *p){
+	uint32_t tim1 = governor_TimerHz(p->hz, p->apb1_div);
+	uint32_t tim2 = governor_TimerHz(p->hz, p->apb2_div);
+	uint32_t psc, arr;
+	int i;
+
+	/* Idle, so the forced update can't put out a step */
+	governor_Timer(&htim3, tim1 / STEPPER_TICK_HZ - 1, htim3.Instance->ARR);
+
+	/* Same microsecond count, so the tick keeps its phase */
+	governor_Timer(&htim4, tim1 / CONTROL_TICK_HZ - 1, htim4.Instance->ARR);
+
+	/* Picked up at the next update: one tone period at most is off pitch */
+	__HAL_TIM_SET_PRESCALER(&htim2, tim1 / BEEP_TICK_HZ - 1);
+
+	governor_Period(tim2, MONITOR_SCAN_HZ, &psc, &arr);
+	governor_Timer(&htim8, psc, arr);
+
+	governor_Spi(&hspi2, FLASH_SPI_HZ);
+	if (sd.ready)
+		governor_Spi(&hspi3, SD_SPI_HZ);
+
+	if (HAL_I2C_Init(&hi2c1) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	/* Cycle counts from before mean something else now */
+	for (i = 0; i < PROFILE_PROBES; i++)
+		profile.probe[i].reset = 1;
+	HAL_NVIC_DisableIRQ(TIM4_IRQn);
+	control_ResetTiming();
+	HAL_NVIC_EnableIRQ(TIM4_IRQn);
+}
+
+static void governor_Go(int profile){
+	const struct governor_profile *p = &governor_profiles[profile];
+
+	governor_Switch(p);
+	governor_Retime(p);
+	governor.profile = profile;
+	governor.switches++;
+}
+
+/* Everything's started at the 72 MHz SystemClock_Config() leaves us at; settle on the pad profile */
+void governor_Start(void){
+	governor_Init(&governor, GOVERNOR_PAD, HAL_GetTick());
+	while (flashBusy() || sd_Busy() || sensor_Busy())
+		;
+	governor_Go(GOVERNOR_PAD);
+	governor.switches = 0;
+}
+
+void governor_Poll(void){
+	int profile = governor_Step(&governor, companion_Latest(&companion)->flight_state, HAL_GetTick());
+
+	if (profile < 0)
+		return;
+	if (stepper_Busy() || flashBusy() || sd_Busy() || sensor_Busy()){
+		governor.deferred++;
+		return;
+	}
+	governor_Go(profile);
+}
@@ -0,0 +1,94 @@
+/*
+ * home.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Gives the step count a meaning. There's no limit switch or current
+ * sense on the board, so homing is open loop: seek past full travel
+ * into the retracted stop at a crawl, call that -backoff, and ease off
+ * to 0. From then on the count is absolute for the control loop and
+ * the table.
+ *
+ * An index sensor wired to Extra_out (TIM3_CH2) is optional. Once
+ * homed, the first edge each way is where the sensor is. An edge
+ * somewhere else later means the motor missed steps. The count is
+ * corrected there and then, and the slip is counted.
+ */
+
+#include <stdlib.h>
+#include "home.h"
+
+void home_Init(struct home *h, const struct home_config *cfg){
+	h->cfg = *cfg;
+	h->state = HOME_IDLE;
+	h->vmax2 = 0;
+	h->accel2 = 0;
+	h->index[0] = 0;
+	h->index[1] = 0;
+	h->learned = 0;
+	h->edges = 0;
+	h->slips = 0;
+	h->error_last = 0;
+	h->error_max = 0;
+}
+
+/* With the planner at rest */
+void home_Start(struct home *h, struct motion *m){
+	h->vmax2 = m->vmax2;
+	h->accel2 = m->accel2;
+	h->learned = 0;
+	motion_SetLimits(m, h->cfg.seek_speed, h->cfg.seek_accel);
+	motion_SetPosition(m, 0);
+	motion_Retarget(m, -h->cfg.seek_steps);
+	h->state = HOME_SEEK;
+}
+
+/* Move homing along once the planner has finished each leg. Returns the state */
+int home_Poll(struct home *h, struct motion *m){
+	if (motion_Busy(m))
+		return h->state;
+
+	switch (h->state){
+	case HOME_SEEK:
+		/* Every step past the stop slipped, so here is the stop */
+		motion_SetPosition(m, -h->cfg.backoff);
+		motion_Retarget(m, 0);
+		h->state = HOME_BACKOFF;
+		break;
+	case HOME_BACKOFF:
+		m->vmax2 = h->vmax2;
+		m->accel2 = h->accel2;
+		h->state = HOME_DONE;
+		break;
+	}
+	return h->state;
+}
+
+/*
+ * The index sensor changed state with the count at position, moving
+ * in direction dir. Returns the correction for motion_Shift(), 0 if
+ * the count agrees or there's nothing to go on yet.
+ */
+int32_t home_Edge(struct home *h, int32_t position, int dir){
+	int i = dir > 0;
+	int32_t error;
+
+	if (h->state != HOME_DONE || dir == 0)
+		return 0;
+	if (!(h->learned & (1 << i))){
+		h->index[i] = position;
+		h->learned |= 1 << i;
+		return 0;
+	}
+
+	h->edges++;
+	error = position - h->index[i];
+	h->error_last = error;
+	if (abs(error) > h->error_max)
+		h->error_max = abs(error);
+	if (abs(error) <= h->cfg.tolerance)
+		return 0;
+	h->slips++;
+	return -error;
+}
@@ -0,0 +1,248 @@
+/*
+ * lut.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Drag table lookups, called from the control loop every companion
+ * update. Everything here is integer: two divides per axis to find
+ * the cell and the Q15 fraction across it, then a bilinear blend of
+ * the four corners. Out of range inputs clamp to the table edge.
+ */
+
+#include "lut.h"
+#include "crc.h"
+
+#define LUT_ONE		(1 << 15)
+
+static uint16_t le16(const uint8_t *p){
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static int32_t lut_Cell(const uint8_t *p){
+	return (int16_t) le16(p);
+}
+
+/* Returns 0 if buf holds a table header we know how to use */
+int lut_ParseHeader(struct lut_header *h, const uint8_t *buf, uint32_t len){
+	if (len < LUT_HEADER_SIZE)
+		return -1;
+
+	h->magic = le32(buf + 0);
+	h->version = le16(buf + 4);
+	h->header_size = le16(buf + 6);
+	h->x0 = (int32_t) le32(buf + 8);
+	h->dx = (int32_t) le32(buf + 12);
+	h->nx = le16(buf + 16);
+	h->ny = le16(buf + 18);
+	h->y0 = (int32_t) le32(buf + 20);
+	h->dy = (int32_t) le32(buf + 24);
+	h->row_stride = le32(buf + 28);
+	h->data_offset = le32(buf + 32);
+	h->cell_size = buf[36];
+	h->frac_bits = buf[37];
+	h->data_size = le32(buf + 40);
+	h->crc32 = le32(buf + 44);
+
+	if (h->magic != LUT_MAGIC || h->version != LUT_VERSION)
+		return -1;
+	if (h->header_size < LUT_HEADER_SIZE || h->data_offset < h->header_size)
+		return -1;
+	if (h->nx < 2 || h->ny < 2)
+		return -1;
+	/* the Q15 fraction is computed as (offset << 15) / step */
+	if (h->dx < 1 || h->dx > 0xffff || h->dy < 1 || h->dy > 0xffff)
+		return -1;
+	if (h->cell_size != 2 || h->frac_bits > 15)
+		return -1;
+	if (h->row_stride < (uint32_t) h->nx * 2 || 2 * h->row_stride > LUT_WINDOW_BYTES)
+		return -1;
+	if (h->data_size != (uint32_t) h->ny * h->row_stride)
+		return -1;
+	return 0;
+}
+
+/* crc32 of the cells where they sit, a bit at a time */
+static int lut_Verify(const struct lut_header *h, uint32_t addr,
+		int (*read)(uint32_t addr, uint8_t *buf, uint32_t len)){
+	uint8_t buf[256];
+	uint32_t crc = CRC32_INIT, left = h->data_size, n;
+
+	addr += h->data_offset;
+	while (left){
+		n = left < sizeof (buf) ? left : sizeof (buf);
+		if (read(addr, buf, n) != 0)
+			return -1;
+		crc = crc32(crc, buf, n);
+		addr += n;
+		left -= n;
+	}
+	return crc == h->crc32 ? 0 : -1;
+}
+
+/*
+ * A partly written or corrupt table is never flown: read has to return
+ * the data there and then, and everything after goes through fetch.
+ */
+int lut_Open(struct lut *l, const uint8_t *header, uint32_t len, uint32_t addr,
+		int (*read)(uint32_t addr, uint8_t *buf, uint32_t len),
+		int (*fetch)(uint32_t addr, uint8_t *buf, uint32_t len)){
+	struct lut_header h;
+
+	l->rows = 0;
+	if (lut_ParseHeader(&h, header, len) != 0 || lut_Verify(&h, addr, read) != 0)
+		return -1;
+	l->h = h;
+
+	l->addr = addr;
+	l->fetch = fetch;
+	l->win_base[0] = -1;
+	l->win_base[1] = -1;
+	l->active = 0;
+	l->fetching = 0;
+	l->lookups = 0;
+	l->misses = 0;
+	l->fetches = 0;
+	l->rows = LUT_WINDOW_BYTES / l->h.row_stride;
+	if (l->rows > l->h.ny)
+		l->rows = l->h.ny;
+	/* Pad: bottom of the table */
+	l->want = 0;
+	return 0;
+}
+
+/* Cell index along one axis and the Q15 fraction of the way to the next */
+static int32_t lut_Axis(int32_t v, int32_t v0, int32_t dv, int32_t n, int32_t *frac){
+	int32_t d = v - v0;
+	int32_t i;
+
+	if (d <= 0){
+		*frac = 0;
+		return 0;
+	}
+	i = d / dv;
+	if (i >= n - 1){
+		*frac = LUT_ONE;
+		return n - 2;
+	}
+	*frac = ((d - i * dv) << 15) / dv;
+	return i;
+}
+
+static int32_t lut_Blend(int32_t a, int32_t b, int32_t t){
+	return a + (((b - a) * t + (1 << 14)) >> 15);
+}
+
+/* Bilinear blend from the active window; track lets the lookup move it */
+static int lut_Interp(struct lut *l, int32_t x, int32_t y, int32_t *value, int track){
+	int32_t i, j, r, tx, ty, base, nb, margin;
+	int32_t a0, a1;
+	const uint8_t *p;
+	uint32_t stride = l->h.row_stride;
+	uint8_t a;
+	int ret = LUT_HIT;
+
+	if (l->rows == 0)
+		return LUT_NONE;
+	if (track)
+		l->lookups++;
+
+	a = l->active;
+	base = l->win_base[a];
+	if (base < 0){
+		if (track)
+			l->misses++;
+		return LUT_NONE;
+	}
+
+	i = lut_Axis(x, l->h.x0, l->h.dx, l->h.nx, &tx);
+	j = lut_Axis(y, l->h.y0, l->h.dy, l->h.ny, &ty);
+
+	r = j - base;
+	if (r < 0){
+		r = 0;
+		ty = 0;
+		ret = LUT_APPROX;
+	}
+	else if (r > l->rows - 2){
+		r = l->rows - 2;
+		ty = LUT_ONE;
+		ret = LUT_APPROX;
+	}
+
+	/* Getting close to the edge of the window, ask for the next one */
+	if (track){
+		if (ret != LUT_HIT)
+			l->misses++;
+		if (!l->fetching && l->want < 0){
+			margin = l->rows / 4;
+			if ((j - base < margin && base > 0) ||
+			    (base + l->rows - 2 - j < margin && base + l->rows < l->h.ny)){
+				nb = j - l->rows / 2;
+				if (nb > l->h.ny - l->rows)
+					nb = l->h.ny - l->rows;
+				if (nb < 0)
+					nb = 0;
+				if (nb != base)
+					l->want = nb;
+			}
+		}
+	}
+
+	p = l->win[a] + r * stride + i * 2;
+	a0 = lut_Blend(lut_Cell(p), lut_Cell(p + 2), tx);
+	a1 = lut_Blend(lut_Cell(p + stride), lut_Cell(p + stride + 2), tx);
+	*value = lut_Blend(a0, a1, ty);
+	return ret;
+}
+
+/*
+ * Table value at (x, y), in cell units (value * 2^frac_bits). Returns
+ * LUT_HIT, LUT_APPROX if y is off the cached rows and the nearest
+ * ones were used instead, or LUT_NONE before the first window lands.
+ */
+int lut_Lookup(struct lut *l, int32_t x, int32_t y, int32_t *value){
+	return lut_Interp(l, x, y, value, 1);
+}
+
+/*
+ * The same, but for looking ahead of the rocket: doesn't count, and
+ * doesn't drag the window away from where the rocket actually is.
+ */
+int lut_Peek(struct lut *l, int32_t x, int32_t y, int32_t *value){
+	return lut_Interp(l, x, y, value, 0);
+}
+
+/* Main loop: start reading whatever window the lookups asked for */
+void lut_Poll(struct lut *l){
+	int32_t nb = l->want;
+	uint8_t next;
+
+	if (l->rows == 0 || l->fetching || nb < 0)
+		return;
+
+	next = l->active ^ 1;
+	l->win_base[next] = -1;
+	l->fetch_base = nb;
+	l->fetching = 1;
+	l->want = -1;
+	l->fetches++;
+	if (l->fetch(l->addr + l->h.data_offset + (uint32_t) nb * l->h.row_stride,
+			l->win[next], (uint32_t) l->rows * l->h.row_stride) != 0){
+		l->fetching = 0;
+		l->want = nb;
+	}
+}
+
+/* The window read has landed, possibly from the DMA interrupt */
+void lut_FetchDone(struct lut *l){
+	uint8_t next = l->active ^ 1;
+
+	l->win_base[next] = l->fetch_base;
+	l->active = next;
+	l->fetching = 0;
+}
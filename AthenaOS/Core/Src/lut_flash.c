@@ -0,0 +1,47 @@
+/*
+ * lut_flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Hooks the drag table up to the W25Q. Window refills go out as SPI2
+ * DMA fast reads started from the main loop, so they never fight the
+ * flash driver from interrupt context.
+ */
+
+#include "main.h"
+#include "flash.h"
+#include "lut.h"
+
+struct lut lut;
+
+static void lut_FlashDone(void){
+	lut_FetchDone(&lut);
+}
+
+static int lut_FlashFetch(uint32_t addr, uint8_t *buf, uint32_t len){
+	return flashReadStart(addr, buf, len, lut_FlashDone);
+}
+
+static int lut_FlashRead(uint32_t addr, uint8_t *buf, uint32_t len){
+	flashReadBlock(addr, buf, len);
+	return 0;
+}
+
+/*
+ * Read the header and check the cells into l. Its fetches finish into
+ * lut, so anything but lut itself has to be copied there before
+ * lut_Poll().
+ */
+int lut_FlashOpen(struct lut *l){
+	uint8_t header[LUT_HEADER_SIZE];
+
+	flashReadBlock(FLASH_LOOKUP_ADDR, header, sizeof (header));
+	return lut_Open(l, header, sizeof (header), FLASH_LOOKUP_ADDR, lut_FlashRead, lut_FlashFetch);
+}
+
+/* Open the table and start pulling in the first window */
+void lut_Start(void){
+	if (lut_FlashOpen(&lut) == 0)
+		lut_Poll(&lut);
+}
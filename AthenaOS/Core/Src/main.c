@@ -26,6 +26,21 @@
 #include "Stepper.h"
 #include "Status_LED.h"
 #include "flash.h"
+#include "lut.h"
+#include "upload.h"
+#include "control.h"
+#include "recorder.h"
+#include "erase.h"
+#include "sdlog.h"
+#include "sd.h"
+#include "fault.h"
+#include "telemetry.h"
+#include "beep.h"
+#include "monitor.h"
+#include "profile.h"
+#include "companion.h"
+#include "governor.h"
+#include "sensor.h"
 
 #include "usbd_cdc_if.h"
 
@@ -43,7 +58,6 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-double VBatt = 0;
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -126,23 +140,29 @@ int main(void)
   MX_USB_DEVICE_Init();
   /* USER CODE BEGIN 2 */
 
+  profile_Start();
+  fault_Start();
+  companion_Start();
+  stepper_Init();
+  stepper_Home();
+  flashInit();
+  lut_Start();
+  control_Start();
+  recorder_Start();
+  sdlog_Start();
+  beep_Start();
+  monitor_Start();
+  sensor_Start();
+  governor_Start();
 
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
 
-  HAL_TIM_Base_Start(&htim2);
-
   startup();
 
-  uint8_t grid[5] = {0x00, 0x01, 0x02, 0x03, 0x04};
-
-  flashWriteArray(0x00, 0x00, 0x00, grid, 4);
-
-  HAL_Delay(50);
-
-  char txBuff[105];
+  uint32_t led_tick = HAL_GetTick();
 
   while (1)
   {
@@ -150,14 +170,22 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
 
-	 sprintf(txBuff, "Read Data Addr1: %X, Read Data Addr2: %X, Read Data Addr3: %X, Read Data Addr4: %X, Read Data Addr5: %X\n", flashRead(0x00, 0x00, 0x00), flashRead(0x00, 0x00, 0x01), flashRead(0x00, 0x00, 0x02), flashRead(0x00, 0x00, 0x03), flashRead(0x00, 0x00, 0x04));
-
-	 status_LED_Swap();
-	 HAL_Delay(100);
-	 status_LED_Swap();
-	 HAL_Delay(100);
-
-	 CDC_Transmit_FS((uint8_t *)txBuff, strlen(txBuff));
+	 flashPoll();
+	 erase_Poll(&erase);
+	 recorder_Poll(&recorder);
+	 sd_Poll();
+	 sdlog_Poll(&sdlog);
+	 monitor_Poll();
+	 sensor_Poll();
+	 lut_Poll(&lut);
+	 upload_Poll();
+	 telemetry_Poll();
+	 governor_Poll();
+
+	 if (HAL_GetTick() - led_tick >= 100){
+		 led_tick += 100;
+		 status_LED_Swap();
+	 }
   }
   /* USER CODE END 3 */
 }
@@ -276,7 +304,7 @@ static void MX_I2C1_Init(void)
 
   /* USER CODE END I2C1_Init 1 */
   hi2c1.Instance = I2C1;
-  hi2c1.Init.ClockSpeed = 100000;
+  hi2c1.Init.ClockSpeed = 400000;
   hi2c1.Init.DutyCycle = I2C_DUTYCYCLE_2;
   hi2c1.Init.OwnAddress1 = 0;
   hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
@@ -530,127 +558,62 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
-void delay (uint16_t us)
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-  __HAL_TIM_SET_COUNTER(&htim2, 0);
-  while (__HAL_TIM_GET_COUNTER(&htim2) < us);
+  if (GPIO_Pin == Altus_CS_Pin){
+    companion_NSS();
+  }
 }
 
+/*
+ * Hello, the battery voltage, then ready. All of it is queued up for
+ * TIM2 to play, so this returns straight away and the companion link,
+ * the control loop and USB carry on underneath.
+ */
 void startup(void){
-	double f = 256.41;
-	for(int i = 0; i < 5; i++){
-			for(int i = 0; i < 500; i++){
-				HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-				delay(f*0.5);
-				HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-				delay(f*0.5);
-			}
-			HAL_Delay(100);
-	}
-
-	HAL_Delay(1000);
-
-	HAL_ADC_Start(&hadc1);
-	HAL_ADC_PollForConversion(&hadc1, HAL_MAX_DELAY);
-
-	VBatt = (((double)HAL_ADC_GetValue(&hadc1)*2)/4095)*3.3;
-
-	f = 250;
-	for(int i = 0; i < (int)VBatt; i++){
-		for(int i = 0; i < 700; i++){
-			HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-			delay(f*0.60);
-			HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-			delay(f*0.40);
-		}
-		HAL_Delay(400);
-	}
-
-	HAL_Delay(600);
-
-	f = 250;
-	for(int i = 0; i < (int)((VBatt-(int)VBatt)*10); i++){
-		for(int i = 0; i < 700; i++){
-			HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-			delay(f*0.60);
-			HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-			delay(f*0.40);
-		}
-		HAL_Delay(400);
-	}
-
-	HAL_Delay(1000);
-
-	f = 256.41;
-	for(int i = 0; i < 500; i++){
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-		delay(f*0.60);
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-		delay(f*0.40);
-	}
-
-	HAL_Delay(100);
-
-	f = 250;
-	for(int i = 0; i < 500; i++){
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-		delay(f*0.60);
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-		delay(f*0.40);
-	}
-
-	HAL_Delay(100);
-
-	f = 243.9;
-	for(int i = 0; i < 500; i++){
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-		delay(f*0.60);
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-		delay(f*0.40);
-	}
-
-	HAL_Delay(100);
-
-	f = 238.095;
-	for(int i = 0; i < 500; i++){
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-		delay(f*0.60);
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-		delay(f*0.40);
-	}
-
-	HAL_Delay(1000);
-
-	stepper_Step (1, 50); //Step in direction 1, 50 steps
-
-	HAL_Delay(1000);
-
-	stepper_Step (1, 50); //Step in direction 1, 50 steps
-
-	HAL_Delay(1000);
-
-	stepper_Step (0, 50); //Step in direction 0, 50 steps
-
-	HAL_Delay(1000);
-
-	stepper_Step (0, 50); //Step in direction 0, 50 steps
-
-	f = 232.55814;
-	for(int i = 0; i < 10000; i++){
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_SET);
-		delay(f*0.60);
-		HAL_GPIO_WritePin(Buzz_PWM_GPIO_Port, Buzz_PWM_Pin, GPIO_PIN_RESET);
-		delay(f*0.40);
-	}
-
-	HAL_Delay(100);
+	static const struct beep_note hello[] = {
+		{ BEEP_LOW, 128 }, { 0, 100 },
+		{ BEEP_LOW, 128 }, { 0, 100 },
+		{ BEEP_LOW, 128 }, { 0, 100 },
+		{ BEEP_LOW, 128 }, { 0, 100 },
+		{ BEEP_LOW, 128 }, { 0, 1100 },
+	};
+	static const struct beep_note ready[] = {
+		{ 0, 400 },
+		{ 3900, 128 }, { 0, 100 },
+		{ 4000, 125 }, { 0, 100 },
+		{ 4100, 122 }, { 0, 100 },
+		{ 4200, 119 }, { 0, 1000 },
+		{ BEEP_HIGH, 2325 },
+	};
+
+	uint32_t start = HAL_GetTick();
+
+	/* The first block of scans is in a few ms after monitor_Start */
+	while (monitor.blocks == 0 && HAL_GetTick() - start < 100)
+		;
+
+	beep_Tune(&beep, hello, sizeof (hello) / sizeof (hello[0]));
+	beep_Battery(&beep, monitor.battery_mv);
+	beep_Tune(&beep, ready, sizeof (ready) / sizeof (ready[0]));
+	beep_Kick();
 }
 
-uint8_t W25Q_Spi(uint8_t Data)
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-	uint8_t ret;
-	HAL_SPI_TransmitReceive(&hspi2, &Data, &ret, 1, HAL_MAX_DELAY);
-	return ret;
+  if (hspi->Instance == SPI2){
+    flashDMADone();
+  }
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI2){
+    flashDMADone();
+  }
+  else if (hspi->Instance == SPI3){
+    sd_DMADone();
+  }
 }
 
 /* USER CODE END 4 */
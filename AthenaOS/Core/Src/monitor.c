@@ -0,0 +1,81 @@
+/*
+ * monitor.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Battery, temperature and supply from blocks of ADC scans. Each block
+ * is averaged down to one reading per channel, VREFINT against its
+ * factory value gives the real VDDA, and the battery and temperature
+ * are scaled from that rather than assuming a perfect 3.3 V.
+ */
+
+#include "monitor.h"
+
+void monitor_Init(struct monitor *m, const struct monitor_cal *cal){
+	int i;
+
+	m->cal = *cal;
+	for (i = 0; i < MONITOR_CHANNELS; i++)
+		m->avg[i] = 0;
+	m->vdda_mv = MONITOR_VDDA_CAL;
+	m->battery_mv = 0;
+	m->battery_min_mv = UINT32_MAX;
+	m->temp = 0;
+	m->low = 0;
+	m->brownouts = 0;
+	m->blocks = 0;
+	m->overruns = 0;
+}
+
+/* Without a calibration, the datasheet's typical 0.76 V at 25 C and 2.5 mV/C */
+static int32_t monitor_Temp(const struct monitor *m, uint32_t raw, uint32_t vdda){
+	const struct monitor_cal *cal = &m->cal;
+	int32_t mv, at3v3;
+
+	if (cal->ts110 <= cal->ts30){
+		mv = (int32_t) (raw * vdda / (4095 * MONITOR_OVERSAMPLE));
+		return 250 + (mv - 760) * 10 * 10 / 25;
+	}
+	at3v3 = (int32_t) (raw * vdda / MONITOR_VDDA_CAL);
+	return 300 + (at3v3 - (int32_t) cal->ts30 * MONITOR_OVERSAMPLE) * (1100 - 300) /
+			(((int32_t) cal->ts110 - cal->ts30) * MONITOR_OVERSAMPLE);
+}
+
+/* DMA half or full: scans of MONITOR_CHANNELS samples each */
+void monitor_Block(struct monitor *m, const uint16_t *samples, uint32_t scans){
+	uint32_t sum[MONITOR_CHANNELS] = { 0 };
+	uint32_t avg[MONITOR_CHANNELS];
+	uint32_t i, c, vdda, mv;
+
+	if (scans == 0)
+		return;
+	for (i = 0; i < scans; i++)
+		for (c = 0; c < MONITOR_CHANNELS; c++)
+			sum[c] += *samples++;
+	for (c = 0; c < MONITOR_CHANNELS; c++){
+		avg[c] = (sum[c] * MONITOR_OVERSAMPLE + scans / 2) / scans;
+		m->avg[c] = (uint16_t) avg[c];
+	}
+
+	vdda = MONITOR_VDDA_CAL;
+	if (m->cal.vrefint && avg[MONITOR_VREF])
+		vdda = (MONITOR_VDDA_CAL * m->cal.vrefint * MONITOR_OVERSAMPLE + avg[MONITOR_VREF] / 2) /
+				avg[MONITOR_VREF];
+	m->vdda_mv = vdda;
+
+	mv = (uint32_t) (((uint64_t) avg[MONITOR_BATTERY] * vdda * MONITOR_DIVIDER +
+			4095 * MONITOR_OVERSAMPLE / 2) / (4095 * MONITOR_OVERSAMPLE));
+	m->battery_mv = mv;
+	if (mv < m->battery_min_mv)
+		m->battery_min_mv = mv;
+	if (!m->low && mv < MONITOR_BROWNOUT_MV){
+		m->low = 1;
+		m->brownouts++;
+	}
+	else if (m->low && mv >= MONITOR_BROWNOUT_MV + MONITOR_HYSTERESIS)
+		m->low = 0;
+
+	m->temp = monitor_Temp(m, avg[MONITOR_TEMP], vdda);
+	m->blocks++;
+}
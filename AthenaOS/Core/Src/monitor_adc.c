@@ -0,0 +1,160 @@
+/*
+ * monitor_adc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * ADC1 scans ADC_Batt, the temperature sensor and VREFINT on every
+ * TIM8 update, and DMA2 Stream0 drops the samples into a circular
+ * buffer. The half and full transfer interrupts hand each half to
+ * monitor_Block while the other half fills, so nothing waits on a
+ * conversion. The long sample time is for the battery divider's
+ * source impedance and the temperature sensor's 10 us minimum.
+ */
+
+#include "main.h"
+#include "monitor.h"
+#include "profile.h"
+
+extern ADC_HandleTypeDef hadc1;
+
+TIM_HandleTypeDef htim8;
+DMA_HandleTypeDef hdma_adc1;
+
+struct monitor monitor;
+
+static uint16_t monitor_buf[2 * MONITOR_BLOCK * MONITOR_CHANNELS];
+
+/* TIM8 is on APB2, which runs timers at twice PCLK2 when it's divided */
+static uint32_t monitor_TimerClock(void){
+	uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+
+	return (RCC->CFGR & RCC_CFGR_PPRE2_2) ? pclk * 2 : pclk;
+}
+
+static void monitor_Channel(uint32_t channel, uint32_t rank){
+	ADC_ChannelConfTypeDef sConfig = {0};
+
+	sConfig.Channel = channel;
+	sConfig.Rank = rank;
+	sConfig.SamplingTime = ADC_SAMPLETIME_480CYCLES;
+	if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+static void monitor_Run(void){
+	if (HAL_ADC_Start_DMA(&hadc1, (uint32_t *) monitor_buf, sizeof (monitor_buf) / sizeof (monitor_buf[0])) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+void monitor_Start(void){
+	TIM_MasterConfigTypeDef sMasterConfig = {0};
+	struct monitor_cal cal;
+
+	cal.vrefint = *VREFINT_CAL_ADDR;
+	cal.ts30 = *TEMPSENSOR_CAL1_ADDR;
+	cal.ts110 = *TEMPSENSOR_CAL2_ADDR;
+	monitor_Init(&monitor, &cal);
+
+	/*
+	 * MX_ADC1_Init left it as a single software triggered conversion.
+	 * PCLK2 / 4 keeps ADCCLK under 36 MHz in every governor profile.
+	 */
+	hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+	hadc1.Init.ScanConvMode = ENABLE;
+	hadc1.Init.ContinuousConvMode = DISABLE;
+	hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+	hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T8_TRGO;
+	hadc1.Init.NbrOfConversion = MONITOR_CHANNELS;
+	hadc1.Init.DMAContinuousRequests = ENABLE;
+	hadc1.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+	if (HAL_ADC_Init(&hadc1) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	monitor_Channel(ADC_CHANNEL_1, MONITOR_BATTERY + 1);
+	monitor_Channel(ADC_CHANNEL_TEMPSENSOR, MONITOR_TEMP + 1);
+	monitor_Channel(ADC_CHANNEL_VREFINT, MONITOR_VREF + 1);
+
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hdma_adc1.Instance = DMA2_Stream0;
+	hdma_adc1.Init.Channel = DMA_CHANNEL_0;
+	hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+	hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+	hdma_adc1.Init.Mode = DMA_CIRCULAR;
+	hdma_adc1.Init.Priority = DMA_PRIORITY_LOW;
+	hdma_adc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hadc1, DMA_Handle, hdma_adc1);
+
+	HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+	__HAL_RCC_TIM8_CLK_ENABLE();
+
+	htim8.Instance = TIM8;
+	htim8.Init.Prescaler = 0;
+	htim8.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim8.Init.Period = monitor_TimerClock() / MONITOR_SCAN_HZ - 1;
+	htim8.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim8.Init.RepetitionCounter = 0;
+	htim8.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	if (HAL_TIM_Base_Init(&htim8) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	if (HAL_TIMEx_MasterConfigSynchronization(&htim8, &sMasterConfig) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	monitor_Run();
+	if (HAL_TIM_Base_Start(&htim8) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+/*
+ * An overrun stops DMA requests until the ADC is restarted; that only
+ * happens if the DMA stream was held off for a whole scan period.
+ */
+void monitor_Poll(void){
+	if (!__HAL_ADC_GET_FLAG(&hadc1, ADC_FLAG_OVR) && !(HAL_ADC_GetState(&hadc1) & HAL_ADC_STATE_ERROR_DMA))
+		return;
+	HAL_ADC_Stop_DMA(&hadc1);
+	__HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_OVR);
+	monitor.overruns++;
+	monitor_Run();
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc){
+	PROFILE_BEGIN(start);
+
+	if (hadc != &hadc1)
+		return;
+	monitor_Block(&monitor, monitor_buf, MONITOR_BLOCK);
+	PROFILE_END(PROFILE_MONITOR, start);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc){
+	PROFILE_BEGIN(start);
+
+	if (hadc != &hadc1)
+		return;
+	monitor_Block(&monitor, monitor_buf + MONITOR_BLOCK * MONITOR_CHANNELS, MONITOR_BLOCK);
+	PROFILE_END(PROFILE_MONITOR, start);
+}
@@ -0,0 +1,140 @@
+/*
+ * motion.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs from the step timer interrupt, one call per step, so keep it
+ * to a handful of single precision FPU ops. Every step is a constant
+ * acceleration segment: with v^2 tracked per step, dv^2 = 2a and the
+ * step time is exactly 2 / (v + v').
+ */
+
+#include <math.h>
+#include "motion.h"
+
+void motion_Init(struct motion *m, float tick_hz, uint32_t max_ticks, float max_speed, float accel){
+	m->position = 0;
+	m->target = 0;
+	m->queue_head = 0;
+	m->queue_count = 0;
+	m->dir = 0;
+	m->v2 = 0;
+	m->frac = 0;
+	m->tick_hz = tick_hz;
+	m->max_ticks = max_ticks;
+	motion_SetLimits(m, max_speed, accel);
+}
+
+void motion_SetLimits(struct motion *m, float max_speed, float accel){
+	m->vmax2 = max_speed * max_speed;
+	m->accel2 = 2 * accel;
+}
+
+/* Go here now, forgetting anything queued */
+void motion_Retarget(struct motion *m, int32_t target){
+	m->queue_count = 0;
+	m->target = target;
+}
+
+/* Go here once the current target (and anything before it) is reached */
+int motion_Queue(struct motion *m, int32_t target){
+	if (m->queue_count == MOTION_QUEUE)
+		return -1;
+	m->queue[(m->queue_head + m->queue_count) % MOTION_QUEUE] = target;
+	m->queue_count++;
+	return 0;
+}
+
+/* We're at position, wherever the count says: only while at rest */
+void motion_SetPosition(struct motion *m, int32_t position){
+	m->queue_count = 0;
+	m->position = position;
+	m->target = position;
+	m->dir = 0;
+	m->v2 = 0;
+}
+
+/*
+ * The count was off by -delta. Move it without touching the target, so
+ * the planner makes up the difference from wherever it is, mid-move or
+ * not. Same context as motion_Next().
+ */
+void motion_Shift(struct motion *m, int32_t delta){
+	m->position += delta;
+}
+
+int motion_Busy(const struct motion *m){
+	return m->dir != 0 || m->position != m->target || m->queue_count != 0;
+}
+
+/*
+ * Plan the next step. Returns its direction (+1/-1) and stores the step
+ * period in timer ticks, or returns 0 when there's nothing left to do.
+ */
+int motion_Next(struct motion *m, uint32_t *ticks){
+	int32_t remaining;
+	float v2, v2n, limit, t;
+	int dir;
+
+	for (;;){
+		if (m->dir == 0){
+			while (m->position == m->target && m->queue_count){
+				m->target = m->queue[m->queue_head];
+				m->queue_head = (m->queue_head + 1) % MOTION_QUEUE;
+				m->queue_count--;
+			}
+			if (m->position == m->target)
+				return 0;
+			m->dir = m->target > m->position ? 1 : -1;
+			m->v2 = 0;
+		}
+		remaining = (m->target - m->position) * m->dir;
+		if (remaining > 0 || m->v2 > 0)
+			break;
+		/* Stopped with the target behind us, turn around */
+		m->dir = 0;
+	}
+
+	v2 = m->v2;
+	limit = m->accel2 * (float) (remaining - 1);	/* fastest v^2 we can still stop from */
+
+	v2n = v2 + m->accel2;
+	if (v2n > m->vmax2){
+		v2n = m->vmax2;
+		if (v2 > m->vmax2 && v2 - m->accel2 > m->vmax2)
+			v2n = v2 - m->accel2;		/* limit was lowered under us */
+	}
+	if (v2n > limit){
+		v2n = v2 > limit ? v2 - m->accel2 : limit;
+		if (v2n < 0)
+			v2n = 0;
+	}
+
+	if (v2 == 0 && v2n == 0)
+		t = 2.0f / sqrtf(m->accel2 * 0.5f);		/* single step from rest to rest */
+	else
+		t = 2.0f / (sqrtf(v2) + sqrtf(v2n));
+
+	/* Carry the fraction of a tick so rounding doesn't add up over a move */
+	t = t * m->tick_hz + m->frac;
+	if (t >= (float) m->max_ticks){
+		*ticks = m->max_ticks;
+		m->frac = 0;
+	}
+	else if (t < 1.0f){
+		*ticks = 1;
+		m->frac = 0;
+	}
+	else{
+		*ticks = (uint32_t) t;
+		m->frac = t - (float) *ticks;
+	}
+
+	dir = m->dir;
+	m->position += dir;
+	m->v2 = v2n;
+	if (v2n == 0)
+		m->dir = 0;
+	return dir;
+}
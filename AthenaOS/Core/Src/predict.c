@@ -0,0 +1,96 @@
+/*
+ * predict.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Apogee prediction for the control loop. Integrates the coast in
+ * single precision (the F446 FPU does these in a cycle or two) with
+ * Cd looked up at every stage, so the transonic drag rise is seen
+ * where it actually happens. The last partial step is finished with
+ * the closed form, which is exact once drag is nearly constant, so a
+ * coarse step doesn't quantize the answer. Test/predict_test has the
+ * error against a fine double precision reference for each step size.
+ */
+
+#include <math.h>
+#include "predict.h"
+
+struct predict_state {
+	float	h;
+	float	v;
+};
+
+/* Drag deceleration per v^2 at (h, v) */
+static float predict_K(const struct predict_model *m, float h, float v, float extension){
+	float rho = m->rho0 * expf(-h / PREDICT_H_RHO);
+
+	return 0.5f * rho * (m->cd(m->arg, v, h) * m->area + extension * m->brake_cda) / m->mass;
+}
+
+static float predict_Finish(float h, float v, float k){
+	if (v <= 0)
+		return h;
+	if (k <= 0)
+		return h + v * v / (2 * PREDICT_G);
+	return h + logf(1 + k * v * v / PREDICT_G) / (2 * k);
+}
+
+/*
+ * Coast with k held at its value a third of the way up a first
+ * guess; drag matters most down low where the rocket is fast.
+ */
+float predict_Closed(const struct predict_model *m, float height, float speed, float extension){
+	float apogee = height, h, cd, k;
+	int pass;
+
+	if (speed <= 0)
+		return height;
+	cd = m->cd(m->arg, speed, height);
+	for (pass = 0; pass < 2; pass++){
+		h = height + (apogee - height) * (1.0f / 3.0f);
+		k = 0.5f * m->rho0 * expf(-h / PREDICT_H_RHO) * (cd * m->area + extension * m->brake_cda) / m->mass;
+		apogee = predict_Finish(height, speed, k);
+	}
+	return apogee;
+}
+
+static float predict_Accel(const struct predict_model *m, float h, float v, float extension){
+	return -PREDICT_G - predict_K(m, h, v, extension) * v * fabsf(v);
+}
+
+float predict_Apogee(const struct predict_model *m, uint8_t method, float dt,
+		float height, float speed, float extension){
+	struct predict_state s = { height, speed };
+	float a1, a2, a3, a4, v2, v3, v4, k;
+	int steps;
+
+	if (method == PREDICT_CLOSED)
+		return predict_Closed(m, height, speed, extension);
+
+	for (steps = 0; steps < PREDICT_MAX_STEPS; steps++){
+		k = predict_K(m, s.h, s.v, extension);
+		a1 = -PREDICT_G - k * s.v * fabsf(s.v);
+		/* Would stop within this step: finish in closed form */
+		if (s.v <= -a1 * dt)
+			return predict_Finish(s.h, s.v, k);
+
+		if (method == PREDICT_RK2){
+			v2 = s.v + a1 * dt * 0.5f;
+			a2 = predict_Accel(m, s.h + s.v * dt * 0.5f, v2, extension);
+			s.h += v2 * dt;
+			s.v += a2 * dt;
+		}
+		else{
+			v2 = s.v + a1 * dt * 0.5f;
+			a2 = predict_Accel(m, s.h + s.v * dt * 0.5f, v2, extension);
+			v3 = s.v + a2 * dt * 0.5f;
+			a3 = predict_Accel(m, s.h + v2 * dt * 0.5f, v3, extension);
+			v4 = s.v + a3 * dt;
+			a4 = predict_Accel(m, s.h + v3 * dt, v4, extension);
+			s.h += (s.v + 2 * v2 + 2 * v3 + v4) * dt * (1.0f / 6.0f);
+			s.v += (a1 + 2 * a2 + 2 * a3 + a4) * dt * (1.0f / 6.0f);
+		}
+	}
+	return predict_Finish(s.h, s.v, predict_K(m, s.h, s.v, extension));
+}
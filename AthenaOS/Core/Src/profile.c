@@ -0,0 +1,142 @@
+/*
+ * profile.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Execution time statistics in CPU cycles. An add is a compare or
+ * two, a 64 bit add and a count leading zeros for the histogram bin,
+ * so probes can sit in the control tick and the step interrupt
+ * without showing up in what they measure.
+ */
+
+#include <string.h>
+#include "profile.h"
+
+const char profile_names[PROFILE_PROBES][PROFILE_NAME] = {
+	[PROFILE_CONTROL] = "control",
+	[PROFILE_LUT] = "lut",
+	[PROFILE_PREDICT] = "predict",
+	[PROFILE_LATENCY] = "latency",
+	[PROFILE_COMPANION] = "companion",
+	[PROFILE_STEPPER] = "stepper",
+	[PROFILE_MONITOR] = "monitor",
+};
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+static void profile_Clear(struct profile_probe *p){
+	p->count = 0;
+	p->min = UINT32_MAX;
+	p->max = 0;
+	p->sum = 0;
+	memset(p->hist, 0, sizeof (p->hist));
+}
+
+void profile_Init(struct profile *p){
+	int i;
+
+	for (i = 0; i < PROFILE_PROBES; i++){
+		profile_Clear(&p->probe[i]);
+		p->probe[i].reset = 0;
+	}
+	memset(p->trace, 0, sizeof (p->trace));
+	p->trace_head = 0;
+}
+
+void profile_Add(struct profile_probe *p, uint32_t cycles){
+	uint32_t bin;
+
+	if (p->reset){
+		profile_Clear(p);
+		p->reset = 0;
+	}
+	bin = cycles ? 32 - __builtin_clz(cycles) : 0;
+	if (bin >= PROFILE_BINS)
+		bin = PROFILE_BINS - 1;
+	p->hist[bin]++;
+	if (cycles < p->min)
+		p->min = cycles;
+	if (cycles > p->max)
+		p->max = cycles;
+	p->sum += cycles;
+	p->count++;
+}
+
+/* Any interrupt may trace, so the slot is claimed before it's written */
+void profile_Trace(struct profile *p, uint8_t id, uint32_t at, uint32_t cycles){
+	uint32_t n = __atomic_fetch_add(&p->trace_head, 1, __ATOMIC_RELAXED);
+	struct profile_event *e = &p->trace[n & (PROFILE_TRACE - 1)];
+
+	if (cycles > 0xffffff)
+		cycles = 0xffffff;
+	e->at = at;
+	e->cycles = ((uint32_t) id << 24) | cycles;
+}
+
+/* Copy a probe from outside its interrupt, retrying if an add lands in the middle */
+void profile_Read(const struct profile_probe *p, struct profile_probe *copy){
+	const volatile struct profile_probe *v = p;
+	uint32_t count;
+
+	do {
+		count = v->count;
+		memcpy(copy, p, sizeof (*copy));
+	} while (count != v->count || copy->count != count);
+	if (copy->reset)
+		profile_Clear(copy);
+}
+
+/* id hz[4] name[PROFILE_NAME] count[4] min[4] max[4] sum[8] hist[4 * PROFILE_BINS] */
+uint16_t profile_Encode(uint8_t *out, uint8_t id, uint32_t hz, const struct profile_probe *p){
+	uint8_t *o = out;
+	int i;
+
+	*o++ = id;
+	put32(o, hz);
+	o += 4;
+	memcpy(o, profile_names[id], PROFILE_NAME);
+	o += PROFILE_NAME;
+	put32(o, p->count);
+	put32(o + 4, p->count ? p->min : 0);
+	put32(o + 8, p->max);
+	put32(o + 12, (uint32_t) p->sum);
+	put32(o + 16, (uint32_t) (p->sum >> 32));
+	o += 20;
+	for (i = 0; i < PROFILE_BINS; i++, o += 4)
+		put32(o, p->hist[i]);
+	return (uint16_t) (o - out);
+}
+
+/* name gets PROFILE_NAME + 1 bytes; returns -1 on a short payload */
+int profile_Decode(const uint8_t *in, uint16_t len, uint8_t *id, uint32_t *hz, char *name,
+		struct profile_probe *p){
+	int i;
+
+	if (len < PROFILE_SIZE)
+		return -1;
+	*id = *in++;
+	*hz = get32(in);
+	in += 4;
+	memcpy(name, in, PROFILE_NAME);
+	name[PROFILE_NAME] = '\0';
+	in += PROFILE_NAME;
+	p->count = get32(in);
+	p->min = get32(in + 4);
+	p->max = get32(in + 8);
+	p->sum = get32(in + 12) | ((uint64_t) get32(in + 16) << 32);
+	in += 20;
+	for (i = 0; i < PROFILE_BINS; i++, in += 4)
+		p->hist[i] = get32(in);
+	p->reset = 0;
+	return 0;
+}
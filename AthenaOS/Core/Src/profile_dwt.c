@@ -0,0 +1,23 @@
+/*
+ * profile_dwt.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * The DWT cycle counter behind the PROFILE_BEGIN/PROFILE_END probes.
+ * It runs at the core clock and wraps every minute at 72 MHz, far
+ * longer than anything we measure.
+ */
+
+#include "main.h"
+#include "profile.h"
+
+struct profile profile;
+
+void profile_Start(void){
+	profile_Init(&profile);
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
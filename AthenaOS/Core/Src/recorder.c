@@ -0,0 +1,355 @@
+/*
+ * recorder.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Append-only flight log. The control interrupt drops a record into
+ * the RAM page being filled; full pages go to flash one at a time
+ * from the main loop, so a slow page program only ever costs records
+ * once all RECORDER_PAGES are waiting, and never costs a control tick.
+ */
+
+#include <string.h>
+#include "recorder.h"
+
+static uint16_t get16(const uint8_t *p){
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v & 0xffff);
+	put16(p + 2, v >> 16);
+}
+
+static float getf(const uint8_t *p){
+	uint32_t v = get32(p);
+	float f;
+
+	memcpy(&f, &v, sizeof (f));
+	return f;
+}
+
+static void putf(uint8_t *p, float f){
+	uint32_t v;
+
+	memcpy(&v, &f, sizeof (v));
+	put32(p, v);
+}
+
+static int16_t recorder_Clamp16(float v){
+	if (v > 32767)
+		return 32767;
+	if (v < -32768)
+		return -32768;
+	return (int16_t) (v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static uint16_t recorder_Unsigned16(float v){
+	if (v > 65535)
+		return 65535;
+	if (v < 0)
+		return 0;
+	return (uint16_t) (v + 0.5f);
+}
+
+static uint16_t recorder_Sat16(uint32_t v){
+	return v > 0xffff ? 0xffff : (uint16_t) v;
+}
+
+void recorder_Init(struct recorder *r, uint32_t addr, uint32_t end,
+		int (*write)(uint32_t addr, const uint8_t *data, uint32_t len)){
+	r->head = 0;
+	r->fill = 0;
+	r->tail = 0;
+	r->writing = 0;
+	r->addr = addr;
+	r->end = end;
+	r->drops = 0;
+	r->records = 0;
+	r->pages = 0;
+	r->lost = 0;
+	r->write = write;
+	memset(r->page[0], 0xff, RECORDER_PAGE_SIZE);
+}
+
+/* Move on from a full head page, if the next one has been written out */
+static int recorder_Advance(struct recorder *r){
+	uint8_t next = (r->head + 1) % RECORDER_PAGES;
+
+	if (next == r->tail)
+		return -1;
+	memset(r->page[next], 0xff, RECORDER_PAGE_SIZE);
+	r->fill = 0;
+	r->head = next;
+	return 0;
+}
+
+/* Stage one encoded record. Returns -1, and counts it, if there's no room */
+int recorder_Add(struct recorder *r, const uint8_t *rec){
+	if (r->fill == RECORDER_PER_PAGE && recorder_Advance(r) != 0){
+		r->drops++;
+		return -1;
+	}
+	memcpy(r->page[r->head] + r->fill * RECORDER_RECORD_SIZE, rec, RECORDER_RECORD_SIZE);
+	r->records++;
+	if (++r->fill == RECORDER_PER_PAGE)
+		recorder_Advance(r);
+	return 0;
+}
+
+/*
+ * Close off a partly filled page so it gets written, leaving the rest
+ * of it erased. Same context as recorder_Add().
+ */
+void recorder_Pad(struct recorder *r){
+	if (r->fill == 0)
+		return;
+	r->fill = RECORDER_PER_PAGE;
+	recorder_Advance(r);
+}
+
+/* Main loop: send the oldest full page on its way */
+void recorder_Poll(struct recorder *r){
+	uint8_t t = r->tail;
+
+	if (r->writing || t == r->head)
+		return;
+	if (r->addr + RECORDER_PAGE_SIZE > r->end){
+		/* Out of log: throw pages away so the producer keeps going */
+		r->lost++;
+		r->tail = (t + 1) % RECORDER_PAGES;
+		return;
+	}
+	r->writing = 1;
+	if (r->write(r->addr, r->page[t], RECORDER_PAGE_SIZE) != 0){
+		r->writing = 0;
+		return;
+	}
+	r->addr += RECORDER_PAGE_SIZE;
+}
+
+/* The tail page is out of RAM, possibly from the DMA interrupt */
+void recorder_WriteDone(struct recorder *r){
+	r->tail = (r->tail + 1) % RECORDER_PAGES;
+	r->pages++;
+	r->writing = 0;
+}
+
+static int recorder_Erased(const uint8_t *page){
+	int i;
+
+	for (i = 0; i < RECORDER_PAGE_SIZE; i++)
+		if (page[i] != 0xff)
+			return 0;
+	return 1;
+}
+
+/* Binary search for the first erased page in [lo, hi), all used below it */
+static uint32_t recorder_Search(uint32_t lo, uint32_t hi,
+		int (*read)(uint32_t addr, uint8_t *data, uint32_t len)){
+	uint8_t page[RECORDER_PAGE_SIZE];
+	uint32_t mid;
+
+	while (lo < hi){
+		mid = lo + (hi - lo) / RECORDER_PAGE_SIZE / 2 * RECORDER_PAGE_SIZE;
+		if (read(mid, page, sizeof (page)) != 0 || !recorder_Erased(page))
+			lo = mid + RECORDER_PAGE_SIZE;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * First erased page in [start, end), start on a sector boundary. The
+ * log is only ever written into erased sectors, but whatever an old log
+ * left further on is erased just ahead of the new one rather than all
+ * at once, so past the log there may be old data as well as blank
+ * sectors. The sector after the last one written is always blank,
+ * though (the erase scheduler holds back every page of a sector
+ * until then), so the first sector that starts with an erased page
+ * ends the search, and the end of the log is in the one before it.
+ * A page with anything at all programmed counts as used, so a torn
+ * write is stepped over rather than written on top of.
+ */
+uint32_t recorder_FindEnd(uint32_t start, uint32_t end,
+		int (*read)(uint32_t addr, uint8_t *data, uint32_t len)){
+	uint8_t page[RECORDER_PAGE_SIZE];
+	uint32_t s;
+
+	for (s = start; s < end; s += RECORDER_SECTOR_SIZE)
+		if (read(s, page, sizeof (page)) == 0 && recorder_Erased(page))
+			break;
+	if (s == start)
+		return start;
+	return recorder_Search(s - RECORDER_SECTOR_SIZE, s < end ? s : end, read);
+}
+
+static void recorder_Sum(uint8_t *rec){
+	uint8_t sum = 0;
+	int i;
+
+	rec[1] = 0;
+	for (i = 0; i < RECORDER_RECORD_SIZE; i++)
+		sum += rec[i];
+	rec[1] = RECORDER_CHECKSUM - sum;
+}
+
+/* Record type, RECORDER_EMPTY for erased flash or RECORDER_BAD */
+int recorder_Check(const uint8_t *rec){
+	uint8_t sum = 0;
+	int i, erased = 1;
+
+	for (i = 0; i < RECORDER_RECORD_SIZE; i++){
+		sum += rec[i];
+		if (rec[i] != 0xff)
+			erased = 0;
+	}
+	if (erased)
+		return RECORDER_EMPTY;
+	if (sum != RECORDER_CHECKSUM)
+		return RECORDER_BAD;
+	return rec[0];
+}
+
+void recorder_EncodeBoot(uint8_t *rec, const struct recorder_boot *b){
+	memset(rec, 0, RECORDER_RECORD_SIZE);
+	rec[0] = RECORDER_BOOT;
+	rec[2] = RECORDER_VERSION;
+	rec[3] = b->method;
+	put32(rec + 4, b->tick);
+	put32(rec + 8, b->lut_crc);
+	put16(rec + 12, (uint16_t) b->target);
+	put16(rec + 14, (uint16_t) b->brake_steps);
+	putf(rec + 16, b->kp);
+	putf(rec + 20, b->ki);
+	put16(rec + 24, b->dt);
+	recorder_Sum(rec);
+}
+
+void recorder_DecodeBoot(const uint8_t *rec, struct recorder_boot *b){
+	b->method = rec[3];
+	b->tick = get32(rec + 4);
+	b->lut_crc = get32(rec + 8);
+	b->target = (int16_t) get16(rec + 12);
+	b->brake_steps = (int16_t) get16(rec + 14);
+	b->kp = getf(rec + 16);
+	b->ki = getf(rec + 20);
+	b->dt = get16(rec + 24);
+}
+
+void recorder_EncodeControl(uint8_t *rec, const struct recorder_control *c){
+	rec[0] = RECORDER_CONTROL;
+	rec[2] = c->flight_state;
+	rec[3] = c->mode;
+	put32(rec + 4, c->tick);
+	put16(rec + 8, c->companion_tick);
+	put16(rec + 10, (uint16_t) c->height);
+	put16(rec + 12, (uint16_t) c->speed);
+	put16(rec + 14, (uint16_t) c->accel);
+	put16(rec + 16, recorder_Unsigned16(c->cd * 10000));
+	put16(rec + 18, (uint16_t) recorder_Clamp16(c->predicted));
+	put16(rec + 20, (uint16_t) recorder_Clamp16((float) c->commanded));
+	put16(rec + 22, (uint16_t) recorder_Clamp16((float) c->position));
+	put16(rec + 24, recorder_Sat16(c->exec));
+	put16(rec + 26, recorder_Sat16(c->period));
+	put16(rec + 28, recorder_Sat16(c->overruns));
+	put16(rec + 30, recorder_Sat16(c->drops));
+	recorder_Sum(rec);
+}
+
+void recorder_DecodeControl(const uint8_t *rec, struct recorder_control *c){
+	c->flight_state = rec[2];
+	c->mode = rec[3];
+	c->tick = get32(rec + 4);
+	c->companion_tick = get16(rec + 8);
+	c->height = (int16_t) get16(rec + 10);
+	c->speed = (int16_t) get16(rec + 12);
+	c->accel = (int16_t) get16(rec + 14);
+	c->cd = get16(rec + 16) / 10000.0f;
+	c->predicted = (int16_t) get16(rec + 18);
+	c->commanded = (int16_t) get16(rec + 20);
+	c->position = (int16_t) get16(rec + 22);
+	c->exec = get16(rec + 24);
+	c->period = get16(rec + 26);
+	c->overruns = get16(rec + 28);
+	c->drops = get16(rec + 30);
+}
+
+void recorder_EncodeFrame(uint8_t *rec, const struct recorder_frame *f){
+	memset(rec, 0, RECORDER_RECORD_SIZE);
+	rec[0] = RECORDER_FRAME;
+	put32(rec + 4, f->tick);
+	memcpy(rec + 8, f->command, RECORDER_COMMAND_SIZE);
+	put32(rec + 24, f->frames);
+	put16(rec + 28, recorder_Sat16(f->errors));
+	recorder_Sum(rec);
+}
+
+void recorder_DecodeFrame(const uint8_t *rec, struct recorder_frame *f){
+	f->tick = get32(rec + 4);
+	memcpy(f->command, rec + 8, RECORDER_COMMAND_SIZE);
+	f->frames = get32(rec + 24);
+	f->errors = get16(rec + 28);
+}
+
+void recorder_EncodeHil(uint8_t *rec, const struct recorder_hil *h){
+	rec[0] = RECORDER_HIL;
+	rec[2] = h->mode;
+	rec[3] = h->flags;
+	put32(rec + 4, h->tick);
+	put16(rec + 8, h->companion_tick);
+	put16(rec + 10, (uint16_t) h->height);
+	put16(rec + 12, (uint16_t) h->speed);
+	put16(rec + 14, (uint16_t) recorder_Clamp16((float) h->commanded));
+	put32(rec + 16, h->frame_cycles);
+	put32(rec + 20, h->start_cycles);
+	put32(rec + 24, h->done_cycles);
+	put16(rec + 28, (uint16_t) recorder_Clamp16((float) h->position));
+	rec[30] = h->mhz;
+	rec[31] = 0;
+	recorder_Sum(rec);
+}
+
+void recorder_DecodeHil(const uint8_t *rec, struct recorder_hil *h){
+	h->mode = rec[2];
+	h->flags = rec[3];
+	h->tick = get32(rec + 4);
+	h->companion_tick = get16(rec + 8);
+	h->height = (int16_t) get16(rec + 10);
+	h->speed = (int16_t) get16(rec + 12);
+	h->commanded = (int16_t) get16(rec + 14);
+	h->frame_cycles = get32(rec + 16);
+	h->start_cycles = get32(rec + 20);
+	h->done_cycles = get32(rec + 24);
+	h->position = (int16_t) get16(rec + 28);
+	h->mhz = rec[30];
+}
+
+void recorder_EncodeBlock(uint8_t *rec, const struct recorder_block *b){
+	memset(rec, 0, RECORDER_RECORD_SIZE);
+	rec[0] = RECORDER_BLOCK;
+	rec[2] = RECORDER_VERSION;
+	put32(rec + 4, b->tick);
+	put32(rec + 8, b->session);
+	put32(rec + 12, b->seq);
+	put32(rec + 16, b->drops);
+	recorder_Sum(rec);
+}
+
+void recorder_DecodeBlock(const uint8_t *rec, struct recorder_block *b){
+	b->tick = get32(rec + 4);
+	b->session = get32(rec + 8);
+	b->seq = get32(rec + 12);
+	b->drops = get32(rec + 16);
+}
@@ -0,0 +1,89 @@
+/*
+ * recorder_flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Puts the flight log in the W25Q storage region, from wherever the
+ * last flight left off to the end of the chip. Pages go out through
+ * the flash write queue, so programming overlaps everything else, and
+ * the sectors ahead of them are erased in the background as the log
+ * gets there.
+ */
+
+#include "main.h"
+#include "flash.h"
+#include "lut.h"
+#include "control.h"
+#include "recorder.h"
+#include "erase.h"
+
+struct recorder recorder;
+struct erase erase;
+
+static void recorder_FlashDone(void){
+	recorder_WriteDone(&recorder);
+}
+
+static int recorder_FlashWrite(uint32_t addr, const uint8_t *data, uint32_t len){
+	/* Not erased yet: recorder_Poll() tries again next time round */
+	if (!erase_Ready(&erase, addr, len))
+		return -1;
+	return flashWriteQueue(addr, data, len, recorder_FlashDone);
+}
+
+static int recorder_FlashRead(uint32_t addr, uint8_t *data, uint32_t len){
+	flashReadBlock(addr, data, len);
+	return 0;
+}
+
+/* A boot record describing the controller, for the start of a log */
+void recorder_Boot(uint8_t *rec){
+	struct recorder_boot b;
+
+	b.tick = HAL_GetTick();
+	b.method = control.cfg.method;
+	b.lut_crc = lut.rows ? lut.h.crc32 : 0;
+	b.target = (int16_t) control.cfg.target;
+	b.brake_steps = (int16_t) control.cfg.brake_steps;
+	b.kp = control.cfg.kp;
+	b.ki = control.cfg.ki;
+	b.dt = (uint16_t) (control.cfg.dt * 1000);
+	recorder_EncodeBoot(rec, &b);
+}
+
+/*
+ * Find the end of the log, below limit, and stage a boot record. The
+ * control interrupt is held off while the ring is reset.
+ */
+static void recorder_Open(uint32_t limit){
+	uint8_t rec[RECORDER_RECORD_SIZE];
+	uint32_t irq = NVIC_GetEnableIRQ(TIM4_IRQn);
+	uint32_t end;
+
+	HAL_NVIC_DisableIRQ(TIM4_IRQn);
+	flashSync();
+	end = recorder_FindEnd(FLASH_STORAGE_ADDR, limit, recorder_FlashRead);
+	recorder_Init(&recorder, end, FLASH_SIZE, recorder_FlashWrite);
+	erase_Restart(&erase, end);
+
+	recorder_Boot(rec);
+	recorder_Add(&recorder, rec);
+
+	if (irq)
+		HAL_NVIC_EnableIRQ(TIM4_IRQn);
+}
+
+void recorder_Start(void){
+	erase_Init(&erase, FLASH_STORAGE_ADDR, FLASH_SIZE - FLASH_STORAGE_ADDR, flashEraseStart, flashEraseBusy);
+	recorder_Open(FLASH_SIZE);
+}
+
+/*
+ * Throw away the log from addr (sector aligned) on. Nothing is erased
+ * here; the log carries on from addr, or wherever it ended below that,
+ * and erase_Poll() clears the way in front of it.
+ */
+void recorder_Erase(uint32_t addr){
+	recorder_Open(addr);
+}
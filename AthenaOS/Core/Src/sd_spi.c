@@ -0,0 +1,386 @@
+/*
+ * sd_spi.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * SPI mode microSD driver. Bringing the card up, and the single block
+ * reads and writes that fat.c does at boot, are plain polled SPI. The
+ * log goes out as one long multi-block write (CMD25): each block's
+ * 512 bytes on the SPI3 TX DMA, and the data response and the card's
+ * busy time picked up from sd_Poll() in the main loop, so nothing ever
+ * waits on the card in flight. A write at the next block carries on
+ * the same CMD25; anything else ends it first.
+ */
+
+#include <string.h>
+#include "main.h"
+#include "sd.h"
+
+#define SD_START_BLOCK		0xFE	/* single block read/write token */
+#define SD_START_MULTI		0xFC	/* CMD25 block token */
+#define SD_STOP_MULTI		0xFD
+#define SD_R1_IDLE			0x01
+#define SD_DATA_ACCEPTED	0x05
+
+/* Where the multi-block write is */
+#define SD_IDLE			0		/* no CMD25, card deselected */
+#define SD_STREAM		1		/* CMD25 open, waiting for the next block */
+#define SD_DMA			2		/* block going out */
+#define SD_RESPONSE		3		/* block out, data response to read */
+#define SD_BUSY			4		/* card programming it */
+
+extern SPI_HandleTypeDef hspi3;
+
+DMA_HandleTypeDef hdma_spi3_tx;
+
+struct sd_card sd;
+
+static volatile uint8_t sd_state;
+static uint32_t sd_next;			/* block the open CMD25 writes next */
+static const uint8_t *sd_data;
+static uint32_t sd_left;			/* blocks not yet sent */
+static uint32_t sd_pending;			/* blocks done() hasn't been called for */
+static void (*sd_done)(void);
+static uint32_t sd_busy_start;
+static uint8_t sd_dma_ready;
+
+static uint8_t sd_Spi(uint8_t data){
+	uint8_t ret;
+
+	HAL_SPI_TransmitReceive(&hspi3, &data, &ret, 1, HAL_MAX_DELAY);
+	return ret;
+}
+
+static void sd_Select(void){
+	HAL_GPIO_WritePin(SD_CS_GPIO_Port, SD_CS_Pin, GPIO_PIN_RESET);
+}
+
+/* The card lets go of MISO on the clock after CS goes up */
+static void sd_Deselect(void){
+	HAL_GPIO_WritePin(SD_CS_GPIO_Port, SD_CS_Pin, GPIO_PIN_SET);
+	sd_Spi(0xff);
+}
+
+static void sd_Speed(uint32_t prescaler){
+	__HAL_SPI_DISABLE(&hspi3);
+	MODIFY_REG(hspi3.Instance->CR1, SPI_CR1_BR, prescaler);
+	hspi3.Init.BaudRatePrescaler = prescaler;
+}
+
+static uint32_t sd_Addr(uint32_t lba){
+	return sd.sdhc ? lba : lba * SD_BLOCK_SIZE;
+}
+
+/* A busy card holds MISO low */
+static int sd_WaitReady(uint32_t timeout){
+	uint32_t start = HAL_GetTick();
+
+	while (sd_Spi(0xff) != 0xff)
+		if (HAL_GetTick() - start > timeout)
+			return -1;
+	return 0;
+}
+
+/* Send a command with the card selected and return R1, 0xff for no answer */
+static uint8_t sd_Command(uint8_t cmd, uint32_t arg){
+	uint8_t frame[6];
+	uint8_t r = 0xff;
+	int i;
+
+	if (cmd != 0 && sd_WaitReady(SD_WRITE_TIMEOUT) != 0)
+		return 0xff;
+
+	frame[0] = 0x40 | cmd;
+	frame[1] = (arg >> 24) & 0xff;
+	frame[2] = (arg >> 16) & 0xff;
+	frame[3] = (arg >> 8) & 0xff;
+	frame[4] = arg & 0xff;
+	/* Only CMD0 and CMD8 are checked in SPI mode */
+	frame[5] = cmd == 0 ? 0x95 : cmd == 8 ? 0x87 : 0x01;
+	HAL_SPI_Transmit(&hspi3, frame, sizeof (frame), HAL_MAX_DELAY);
+
+	for (i = 0; i < 10; i++)
+		if (!((r = sd_Spi(0xff)) & 0x80))
+			break;
+	return r;
+}
+
+static uint8_t sd_AppCommand(uint8_t cmd, uint32_t arg){
+	sd_Command(55, 0);
+	return sd_Command(cmd, arg);
+}
+
+static void sd_DMAInit(void){
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hdma_spi3_tx.Instance = DMA1_Stream5;
+	hdma_spi3_tx.Init.Channel = DMA_CHANNEL_0;
+	hdma_spi3_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi3_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi3_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi3_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi3_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi3_tx.Init.Mode = DMA_NORMAL;
+	hdma_spi3_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+	hdma_spi3_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi3_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi3, hdmatx, hdma_spi3_tx);
+
+	HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 3, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+	sd_dma_ready = 1;
+}
+
+/* SD Physical Layer spec, SPI mode: CMD0, CMD8, ACMD41 until ready, CMD58 */
+static int sd_Identify(void){
+	uint8_t r, ocr[4];
+	uint32_t start;
+	int i, v2;
+
+	for (i = 0; (r = sd_Command(0, 0)) != SD_R1_IDLE; i++)
+		if (i == 10)
+			return -1;
+
+	/* Version 2 cards echo the check pattern; older ones don't know CMD8 */
+	v2 = sd_Command(8, 0x1aa) == SD_R1_IDLE;
+	if (v2){
+		for (i = 0; i < 4; i++)
+			ocr[i] = sd_Spi(0xff);
+		if ((ocr[2] & 0x0f) != 0x01 || ocr[3] != 0xaa)
+			return -1;
+	}
+
+	start = HAL_GetTick();
+	while ((r = sd_AppCommand(41, v2 ? 1ul << 30 : 0)) == SD_R1_IDLE)
+		if (HAL_GetTick() - start > SD_INIT_TIMEOUT)
+			return -1;
+	if (r != 0)
+		return -1;
+
+	sd.sdhc = 0;
+	if (v2){
+		if (sd_Command(58, 0) != 0)
+			return -1;
+		for (i = 0; i < 4; i++)
+			ocr[i] = sd_Spi(0xff);
+		sd.sdhc = (ocr[0] & 0x40) != 0;
+	}
+	if (!sd.sdhc && sd_Command(16, SD_BLOCK_SIZE) != 0)
+		return -1;
+	return 0;
+}
+
+/* Bring the card up. Returns -1 if there isn't one that answers */
+int sd_Init(void){
+	int i, ret;
+
+	if (!sd_dma_ready)
+		sd_DMAInit();
+	sd.ready = 0;
+	sd.errors = 0;
+	sd.busy_max = 0;
+	sd_state = SD_IDLE;
+
+	/* Under 400 kHz until it's identified, then PCLK1 / 2 */
+	sd_Speed(SPI_BAUDRATEPRESCALER_128);
+	HAL_GPIO_WritePin(SD_CS_GPIO_Port, SD_CS_Pin, GPIO_PIN_SET);
+	for (i = 0; i < 10; i++)
+		sd_Spi(0xff);
+
+	sd_Select();
+	ret = sd_Identify();
+	sd_Deselect();
+	if (ret != 0)
+		return -1;
+
+	sd_Speed(SPI_BAUDRATEPRESCALER_2);
+	sd.ready = 1;
+	return 0;
+}
+
+/*
+ * The card has stopped answering. Drop it until the next boot, and
+ * hand back the blocks it was given so the log keeps moving.
+ */
+static void sd_Fail(void){
+	void (*done)(void) = sd_done;
+
+	sd.ready = 0;
+	sd.errors++;
+	HAL_SPI_Abort(&hspi3);
+	sd_Deselect();
+	sd_state = SD_IDLE;
+	sd_left = 0;
+	while (sd_pending){
+		sd_pending--;
+		if (done)
+			done();
+	}
+}
+
+static void sd_SendBlock(void){
+	const uint8_t *data = sd_data;
+
+	sd_Spi(SD_START_MULTI);
+	sd_data += SD_BLOCK_SIZE;
+	sd_left--;
+	sd_state = SD_DMA;
+	if (HAL_SPI_Transmit_DMA(&hspi3, (uint8_t *) data, SD_BLOCK_SIZE) != HAL_OK)
+		sd_Fail();
+}
+
+/* From HAL_SPI_TxCpltCallback: the block is out, CS stays down */
+void sd_DMADone(void){
+	sd_state = SD_RESPONSE;
+}
+
+/*
+ * Carry the multi-block write along: read each block's data response
+ * once the DMA is done with it, then watch for the card to finish
+ * programming before sending the next. Never waits.
+ */
+void sd_Poll(void){
+	uint32_t busy;
+	uint8_t r = 0xff;
+	int i;
+
+	switch (sd_state){
+	case SD_RESPONSE:
+		/* CRC, not checked in SPI mode, then the data response */
+		sd_Spi(0xff);
+		sd_Spi(0xff);
+		for (i = 0; i < 4 && r == 0xff; i++)
+			r = sd_Spi(0xff);
+		if ((r & 0x1f) != SD_DATA_ACCEPTED)
+			sd.errors++;
+		sd_busy_start = HAL_GetTick();
+		sd_state = SD_BUSY;
+		sd_pending--;
+		if (sd_done)
+			sd_done();
+		/* fall through */
+	case SD_BUSY:
+		busy = HAL_GetTick() - sd_busy_start;
+		if (sd_Spi(0xff) != 0xff){
+			if (busy > SD_WRITE_TIMEOUT)
+				sd_Fail();
+			return;
+		}
+		if (busy > sd.busy_max)
+			sd.busy_max = busy;
+		if (sd_left)
+			sd_SendBlock();
+		else
+			sd_state = SD_STREAM;
+		return;
+	default:
+		return;
+	}
+}
+
+/* A block is going out by DMA, so SPI3 has to be left alone */
+int sd_Busy(void){
+	return sd_state == SD_DMA;
+}
+
+/* Wait out any block on its way */
+static void sd_Sync(void){
+	while (sd_state == SD_DMA || sd_state == SD_RESPONSE || sd_state == SD_BUSY)
+		sd_Poll();
+}
+
+/* Finish the multi-block write, if there is one, and deselect the card */
+void sd_Close(void){
+	sd_Sync();
+	if (sd_state != SD_STREAM)
+		return;
+	sd_Spi(SD_STOP_MULTI);
+	sd_Spi(0xff);
+	if (sd_WaitReady(SD_WRITE_TIMEOUT) != 0)
+		sd.errors++;
+	sd_Deselect();
+	sd_state = SD_IDLE;
+}
+
+/*
+ * Start count blocks from data on their way to lba, on the end of the
+ * running multi-block write if that's where it was up to. done() runs
+ * from sd_Poll() as each block is taken, after which that block's RAM
+ * is free. Returns -1 if the card is still busy with the last lot, or
+ * gone.
+ */
+int sd_WriteStart(uint32_t lba, const uint8_t *data, uint32_t count, void (*done)(void)){
+	if (!sd.ready || count == 0)
+		return -1;
+	if (sd_state != SD_IDLE && sd_state != SD_STREAM)
+		return -1;
+	if (sd_state == SD_STREAM && lba != sd_next)
+		sd_Close();
+	if (sd_state == SD_IDLE){
+		sd_Select();
+		if (sd_Command(25, sd_Addr(lba)) != 0){
+			sd_pending = 0;
+			sd_Fail();
+			return -1;
+		}
+		sd_Spi(0xff);
+		sd_state = SD_STREAM;
+	}
+	sd_data = data;
+	sd_left = count;
+	sd_pending = count;
+	sd_done = done;
+	sd_next = lba + count;
+	sd_SendBlock();
+	return 0;
+}
+
+int sd_ReadBlock(uint32_t lba, uint8_t *data){
+	uint32_t start;
+	uint8_t r = 0xff;
+	int ret = -1;
+
+	if (!sd.ready)
+		return -1;
+	sd_Close();
+	sd_Select();
+	if (sd_Command(17, sd_Addr(lba)) == 0){
+		start = HAL_GetTick();
+		while ((r = sd_Spi(0xff)) == 0xff && HAL_GetTick() - start < SD_READ_TIMEOUT)
+			;
+		if (r == SD_START_BLOCK){
+			/* HAL clocks the buffer out as it reads into it: keep MOSI high */
+			memset(data, 0xff, SD_BLOCK_SIZE);
+			HAL_SPI_Receive(&hspi3, data, SD_BLOCK_SIZE, HAL_MAX_DELAY);
+			sd_Spi(0xff);
+			sd_Spi(0xff);
+			ret = 0;
+		}
+	}
+	sd_Deselect();
+	return ret;
+}
+
+int sd_WriteBlock(uint32_t lba, const uint8_t *data){
+	int ret = -1;
+
+	if (!sd.ready)
+		return -1;
+	sd_Close();
+	sd_Select();
+	if (sd_Command(24, sd_Addr(lba)) == 0){
+		sd_Spi(0xff);
+		sd_Spi(SD_START_BLOCK);
+		HAL_SPI_Transmit(&hspi3, (uint8_t *) data, SD_BLOCK_SIZE, HAL_MAX_DELAY);
+		sd_Spi(0xff);
+		sd_Spi(0xff);
+		if ((sd_Spi(0xff) & 0x1f) == SD_DATA_ACCEPTED && sd_WaitReady(SD_WRITE_TIMEOUT) == 0)
+			ret = 0;
+	}
+	sd_Deselect();
+	return ret;
+}
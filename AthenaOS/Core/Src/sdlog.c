@@ -0,0 +1,134 @@
+/*
+ * sdlog.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Block ring for the SD log. Works like the recorder's page ring,
+ * except that each block gets a header record when its first record
+ * goes in, and the main loop hands over as many full blocks as sit
+ * together in RAM so the card sees long multi-block writes.
+ */
+
+#include <string.h>
+#include "sdlog.h"
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* No write() means no card, and nothing is staged */
+void sdlog_Init(struct sdlog *s, uint32_t lba, uint32_t end, uint32_t session,
+		int (*write)(uint32_t lba, const uint8_t *data, uint32_t count)){
+	s->head = 0;
+	s->fill = 0;
+	s->tail = 0;
+	s->writing = 0;
+	s->lba = lba;
+	s->end = end;
+	s->session = session;
+	s->seq = 0;
+	s->drops = 0;
+	s->records = 0;
+	s->blocks = 0;
+	s->lost = 0;
+	s->write = write;
+	memset(s->block[0], 0xff, SDLOG_BLOCK_SIZE);
+}
+
+/* Move on from a full head block, if the next one has been written out */
+static int sdlog_Advance(struct sdlog *s){
+	uint8_t next = (s->head + 1) % SDLOG_BLOCKS;
+
+	if (next == s->tail)
+		return -1;
+	memset(s->block[next], 0xff, SDLOG_BLOCK_SIZE);
+	s->fill = 0;
+	s->seq++;
+	s->head = next;
+	return 0;
+}
+
+/* Stage one encoded record. Returns -1, and counts it, if there's no room */
+int sdlog_Add(struct sdlog *s, const uint8_t *rec){
+	struct recorder_block b;
+
+	if (!s->write)
+		return -1;
+	if (s->fill == SDLOG_PER_BLOCK && sdlog_Advance(s) != 0){
+		s->drops++;
+		return -1;
+	}
+	if (s->fill == 0){
+		b.tick = get32(rec + 4);
+		b.session = s->session;
+		b.seq = s->seq;
+		b.drops = s->drops;
+		recorder_EncodeBlock(s->block[s->head], &b);
+		s->fill = 1;
+	}
+	memcpy(s->block[s->head] + s->fill * RECORDER_RECORD_SIZE, rec, RECORDER_RECORD_SIZE);
+	s->records++;
+	if (++s->fill == SDLOG_PER_BLOCK)
+		sdlog_Advance(s);
+	return 0;
+}
+
+/* Close off a partly filled block so it gets written. Same context as sdlog_Add() */
+void sdlog_Pad(struct sdlog *s){
+	if (s->fill == 0)
+		return;
+	s->fill = SDLOG_PER_BLOCK;
+	sdlog_Advance(s);
+}
+
+/* Main loop: send every full block that's together in RAM on its way */
+void sdlog_Poll(struct sdlog *s){
+	uint8_t t = s->tail, h = s->head;
+	uint32_t count;
+
+	if (s->writing || t == h)
+		return;
+	count = h > t ? h - t : SDLOG_BLOCKS - t;
+	if (s->lba >= s->end){
+		/* Out of file: throw blocks away so the producer keeps going */
+		s->lost += count;
+		s->tail = (t + count) % SDLOG_BLOCKS;
+		return;
+	}
+	if (count > s->end - s->lba)
+		count = s->end - s->lba;
+	s->writing = count;
+	if (s->write(s->lba, s->block[t], count) != 0){
+		s->writing = 0;
+		return;
+	}
+	s->lba += count;
+}
+
+/* The tail block is on the card, possibly from an interrupt */
+void sdlog_WriteDone(struct sdlog *s){
+	s->tail = (s->tail + 1) % SDLOG_BLOCKS;
+	s->blocks++;
+	s->writing--;
+}
+
+/*
+ * Is this block seq of the log? The first block of a file is taken
+ * to be the start of one whatever its session, which is then held to
+ * for the rest.
+ */
+int sdlog_Check(const uint8_t *block, uint32_t *session, uint32_t seq){
+	struct recorder_block b;
+
+	if (recorder_Check(block) != RECORDER_BLOCK)
+		return -1;
+	recorder_DecodeBlock(block, &b);
+	if (b.seq != seq)
+		return -1;
+	if (seq == 0)
+		*session = b.session;
+	else if (b.session != *session)
+		return -1;
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * sdlog_sd.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Puts the SD log in a new file on the microSD card every boot. All
+ * the FAT work happens here, before flight: the next ATHNnnnn.LOG is
+ * created at its full size in one run of clusters, and from then on
+ * blocks go to the card as raw multi-block writes. Without a card, or
+ * one fat.c can't use, there's no SD log and the flash log carries on
+ * as before.
+ */
+
+#include "main.h"
+#include "recorder.h"
+#include "sdlog.h"
+#include "fat.h"
+#include "sd.h"
+
+struct sdlog sdlog;
+
+static struct fat sdlog_fat;
+
+static void sdlog_SdDone(void){
+	sdlog_WriteDone(&sdlog);
+}
+
+static int sdlog_SdWrite(uint32_t lba, const uint8_t *data, uint32_t count){
+	return sd_WriteStart(lba, data, count, sdlog_SdDone);
+}
+
+static int sdlog_Create(uint32_t *lba, int *number){
+	char name[11];
+
+	if (sd_Init() != 0)
+		return -1;
+	if (fat_Mount(&sdlog_fat, sd_ReadBlock, sd_WriteBlock) != FAT_OK)
+		return -1;
+	if ((*number = fat_NextNumber(&sdlog_fat, SDLOG_PREFIX, SDLOG_EXT)) < 0)
+		return -1;
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, *number);
+	return fat_Create(&sdlog_fat, name, SDLOG_FILE_SIZE, lba) == FAT_OK ? 0 : -1;
+}
+
+/*
+ * Called with the control loop already running, so its interrupt is
+ * held off while the ring is set up. The session only has to differ
+ * from whatever an earlier boot left in these clusters; the cycle
+ * count after talking to the card for a while is as good as any.
+ */
+void sdlog_Start(void){
+	uint8_t rec[RECORDER_RECORD_SIZE];
+	uint32_t irq, lba;
+	int number;
+
+	sdlog_Init(&sdlog, 0, 0, 0, NULL);
+	if (sdlog_Create(&lba, &number) != 0)
+		return;
+
+	irq = NVIC_GetEnableIRQ(TIM4_IRQn);
+	HAL_NVIC_DisableIRQ(TIM4_IRQn);
+	sdlog_Init(&sdlog, lba, lba + SDLOG_FILE_SIZE / SDLOG_BLOCK_SIZE,
+			DWT->CYCCNT ^ ((uint32_t) number << 16), sdlog_SdWrite);
+	recorder_Boot(rec);
+	sdlog_Add(&sdlog, rec);
+	if (irq)
+		HAL_NVIC_EnableIRQ(TIM4_IRQn);
+}
@@ -0,0 +1,444 @@
+/*
+ * sensor.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Schedules the barometer and IMU on their shared bus and runs a
+ * vertical filter over them. The glue asks for the next transaction
+ * whenever the bus is free and hands back what came of it. The IMU
+ * goes first whenever both are due; the baro only ever waits out
+ * part of one burst.
+ *
+ * The filter integrates the IMU's axial acceleration and pulls the
+ * result toward the baro and, harder, toward each companion frame:
+ * the TeleMega's own estimate is better than ours, but ours carries
+ * on if the TeleMega stops. Off the pad the accelerometer's resting
+ * count is gravity, so it is subtracted without knowing the tilt.
+ */
+
+#include <math.h>
+#include "sensor.h"
+
+#define SENSOR_RESET_MS		3		/* MS5607 reset takes 2.8 ms */
+#define SENSOR_WAKE_MS		100		/* MPU-6050 after a device reset */
+#define SENSOR_CLOCK_MS		10		/* and after moving to the gyro clock */
+
+#define SENSOR_GROUNDED_BARO	0x01
+#define SENSOR_GROUNDED_IMU		0x02
+
+static const uint8_t sensor_imu_setup[][2] = {
+	{ 0x1A, 0x03 },		/* CONFIG: 44 Hz low pass */
+	{ 0x19, 0x00 },		/* SMPLRT_DIV: 1 kHz */
+	{ 0x1B, 0x18 },		/* GYRO_CONFIG: +/-2000 deg/s */
+	{ 0x1C, 0x18 },		/* ACCEL_CONFIG: +/-16 g */
+};
+
+#define SENSOR_IMU_SETUP_STEPS	(sizeof (sensor_imu_setup) / sizeof (sensor_imu_setup[0]))
+
+void sensor_Init(struct sensor *s, const struct sensor_config *cfg, uint32_t now){
+	int i;
+
+	s->cfg = *cfg;
+	s->pending = SENSOR_NONE;
+	s->flight_state = COMPANION_STATE_INVALID;	/* no pad references until the TeleMega says pad */
+
+	s->baro_state = SENSOR_BARO_START;
+	s->baro_step = 0;
+	s->baro_converting = 0;
+	s->baro_due = now;
+	for (i = 0; i < 8; i++)
+		s->prom[i] = 0;
+	s->d2 = 0;
+	s->temp = 0;
+	s->pressure = 0;
+	s->baro_tick = 0;
+
+	s->imu_state = SENSOR_IMU_START;
+	s->imu_step = 0;
+	s->imu_due = now;
+	for (i = 0; i < 7; i++)
+		s->raw[i] = 0;
+	s->imu_tick = 0;
+
+	s->ground_alt = 0;
+	s->ground_accel = 0;
+	s->grounded = 0;
+	s->height = 0;
+	s->speed = 0;
+	s->accel = 0;
+	for (i = 0; i < 2; i++)
+		s->est[i] = (struct sensor_estimate) { 0 };
+	s->latest = 0;
+
+	s->ops = 0;
+	s->errors = 0;
+	s->baro_samples = 0;
+	s->imu_samples = 0;
+	s->restarts = 0;
+}
+
+static int sensor_Due(uint32_t now, uint32_t due){
+	return (int32_t) (now - due) >= 0;
+}
+
+static int sensor_OnPad(const struct sensor *s){
+	return s->flight_state <= COMPANION_STATE_PAD;
+}
+
+static int sensor_Flying(const struct sensor *s){
+	return s->flight_state >= COMPANION_STATE_BOOST && s->flight_state <= COMPANION_STATE_MAIN;
+}
+
+static int sensor_Fresh(uint32_t samples, uint32_t tick, uint32_t now){
+	return samples && now - tick <= SENSOR_FRESH_MS;
+}
+
+/* AN520's CRC4 over the PROM, with the CRC's own nibble taken as 0 */
+int sensor_BaroCrc(const uint16_t *prom){
+	uint16_t rem = 0, word;
+	int i, bit;
+
+	if (prom[1] == 0 || prom[1] == 0xFFFF)
+		return 0;	/* nobody there */
+	for (i = 0; i < 16; i++){
+		word = i == 14 || i == 15 ? prom[7] & 0xFF00 : prom[i >> 1];
+		rem ^= i & 1 ? word & 0xFF : word >> 8;
+		for (bit = 0; bit < 8; bit++)
+			rem = rem & 0x8000 ? (uint16_t) ((rem << 1) ^ 0x3000) : (uint16_t) (rem << 1);
+	}
+	return (rem >> 12 & 0xF) == (prom[7] & 0xF);
+}
+
+/* The MS5607 datasheet's compensation, second order below 20 C. Returns Pa */
+int32_t sensor_BaroConvert(const uint16_t *prom, uint32_t d1, uint32_t d2, int32_t *temp){
+	int64_t dt, off, sens, t, off2 = 0, sens2 = 0, t2 = 0;
+
+	dt = (int64_t) d2 - ((int64_t) prom[5] << 8);
+	t = 2000 + (dt * prom[6] >> 23);
+	off = ((int64_t) prom[2] << 17) + ((int64_t) prom[4] * dt >> 6);
+	sens = ((int64_t) prom[1] << 16) + ((int64_t) prom[3] * dt >> 7);
+	if (t < 2000){
+		t2 = dt * dt >> 31;
+		off2 = 61 * (t - 2000) * (t - 2000) >> 4;
+		sens2 = 2 * (t - 2000) * (t - 2000);
+		if (t < -1500){
+			off2 += 15 * (t + 1500) * (t + 1500);
+			sens2 += 8 * (t + 1500) * (t + 1500);
+		}
+	}
+	off -= off2;
+	sens -= sens2;
+	*temp = (int32_t) (t - t2);
+	return (int32_t) ((((int64_t) d1 * sens >> 21) - off) >> 15);
+}
+
+/* Standard atmosphere, m */
+float sensor_Altitude(float pa){
+	return 44330.77f * (1.0f - powf(pa / 101325.0f, 0.190263f));
+}
+
+static void sensor_Publish(struct sensor *s, uint32_t now){
+	struct sensor_estimate *e = &s->est[!s->latest];
+
+	e->height = s->height;
+	e->speed = s->speed;
+	e->accel = s->accel;
+	e->tick = now;
+	e->valid = s->grounded != 0;
+	s->latest = !s->latest;
+}
+
+static void sensor_Baro(struct sensor *s, uint32_t now){
+	float alt = sensor_Altitude((float) s->pressure);
+	float dt = (float) (now - s->baro_tick) / 1000.0f;
+	int fresh = sensor_Fresh(s->baro_samples, s->baro_tick, now);
+	float error;
+
+	s->baro_tick = now;
+	s->baro_samples++;
+	if (sensor_OnPad(s)){
+		if (s->grounded & SENSOR_GROUNDED_BARO)
+			s->ground_alt += (alt - s->ground_alt) * s->cfg.ground_rate;
+		else
+			s->ground_alt = alt;
+		s->grounded |= SENSOR_GROUNDED_BARO;
+	}
+	if (!(s->grounded & SENSOR_GROUNDED_BARO))
+		return;
+	if (!sensor_Flying(s)){
+		s->height = alt - s->ground_alt;
+		sensor_Publish(s, now);
+		return;
+	}
+
+	/* Without the IMU, carry on at the speed we had */
+	if (fresh && !sensor_Fresh(s->imu_samples, s->imu_tick, now))
+		s->height += s->speed * dt;
+	if (fresh && fabsf(s->speed) < s->cfg.baro_max_speed){
+		error = alt - s->ground_alt - s->height;
+		s->height += s->cfg.baro_height * error * dt;
+		s->speed += s->cfg.baro_speed * error * dt;
+	}
+	sensor_Publish(s, now);
+}
+
+static void sensor_Imu(struct sensor *s, uint32_t now){
+	float counts = (float) s->raw[s->cfg.axis] * s->cfg.sign;
+	float dt = (float) (now - s->imu_tick) / 1000.0f;
+	int fresh = sensor_Fresh(s->imu_samples, s->imu_tick, now);
+
+	s->imu_tick = now;
+	s->imu_samples++;
+	if (sensor_OnPad(s)){
+		if (s->grounded & SENSOR_GROUNDED_IMU)
+			s->ground_accel += (counts - s->ground_accel) * s->cfg.ground_rate;
+		else
+			s->ground_accel = counts;
+		s->grounded |= SENSOR_GROUNDED_IMU;
+	}
+	if (!(s->grounded & SENSOR_GROUNDED_IMU))
+		return;
+	if (!sensor_Flying(s)){
+		s->speed = 0;
+		s->accel = 0;
+		sensor_Publish(s, now);
+		return;
+	}
+
+	s->accel = (counts - s->ground_accel) * (SENSOR_G / SENSOR_IMU_LSB_G);
+	if (fresh){
+		s->height += s->speed * dt + 0.5f * s->accel * dt * dt;
+		s->speed += s->accel * dt;
+	}
+	sensor_Publish(s, now);
+}
+
+/* A companion frame just landed: the TeleMega knows better */
+void sensor_Companion(struct sensor *s, const struct companion_state *c){
+	s->flight_state = c->flight_state;
+	if (!sensor_Flying(s) || !s->grounded)
+		return;
+	s->height += s->cfg.companion_height * ((float) c->height - s->height);
+	s->speed += s->cfg.companion_speed * ((float) c->speed / 16.0f - s->speed);
+	sensor_Publish(s, c->rx_tick);
+}
+
+static int16_t sensor_Clamp16(float v){
+	return v >= 32767.0f ? 32767 : v <= -32768.0f ? -32768 : (int16_t) lrintf(v);
+}
+
+/*
+ * Stand in for companion data gone stale with our own estimate, if
+ * that's fresh. The flight state stays the last the TeleMega sent, so
+ * the controller still knows it's coasting and finds apogee from our
+ * speed. Returns 1 if c now holds the local estimate.
+ */
+int sensor_Cover(const struct sensor_estimate *e, struct companion_state *c, uint32_t now, uint32_t stale_ms){
+	if (c->rx_tick != 0 && now - c->rx_tick <= stale_ms)
+		return 0;
+	if (!e->valid || e->tick == 0 || now - e->tick > stale_ms)
+		return 0;
+	c->height = sensor_Clamp16(e->height);
+	c->speed = sensor_Clamp16(e->speed * 16.0f);
+	c->accel = sensor_Clamp16(e->accel * 16.0f);
+	c->rx_tick = e->tick;
+	return 1;
+}
+
+/* Temperature first, then every temp_every'th conversion */
+static uint8_t sensor_BaroConversion(const struct sensor *s){
+	return s->d2 == 0 || s->baro_step % s->cfg.temp_every == 0 ? SENSOR_BARO_D2 : SENSOR_BARO_D1;
+}
+
+static void sensor_BaroOp(const struct sensor *s, struct sensor_op *op){
+	op->addr = s->cfg.baro_addr;
+	op->write = 0;
+	op->read = 0;
+	switch (s->baro_state){
+	case SENSOR_BARO_START:
+		op->reg = SENSOR_BARO_RESET;
+		break;
+	case SENSOR_BARO_LOAD:
+		op->reg = SENSOR_BARO_PROM + 2 * s->baro_step;
+		op->read = 2;
+		break;
+	default:
+		if (s->baro_converting){
+			op->reg = SENSOR_BARO_ADC;
+			op->read = 3;
+		}
+		else
+			op->reg = sensor_BaroConversion(s);
+		break;
+	}
+}
+
+static void sensor_ImuOp(const struct sensor *s, struct sensor_op *op){
+	op->addr = s->cfg.imu_addr;
+	op->write = 0;
+	op->read = 0;
+	switch (s->imu_state){
+	case SENSOR_IMU_START:
+		op->reg = SENSOR_IMU_PWR_MGMT;
+		op->write = 1;
+		op->data = 0x80;	/* device reset */
+		break;
+	case SENSOR_IMU_WAKE:
+		op->reg = SENSOR_IMU_PWR_MGMT;
+		op->write = 1;
+		op->data = 0x01;	/* out of sleep, clocked off the X gyro */
+		break;
+	case SENSOR_IMU_CHECK:
+		op->reg = SENSOR_IMU_WHO_AM_I;
+		op->read = 1;
+		break;
+	case SENSOR_IMU_SETUP:
+		op->reg = sensor_imu_setup[s->imu_step][0];
+		op->write = 1;
+		op->data = sensor_imu_setup[s->imu_step][1];
+		break;
+	default:
+		op->reg = SENSOR_IMU_DATA;
+		op->read = SENSOR_READ_MAX;
+		break;
+	}
+}
+
+/* The next transaction, if the bus is free and a part is due. Returns 1 if op is to run */
+int sensor_Next(struct sensor *s, uint32_t now, struct sensor_op *op){
+	if (s->pending != SENSOR_NONE)
+		return 0;
+	if (sensor_Due(now, s->imu_due)){
+		sensor_ImuOp(s, op);
+		s->pending = SENSOR_IMU;
+	}
+	else if (sensor_Due(now, s->baro_due)){
+		sensor_BaroOp(s, op);
+		s->pending = SENSOR_BARO;
+	}
+	else
+		return 0;
+	s->ops++;
+	return 1;
+}
+
+static void sensor_BaroDone(struct sensor *s, const uint8_t *data, uint32_t now){
+	uint32_t adc;
+	uint8_t conversion;
+
+	switch (s->baro_state){
+	case SENSOR_BARO_START:
+		s->baro_state = SENSOR_BARO_LOAD;
+		s->baro_step = 0;
+		s->baro_due = now + SENSOR_RESET_MS;
+		break;
+	case SENSOR_BARO_LOAD:
+		s->prom[s->baro_step] = (uint16_t) (data[0] << 8 | data[1]);
+		s->baro_due = now;
+		if (++s->baro_step < 8)
+			break;
+		if (!sensor_BaroCrc(s->prom)){
+			s->errors++;
+			s->restarts++;
+			s->baro_state = SENSOR_BARO_START;
+			s->baro_due = now + SENSOR_RETRY_MS;
+			break;
+		}
+		s->baro_state = SENSOR_BARO_RUN;
+		s->baro_step = 0;
+		s->baro_converting = 0;
+		s->d2 = 0;
+		break;
+	default:
+		if (!s->baro_converting){
+			s->baro_converting = sensor_BaroConversion(s);
+			s->baro_due = now + SENSOR_BARO_WAIT_MS;
+			break;
+		}
+		conversion = s->baro_converting;
+		s->baro_converting = 0;
+		s->baro_due = now;
+		adc = (uint32_t) data[0] << 16 | (uint32_t) data[1] << 8 | data[2];
+		if (adc == 0){
+			s->errors++;	/* read before the conversion finished */
+			break;
+		}
+		s->baro_step++;
+		if (conversion == SENSOR_BARO_D2){
+			s->d2 = adc;
+			break;
+		}
+		s->pressure = sensor_BaroConvert(s->prom, adc, s->d2, &s->temp);
+		sensor_Baro(s, now);
+		break;
+	}
+}
+
+static void sensor_ImuDone(struct sensor *s, const uint8_t *data, uint32_t now){
+	int i;
+
+	switch (s->imu_state){
+	case SENSOR_IMU_START:
+		s->imu_state = SENSOR_IMU_WAKE;
+		s->imu_due = now + SENSOR_WAKE_MS;
+		break;
+	case SENSOR_IMU_WAKE:
+		s->imu_state = SENSOR_IMU_CHECK;
+		s->imu_due = now + SENSOR_CLOCK_MS;
+		break;
+	case SENSOR_IMU_CHECK:
+		if (data[0] != SENSOR_IMU_ID){
+			s->errors++;
+			s->restarts++;
+			s->imu_state = SENSOR_IMU_START;
+			s->imu_due = now + SENSOR_RETRY_MS;
+			break;
+		}
+		s->imu_state = SENSOR_IMU_SETUP;
+		s->imu_step = 0;
+		s->imu_due = now;
+		break;
+	case SENSOR_IMU_SETUP:
+		s->imu_due = now;
+		if (++s->imu_step == SENSOR_IMU_SETUP_STEPS)
+			s->imu_state = SENSOR_IMU_RUN;
+		break;
+	default:
+		for (i = 0; i < 7; i++)
+			s->raw[i] = (int16_t) (data[2 * i] << 8 | data[2 * i + 1]);
+		s->imu_due += s->cfg.imu_ms;
+		if (sensor_Due(now, s->imu_due + s->cfg.imu_ms))
+			s->imu_due = now;	/* fallen behind: don't try to catch up */
+		sensor_Imu(s, now);
+		break;
+	}
+}
+
+/* Whatever's gone wrong, the part starts over */
+static void sensor_Fail(struct sensor *s, uint8_t part, uint32_t now){
+	s->errors++;
+	s->restarts++;
+	if (part == SENSOR_BARO){
+		s->baro_state = SENSOR_BARO_START;
+		s->baro_converting = 0;
+		s->baro_due = now + SENSOR_RETRY_MS;
+	}
+	else {
+		s->imu_state = SENSOR_IMU_START;
+		s->imu_due = now + SENSOR_RETRY_MS;
+	}
+}
+
+/* The transaction from sensor_Next() is over; data holds what it read */
+void sensor_Done(struct sensor *s, const uint8_t *data, int ok, uint32_t now){
+	uint8_t part = s->pending;
+
+	s->pending = SENSOR_NONE;
+	if (!ok)
+		sensor_Fail(s, part, now);
+	else if (part == SENSOR_BARO)
+		sensor_BaroDone(s, data, now);
+	else if (part == SENSOR_IMU)
+		sensor_ImuDone(s, data, now);
+}
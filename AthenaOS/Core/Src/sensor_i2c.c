@@ -0,0 +1,211 @@
+/*
+ * sensor_i2c.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * I2C1 at 400 kHz, driven a register at a time from its event
+ * interrupt so the main loop never spins on the bus. The address and
+ * register go out byte by byte; after the repeated start the read
+ * is DMA1 Stream0, with LAST set so the hardware NACKs the final
+ * byte itself. A 14 byte IMU burst costs three or four interrupts
+ * whatever its length. HAL_I2C_Mem_Read_DMA() would poll through the
+ * whole address phase, and I2C1 can't do fast mode plus on PB6/PB7
+ * (only FMPI2C1 can, on other pins).
+ *
+ * sensor_Poll() starts whatever sensor.c asks for next and hands back
+ * the result. A transaction that runs past SENSOR_TIMEOUT_MS has hung
+ * the bus, and the peripheral is reset.
+ */
+
+#include "main.h"
+#include "sensor.h"
+
+#define SENSOR_BUS_IDLE		0
+#define SENSOR_BUS_WRITE	1	/* address, register and data out */
+#define SENSOR_BUS_READ		2	/* repeated start, address, DMA in */
+
+extern I2C_HandleTypeDef hi2c1;
+
+DMA_HandleTypeDef hdma_i2c1_rx;
+
+struct sensor sensor;
+
+static struct sensor_op sensor_op;
+static uint8_t sensor_rx[SENSOR_READ_MAX];
+static volatile uint8_t sensor_bus;
+static volatile int8_t sensor_result;	/* 1 done, -1 failed, 0 neither yet */
+static uint8_t sensor_sent;				/* bytes after the address */
+static uint32_t sensor_started;
+static uint32_t sensor_frames;			/* companion frames fused */
+
+static void sensor_Finish(int8_t result){
+	I2C1->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+	sensor_bus = SENSOR_BUS_IDLE;
+	sensor_result = result;
+}
+
+static void sensor_DMADone(DMA_HandleTypeDef *hdma){
+	(void) hdma;
+	if (sensor_op.read > 1)
+		I2C1->CR1 |= I2C_CR1_STOP;
+	sensor_Finish(1);
+}
+
+static void sensor_DMAError(DMA_HandleTypeDef *hdma){
+	(void) hdma;
+	I2C1->CR1 |= I2C_CR1_STOP;
+	sensor_Finish(-1);
+}
+
+static void sensor_Begin(void){
+	sensor_result = 0;
+	sensor_sent = 0;
+	sensor_started = HAL_GetTick();
+	if (sensor_op.read)
+		HAL_DMA_Start_IT(&hdma_i2c1_rx, (uint32_t) &I2C1->DR, (uint32_t) sensor_rx, sensor_op.read);
+	sensor_bus = SENSOR_BUS_WRITE;
+	I2C1->CR1 |= I2C_CR1_ACK;
+	I2C1->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+	I2C1->CR1 |= I2C_CR1_START;
+}
+
+/* The peripheral from scratch: the governor re-inits it too, so this is only for a hung bus */
+static void sensor_Recover(void){
+	HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+	HAL_DMA_Abort(&hdma_i2c1_rx);
+	if (HAL_I2C_Init(&hi2c1) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	sensor_Finish(-1);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+}
+
+void sensor_Start(void){
+	static const struct sensor_config cfg = SENSOR_CONFIG_DEFAULT;
+
+	sensor_Init(&sensor, &cfg, HAL_GetTick());
+
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hdma_i2c1_rx.Instance = DMA1_Stream0;
+	hdma_i2c1_rx.Init.Channel = DMA_CHANNEL_1;
+	hdma_i2c1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_i2c1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_i2c1_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_i2c1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_i2c1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_i2c1_rx.Init.Mode = DMA_NORMAL;
+	hdma_i2c1_rx.Init.Priority = DMA_PRIORITY_LOW;
+	hdma_i2c1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_i2c1_rx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hi2c1, hdmarx, hdma_i2c1_rx);
+	hdma_i2c1_rx.XferCpltCallback = sensor_DMADone;
+	hdma_i2c1_rx.XferErrorCallback = sensor_DMAError;
+
+	/* Below the control loop: nothing here is urgent */
+	HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+	HAL_NVIC_SetPriority(I2C1_EV_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_SetPriority(I2C1_ER_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+}
+
+/* I2C1 event: SB, ADDR, TXE and BTF each move the transaction on a step */
+void sensor_Event(void){
+	I2C_TypeDef *i2c = I2C1;
+	uint32_t sr1 = i2c->SR1;
+
+	if (sr1 & I2C_SR1_SB){
+		i2c->DR = (uint32_t) (sensor_op.addr << 1 | (sensor_bus == SENSOR_BUS_READ));
+		return;
+	}
+	if (sr1 & I2C_SR1_ADDR){
+		if (sensor_bus == SENSOR_BUS_READ){
+			/* One byte: NACK it and stop as soon as ADDR clears. More: LAST NACKs at the end */
+			if (sensor_op.read == 1)
+				i2c->CR1 &= ~I2C_CR1_ACK;
+			else
+				i2c->CR2 |= I2C_CR2_LAST;
+			i2c->CR2 |= I2C_CR2_DMAEN;
+			(void) i2c->SR2;
+			if (sensor_op.read == 1)
+				i2c->CR1 |= I2C_CR1_STOP;
+			return;
+		}
+		(void) i2c->SR2;
+		i2c->DR = sensor_op.reg;
+		sensor_sent = 1;
+		i2c->CR2 |= I2C_CR2_ITBUFEN;
+		return;
+	}
+	if ((sr1 & I2C_SR1_TXE) && (i2c->CR2 & I2C_CR2_ITBUFEN)){
+		if (sensor_sent <= sensor_op.write){
+			i2c->DR = sensor_op.data;
+			sensor_sent++;
+		}
+		else
+			i2c->CR2 &= ~I2C_CR2_ITBUFEN;	/* last byte's going: wait for BTF */
+		return;
+	}
+	/* While the DMA reads, BTF only means it's behind */
+	if ((sr1 & I2C_SR1_BTF) && sensor_bus == SENSOR_BUS_WRITE){
+		if (sensor_op.read){
+			sensor_bus = SENSOR_BUS_READ;
+			i2c->CR1 |= I2C_CR1_START;
+		}
+		else {
+			i2c->CR1 |= I2C_CR1_STOP;
+			sensor_Finish(1);
+		}
+	}
+}
+
+/* I2C1 error: a NACK is a part that isn't there, anything else a bus gone bad */
+void sensor_Error(void){
+	I2C_TypeDef *i2c = I2C1;
+
+	i2c->SR1 &= ~(I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR | I2C_SR1_TIMEOUT);
+	i2c->CR1 |= I2C_CR1_STOP;
+	if (sensor_op.read)
+		HAL_DMA_Abort_IT(&hdma_i2c1_rx);
+	sensor_Finish(-1);
+}
+
+int sensor_Busy(void){
+	return sensor_bus != SENSOR_BUS_IDLE;
+}
+
+void sensor_Poll(void){
+	uint32_t now = HAL_GetTick();
+	uint32_t frames = companion.frames;
+
+	if (frames != sensor_frames){
+		sensor_frames = frames;
+		sensor_Companion(&sensor, companion_Latest(&companion));
+	}
+
+	if (sensor_bus != SENSOR_BUS_IDLE){
+		if (now - sensor_started <= SENSOR_TIMEOUT_MS)
+			return;
+		sensor_Recover();
+	}
+	if (sensor_result){
+		int8_t result = sensor_result;
+
+		sensor_result = 0;
+		sensor_Done(&sensor, sensor_rx, result > 0, now);
+	}
+	/* STOP is still going out from the last one */
+	if (I2C1->CR1 & I2C_CR1_STOP)
+		return;
+	if (sensor_Next(&sensor, now, &sensor_op))
+		sensor_Begin();
+}
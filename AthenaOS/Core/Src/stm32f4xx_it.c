@@ -22,6 +22,10 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "Stepper.h"
+#include "control.h"
+#include "beep.h"
+#include "sensor.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -57,6 +61,11 @@
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
 /* USER CODE BEGIN EV */
+extern DMA_HandleTypeDef hdma_spi2_rx;
+extern DMA_HandleTypeDef hdma_spi2_tx;
+extern DMA_HandleTypeDef hdma_spi3_tx;
+extern DMA_HandleTypeDef hdma_adc1;
+extern DMA_HandleTypeDef hdma_i2c1_rx;
 
 /* USER CODE END EV */
 
@@ -214,4 +223,92 @@ void OTG_FS_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles EXTI line4 interrupt (Altus_CS).
+  */
+void EXTI4_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(Altus_CS_Pin);
+}
+
+/**
+  * @brief This function handles DMA1 stream3 global interrupt (SPI2 RX).
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi2_rx);
+}
+
+/**
+  * @brief This function handles DMA1 stream4 global interrupt (SPI2 TX).
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi2_tx);
+}
+
+/**
+  * @brief This function handles DMA1 stream5 global interrupt (SPI3 TX, microSD).
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi3_tx);
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt (ADC1 monitor).
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_adc1);
+}
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (I2C1 RX, sensors).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_i2c1_rx);
+}
+
+/**
+  * @brief This function handles I2C1 event interrupt (sensors).
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  sensor_Event();
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt (sensors).
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  sensor_Error();
+}
+
+/**
+  * @brief This function handles TIM3 global interrupt (stepper).
+  */
+void TIM3_IRQHandler(void)
+{
+  stepper_IRQ();
+}
+
+/**
+  * @brief This function handles TIM4 global interrupt (control loop).
+  */
+void TIM4_IRQHandler(void)
+{
+  control_IRQ();
+}
+
+/**
+  * @brief This function handles TIM2 global interrupt (buzzer).
+  */
+void TIM2_IRQHandler(void)
+{
+  beep_IRQ();
+}
+
 /* USER CODE END 1 */
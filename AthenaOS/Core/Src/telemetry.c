@@ -0,0 +1,104 @@
+/*
+ * telemetry.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Live control loop data for the bench. The control tick hands over
+ * the record it has already encoded for the recorder, which costs a
+ * 32 byte copy; framing and the CRC happen later in the main loop. A
+ * host that can't keep up costs records, counted, and nothing else.
+ */
+
+#include <string.h>
+#include "telemetry.h"
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+void telemetry_Init(struct telemetry *t){
+	t->head = 0;
+	t->tail = 0;
+	t->divisor = 0;
+	t->count = 0;
+	t->drops = 0;
+	t->sent = 0;
+}
+
+void telemetry_Rate(struct telemetry *t, uint8_t divisor){
+	t->divisor = divisor;
+}
+
+/* Control tick: queue every divisor'th record */
+void telemetry_Add(struct telemetry *t, const uint8_t *rec){
+	uint8_t head = t->head, next;
+
+	if (t->divisor == 0)
+		return;
+	if (++t->count < t->divisor)
+		return;
+	t->count = 0;
+
+	next = (head + 1) % TELEMETRY_QUEUE;
+	if (next == t->tail){
+		t->drops++;
+		return;
+	}
+	memcpy(t->rec[head], rec, RECORDER_RECORD_SIZE);
+	t->head = next;
+}
+
+/* Main loop: frame queued records until send() runs out of room */
+void telemetry_Send(struct telemetry *t, int (*send)(const uint8_t *frame, uint16_t len)){
+	uint8_t tail = t->tail;
+	uint16_t len;
+
+	while (tail != t->head){
+		len = frame_Encode(t->frame, TELEMETRY_CONTROL, t->rec[tail], RECORDER_RECORD_SIZE);
+		if (send(t->frame, len) != 0)
+			break;
+		tail = (tail + 1) % TELEMETRY_QUEUE;
+		t->tail = tail;
+		t->sent++;
+	}
+}
+
+/* Payload for a TELEMETRY_STATUS frame; returns its length */
+uint16_t telemetry_EncodeStatus(uint8_t *out, const struct telemetry_status *s){
+	const uint32_t v[TELEMETRY_STATUS_WORDS] = {
+		s->tick, s->companion_frames, s->companion_errors,
+		s->period_min, s->period_max, s->exec_max, s->overruns,
+		s->lut_lookups, s->lut_misses, s->lut_fetches,
+		s->recorder_addr, s->recorder_drops, s->recorder_pages,
+		s->telemetry_drops, s->battery_mv, s->battery_min_mv,
+		s->brownouts, s->temp,
+	};
+	int i;
+
+	for (i = 0; i < TELEMETRY_STATUS_WORDS; i++)
+		put32(out + i * 4, v[i]);
+	return TELEMETRY_STATUS_WORDS * 4;
+}
+
+void telemetry_DecodeStatus(const uint8_t *payload, struct telemetry_status *s){
+	uint32_t *v[TELEMETRY_STATUS_WORDS] = {
+		&s->tick, &s->companion_frames, &s->companion_errors,
+		&s->period_min, &s->period_max, &s->exec_max, &s->overruns,
+		&s->lut_lookups, &s->lut_misses, &s->lut_fetches,
+		&s->recorder_addr, &s->recorder_drops, &s->recorder_pages,
+		&s->telemetry_drops, &s->battery_mv, &s->battery_min_mv,
+		&s->brownouts, &s->temp,
+	};
+	int i;
+
+	for (i = 0; i < TELEMETRY_STATUS_WORDS; i++)
+		*v[i] = get32(payload + i * 4);
+}
@@ -0,0 +1,57 @@
+/*
+ * telemetry_cdc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Sends telemetry out the CDC TX ring from the main loop, with a
+ * status frame once a second while the host has it turned on.
+ */
+
+#include "main.h"
+#include "companion.h"
+#include "lut.h"
+#include "control.h"
+#include "recorder.h"
+#include "monitor.h"
+#include "cdc_link.h"
+#include "telemetry.h"
+
+struct telemetry telemetry;
+
+static uint32_t telemetry_status_tick;
+
+static void telemetry_Status(void){
+	struct telemetry_status s;
+	uint32_t mhz = SystemCoreClock / 1000000;
+	uint8_t *payload = telemetry.frame + FRAME_HEADER_SIZE;
+
+	s.tick = HAL_GetTick();
+	s.companion_frames = companion.frames;
+	s.companion_errors = companion.errors;
+	s.period_min = control_timing.period_min == UINT32_MAX ? 0 : control_timing.period_min / mhz;
+	s.period_max = control_timing.period_max / mhz;
+	s.exec_max = control_timing.exec_max / mhz;
+	s.overruns = control_timing.overruns;
+	s.lut_lookups = lut.lookups;
+	s.lut_misses = lut.misses;
+	s.lut_fetches = lut.fetches;
+	s.recorder_addr = recorder.addr;
+	s.recorder_drops = recorder.drops;
+	s.recorder_pages = recorder.pages;
+	s.telemetry_drops = telemetry.drops;
+	s.battery_mv = monitor.battery_mv;
+	s.battery_min_mv = monitor.battery_min_mv == UINT32_MAX ? 0 : monitor.battery_min_mv;
+	s.brownouts = monitor.brownouts;
+	s.temp = (uint32_t) monitor.temp;
+	cdc_Send(telemetry.frame, frame_Encode(telemetry.frame, TELEMETRY_STATUS, payload,
+			telemetry_EncodeStatus(payload, &s)));
+}
+
+void telemetry_Poll(void){
+	telemetry_Send(&telemetry, cdc_Send);
+	if (telemetry.divisor == 0 || HAL_GetTick() - telemetry_status_tick < TELEMETRY_STATUS_MS)
+		return;
+	telemetry_status_tick = HAL_GetTick();
+	telemetry_Status();
+}
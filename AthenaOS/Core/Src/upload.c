@@ -0,0 +1,209 @@
+/*
+ * upload.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Command side of the flash upload protocol. Knows nothing about the
+ * HAL: bytes come in through upload_Input() and everything else goes
+ * through the ops, so the host test can run it against a RAM flash.
+ */
+
+#include "crc.h"
+#include "upload.h"
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v & 0xffff);
+	put16(p + 2, v >> 16);
+}
+
+void upload_Init(struct upload *u, const struct upload_ops *ops){
+	u->ops = ops;
+	frame_Reset(&u->rx);
+}
+
+static int upload_Range(struct upload *u, uint32_t addr, uint32_t len){
+	return addr <= u->ops->size && len <= u->ops->size - addr;
+}
+
+/* In range, and clear of anything the board keeps for itself */
+static int upload_Writable(struct upload *u, uint32_t addr, uint32_t len){
+	const struct upload_ops *o = u->ops;
+
+	if (!upload_Range(u, addr, len))
+		return 0;
+	return o->reserved_len == 0 || len == 0 ||
+	       addr + len <= o->reserved || addr >= o->reserved + o->reserved_len;
+}
+
+/* Likewise, except the reserved range can be cleared as a whole */
+static int upload_Erasable(struct upload *u, uint32_t addr, uint32_t len){
+	const struct upload_ops *o = u->ops;
+
+	if (o->reserved_len && addr == o->reserved && len == o->reserved_len)
+		return upload_Range(u, addr, len);
+	return upload_Writable(u, addr, len);
+}
+
+/* Reply payload is built in place after the frame header */
+static void upload_Reply(struct upload *u, uint8_t status, uint16_t len){
+	uint8_t *p = u->tx + FRAME_HEADER_SIZE;
+
+	p[0] = status;
+	u->ops->send(u->tx, frame_Encode(u->tx, u->rx.type | UPLOAD_REPLY, p, len + 1));
+}
+
+static uint8_t upload_Crc(struct upload *u, uint32_t addr, uint32_t len, uint32_t *crc){
+	uint8_t *buf = u->tx + FRAME_HEADER_SIZE + 5;
+	uint32_t n;
+
+	*crc = CRC32_INIT;
+	while (len){
+		n = len < UPLOAD_MAX_DATA ? len : UPLOAD_MAX_DATA;
+		if (u->ops->read(addr, buf, n) != 0)
+			return UPLOAD_FAILED;
+		*crc = crc32(*crc, buf, n);
+		addr += n;
+		len -= n;
+	}
+	return UPLOAD_OK;
+}
+
+static void upload_Command(struct upload *u){
+	const uint8_t *in = u->rx.payload;
+	uint8_t *out = u->tx + FRAME_HEADER_SIZE + 1;
+	uint16_t n = u->rx.len;
+	uint32_t addr, len, crc;
+	uint8_t status;
+
+	switch (u->rx.type){
+	case UPLOAD_PING:
+		out[0] = UPLOAD_VERSION;
+		put32(out + 1, u->ops->size);
+		put16(out + 5, u->ops->page);
+		put16(out + 7, UPLOAD_SECTOR);
+		put16(out + 9, UPLOAD_MAX_DATA);
+		upload_Reply(u, UPLOAD_OK, 11);
+		return;
+	case UPLOAD_ERASE:
+		if (n != 8)
+			break;
+		addr = get32(in);
+		len = get32(in + 4);
+		if (!upload_Erasable(u, addr, len) || (addr | len) & (UPLOAD_SECTOR - 1))
+			status = UPLOAD_BAD_ADDRESS;
+		else
+			status = u->ops->erase(addr, len) == 0 ? UPLOAD_OK : UPLOAD_FAILED;
+		upload_Reply(u, status, 0);
+		return;
+	case UPLOAD_WRITE:
+		if (n < 4 || n - 4 > UPLOAD_MAX_DATA)
+			break;
+		addr = get32(in);
+		len = n - 4;
+		if (!upload_Writable(u, addr, len))
+			status = UPLOAD_BAD_ADDRESS;
+		else
+			status = u->ops->write(addr, in + 4, len) == 0 ? UPLOAD_OK : UPLOAD_FAILED;
+		put32(out, addr);
+		upload_Reply(u, status, 4);
+		return;
+	case UPLOAD_READ:
+		if (n != 6)
+			break;
+		addr = get32(in);
+		len = in[4] | (in[5] << 8);
+		put32(out, addr);
+		if (len > UPLOAD_MAX_DATA || !upload_Range(u, addr, len)){
+			upload_Reply(u, UPLOAD_BAD_ADDRESS, 4);
+			return;
+		}
+		if (u->ops->read(addr, out + 4, len) != 0){
+			upload_Reply(u, UPLOAD_FAILED, 4);
+			return;
+		}
+		upload_Reply(u, UPLOAD_OK, 4 + len);
+		return;
+	case UPLOAD_CRC:
+		if (n != 8)
+			break;
+		addr = get32(in);
+		len = get32(in + 4);
+		if (!upload_Range(u, addr, len)){
+			upload_Reply(u, UPLOAD_BAD_ADDRESS, 0);
+			return;
+		}
+		status = upload_Crc(u, addr, len, &crc);
+		put32(out, crc);
+		upload_Reply(u, status, 4);
+		return;
+	case UPLOAD_RELOAD:
+		if (n != 0)
+			break;
+		upload_Reply(u, u->ops->reload() == 0 ? UPLOAD_OK : UPLOAD_FAILED, 0);
+		return;
+	case UPLOAD_TELEMETRY:
+		if (n != 1)
+			break;
+		if (!u->ops->telemetry){
+			upload_Reply(u, UPLOAD_BAD_COMMAND, 0);
+			return;
+		}
+		upload_Reply(u, u->ops->telemetry(in[0]) == 0 ? UPLOAD_OK : UPLOAD_FAILED, 0);
+		return;
+	case UPLOAD_PROFILE:
+		if (n != 2)
+			break;
+		if (!u->ops->profile){
+			upload_Reply(u, UPLOAD_BAD_COMMAND, 0);
+			return;
+		}
+		if ((len = u->ops->profile(in[0], in[1], out)) == (uint32_t) -1){
+			upload_Reply(u, UPLOAD_BAD_ADDRESS, 0);
+			return;
+		}
+		upload_Reply(u, UPLOAD_OK, len);
+		return;
+	case UPLOAD_HIL:
+		if (n != 1)
+			break;
+		if (!u->ops->hil){
+			upload_Reply(u, UPLOAD_BAD_COMMAND, 0);
+			return;
+		}
+		upload_Reply(u, u->ops->hil(in[0]) == 0 ? UPLOAD_OK : UPLOAD_FAILED, 0);
+		return;
+	case UPLOAD_INJECT:
+		if (n == 0)
+			break;
+		if (!u->ops->inject){
+			upload_Reply(u, UPLOAD_BAD_COMMAND, 0);
+			return;
+		}
+		status = UPLOAD_OK;
+		if ((len = (uint32_t) u->ops->inject(in, n)) == (uint32_t) -1)
+			status = UPLOAD_FAILED;
+		out[0] = (uint8_t) len;
+		upload_Reply(u, status, 1);
+		return;
+	default:
+		upload_Reply(u, UPLOAD_BAD_COMMAND, 0);
+		return;
+	}
+	upload_Reply(u, UPLOAD_BAD_LENGTH, 0);
+}
+
+void upload_Input(struct upload *u, const uint8_t *buf, uint32_t len){
+	while (len--)
+		if (frame_Input(&u->rx, *buf++))
+			upload_Command(u);
+}
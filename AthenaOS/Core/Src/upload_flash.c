@@ -0,0 +1,160 @@
+/*
+ * upload_flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs the upload protocol from the main loop against the W25Q, with
+ * replies going straight back out over CDC.
+ */
+
+#include <string.h>
+#include "main.h"
+#include "flash.h"
+#include "lut.h"
+#include "cdc_link.h"
+#include "upload.h"
+#include "recorder.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "companion.h"
+
+/* Not while the TeleMega says we're flying, same as HIL */
+static int upload_Flying(void){
+	uint8_t state = companion_Latest(&companion)->flight_state;
+
+	return state >= COMPANION_STATE_BOOST && state <= COMPANION_STATE_MAIN;
+}
+
+/*
+ * The drag table region is erased there and then. In the storage
+ * region the log just starts over at addr, with everything after it
+ * erased as the log reaches it, so the reply comes straight back;
+ * erasing any of the log drops the rest of it too.
+ */
+static int upload_FlashErase(uint32_t addr, uint32_t len){
+	uint32_t end = addr + len;
+
+	if (upload_Flying())
+		return -1;
+	if (addr < FLASH_STORAGE_ADDR)
+		flashErase(addr, (end < FLASH_STORAGE_ADDR ? end : FLASH_STORAGE_ADDR) - addr);
+	if (end > FLASH_STORAGE_ADDR)
+		recorder_Erase(addr > FLASH_STORAGE_ADDR ? addr : FLASH_STORAGE_ADDR);
+	return 0;
+}
+
+static int upload_FlashWrite(uint32_t addr, const uint8_t *data, uint32_t len){
+	if (upload_Flying())
+		return -1;
+	flashWrite(addr, data, len);
+	return 0;
+}
+
+/*
+ * No flashSync() here: that would wait out a background sector erase,
+ * where flashReadBlock() suspends it for the read. The log's page on
+ * its way to the chip isn't there yet, so it reads as erased with
+ * everything past it until the next read.
+ */
+static int upload_FlashRead(uint32_t addr, uint8_t *data, uint32_t len){
+	uint32_t end = recorder.addr, n = len;
+
+	if (recorder.writing)
+		end -= RECORDER_PAGE_SIZE;
+
+	/* Past the end of the log reads as erased, whether or not it is yet */
+	if (addr + len > end){
+		n = addr < end ? end - addr : 0;
+		memset(data + n, 0xff, len - n);
+	}
+	if (n)
+		flashReadBlock(addr, data, n);
+	return 0;
+}
+
+static struct lut upload_lut;
+
+/*
+ * control_Step reads the table from the TIM4 interrupt. The new one is
+ * opened and its crc checked off to the side with the loop still
+ * running, then TIM4 is held off just to copy it into place, so no tick
+ * sees it half parsed. The old cells have been written over by now, so
+ * a bad table leaves none at all.
+ */
+static int upload_FlashReload(void){
+	uint32_t irq = NVIC_GetEnableIRQ(TIM4_IRQn);
+	int ret;
+
+	if (upload_Flying())
+		return -1;
+	flashSync();
+	ret = lut_FlashOpen(&upload_lut);
+	HAL_NVIC_DisableIRQ(TIM4_IRQn);
+	if (ret == 0)
+		lut = upload_lut;
+	else
+		lut.rows = 0;
+	if (irq)
+		HAL_NVIC_EnableIRQ(TIM4_IRQn);
+	if (ret == 0)
+		lut_Poll(&lut);
+	return ret;
+}
+
+static int upload_FlashTelemetry(uint8_t divisor){
+	telemetry_Rate(&telemetry, divisor);
+	return 0;
+}
+
+static int upload_FlashProfile(uint8_t probe, uint8_t flags, uint8_t *out){
+	struct profile_probe p;
+	uint16_t len;
+
+	if (probe >= PROFILE_PROBES)
+		return -1;
+	profile_Read(&profile.probe[probe], &p);
+	len = profile_Encode(out, probe, SystemCoreClock, &p);
+	if (flags & PROFILE_RESET)
+		profile.probe[probe].reset = 1;
+	return len;
+}
+
+static void upload_FlashSend(const uint8_t *frame, uint16_t len){
+	cdc_Write(frame, len);
+}
+
+/*
+ * The fault sector sits just below the log, where a big table or a
+ * region erase would reach it; only faultdump --erase gets to clear it.
+ */
+static const struct upload_ops upload_flash_ops = {
+	.size = FLASH_SIZE,
+	.page = FLASH_PAGE_SIZE,
+	.reserved = FLASH_FAULT_ADDR,
+	.reserved_len = FLASH_SECTOR_SIZE,
+	.erase = upload_FlashErase,
+	.write = upload_FlashWrite,
+	.read = upload_FlashRead,
+	.reload = upload_FlashReload,
+	.telemetry = upload_FlashTelemetry,
+	.profile = upload_FlashProfile,
+	.hil = companion_Hil,
+	.inject = companion_Inject,
+	.send = upload_FlashSend,
+};
+
+static struct upload upload;
+static uint8_t upload_started;
+
+void upload_Poll(void){
+	uint8_t buf[CDC_PACKET];
+	uint32_t n;
+
+	if (!upload_started){
+		upload_Init(&upload, &upload_flash_ops);
+		upload_started = 1;
+	}
+	while ((n = cdc_Read(buf, sizeof (buf))) != 0)
+		upload_Input(&upload, buf, n);
+}
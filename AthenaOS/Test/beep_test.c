@@ -0,0 +1,139 @@
+/*
+ * beep_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Plays the note queue the way the TIM2 interrupt does, counting timer
+ * ticks, and checks pitch and length against what was asked for, that
+ * a full queue refuses notes instead of overwriting, and the battery
+ * readout for a few voltages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "beep.h"
+
+static struct beep b;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+/* Drain the queue, returns the total in microseconds and counts tones and tone time */
+static uint64_t play(uint32_t *tones, uint64_t *tone_us){
+	struct beep_timing t;
+	uint64_t us = 0;
+
+	*tones = 0;
+	*tone_us = 0;
+	while (beep_Next(&b, BEEP_TICK_HZ, &t)){
+		us += (uint64_t) t.period * t.count;
+		if (t.pulse){
+			CHECK(t.pulse == t.period / 2);
+			(*tones)++;
+			*tone_us += (uint64_t) t.period * t.count;
+		}
+	}
+	return us;
+}
+
+static void test_timing(void){
+	static const uint16_t hz[] = { 440, 2000, BEEP_LOW, BEEP_MID, BEEP_HIGH, 10000 };
+	static const uint16_t ms[] = { 1, 10, 128, 175, 1000, 2325 };
+	struct beep_timing t;
+	double f, len;
+	unsigned i, j;
+
+	for (i = 0; i < sizeof (hz) / sizeof (hz[0]); i++){
+		for (j = 0; j < sizeof (ms) / sizeof (ms[0]); j++){
+			beep_Init(&b);
+			CHECK(beep_Queue(&b, hz[i], ms[j]) == 0);
+			CHECK(beep_Next(&b, BEEP_TICK_HZ, &t));
+			f = (double) BEEP_TICK_HZ / t.period;
+			len = (double) t.period * t.count / 1000.0;
+			/* Pitch within a percent, length within a period */
+			CHECK(f > hz[i] * 0.99 && f < hz[i] * 1.01);
+			CHECK(len > ms[j] - 1000.0 / hz[i] && len < ms[j] + 1000.0 / hz[i]);
+			CHECK(!beep_Next(&b, BEEP_TICK_HZ, &t));
+		}
+	}
+
+	/* Rests are exact and silent */
+	beep_Init(&b);
+	beep_Queue(&b, 0, 600);
+	CHECK(beep_Next(&b, BEEP_TICK_HZ, &t));
+	CHECK(t.pulse == 0 && t.period * t.count == 600000);
+
+	/* Zero length still plays one period rather than stalling */
+	beep_Queue(&b, 4000, 0);
+	CHECK(beep_Next(&b, BEEP_TICK_HZ, &t) && t.count == 1);
+}
+
+static void test_queue(void){
+	struct beep_timing t;
+	int i, n = 0;
+
+	beep_Init(&b);
+	CHECK(!beep_Busy(&b));
+	for (i = 0; i < BEEP_QUEUE; i++)
+		CHECK(beep_Queue(&b, 1000 + i, 10) == 0);
+	CHECK(beep_Queue(&b, 5000, 10) == -1);
+	CHECK(beep_Busy(&b));
+
+	/* Wrap the indices around a few times */
+	for (i = 0; i < 1000; i++){
+		CHECK(beep_Next(&b, BEEP_TICK_HZ, &t));
+		n++;
+		CHECK(beep_Queue(&b, 1000 + BEEP_QUEUE + i, 10) == 0);
+	}
+	while (beep_Next(&b, BEEP_TICK_HZ, &t))
+		n++;
+	CHECK(n == 1000 + BEEP_QUEUE);
+	CHECK(!beep_Busy(&b));
+}
+
+static void test_battery(void){
+	uint32_t tones;
+	uint64_t us, tone_us;
+
+	/* 7.4 V: seven, pause, four */
+	beep_Init(&b);
+	CHECK(beep_Battery(&b, 7380) == 0);
+	us = play(&tones, &tone_us);
+	CHECK(tones == 11);
+	CHECK((us + 500) / 1000 == 11 * (175 + 400) + 600);
+
+	/* 8.0 V: a long low beep stands in for the zero */
+	beep_Init(&b);
+	CHECK(beep_Battery(&b, 8000) == 0);
+	us = play(&tones, &tone_us);
+	CHECK(tones == 9);
+	CHECK((us + 500) / 1000 == 8 * (175 + 400) + 600 + 500 + 400);
+
+	/* Rounds to the nearest tenth */
+	beep_Init(&b);
+	beep_Battery(&b, 3951);
+	play(&tones, &tone_us);
+	CHECK(tones == 4 + 1);
+
+	/* A battery that can't be read still gives a readout */
+	beep_Init(&b);
+	beep_Battery(&b, 0);
+	us = play(&tones, &tone_us);
+	CHECK(tones == 2);
+}
+
+int main(void){
+	test_timing();
+	test_queue();
+	test_battery();
+
+	if (failures){
+		printf("beep_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("beep_test: ok\n");
+	return 0;
+}
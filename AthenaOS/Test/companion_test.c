@@ -0,0 +1,326 @@
+/*
+ * companion_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Feeds TeleMega companion transactions through companion_Decode the
+ * way companion_spi.c does: a 256 byte DMA ring with chip select edges
+ * marking where each transaction starts and stops.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "companion.h"
+
+#define RING_SIZE	256
+#define RING_MASK	(RING_SIZE - 1)
+
+static uint8_t ring[RING_SIZE];
+static uint16_t head;
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+struct command {
+	uint8_t		command;
+	uint8_t		flight_state;
+	uint16_t	tick;
+	uint16_t	serial;
+	uint16_t	flight;
+	int16_t		accel;
+	int16_t		speed;
+	int16_t		height;
+	uint16_t	motor_number;
+};
+
+static void put(uint8_t b){
+	ring[head & RING_MASK] = b;
+	head++;
+}
+
+static void put16(uint16_t v){
+	put(v & 0xff);
+	put(v >> 8);
+}
+
+/* One chip select worth of bytes, as the TeleMega clocks them */
+static int transaction(struct companion_decoder *c, const struct command *cmd, int reply_len){
+	uint16_t start = head;
+	int i;
+
+	put(cmd->command);
+	put(cmd->flight_state);
+	put16(cmd->tick);
+	put16(cmd->serial);
+	put16(cmd->flight);
+	put16((uint16_t) cmd->accel);
+	put16((uint16_t) cmd->speed);
+	put16((uint16_t) cmd->height);
+	put16(cmd->motor_number);
+	for (i = 0; i < reply_len; i++)
+		put(0xff);
+	return companion_Decode(c, ring, RING_MASK, start, (uint16_t) (head - start), 1234);
+}
+
+static int reply_len(const struct companion_decoder *c, uint8_t command){
+	switch (command){
+	case COMPANION_SETUP:
+		return COMPANION_SETUP_SIZE;
+	case COMPANION_FETCH:
+		return 2 * c->channels;
+	default:
+		return 0;
+	}
+}
+
+static void random_command(struct command *cmd){
+	cmd->command = COMPANION_SETUP + rand() % 3;
+	cmd->flight_state = rand() % (COMPANION_STATE_TEST + 1);
+	cmd->tick = rand();
+	cmd->serial = rand();
+	cmd->flight = rand();
+	cmd->accel = rand();
+	cmd->speed = rand();
+	cmd->height = rand();
+	cmd->motor_number = rand();
+}
+
+static void check_state(const struct companion_state *s, const struct command *cmd){
+	CHECK(s->command == cmd->command);
+	CHECK(s->flight_state == cmd->flight_state);
+	CHECK(s->tick == cmd->tick);
+	CHECK(s->serial == cmd->serial);
+	CHECK(s->flight == cmd->flight);
+	CHECK(s->accel == cmd->accel);
+	CHECK(s->speed == cmd->speed);
+	CHECK(s->height == cmd->height);
+	CHECK(s->motor_number == cmd->motor_number);
+	CHECK(s->rx_tick == 1234);
+}
+
+static void test_handshake(void){
+	struct companion_decoder c;
+	struct command cmd = { .command = COMPANION_SETUP, .flight_state = COMPANION_STATE_PAD };
+
+	companion_Reset(&c, 4);
+	CHECK(c.reply == COMPANION_REPLY_SETUP);
+
+	/* First SETUP was answered with our setup block, switch to data */
+	CHECK(transaction(&c, &cmd, COMPANION_SETUP_SIZE) == COMPANION_SETUP);
+	CHECK(c.reply == COMPANION_REPLY_DATA);
+
+	cmd.command = COMPANION_FETCH;
+	CHECK(transaction(&c, &cmd, 8) == COMPANION_FETCH);
+	CHECK(c.reply == COMPANION_REPLY_DATA);
+
+	cmd.command = COMPANION_NOTIFY;
+	cmd.flight_state = COMPANION_STATE_BOOST;
+	CHECK(transaction(&c, &cmd, 0) == COMPANION_NOTIFY);
+	CHECK(companion_Latest(&c)->flight_state == COMPANION_STATE_BOOST);
+
+	/* TeleMega rebooted: it got data instead of setup, and will retry */
+	cmd.command = COMPANION_SETUP;
+	CHECK(transaction(&c, &cmd, COMPANION_SETUP_SIZE) == COMPANION_SETUP);
+	CHECK(c.reply == COMPANION_REPLY_SETUP);
+	CHECK(transaction(&c, &cmd, COMPANION_SETUP_SIZE) == COMPANION_SETUP);
+	CHECK(c.reply == COMPANION_REPLY_DATA);
+
+	CHECK(c.frames == 5);
+	CHECK(c.errors == 0);
+}
+
+static void test_framing(void){
+	struct companion_decoder c;
+	struct command cmd = { .command = COMPANION_FETCH, .flight_state = COMPANION_STATE_COAST, .height = 1500 };
+
+	companion_Reset(&c, 3);
+	CHECK(transaction(&c, &cmd, 6) == COMPANION_FETCH);
+
+	/* Short, long and unknown transactions never reach the published state */
+	cmd.height = 99;
+	CHECK(transaction(&c, &cmd, 5) == -1);
+	CHECK(transaction(&c, &cmd, 7) == -1);
+	cmd.command = 0x42;
+	CHECK(transaction(&c, &cmd, 0) == -1);
+	cmd.command = COMPANION_NOTIFY;
+	cmd.flight_state = COMPANION_STATE_TEST + 1;
+	CHECK(transaction(&c, &cmd, 0) == -1);
+
+	CHECK(companion_Latest(&c)->height == 1500);
+	CHECK(c.frames == 1);
+	CHECK(c.errors == 4);
+}
+
+/* Every accepted command can be put back together byte for byte */
+static void test_encode(void){
+	struct companion_decoder c;
+	struct command cmd;
+	uint8_t command[COMPANION_COMMAND_SIZE];
+	uint16_t start;
+	int i, j;
+
+	companion_Reset(&c, 2);
+	for (i = 0; i < 1000; i++){
+		random_command(&cmd);
+		start = head;
+		if (transaction(&c, &cmd, reply_len(&c, cmd.command)) < 0)
+			continue;
+		companion_Encode(companion_Latest(&c), command);
+		for (j = 0; j < COMPANION_COMMAND_SIZE; j++)
+			CHECK(command[j] == ring[(start + j) & RING_MASK]);
+	}
+	CHECK(c.frames > 0);
+}
+
+static uint16_t channel(const uint8_t *data, int ch){
+	return (uint16_t) (data[2 * ch] | (data[2 * ch + 1] << 8));
+}
+
+static void test_return(void){
+	struct companion_return r = {
+		.mode = 1,
+		.flags = COMPANION_RETURN_HOMED | COMPANION_RETURN_SD,
+		.position = 1234,
+		.target = -20,
+		.extension = 0.61705f,
+		.predicted = 3101.4f,
+		.error = -53.26f,
+		.cd = 0.4517f,
+		.overruns = 3,
+		.exec_us = 412,
+		.slips = 0,
+	};
+	uint8_t data[2 * COMPANION_CHANNELS + 1];
+
+	/* Has to fit what the TeleMega will take */
+	CHECK(COMPANION_CHANNELS <= COMPANION_MAX_CHANNELS);
+
+	memset(data, 0xa5, sizeof (data));
+	companion_EncodeReturn(&r, data);
+	CHECK(data[2 * COMPANION_CHANNELS] == 0xa5);
+	CHECK(channel(data, COMPANION_CH_STATUS) == (1 | (COMPANION_RETURN_HOMED | COMPANION_RETURN_SD) << 8));
+	CHECK(channel(data, COMPANION_CH_POSITION) == 1234);
+	CHECK((int16_t) channel(data, COMPANION_CH_TARGET) == -20);
+	CHECK(channel(data, COMPANION_CH_EXTENSION) == 6171);
+	CHECK(channel(data, COMPANION_CH_PREDICTED) == 3101);
+	CHECK((int16_t) channel(data, COMPANION_CH_ERROR) == -533);
+	CHECK(channel(data, COMPANION_CH_CD) == 4517);
+	CHECK(channel(data, COMPANION_CH_OVERRUNS) == 3);
+	CHECK(channel(data, COMPANION_CH_EXEC) == 412);
+	CHECK(channel(data, COMPANION_CH_SLIPS) == 0);
+
+	/* Out of range pins to the ends, counters stick at the top */
+	r.position = 100000;
+	r.target = -100000;
+	r.extension = 1.5f;
+	r.predicted = -10;
+	r.error = 5000;
+	r.overruns = 70000;
+	r.exec_us = UINT32_MAX;
+	companion_EncodeReturn(&r, data);
+	CHECK((int16_t) channel(data, COMPANION_CH_POSITION) == INT16_MAX);
+	CHECK((int16_t) channel(data, COMPANION_CH_TARGET) == INT16_MIN);
+	CHECK(channel(data, COMPANION_CH_EXTENSION) == 10000);
+	CHECK(channel(data, COMPANION_CH_PREDICTED) == 0);
+	CHECK((int16_t) channel(data, COMPANION_CH_ERROR) == INT16_MAX);
+	CHECK(channel(data, COMPANION_CH_OVERRUNS) == UINT16_MAX);
+	CHECK(channel(data, COMPANION_CH_EXEC) == UINT16_MAX);
+
+	/* Before the predictor has anything */
+	r.predicted = 0.0f / 0.0f;
+	companion_EncodeReturn(&r, data);
+	CHECK(channel(data, COMPANION_CH_PREDICTED) == 0);
+}
+
+/* Random mix of good transactions, glitches and line noise at every ring offset */
+static void test_fuzz(int rounds){
+	struct companion_decoder c;
+	struct command cmd, good;
+	int have_good = 0;
+	uint32_t frames = 0;
+	int i, j, len;
+
+	companion_Reset(&c, COMPANION_MAX_CHANNELS);
+	for (i = 0; i < rounds; i++){
+		switch (rand() % 4){
+		case 0: {
+			uint16_t start = head;
+
+			len = rand() % 64;
+			for (j = 0; j < len; j++)
+				put(rand());
+			if (companion_Decode(&c, ring, RING_MASK, start, (uint16_t) len, 1234) >= 0){
+				/* noise that happens to frame correctly is still a frame */
+				frames++;
+				have_good = 0;
+			}
+			break;
+		}
+		case 1:
+			random_command(&cmd);
+			CHECK(transaction(&c, &cmd, reply_len(&c, cmd.command) + 1 + rand() % 4) == -1);
+			break;
+		default:
+			random_command(&cmd);
+			CHECK(transaction(&c, &cmd, reply_len(&c, cmd.command)) == cmd.command);
+			good = cmd;
+			have_good = 1;
+			frames++;
+			break;
+		}
+		if (have_good)
+			check_state(companion_Latest(&c), &good);
+		if (failures)
+			break;
+	}
+	CHECK(c.frames == frames);
+}
+
+static void test_throughput(int count){
+	struct companion_decoder c;
+	struct command cmd;
+	struct timespec t0, t1;
+	uint16_t start[16];
+	double secs;
+	int i;
+
+	companion_Reset(&c, 0);
+	head = 0;
+	for (i = 0; i < 16; i++){
+		random_command(&cmd);
+		cmd.command = COMPANION_NOTIFY;
+		start[i] = head;
+		transaction(&c, &cmd, 0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < count; i++)
+		companion_Decode(&c, ring, RING_MASK, start[i & 15], COMPANION_COMMAND_SIZE, (uint32_t) i);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("decode: %d frames in %.3f s, %.1f ns/frame\n", count, secs, secs * 1e9 / count);
+	CHECK(c.frames == (uint32_t) count + 16);
+}
+
+int main(int argc, char **argv){
+	srand(argc > 1 ? atoi(argv[1]) : 1);
+
+	test_handshake();
+	test_framing();
+	test_encode();
+	test_return();
+	test_fuzz(1000000);
+	test_throughput(10000000);
+
+	if (failures){
+		printf("companion_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("companion_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * control_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Flies the control law against a point mass coasting through an
+ * exponential atmosphere, ticking it at CONTROL_HZ off companion
+ * frames built from the simulated state, with the brakes following
+ * the commanded position at the stepper's top speed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "control.h"
+#include "crc.h"
+
+#define DT			0.001		/* plant step, s */
+#define G			9.80665
+#define BRAKE_RATE	5000.0		/* steps/s */
+
+/* Flat table: the body Cd the plant uses too */
+#define TABLE_CD	0.5
+#define FRAC		14
+
+static struct lut l;
+static uint8_t table[LUT_HEADER_SIZE + 4 * 4];
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static int table_read(uint32_t addr, uint8_t *buf, uint32_t len){
+	memcpy(buf, table + addr, len);
+	return 0;
+}
+
+static int fetch(uint32_t addr, uint8_t *buf, uint32_t len){
+	table_read(addr, buf, len);
+	lut_FetchDone(&l);
+	return 0;
+}
+
+static void make_table(void){
+	int i;
+
+	put32(table + 0, LUT_MAGIC);
+	put16(table + 4, LUT_VERSION);
+	put16(table + 6, LUT_HEADER_SIZE);
+	put32(table + 8, 0);
+	put32(table + 12, 400 * 16);
+	put16(table + 16, 2);
+	put16(table + 18, 2);
+	put32(table + 20, 0);
+	put32(table + 24, 5000);
+	put32(table + 28, 4);
+	put32(table + 32, LUT_HEADER_SIZE);
+	table[36] = 2;
+	table[37] = FRAC;
+	put32(table + 40, 8);
+	for (i = 0; i < 4; i++)
+		put16(table + LUT_HEADER_SIZE + i * 2, (uint16_t) lrint(TABLE_CD * (1 << FRAC)));
+	put32(table + 44, crc32(CRC32_INIT, table + LUT_HEADER_SIZE, 8));
+	CHECK(lut_Open(&l, table, sizeof (table), 0, table_read, fetch) == 0);
+	lut_Poll(&l);
+}
+
+struct flight {
+	double	apogee;
+	double	max_extension;
+	int32_t	final_position;
+};
+
+/* Coast from burnout at (h, v) until apogee */
+static void fly(const struct control_config *cfg, double h, double v, struct flight *f){
+	struct control c;
+	struct companion_state s = {0};
+	double t = 0, brake = 0, next_tick = 0, rho, k;
+	int32_t target = 0;
+	uint32_t ms;
+
+	control_Init(&c, cfg, &l);
+	f->max_extension = 0;
+	while (v > 0){
+		if (t >= next_tick){
+			ms = (uint32_t) lrint(t * 1000) + 1000;
+			s.flight_state = COMPANION_STATE_COAST;
+			s.speed = (int16_t) lrint(v * 16);
+			s.height = (int16_t) lrint(h);
+			s.rx_tick = ms;
+			target = control_Step(&c, &s, (int32_t) lrint(brake), ms);
+			next_tick += 1.0 / cfg->hz;
+		}
+		if (brake < target)
+			brake = fmin(brake + BRAKE_RATE * DT, target);
+		else
+			brake = fmax(brake - BRAKE_RATE * DT, target);
+		if (brake / cfg->brake_steps > f->max_extension)
+			f->max_extension = brake / cfg->brake_steps;
+
+		rho = cfg->rho0 * exp(-h / 8500);
+		k = 0.5 * rho * (TABLE_CD * cfg->area + brake / cfg->brake_steps * cfg->brake_cda) / cfg->mass;
+		v += (-G - k * v * v) * DT;
+		h += v * DT;
+		t += DT;
+	}
+	f->apogee = h;
+	f->final_position = target;
+}
+
+static void test_flights(void){
+	struct control_config cfg = CONTROL_CONFIG_DEFAULT;
+	struct control_config off = CONTROL_CONFIG_DEFAULT;
+	static const double burnout[][2] = {
+		{ 900, 280 }, { 600, 300 }, { 1000, 290 }, { 800, 310 },
+	};
+	struct flight f, free_flight;
+	unsigned i;
+
+	off.kp = 0;
+	off.ki = 0;
+	for (i = 0; i < sizeof (burnout) / sizeof (burnout[0]); i++){
+		fly(&off, burnout[i][0], burnout[i][1], &free_flight);
+		fly(&cfg, burnout[i][0], burnout[i][1], &f);
+		printf("control: burnout %4.0f m %3.0f m/s: free %6.1f m, controlled %6.1f m, peak extension %.2f\n",
+		       burnout[i][0], burnout[i][1], free_flight.apogee, f.apogee, f.max_extension);
+		CHECK(free_flight.apogee > cfg.target + 50);
+		CHECK(fabs(f.apogee - cfg.target) < 15);
+	}
+
+	/* Short of the target: brakes stay in */
+	fly(&cfg, 500, 200, &f);
+	CHECK(f.max_extension == 0);
+	CHECK(f.apogee < cfg.target);
+}
+
+static void test_modes(void){
+	struct control_config cfg = CONTROL_CONFIG_DEFAULT;
+	struct companion_state s = { .flight_state = COMPANION_STATE_BOOST, .speed = 280 * 16, .height = 900, .rx_tick = 5000 };
+	struct control c;
+
+	control_Init(&c, &cfg, &l);
+
+	/* Under power, never */
+	CHECK(control_Step(&c, &s, 0, 5000) == 0);
+	CHECK(c.mode == CONTROL_IDLE);
+
+	s.flight_state = COMPANION_STATE_COAST;
+	CHECK(control_Step(&c, &s, 0, 5000) > 0);
+	CHECK(c.mode == CONTROL_ACTIVE);
+	CHECK(c.error > 0);
+	CHECK(fabs(c.cd - TABLE_CD) < 0.001);
+
+	/* TeleMega goes quiet: in they come */
+	CHECK(control_Step(&c, &s, 500, 5000 + cfg.stale_ms + 1) == 0);
+	CHECK(c.mode == CONTROL_STALE);
+	CHECK(control_Step(&c, &s, 0, 5000) > 0);
+
+	/* Drogue latches retracted, even if a later frame says coast */
+	s.flight_state = COMPANION_STATE_DROGUE;
+	CHECK(control_Step(&c, &s, 500, 5000) == 0);
+	CHECK(c.mode == CONTROL_DONE);
+	s.flight_state = COMPANION_STATE_COAST;
+	CHECK(control_Step(&c, &s, 0, 5000) == 0);
+
+	/* Never heard from the TeleMega at all */
+	control_Init(&c, &cfg, NULL);
+	s.rx_tick = 0;
+	CHECK(control_Step(&c, &s, 0, 10) == 0);
+	CHECK(c.mode == CONTROL_STALE);
+}
+
+static void test_speed(int count){
+	struct control_config cfg = CONTROL_CONFIG_DEFAULT;
+	struct companion_state s = { .flight_state = COMPANION_STATE_COAST, .height = 900, .rx_tick = 5000 };
+	struct timespec t0, t1;
+	struct control c;
+	int32_t sum = 0;
+	double secs;
+	int n;
+
+	control_Init(&c, &cfg, &l);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (n = 0; n < count; n++){
+		s.speed = 16 * (100 + (n & 127));
+		sum += control_Step(&c, &s, n & 1023, 5000);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("control: %d steps in %.3f s, %.1f ns/step (%d)\n", count, secs, secs * 1e9 / count, sum & 1);
+}
+
+int main(void){
+	make_table();
+
+	test_flights();
+	test_modes();
+	test_speed(200000);
+
+	if (failures){
+		printf("control_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("control_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,299 @@
+/*
+ * erase_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs the flight recorder over a RAM flash full of an old log, with
+ * the erase scheduler clearing sectors in front of it the way
+ * recorder_flash.c wires them up. Sector erases and page programs
+ * take a few main loop passes each and can't overlap. Checks that the
+ * log never lands on unerased flash, that it's writing within a
+ * couple of passes of being cleared, and that the boot scan finds the
+ * end of the new log with the old one still past it, wherever the
+ * power is cut.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "recorder.h"
+#include "erase.h"
+
+#define START		0x10000
+#define SECTORS		32
+#define END			(START + SECTORS * ERASE_SECTOR_SIZE)
+
+#define ERASE_POLLS	20
+#define WRITE_POLLS	2
+
+static uint8_t flash[END];
+static struct recorder r;
+static struct erase e;
+
+static const uint8_t *pending;
+static uint32_t pending_addr;
+static int32_t erasing = -1;
+static int busy;
+static uint32_t programmed_dirty;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static int ram_erase(uint32_t addr){
+	CHECK(addr % ERASE_SECTOR_SIZE == 0 && addr >= START && addr < END);
+	if (pending || erasing >= 0)
+		return -1;
+	erasing = addr;
+	busy = ERASE_POLLS;
+	return 0;
+}
+
+static int ram_busy(void){
+	return erasing >= 0;
+}
+
+static int ram_write(uint32_t addr, const uint8_t *data, uint32_t len){
+	uint32_t i;
+
+	if (!erase_Ready(&e, addr, len))
+		return -1;
+	if (pending || erasing >= 0)
+		return -1;
+	for (i = 0; i < len; i++)
+		if (flash[addr + i] != 0xff)
+			programmed_dirty++;
+	pending = data;
+	pending_addr = addr;
+	busy = WRITE_POLLS;
+	return 0;
+}
+
+static int ram_read(uint32_t addr, uint8_t *data, uint32_t len){
+	memcpy(data, flash + addr, len);
+	return 0;
+}
+
+/* One main loop pass: the chip may finish, then erase and recorder poll */
+static void poll(void){
+	uint32_t i;
+
+	if (busy && --busy == 0){
+		if (erasing >= 0){
+			memset(flash + erasing, 0xff, ERASE_SECTOR_SIZE);
+			erasing = -1;
+		}
+		else if (pending){
+			for (i = 0; i < RECORDER_PAGE_SIZE; i++)
+				flash[pending_addr + i] &= pending[i];
+			pending = NULL;
+			recorder_WriteDone(&r);
+		}
+	}
+	erase_Poll(&e);
+	recorder_Poll(&r);
+}
+
+static void settle(void){
+	int i;
+
+	for (i = 0; i < 4 * ERASE_POLLS * ERASE_AHEAD; i++)
+		poll();
+}
+
+static void add(uint32_t n){
+	struct recorder_control c;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	memset(&c, 0, sizeof (c));
+	c.tick = 1000 + n * 10;
+	c.commanded = (int32_t) n;
+	recorder_EncodeControl(rec, &c);
+	recorder_Add(&r, rec);
+}
+
+/* Every record from start up to the first erased page matches 0, 1, 2, ... */
+static uint32_t verify(uint32_t start){
+	struct recorder_control c;
+	uint32_t addr, n = 0;
+	int i, type;
+
+	for (addr = start; addr < END; addr += RECORDER_PAGE_SIZE){
+		if (recorder_Check(flash + addr) == RECORDER_EMPTY)
+			break;
+		for (i = 0; i < RECORDER_PER_PAGE; i++){
+			type = recorder_Check(flash + addr + i * RECORDER_RECORD_SIZE);
+			if (type == RECORDER_EMPTY)
+				continue;
+			if (type != RECORDER_CONTROL)
+				return n;
+			recorder_DecodeControl(flash + addr + i * RECORDER_RECORD_SIZE, &c);
+			if (c.tick != 1000 + n * 10)
+				return n;
+			n++;
+		}
+	}
+	return n;
+}
+
+/* An old flight's worth of log everywhere, as if nothing had been erased */
+static void old_log(void){
+	memset(flash, 0x00, sizeof (flash));
+}
+
+/* The log starts over at addr, the way recorder_Erase() does it */
+static void restart(uint32_t addr){
+	settle();
+	recorder_Init(&r, recorder_FindEnd(START, addr, ram_read), END, ram_write);
+	erase_Init(&e, START, END - START, ram_erase, ram_busy);
+	erase_Restart(&e, r.addr);
+}
+
+static void test_ahead(void){
+	uint32_t s;
+
+	old_log();
+	erase_Init(&e, START, END - START, ram_erase, ram_busy);
+	erase_Restart(&e, START);
+	settle();
+	CHECK(e.erases == ERASE_AHEAD);
+	for (s = 0; s < SECTORS; s++)
+		CHECK((flash[START + s * ERASE_SECTOR_SIZE] == 0xff) == (s < ERASE_AHEAD));
+
+	/* Moving the head along pulls the window with it */
+	CHECK(erase_Ready(&e, START + 3 * ERASE_SECTOR_SIZE, RECORDER_PAGE_SIZE));
+	settle();
+	CHECK(e.erases == ERASE_AHEAD + 3);
+
+	/* Nothing goes into a sector until the one after it is erased too */
+	erase_Restart(&e, START);
+	CHECK(!erase_Ready(&e, START, RECORDER_PAGE_SIZE));
+	erase_Poll(&e);
+	settle();
+	CHECK(erase_Ready(&e, START, RECORDER_PAGE_SIZE));
+	CHECK(erase_Ready(&e, START + ERASE_SECTOR_SIZE - RECORDER_PAGE_SIZE, RECORDER_PAGE_SIZE));
+
+	/* Carrying on part way through a sector only needs the next one erased */
+	flash[START] = 0x00;
+	erase_Restart(&e, START + 5 * RECORDER_PAGE_SIZE);
+	CHECK(!erase_Ready(&e, START + 5 * RECORDER_PAGE_SIZE, RECORDER_PAGE_SIZE));
+	erase_Poll(&e);
+	settle();
+	CHECK(erase_Ready(&e, START + 5 * RECORDER_PAGE_SIZE, RECORDER_PAGE_SIZE));
+	CHECK(flash[START] == 0x00);
+	CHECK(flash[START + ERASE_SECTOR_SIZE] == 0xff);
+}
+
+static void test_stream(void){
+	uint32_t n, polls, total = 2000;
+
+	/* Cleared with the whole region still holding the old log */
+	old_log();
+	programmed_dirty = 0;
+	restart(START);
+	CHECK(r.addr == START);
+
+	/* The first page is on its way as soon as two sectors are erased */
+	for (n = 0; n < RECORDER_PER_PAGE; n++)
+		add(n);
+	for (polls = 0; r.pages == 0 && polls < 10 * ERASE_POLLS; polls++)
+		poll();
+	CHECK(r.pages == 1);
+	CHECK(polls <= 2 * ERASE_POLLS + WRITE_POLLS + 2);
+
+	/* A control tick every four passes keeps ahead of the erases */
+	for (; n < total; n++){
+		add(n);
+		poll();
+		poll();
+		poll();
+		poll();
+	}
+	recorder_Pad(&r);
+	settle();
+	CHECK(r.drops == 0 && r.lost == 0);
+	CHECK(programmed_dirty == 0);
+	CHECK(verify(START) == total);
+
+	/* Power cycle: the boot scan stops at the blank sector past the log */
+	CHECK(flash[END - 1] == 0x00);
+	CHECK(recorder_FindEnd(START, END, ram_read) == r.addr);
+}
+
+static void test_reboot(void){
+	uint32_t n, k, addr;
+
+	/* Lose power with the log at every point through a sector */
+	for (k = 0; k < 2 * ERASE_SECTOR_SIZE / RECORDER_PAGE_SIZE; k++){
+		old_log();
+		programmed_dirty = 0;
+		restart(START);
+		for (n = 0; n < (k + 1) * RECORDER_PER_PAGE; n++){
+			add(n);
+			poll();
+			poll();
+			poll();
+		}
+		settle();
+		CHECK(r.pages == k + 1);
+		addr = recorder_FindEnd(START, END, ram_read);
+		CHECK(addr == r.addr);
+
+		/* And carry on from there, after the old records */
+		recorder_Init(&r, addr, END, ram_write);
+		erase_Restart(&e, addr);
+		for (; n < (k + 20) * RECORDER_PER_PAGE; n++){
+			add(n);
+			poll();
+			poll();
+			poll();
+		}
+		settle();
+		CHECK(programmed_dirty == 0);
+		CHECK(verify(START) == n);
+	}
+}
+
+/*
+ * Pull the power after every main loop pass of a new log going down
+ * over an old one, with erases and page programs left wherever they
+ * were: once any of it is down, the boot scan has to find the end of
+ * what got programmed.
+ */
+static void test_cut(void){
+	uint32_t n, i, end;
+
+	old_log();
+	programmed_dirty = 0;
+	restart(START);
+	/* A few pages already waiting, and records coming faster than the erases */
+	for (n = 0; n < 2 * RECORDER_PER_PAGE; n++)
+		add(n);
+	for (; n < 4 * ERASE_SECTOR_SIZE / RECORDER_RECORD_SIZE; n++){
+		add(n);
+		for (i = 0; i < 2; i++){
+			poll();
+			end = r.addr - (pending ? RECORDER_PAGE_SIZE : 0);
+			if (end > START)
+				CHECK(recorder_FindEnd(START, END, ram_read) == end);
+		}
+	}
+	CHECK(r.pages >= 2 * ERASE_SECTOR_SIZE / RECORDER_PAGE_SIZE);
+	CHECK(programmed_dirty == 0);
+}
+
+int main(void){
+	test_ahead();
+	test_stream();
+	test_reboot();
+	test_cut();
+
+	if (failures){
+		printf("erase_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("erase_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * estimate_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Flies estimate.c through a burn and a coast whose truth is known,
+ * with companion frames quantized the way the TeleMega sends them at
+ * COMPANION_HZ and control ticks at CONTROL_HZ in between. Checks the
+ * ticks between frames are closer to the truth than the last frame
+ * was, that the IMU keeps it right when frames are lost at burnout,
+ * that corrections blend in rather than step, and that a link gone
+ * quiet isn't carried forward for long.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "estimate.h"
+#include "control.h"
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+#define DT			0.0001		/* s, truth step */
+#define G			9.80665
+#define K			0.0002		/* drag per v^2, brakes in */
+#define BURN		3.0			/* s */
+#define THRUST		100.0		/* m/s^2 less gravity */
+#define TICK_US		(CONTROL_TICK_HZ / CONTROL_HZ)
+#define FRAME_US	(1000000 / COMPANION_HZ)
+
+struct truth {
+	double	t;
+	double	height;
+	double	speed;
+	double	accel;
+};
+
+static void truth_Step(struct truth *w){
+	w->accel = w->t < BURN ? THRUST : -G - K * w->speed * fabs(w->speed);
+	w->height += w->speed * DT + 0.5 * w->accel * DT * DT;
+	w->speed += w->accel * DT;
+	w->t += DT;
+}
+
+static void frame(struct companion_state *s, const struct truth *w, uint16_t tick){
+	s->flight_state = w->t < BURN ? COMPANION_STATE_BOOST : COMPANION_STATE_COAST;
+	s->tick = tick;
+	s->height = (int16_t) lrint(w->height);
+	s->speed = (int16_t) lrint(w->speed * 16);
+	s->accel = (int16_t) lrint(w->accel * 16);
+}
+
+struct errors {
+	double	height;			/* worst in coast, on ticks between frames */
+	double	speed;
+	double	hold_height;	/* the same for the last frame as it came */
+	double	hold_speed;
+	double	burnout;		/* worst speed just after burnout, every tick, two frames lost */
+	double	step;			/* worst jump in height from one tick to the next, less the truth's */
+};
+
+/* Launch to apogee; local feeds the true acceleration in as the IMU would */
+static void fly(int local, struct errors *r){
+	static const struct estimate_config cfg = ESTIMATE_CONFIG_DEFAULT;
+	struct estimate e;
+	struct truth w = {0};
+	struct companion_state s = {0}, out;
+	uint32_t us = 0, next_tick = 0, next_frame = 0;
+	uint16_t tick = 0;
+	double last = 0, last_truth = 0;
+	int started = 0;
+
+	estimate_Init(&e, &cfg);
+	*r = (struct errors) {0};
+	while (w.t < BURN || w.speed > 0){
+		us = (uint32_t) lrint(w.t * 1e6);
+		if (us >= next_frame){
+			if (w.t < BURN + 0.005 || w.t > BURN + 0.025){
+				frame(&s, &w, tick);
+				estimate_Frame(&e, &s, us);
+			}
+			tick++;
+			next_frame += FRAME_US;
+		}
+		if (us >= next_tick){
+			if (local)
+				estimate_Accel(&e, (float) w.accel, us);
+			out = s;
+			CHECK(estimate_Step(&e, &out, us));
+			if (w.t > BURN && w.t < BURN + 0.05)
+				r->burnout = fmax(r->burnout, fabs(out.speed / 16.0 - w.speed));
+			if (us + TICK_US / 2 < next_frame && w.t > BURN + 0.05){
+				r->height = fmax(r->height, fabs(out.height - w.height));
+				r->speed = fmax(r->speed, fabs(out.speed / 16.0 - w.speed));
+				r->hold_height = fmax(r->hold_height, fabs(s.height - w.height));
+				r->hold_speed = fmax(r->hold_speed, fabs(s.speed / 16.0 - w.speed));
+			}
+			if (started)
+				r->step = fmax(r->step, fabs((out.height - last) - (w.height - last_truth)));
+			last = out.height;
+			last_truth = w.height;
+			started = 1;
+			next_tick += TICK_US;
+		}
+		truth_Step(&w);
+	}
+}
+
+static void test_flight(void){
+	struct errors frames, local;
+
+	fly(0, &frames);
+	fly(1, &local);
+	printf("estimate: coast between frames %.2f m %.2f m/s (held %.2f m %.2f m/s), burnout %.2f m/s (%.2f with the IMU), worst step %.2f m\n",
+	       frames.height, frames.speed, frames.hold_height, frames.hold_speed, frames.burnout, local.burnout, frames.step);
+	CHECK(frames.height < 1.0);
+	CHECK(frames.height < frames.hold_height / 2);
+	CHECK(frames.speed < frames.hold_speed / 2);
+	/* Burnout is where the frame's accel is wrong until the next one gets through */
+	CHECK(local.burnout < frames.burnout / 2);
+	CHECK(frames.step < 1.5);
+}
+
+static void test_blend(void){
+	static const struct estimate_config cfg = ESTIMATE_CONFIG_DEFAULT;
+	struct estimate e;
+	struct companion_state s = { .tick = 1, .height = 1000, .speed = 100 * 16 }, out = s;
+
+	estimate_Init(&e, &cfg);
+	CHECK(!estimate_Step(&e, &out, 0));
+
+	/* Straight line at 100 m/s */
+	estimate_Frame(&e, &s, 10000);
+	CHECK(estimate_Step(&e, &out, 10000) && out.height == 1000);
+	CHECK(estimate_Step(&e, &out, 16000) && out.height == 1001);	/* 1000.6 */
+	CHECK(estimate_Step(&e, &out, 20000) && out.height == 1001);
+
+	/* The next frame says 5 m higher: fades in over blend_us */
+	s.tick = 2;
+	s.height = 1006;
+	estimate_Frame(&e, &s, 20000);
+	CHECK(estimate_Step(&e, &out, 20000) && out.height == 1001);
+	CHECK(estimate_Step(&e, &out, 25000) && out.height == 1003);	/* 1006.5 - 3.75 */
+	CHECK(estimate_Step(&e, &out, 32000) && out.height == 1005);	/* 1007.2 - 2 */
+	CHECK(estimate_Step(&e, &out, 40000) && out.height == 1008);
+	CHECK(e.snaps == 0);
+
+	/* A NOTIFY with the same tick changes nothing */
+	s.height = 900;
+	estimate_Frame(&e, &s, 40000);
+	CHECK(e.frames == 2);
+
+	/* Way off: taken at once */
+	s.tick = 3;
+	estimate_Frame(&e, &s, 40000);
+	CHECK(estimate_Step(&e, &out, 40000) && out.height == 900);
+	CHECK(e.snaps == 1);
+
+	/* No more frames: carried max_us and then held */
+	CHECK(estimate_Step(&e, &out, 40000 + cfg.max_us) && out.height == 905);
+	CHECK(estimate_Step(&e, &out, 40000 + 4 * cfg.max_us) && out.height == 905);
+	CHECK(out.speed == 100 * 16);
+
+	/* Latency: a frame is already that old when it lands */
+	e.cfg.latency_us = 10000;
+	s.tick = 4;
+	s.height = 2000;
+	estimate_Frame(&e, &s, 500000);
+	CHECK(estimate_Step(&e, &out, 500000) && out.height == 2001);
+}
+
+int main(void){
+	test_flight();
+	test_blend();
+
+	if (failures){
+		printf("estimate_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("estimate_test: ok\n");
+	return 0;
+}
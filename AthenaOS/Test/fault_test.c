@@ -0,0 +1,110 @@
+/*
+ * fault_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Checks the fault record round trip, that a damaged or erased slot
+ * is told apart from a good one, and that the profiler's trace ring
+ * comes out oldest first whether or not it has wrapped.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fault.h"
+
+static struct profile prof;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static void test_record(void){
+	uint8_t rec[FAULT_RECORD_SIZE];
+	struct fault f, g;
+	int i;
+
+	memset(&f, 0, sizeof (f));
+	f.type = FAULT_BUS;
+	f.tick = 123456;
+	for (i = 0; i < FAULT_FRAME; i++)
+		f.frame[i] = 0x20001000 + i;
+	f.frame[FAULT_PC] = 0x08001234;
+	f.frame[FAULT_LR] = 0x08005679;
+	f.exc_return = 0xfffffff9;
+	f.sp = 0x2001ff00;
+	f.cfsr = 0x8200;
+	f.hfsr = 0x40000000;
+	f.mmfar = 0xe000ed34;
+	f.bfar = 0xdeadbeef;
+	f.cycles = 0x12345678;
+	f.stack_words = 20;
+	for (i = 0; i < f.stack_words; i++)
+		f.stack[i] = 0x08000001 + 16 * i;
+
+	profile_Init(&prof);
+	for (i = 0; i < 5; i++)
+		profile_Trace(&prof, i % PROFILE_PROBES, 1000 * i, 100 + i);
+	fault_SetTrace(&f, prof.trace, prof.trace_head);
+
+	fault_Encode(rec, &f);
+	CHECK(fault_Decode(rec, &g) == 0);
+	CHECK(g.type == FAULT_BUS && g.tick == f.tick && g.exc_return == f.exc_return && g.sp == f.sp);
+	CHECK(memcmp(g.frame, f.frame, sizeof (f.frame)) == 0);
+	CHECK(g.cfsr == f.cfsr && g.hfsr == f.hfsr && g.mmfar == f.mmfar && g.bfar == f.bfar);
+	CHECK(g.cycles == f.cycles);
+	CHECK(g.stack_words == 20 && memcmp(g.stack, f.stack, 20 * sizeof (uint32_t)) == 0);
+	CHECK(g.trace_head == 5 && g.trace_count == 5);
+	for (i = 0; i < 5; i++){
+		CHECK(g.trace[i].at == (uint32_t) (1000 * i));
+		CHECK(PROFILE_EVENT_ID(&g.trace[i]) == (uint32_t) (i % PROFILE_PROBES));
+		CHECK(PROFILE_EVENT_CYCLES(&g.trace[i]) == (uint32_t) (100 + i));
+	}
+
+	/* Any flipped bit is caught; erased flash is an empty slot */
+	for (i = 0; i < FAULT_RECORD_SIZE; i += 37){
+		rec[i] ^= 0x04;
+		CHECK(fault_Decode(rec, &g) == FAULT_BAD);
+		rec[i] ^= 0x04;
+	}
+	CHECK(fault_Decode(rec, &g) == 0);
+	memset(rec, 0xff, sizeof (rec));
+	CHECK(fault_Decode(rec, &g) == FAULT_EMPTY);
+	CHECK(strcmp(fault_Name(FAULT_HARD), "HardFault") == 0);
+}
+
+static void test_trace(void){
+	struct fault f;
+	uint32_t i;
+
+	/* Wrapped several times: only the newest PROFILE_TRACE, in order */
+	profile_Init(&prof);
+	for (i = 0; i < 3 * PROFILE_TRACE + 7; i++)
+		profile_Trace(&prof, PROFILE_STEPPER, i, 0x1000000 + i);
+	fault_SetTrace(&f, prof.trace, prof.trace_head);
+	CHECK(f.trace_head == 3 * PROFILE_TRACE + 7 && f.trace_count == FAULT_TRACE);
+	for (i = 0; i < FAULT_TRACE; i++){
+		CHECK(f.trace[i].at == 2 * PROFILE_TRACE + 7 + i);
+		CHECK(PROFILE_EVENT_ID(&f.trace[i]) == PROFILE_STEPPER);
+		CHECK(PROFILE_EVENT_CYCLES(&f.trace[i]) == 0xffffff);
+	}
+
+	/* Nothing traced yet */
+	profile_Init(&prof);
+	fault_SetTrace(&f, prof.trace, prof.trace_head);
+	CHECK(f.trace_count == 0 && f.trace_head == 0);
+}
+
+int main(void){
+	test_record();
+	test_trace();
+
+	if (failures){
+		printf("fault_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("fault_test: ok\n");
+	return 0;
+}
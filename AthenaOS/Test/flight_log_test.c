@@ -0,0 +1,201 @@
+/*
+ * flight_log_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Reads back a small AltosUI CSV and a TeleMega .eeprom dump made up
+ * here: the CSV's columns found by name and the missing accelerometer
+ * speed filled from the baro, the eeprom's records checksummed, its
+ * tick unwrapped and its MS5607 pressure turned into height. Then
+ * flight_log_at between and beyond the samples.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "companion.h"
+#include "flight_log.h"
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+#define NEAR(a, b, e)	(fabs((a) - (b)) <= (e))
+
+/* The MS5607 datasheet's worked example: 100009 Pa at 20.07 C */
+#define PROM_SENS		46372
+#define PROM_OFF		43981
+#define PROM_TCS		29059
+#define PROM_TCO		27842
+#define PROM_TREF		31553
+#define PROM_TEMPSENS	28165
+#define D1_GROUND		6465444
+#define D2				8077636
+
+#define GROUND_ACCEL	3000
+#define PLUS_G			2000	/* 1000 counts per g */
+#define MINUS_G			4000
+
+static double pressure(uint32_t d1){
+	int64_t dt = (int64_t) D2 - ((int64_t) PROM_TREF << 8);
+	int64_t off = ((int64_t) PROM_OFF << 17) + (PROM_TCO * dt >> 6);
+	int64_t sens = ((int64_t) PROM_SENS << 16) + (PROM_TCS * dt >> 7);
+
+	return (double) ((((int64_t) d1 * sens >> 21) - off) >> 15);
+}
+
+static double altitude(double pa){
+	return 44330.77 * (1 - pow(pa / 101325.0, 0.190263));
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v & 0xffff);
+	put16(p + 2, v >> 16);
+}
+
+static void record(FILE *f, uint8_t type, uint16_t tick, const uint8_t *data, int bad){
+	uint8_t r[32];
+	uint8_t sum = 0x5a;
+	int i;
+
+	memset(r, 0, sizeof (r));
+	r[0] = type;
+	put16(r + 2, tick);
+	memcpy(r + 4, data, 28);
+	for (i = 0; i < 32; i++)
+		if (i != 1)
+			sum += r[i];
+	r[1] = (uint8_t) -sum + (bad ? 1 : 0);
+	for (i = 0; i < 32; i++)
+		fprintf(f, "%02x%c", r[i], i % 8 == 7 ? '\n' : ' ');
+}
+
+static void sensor(FILE *f, uint16_t tick, uint32_t d1, int16_t accel, int bad){
+	uint8_t d[28];
+
+	memset(d, 0, sizeof (d));
+	put32(d, d1);
+	put32(d + 4, D2);
+	put16(d + 26, (uint16_t) accel);	/* accel_along at 30 */
+	record(f, 'A', tick, d, bad);
+}
+
+/* format is the ao_config log_format the board wrote; they all share struct ao_log_mega */
+static void test_eeprom(int format){
+	struct flight_log log;
+	struct flight_sample s;
+	char err[128];
+	uint8_t d[28];
+	uint16_t tick = 0xfff0;
+	uint32_t d1 = D1_GROUND - 20000;
+	double up = altitude(pressure(d1)) - altitude(pressure(D1_GROUND));
+	FILE *f = tmpfile();
+	int i;
+
+	fprintf(f, "{\n\t\"ao_config\" : {\n\t\t\"serial\" : 4242,\n\t\t\"log_format\" : %d,\n"
+		"\t\t\"accel_cal_plus\" : %d,\n\t\t\"accel_cal_minus\" : %d\n\t},\n"
+		"\t\"ms5607\" : {\n\t\t\"reserved\" : 0,\n\t\t\"sens\" : %d,\n\t\t\"off\" : %d,\n"
+		"\t\t\"tcs\" : %d,\n\t\t\"tco\" : %d,\n\t\t\"tref\" : %d,\n\t\t\"tempsens\" : %d\n\t}\n}\n",
+		format, PLUS_G, MINUS_G, PROM_SENS, PROM_OFF, PROM_TCS, PROM_TCO, PROM_TREF, PROM_TEMPSENS);
+
+	memset(d, 0, sizeof (d));
+	put16(d, 7);
+	put16(d + 2, GROUND_ACCEL);
+	put32(d + 4, (uint32_t) pressure(D1_GROUND));
+	record(f, 'F', tick, d, 0);
+	memset(d, 0, sizeof (d));
+	put16(d, COMPANION_STATE_PAD);
+	record(f, 'S', tick, d, 0);
+
+	/* 1 s on the pad at rest, through the tick wrap */
+	for (i = 0; i < 100; i++, tick++)
+		sensor(f, tick, D1_GROUND, GROUND_ACCEL, i == 50);
+	memset(d, 0, sizeof (d));
+	put16(d, COMPANION_STATE_BOOST);
+	record(f, 'S', tick, d, 0);
+
+	/* Then 20 s higher up, and a last sample at 1 g */
+	for (i = 0; i < 2000; i++, tick++)
+		sensor(f, tick, d1, GROUND_ACCEL, 0);
+	sensor(f, tick, d1, GROUND_ACCEL - 1000, 0);
+	rewind(f);
+
+	CHECK(flight_log_read_eeprom(&log, f, err, sizeof (err)) == 0);
+	fclose(f);
+	CHECK(log.serial == 4242 && log.flight == 7);
+	CHECK(log.n == 2100);		/* less the bad record */
+	CHECK(log.s[0].t == 0 && NEAR(log.s[98].t, 0.99, 1e-9));
+	CHECK(log.s[0].state == COMPANION_STATE_PAD && log.s[log.n - 1].state == COMPANION_STATE_BOOST);
+	CHECK(NEAR(log.s[98].height, 0, 0.01) && NEAR(log.s[98].speed, 0, 0.01));
+	CHECK(NEAR(log.s[98].accel, 0, 1e-9));
+	CHECK(NEAR(log.s[log.n - 1].accel, 9.80665, 1e-6));
+	CHECK(up > 50);
+
+	/* The filter settles on the baro height */
+	flight_log_at(&log, 20, &s);
+	CHECK(NEAR(s.height, up, 1));
+	flight_log_free(&log);
+
+	/* Something else */
+	f = tmpfile();
+	fprintf(f, "{ \"ao_config\" : { \"log_format\" : 4, \"accel_cal_plus\" : 1, \"accel_cal_minus\" : 2 },"
+		" \"ms5607\" : { } }\n");
+	rewind(f);
+	CHECK(flight_log_read_eeprom(&log, f, err, sizeof (err)) != 0);
+	fclose(f);
+}
+
+static void test_csv(void){
+	struct flight_log log;
+	struct flight_sample s;
+	char err[128];
+	FILE *f = tmpfile();
+
+	fprintf(f, "# Config version: 1.11\n#\n"
+		"#version,serial,flight,call,time,clock,state,state_name,acceleration,height,accel_speed,baro_speed\n"
+		"5,58,5,KD7SQG,-1.00,0,2,pad,0.00,0.00,2147483647.00,0.00\n"
+		"5,58,5,KD7SQG,0.00,0,3,boost,100.00,10.00,2147483647.00,20.00\n"
+		"5,58,5,KD7SQG,2.00,0,5,coast,-20.00,210.00,2147483647.00,180.00\n");
+	rewind(f);
+	CHECK(flight_log_read_csv(&log, f, err, sizeof (err)) == 0);
+	fclose(f);
+	CHECK(log.n == 3 && log.serial == 58 && log.flight == 5);
+	CHECK(log.s[0].t == 0 && log.s[2].t == 3);
+	CHECK(log.s[1].speed == 20 && log.s[1].accel == 100);
+
+	flight_log_at(&log, 2, &s);
+	CHECK(s.t == 2 && s.state == 3);
+	CHECK(NEAR(s.height, 110, 1e-9) && NEAR(s.speed, 100, 1e-9) && NEAR(s.accel, 40, 1e-9));
+	flight_log_at(&log, -5, &s);
+	CHECK(s.state == 2 && s.height == 0);
+	flight_log_at(&log, 100, &s);
+	CHECK(s.state == 5 && s.height == 210);
+	flight_log_free(&log);
+
+	f = tmpfile();
+	fprintf(f, "version,serial,flight,time\n5,58,5,0.0\n");
+	rewind(f);
+	CHECK(flight_log_read_csv(&log, f, err, sizeof (err)) != 0);
+	fclose(f);
+}
+
+int main(void){
+	test_eeprom(10);	/* AO_LOG_FORMAT_TELEMEGA */
+	test_eeprom(21);	/* AO_LOG_FORMAT_TELEMEGA_5, telemega-v5.0 */
+	test_csv();
+
+	if (failures){
+		printf("flight_log_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("flight_log_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * governor_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Holds the clock profiles to the F446's limits and to what the rest
+ * of the firmware assumes of them, then walks the governor through a
+ * flight and works the prescaler arithmetic.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "governor.h"
+#include "companion.h"
+#include "control.h"
+#include "Stepper.h"
+#include "beep.h"
+#include "monitor.h"
+#include "flash.h"
+#include "sd.h"
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static void test_profiles(void){
+	int i;
+
+	for (i = 0; i < GOVERNOR_PROFILES; i++){
+		const struct governor_profile *p = &governor_profiles[i];
+		uint32_t vco = GOVERNOR_HSE_HZ / 8 * p->pll_n;
+		uint32_t pclk1 = p->hz / p->apb1_div, pclk2 = p->hz / p->apb2_div;
+		uint32_t tim1 = governor_TimerHz(p->hz, p->apb1_div);
+		uint32_t tim2 = governor_TimerHz(p->hz, p->apb2_div);
+		uint32_t max = p->scale == 3 ? 120000000 : p->scale == 2 ? 144000000 : 168000000;
+
+		/* The PLL can make it */
+		CHECK(vco >= 100000000 && vco <= 432000000);
+		CHECK(p->pll_p == 2 || p->pll_p == 4 || p->pll_p == 6 || p->pll_p == 8);
+		CHECK(vco / p->pll_p == p->hz);
+		CHECK(p->pll_q >= 2 && p->pll_q <= 15);
+		CHECK(vco / p->pll_q <= 75000000);
+
+		/* The regulator and flash keep up */
+		if (p->overdrive){
+			CHECK(p->scale == 1);
+			max = 180000000;
+		}
+		CHECK(p->hz <= max);
+		CHECK(p->latency <= 7);
+		CHECK(p->hz <= 30000000 * (p->latency + 1u));
+
+		/* Bus limits, and APB1 divided so its timers run at 2 * PCLK1 */
+		CHECK(pclk1 <= 45000000);
+		CHECK(pclk2 <= 90000000);
+		CHECK(p->apb1_div > 1);
+		CHECK(tim1 == 2 * pclk1);
+
+		/* USB needs HCLK over 14.2 MHz; the monitor's ADC / 4 under 36 MHz */
+		CHECK(p->hz > 14200000);
+		CHECK(pclk2 / 4 <= 36000000);
+
+		/* Microsecond timers divide exactly */
+		CHECK(tim1 % STEPPER_TICK_HZ == 0);
+		CHECK(tim1 % CONTROL_TICK_HZ == 0);
+		CHECK(tim1 % BEEP_TICK_HZ == 0);
+		CHECK(tim2 % MONITOR_SCAN_HZ == 0);
+
+		/* SPI2 and SPI3 land close under their limits */
+		CHECK(pclk1 >> (governor_SpiDivider(pclk1, FLASH_SPI_HZ) + 1) <= FLASH_SPI_HZ);
+		CHECK(pclk1 >> governor_SpiDivider(pclk1, FLASH_SPI_HZ) > FLASH_SPI_HZ);
+		CHECK(pclk1 >> (governor_SpiDivider(pclk1, SD_SPI_HZ) + 1) <= SD_SPI_HZ);
+		printf("profile %d: %3u MHz, APB1 %2u MHz, APB2 %2u MHz, flash SCK %u kHz, SD SCK %u kHz\n",
+		       i, p->hz / 1000000, pclk1 / 1000000, pclk2 / 1000000,
+		       (pclk1 >> (governor_SpiDivider(pclk1, FLASH_SPI_HZ) + 1)) / 1000,
+		       (pclk1 >> (governor_SpiDivider(pclk1, SD_SPI_HZ) + 1)) / 1000);
+	}
+	CHECK(governor_profiles[GOVERNOR_COAST].hz == 180000000);
+	CHECK(governor_profiles[GOVERNOR_PAD].hz < governor_profiles[GOVERNOR_COAST].hz);
+}
+
+static void test_flight(void){
+	static const struct {
+		uint32_t	ms;
+		uint8_t		state;
+		int			expect;
+	} steps[] = {
+		{ 0,      COMPANION_STATE_STARTUP, -1 },
+		{ 100,    COMPANION_STATE_PAD,     -1 },
+		{ 3600000, COMPANION_STATE_PAD,    -1 },
+		{ 3600010, COMPANION_STATE_BOOST,  GOVERNOR_COAST },
+		{ 3600020, COMPANION_STATE_BOOST,  -1 },
+		{ 3602000, COMPANION_STATE_FAST,   -1 },
+		{ 3605000, COMPANION_STATE_COAST,  -1 },
+		{ 3620000, COMPANION_STATE_DROGUE, -1 },		/* apogee: wait a while */
+		{ 3621000, COMPANION_STATE_DROGUE, -1 },
+		{ 3622000, COMPANION_STATE_DROGUE, GOVERNOR_PAD },
+		{ 3700000, COMPANION_STATE_LANDED, -1 },
+	};
+	struct governor g;
+	unsigned i;
+	int r;
+
+	governor_Init(&g, GOVERNOR_PAD, 0);
+	for (i = 0; i < sizeof (steps) / sizeof (steps[0]); i++){
+		r = governor_Step(&g, steps[i].state, steps[i].ms);
+		CHECK(r == steps[i].expect);
+		if (r >= 0)
+			g.profile = r;
+	}
+
+	/* One odd frame mid-coast doesn't slow us down, and the hold starts over */
+	governor_Init(&g, GOVERNOR_COAST, 0);
+	CHECK(governor_Step(&g, COMPANION_STATE_COAST, 10) == -1);
+	CHECK(governor_Step(&g, COMPANION_STATE_INVALID, 20) == -1);
+	CHECK(governor_Step(&g, COMPANION_STATE_COAST, 30) == -1);
+	CHECK(governor_Step(&g, COMPANION_STATE_INVALID, 1000) == -1);
+	CHECK(governor_Step(&g, COMPANION_STATE_INVALID, 1000 + GOVERNOR_HOLD_MS - 1) == -1);
+	CHECK(governor_Step(&g, COMPANION_STATE_INVALID, 1000 + GOVERNOR_HOLD_MS) == GOVERNOR_PAD);
+
+	/* A switch the caller couldn't make yet is asked for again */
+	governor_Init(&g, GOVERNOR_PAD, 0);
+	CHECK(governor_Step(&g, COMPANION_STATE_BOOST, 10) == GOVERNOR_COAST);
+	CHECK(governor_Step(&g, COMPANION_STATE_BOOST, 20) == GOVERNOR_COAST);
+}
+
+static void test_arithmetic(void){
+	uint32_t psc, arr;
+
+	CHECK(governor_TimerHz(48000000, 1) == 48000000);
+	CHECK(governor_TimerHz(180000000, 4) == 90000000);
+	CHECK(governor_TimerHz(180000000, 2) == 180000000);
+
+	CHECK(governor_SpiDivider(24000000, 12000000) == 0);
+	CHECK(governor_SpiDivider(45000000, 12000000) == 1);
+	CHECK(governor_SpiDivider(36000000, 400000) == 6);
+	CHECK(governor_SpiDivider(180000000, 1) == 7);
+
+	/* 16 bit reload needs a prescaler past 65.5 ms of ticks */
+	governor_Period(48000000, 2000, &psc, &arr);
+	CHECK(psc == 0 && arr == 23999);
+	governor_Period(180000000, 2000, &psc, &arr);
+	CHECK(psc == 1 && arr == 44999);
+	governor_Period(65536 * 2000, 2000, &psc, &arr);
+	CHECK(psc == 0 && arr == 65535);
+	CHECK((psc + 1) * (arr + 1) == 65536);
+}
+
+int main(void){
+	test_profiles();
+	test_flight();
+	test_arithmetic();
+
+	if (failures){
+		printf("governor_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("governor_test: ok\n");
+	return 0;
+}
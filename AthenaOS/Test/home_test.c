@@ -0,0 +1,192 @@
+/*
+ * home_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Drives home.c and the step planner against a model of the brake: a
+ * shaft that follows each step unless it's up against the retracted
+ * stop, with an optional index flag part way out. Checks homing lands
+ * the count on the shaft from anywhere, and that the index catches and
+ * fixes steps the shaft dropped.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "home.h"
+
+#define TICK_HZ		1000000.0f
+#define MAX_TICKS	0x10000
+#define VMAX		5000.0f
+#define ACCEL		20000.0f
+
+#define STOP		-37		/* shaft position of the hard stop, anywhere will do */
+#define TRAVEL		2000
+#define FLAG		(STOP + 700)	/* index sensor reads 1 at and above this */
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+struct shaft {
+	int32_t		at;
+	int			drop;		/* steps still to lose */
+	int			flag;		/* sensor state */
+	int			index;		/* report edges to home_Edge() */
+};
+
+/* One planner step, as TIM3 would, and the shaft's answer to it */
+static int step(struct motion *m, struct home *h, struct shaft *s){
+	uint32_t ticks;
+	int dir = motion_Next(m, &ticks);
+	int flag;
+
+	if (dir == 0)
+		return 0;
+	if (s->drop)
+		s->drop--;
+	else if (s->at + dir >= STOP)
+		s->at += dir;
+	flag = s->at >= FLAG;
+	if (flag != s->flag && s->index)
+		motion_Shift(m, home_Edge(h, m->position, dir));
+	s->flag = flag;
+	return dir;
+}
+
+static void run(struct motion *m, struct home *h, struct shaft *s){
+	int n;
+
+	for (n = 0; n < 1000000 && step(m, h, s); n++)
+		;
+}
+
+static void home(struct motion *m, struct home *h, struct shaft *s){
+	int n;
+
+	home_Start(h, m);
+	CHECK(h->state == HOME_SEEK);
+	for (n = 0; n < 10 && home_Poll(h, m) != HOME_DONE; n++)
+		run(m, h, s);
+	CHECK(h->state == HOME_DONE);
+}
+
+static void test_home(void){
+	static const int32_t starts[] = { STOP, STOP + 1, STOP + 500, STOP + TRAVEL, STOP + TRAVEL + 300 };
+	static const struct home_config cfg = HOME_CONFIG_DEFAULT;
+	struct motion m;
+	struct home h;
+	struct shaft s;
+	unsigned i;
+
+	for (i = 0; i < sizeof (starts) / sizeof (starts[0]); i++){
+		motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+		home_Init(&h, &cfg);
+		CHECK(h.state == HOME_IDLE);
+
+		/* Wherever the count happened to be, it's forgotten */
+		motion_Retarget(&m, 1234);
+		run(&m, &h, &(struct shaft) { .at = 0 });
+		s = (struct shaft) { .at = starts[i] };
+		home(&m, &h, &s);
+		CHECK(m.position == 0);
+		CHECK(s.at == STOP + cfg.backoff);
+		CHECK(!motion_Busy(&m));
+
+		/* Full speed again afterwards */
+		CHECK(m.vmax2 == VMAX * VMAX);
+		CHECK(m.accel2 == 2 * ACCEL);
+
+		/* The count is absolute from here on */
+		motion_Retarget(&m, TRAVEL);
+		run(&m, &h, &s);
+		CHECK(s.at - m.position == STOP + cfg.backoff);
+	}
+}
+
+static void test_index(void){
+	static const struct home_config cfg = HOME_CONFIG_DEFAULT;
+	struct motion m;
+	struct home h;
+	struct shaft s = { .at = STOP + 900, .index = 1 };
+	int32_t offset;
+
+	motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+	home_Init(&h, &cfg);
+
+	/* Edges while homing mean nothing yet */
+	home(&m, &h, &s);
+	CHECK(h.learned == 0);
+	offset = s.at - m.position;
+
+	/* First pass each way learns where the flag is */
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+	CHECK(h.learned == 3);
+	CHECK(h.edges == 0);
+
+	/* Clean passes agree with it */
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+	CHECK(h.edges == 2);
+	CHECK(h.slips == 0);
+	CHECK(h.error_max == 0);
+
+	/* A few dropped steps are inside tolerance and left alone */
+	s.drop = cfg.tolerance;
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	CHECK(h.slips == 0);
+	CHECK(h.error_last == cfg.tolerance);
+	CHECK(s.at - m.position == offset - cfg.tolerance);
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+
+	/* Home again, then lose 50 steps on the way out: fixed at the flag */
+	home(&m, &h, &s);
+	offset = s.at - m.position;
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+	s.drop = 50;
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	CHECK(h.slips == 1);
+	CHECK(h.error_last == 50);
+	CHECK(h.error_max == 50);
+	CHECK(m.position == TRAVEL);
+	CHECK(s.at - m.position == offset);
+
+	/* Lost short of the flag: fixed on the next crossing */
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+	s.drop = 10;
+	motion_Retarget(&m, 400);
+	run(&m, &h, &s);
+	motion_Retarget(&m, 0);
+	run(&m, &h, &s);
+	CHECK(s.at - m.position == offset - 10);
+	motion_Retarget(&m, TRAVEL);
+	run(&m, &h, &s);
+	CHECK(h.slips == 2);
+	CHECK(h.error_last == 10);
+	CHECK(s.at - m.position == offset);
+}
+
+int main(void){
+	test_home();
+	test_index();
+
+	if (failures){
+		printf("home_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("home_test: ok\n");
+	return 0;
+}
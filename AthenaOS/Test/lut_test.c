@@ -0,0 +1,277 @@
+/*
+ * lut_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Builds a drag table in memory, lets the lookup engine page it
+ * through its RAM windows with reads that land a few lookups late
+ * (like the SPI2 DMA does), and checks the answers against a double
+ * precision bilinear interpolation over the whole table.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "lut.h"
+#include "crc.h"
+
+#define NX		64
+#define NY		200
+#define X0		0
+#define DX		(5 * 16)	/* 5 m/s in 1/16 m/s */
+#define Y0		0
+#define DY		20			/* m */
+#define STRIDE	(NX * 2)
+#define FRAC	12
+
+#define TABLE_ADDR	0x1000
+#define DATA_OFFSET	64
+
+static uint8_t flash[TABLE_ADDR + DATA_OFFSET + NY * STRIDE];
+static int16_t cells[NY][NX];
+
+static struct lut l;
+static int pending;			/* lookups until the read in flight lands */
+static int fetch_delay;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static void header(uint8_t *h){
+	memset(h, 0, LUT_HEADER_SIZE);
+	put32(h + 0, LUT_MAGIC);
+	put16(h + 4, LUT_VERSION);
+	put16(h + 6, LUT_HEADER_SIZE);
+	put32(h + 8, X0);
+	put32(h + 12, DX);
+	put16(h + 16, NX);
+	put16(h + 18, NY);
+	put32(h + 20, Y0);
+	put32(h + 24, DY);
+	put32(h + 28, STRIDE);
+	put32(h + 32, DATA_OFFSET);
+	h[36] = 2;
+	h[37] = FRAC;
+	put32(h + 40, NY * STRIDE);
+}
+
+/* Something drag shaped: transonic bump in speed, falling off with height */
+static void build(void){
+	int i, j;
+
+	header(flash + TABLE_ADDR);
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++){
+			double mach = i * 5.0 / 340.0;
+			double cd = 0.45 + 0.3 * exp(-(mach - 1) * (mach - 1) * 20) - j * 0.0002;
+
+			cells[j][i] = (int16_t) lrint(cd * (1 << FRAC));
+			put16(flash + TABLE_ADDR + DATA_OFFSET + j * STRIDE + i * 2, cells[j][i]);
+		}
+	put32(flash + TABLE_ADDR + 44, crc32(CRC32_INIT, flash + TABLE_ADDR + DATA_OFFSET, NY * STRIDE));
+}
+
+static int table_read(uint32_t addr, uint8_t *buf, uint32_t len){
+	CHECK(addr + len <= sizeof (flash));
+	memcpy(buf, flash + addr, len);
+	return 0;
+}
+
+static int fetch(uint32_t addr, uint8_t *buf, uint32_t len){
+	CHECK(addr + len <= sizeof (flash));
+	memcpy(buf, flash + addr, len);
+	pending = fetch_delay;
+	if (pending == 0)
+		lut_FetchDone(&l);
+	return 0;
+}
+
+/* One control loop iteration: the DMA may land, then the main loop polls */
+static int lookup(int32_t x, int32_t y, int32_t *v){
+	int ret = lut_Lookup(&l, x, y, v);
+
+	if (l.fetching && pending && --pending == 0)
+		lut_FetchDone(&l);
+	lut_Poll(&l);
+	return ret;
+}
+
+static double axis(int32_t v, int32_t v0, int32_t dv, int n, int *i){
+	double f = (double) (v - v0) / dv;
+
+	if (f < 0)
+		f = 0;
+	if (f > n - 1)
+		f = n - 1;
+	*i = (int) f;
+	if (*i > n - 2)
+		*i = n - 2;
+	return f - *i;
+}
+
+static double reference(int32_t x, int32_t y){
+	int i, j;
+	double tx = axis(x, X0, DX, NX, &i);
+	double ty = axis(y, Y0, DY, NY, &j);
+
+	return (cells[j][i] * (1 - tx) + cells[j][i + 1] * tx) * (1 - ty) +
+		(cells[j + 1][i] * (1 - tx) + cells[j + 1][i + 1] * tx) * ty;
+}
+
+static void open_table(int delay){
+	fetch_delay = delay;
+	CHECK(lut_Open(&l, flash + TABLE_ADDR, LUT_HEADER_SIZE, TABLE_ADDR, table_read, fetch) == 0);
+	lut_Poll(&l);
+}
+
+static void test_header(void){
+	uint8_t h[LUT_HEADER_SIZE];
+	struct lut_header p;
+
+	header(h);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == 0);
+	CHECK(p.nx == NX && p.ny == NY && p.dx == DX && p.frac_bits == FRAC);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h) - 1) == -1);
+
+	header(h); h[0] ^= 1;
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put16(h + 4, LUT_VERSION + 1);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put32(h + 12, 0);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put16(h + 18, 1);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put32(h + 28, LUT_WINDOW_BYTES);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put32(h + 40, NY * STRIDE - 1);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+	header(h); put32(h + 32, 8);
+	CHECK(lut_ParseHeader(&p, h, sizeof (h)) == -1);
+}
+
+/* One cell flipped, as a torn upload would leave it: not flown until it's put back */
+static void test_crc(void){
+	uint8_t *cell = flash + TABLE_ADDR + DATA_OFFSET + (NY / 2) * STRIDE + 7;
+	int32_t v;
+
+	open_table(0);
+	*cell ^= 0x10;
+	CHECK(lut_Open(&l, flash + TABLE_ADDR, LUT_HEADER_SIZE, TABLE_ADDR, table_read, fetch) == -1);
+	CHECK(l.rows == 0);
+	CHECK(lut_Lookup(&l, 100 * 16, 1000, &v) == LUT_NONE);
+	lut_Poll(&l);
+	CHECK(!l.fetching);
+
+	*cell ^= 0x10;
+	open_table(0);
+	CHECK(l.rows > 0);
+	CHECK(lut_Lookup(&l, 100 * 16, 0, &v) == LUT_HIT);
+}
+
+static void test_accuracy(void){
+	int32_t x, y, v;
+	double err, worst = 0;
+	int ret;
+
+	/* Whole table through the windows at a crawl, every lookup a hit */
+	open_table(0);
+	for (y = -100; y < NY * DY + 100; y += 7)
+		for (x = -200; x < NX * DX + 200; x += 13){
+			ret = lookup(x, y, &v);
+			if (ret == LUT_APPROX)
+				continue;
+			CHECK(ret == LUT_HIT);
+			err = fabs(v - reference(x, y));
+			if (err > worst)
+				worst = err;
+		}
+	printf("lut: worst error %.3f cells, %u fetches\n", worst, (unsigned) l.fetches);
+	CHECK(worst <= 1.0);
+
+	/* Grid points come back exactly, once the window has followed us back down */
+	lookup(10 * DX, 50 * DY, &v);
+	CHECK(lookup(10 * DX, 50 * DY, &v) == LUT_HIT && v == cells[50][10]);
+}
+
+/* Boost and coast: height climbs, speed falls, reads land late */
+static void test_flight(void){
+	int32_t x, y, v;
+	int n, approx = 0;
+	double t;
+
+	open_table(5);
+	for (n = 0; n < 5; n++)
+		CHECK(lookup(0, 0, &v) == LUT_NONE);
+	CHECK(lookup(0, 0, &v) == LUT_HIT);
+
+	for (n = 0; n < 2000; n++){
+		t = n * 0.01;
+		x = (int32_t) ((260 - 13 * t) * 16);
+		y = (int32_t) (260 * t - 6.5 * t * t);
+		if (lookup(x, y, &v) != LUT_HIT)
+			approx++;
+		else
+			CHECK(fabs(v - reference(x, y)) <= 1.0);
+	}
+	printf("lut: flight %d lookups, %d approximate, %u fetches\n", n, approx, (unsigned) l.fetches);
+	CHECK(approx == 0);
+	CHECK(l.fetches > 1);
+
+	/* A jump to the other end of the table is approximate until the window catches up */
+	CHECK(lookup(0, NY * DY, &v) == LUT_APPROX || l.win_base[l.active] + l.rows >= NY);
+	for (n = 0; n < 10; n++)
+		lookup(0, NY * DY, &v);
+	CHECK(lookup(0, NY * DY, &v) == LUT_HIT);
+	CHECK(v == cells[NY - 1][0]);
+}
+
+static void test_speed(int count){
+	struct timespec t0, t1;
+	int32_t v, sum = 0;
+	double secs;
+	int n;
+
+	open_table(0);
+	lookup(0, 1000, &v);
+	lookup(0, 1000, &v);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (n = 0; n < count; n++){
+		lut_Lookup(&l, (n * 37) & 0x1fff, 1000 + (n & 255), &v);
+		sum += v;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("lut: %d lookups in %.3f s, %.1f ns/lookup (%d)\n", count, secs, secs * 1e9 / count, sum & 1);
+}
+
+int main(void){
+	build();
+
+	test_header();
+	test_crc();
+	test_accuracy();
+	test_flight();
+	test_speed(10000000);
+
+	if (failures){
+		printf("lut_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("lut_test: ok\n");
+	return 0;
+}
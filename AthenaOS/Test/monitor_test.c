@@ -0,0 +1,118 @@
+/*
+ * monitor_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Builds blocks of ADC scans the way the DMA leaves them, from a
+ * battery voltage, die temperature and VDDA, with some noise on each
+ * sample, and checks what monitor_Block makes of them: the averages,
+ * the VDDA correction, temperature from the factory calibration, and
+ * the brown-out flag with its hysteresis.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "monitor.h"
+
+/* Typical part: VREFINT 1.21 V, sensor 0.76 V at 25 C rising 2.5 mV/C */
+#define VREFINT_V	1.21
+#define TS_V(c)		(0.76 + ((c) - 25) * 0.0025)
+
+static const struct monitor_cal cal = {
+	.vrefint = (uint16_t) (VREFINT_V / 3.3 * 4095 + 0.5),
+	.ts30 = (uint16_t) (TS_V(30) / 3.3 * 4095 + 0.5),
+	.ts110 = (uint16_t) (TS_V(110) / 3.3 * 4095 + 0.5),
+};
+
+static struct monitor m;
+static uint16_t block[MONITOR_BLOCK * MONITOR_CHANNELS];
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static uint16_t sample(double v, double vdda){
+	long raw = (long) (v / vdda * 4095 + 0.5) + rand() % 5 - 2;
+
+	if (raw < 0)
+		raw = 0;
+	if (raw > 4095)
+		raw = 4095;
+	return (uint16_t) raw;
+}
+
+static void feed(double battery, double temp, double vdda){
+	int i;
+
+	for (i = 0; i < MONITOR_BLOCK; i++){
+		block[i * MONITOR_CHANNELS + MONITOR_BATTERY] = sample(battery / MONITOR_DIVIDER, vdda);
+		block[i * MONITOR_CHANNELS + MONITOR_TEMP] = sample(TS_V(temp), vdda);
+		block[i * MONITOR_CHANNELS + MONITOR_VREF] = sample(VREFINT_V, vdda);
+	}
+	monitor_Block(&m, block, MONITOR_BLOCK);
+}
+
+static void test_readings(void){
+	static const double vdda[] = { 3.0, 3.3, 3.45 };
+	static const double battery[] = { 3.0, 3.7, 4.2 };
+	static const double temp[] = { -20, 25, 85 };
+	unsigned i, j, k;
+
+	for (i = 0; i < 3; i++)
+		for (j = 0; j < 3; j++)
+			for (k = 0; k < 3; k++){
+				monitor_Init(&m, &cal);
+				feed(battery[j], temp[k], vdda[i]);
+				CHECK(m.blocks == 1);
+				CHECK(abs((int) m.vdda_mv - (int) (vdda[i] * 1000)) < 10);
+				CHECK(abs((int) m.battery_mv - (int) (battery[j] * 1000)) < 25);
+				CHECK(abs(m.temp - (int) (temp[k] * 10)) < 15);
+			}
+
+	/* No calibration: assume 3.3 V and typical sensor numbers */
+	{
+		const struct monitor_cal none = { 0, 0, 0 };
+
+		monitor_Init(&m, &none);
+		feed(3.7, 40, 3.3);
+		CHECK(m.vdda_mv == MONITOR_VDDA_CAL);
+		CHECK(abs((int) m.battery_mv - 3700) < 25);
+		CHECK(abs(m.temp - 400) < 15);
+	}
+}
+
+static void test_brownout(void){
+	monitor_Init(&m, &cal);
+
+	feed(3.9, 25, 3.3);
+	CHECK(!m.low && m.brownouts == 0);
+
+	/* Sag under the stepper: low once, not again until it recovers past the hysteresis */
+	feed(3.2, 25, 3.3);
+	CHECK(m.low && m.brownouts == 1);
+	feed(3.35, 25, 3.3);
+	CHECK(m.low);
+	feed(3.25, 25, 3.3);
+	CHECK(m.brownouts == 1);
+	feed(3.5, 25, 3.3);
+	CHECK(!m.low);
+	feed(3.1, 25, 3.3);
+	CHECK(m.low && m.brownouts == 2);
+	CHECK(abs((int) m.battery_min_mv - 3100) < 25);
+}
+
+int main(void){
+	srand(1);
+
+	test_readings();
+	test_brownout();
+
+	if (failures){
+		printf("monitor_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("monitor_test: ok\n");
+	return 0;
+}
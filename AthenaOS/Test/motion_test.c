@@ -0,0 +1,198 @@
+/*
+ * motion_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs the step planner the way TIM3 does and checks the resulting
+ * step train: lands on target, respects the speed and acceleration
+ * limits, and turns around cleanly when retargeted mid-move.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "motion.h"
+
+#define TICK_HZ		1000000.0f
+#define MAX_TICKS	0x10000
+#define VMAX		5000.0f
+#define ACCEL		20000.0f
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+struct run {
+	int		steps;
+	int		reversals;
+	double	time;		/* seconds */
+	double	vpeak;		/* steps/s */
+	double	apeak;		/* steps/s^2 */
+};
+
+/*
+ * Step until idle or until limit steps, optionally calling hook at
+ * a given step. Speed is measured over each step; acceleration over
+ * windows of WINDOW steps so single tick rounding doesn't swamp it.
+ */
+#define WINDOW	16
+
+static void run(struct motion *m, struct run *r, int limit, int hook_at, void (*hook)(struct motion *)){
+	uint32_t ticks;
+	int dir, last_dir = 0, n = 0;
+	double t, v, wt = 0, wv, last_wv = 0, last_wt = 0;
+
+	*r = (struct run) {0};
+	while (r->steps < limit){
+		if (hook && r->steps == hook_at)
+			hook(m);
+		dir = motion_Next(m, &ticks);
+		if (dir == 0)
+			break;
+		t = ticks / TICK_HZ;
+		v = 1.0 / t;
+		if (v > r->vpeak)
+			r->vpeak = v;
+		if (last_dir && dir != last_dir){
+			r->reversals++;
+			n = 0;
+			wt = 0;
+			last_wt = 0;
+		}
+		last_dir = dir;
+		wt += t;
+		if (++n == WINDOW){
+			wv = WINDOW / wt;
+			if (last_wt > 0){
+				double a = fabs(wv - last_wv) / ((wt + last_wt) / 2);
+				if (a > r->apeak)
+					r->apeak = a;
+			}
+			last_wv = wv;
+			last_wt = wt;
+			wt = 0;
+			n = 0;
+		}
+		r->time += t;
+		r->steps++;
+	}
+}
+
+static double trapezoid_time(double d){
+	double da = VMAX * VMAX / ACCEL;	/* distance to reach vmax and stop again */
+
+	if (d <= da)
+		return 2 * sqrt(d / ACCEL);
+	return 2 * VMAX / ACCEL + (d - da) / VMAX;
+}
+
+static void test_moves(void){
+	static const int32_t moves[] = { 1, 2, 3, 10, 100, 1250, 5000, -3000, 20000 };
+	struct motion m;
+	struct run r;
+	unsigned i;
+
+	for (i = 0; i < sizeof (moves) / sizeof (moves[0]); i++){
+		motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+		motion_Retarget(&m, moves[i]);
+		run(&m, &r, 1000000, -1, NULL);
+		CHECK(m.position == moves[i]);
+		CHECK(r.steps == abs(moves[i]));
+		CHECK(r.reversals == 0);
+		CHECK(!motion_Busy(&m));
+		CHECK(r.vpeak <= VMAX * 1.01);
+		CHECK(r.apeak <= ACCEL * 1.05);
+		/* within a step or two of the ideal trapezoid */
+		if (abs(moves[i]) > 2)
+			CHECK(fabs(r.time - trapezoid_time(abs(moves[i]))) < 2.5 / sqrt(ACCEL * abs(moves[i])) + 2.0 / VMAX);
+		printf("move %6d: %6d steps %.4f s (ideal %.4f) vpeak %.0f apeak %.0f\n",
+		       moves[i], r.steps, r.time, trapezoid_time(abs(moves[i])), r.vpeak, r.apeak);
+	}
+}
+
+static void back_to_zero(struct motion *m){
+	motion_Retarget(m, 0);
+}
+
+static void further(struct motion *m){
+	motion_Retarget(m, 8000);
+}
+
+static void test_retarget(void){
+	struct motion m;
+	struct run r;
+
+	/* Flying out at speed, told to come home: overshoot, stop, reverse */
+	motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+	motion_Retarget(&m, 4000);
+	run(&m, &r, 1000000, 1500, back_to_zero);
+	CHECK(m.position == 0);
+	CHECK(r.reversals == 1);
+	CHECK(r.apeak <= ACCEL * 1.05);
+	CHECK(r.vpeak <= VMAX * 1.01);
+	CHECK(!motion_Busy(&m));
+
+	/* Target pushed further out while decelerating: speed back up, no stop */
+	motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+	motion_Retarget(&m, 2000);
+	run(&m, &r, 1000000, 1800, further);
+	CHECK(m.position == 8000);
+	CHECK(r.reversals == 0);
+	CHECK(r.apeak <= ACCEL * 1.05);
+}
+
+static void test_queue(void){
+	struct motion m;
+	struct run r;
+	int i;
+
+	motion_Init(&m, TICK_HZ, MAX_TICKS, VMAX, ACCEL);
+	CHECK(motion_Queue(&m, 50) == 0);
+	CHECK(motion_Queue(&m, 100) == 0);
+	CHECK(motion_Queue(&m, 50) == 0);
+	CHECK(motion_Queue(&m, 0) == 0);
+	CHECK(motion_Busy(&m));
+
+	run(&m, &r, 1000000, -1, NULL);
+	CHECK(m.position == 0);
+	CHECK(r.steps == 200);
+	CHECK(r.reversals == 1);
+
+	for (i = 0; i < MOTION_QUEUE; i++)
+		CHECK(motion_Queue(&m, i) == 0);
+	CHECK(motion_Queue(&m, 99) == -1);
+
+	/* Retarget throws the queue away */
+	motion_Retarget(&m, -10);
+	run(&m, &r, 1000000, -1, NULL);
+	CHECK(m.position == -10);
+	CHECK(!motion_Busy(&m));
+}
+
+static void test_slow(void){
+	struct motion m;
+	struct run r;
+
+	/* Crawling acceleration must clamp to the 16 bit timer, not wrap */
+	motion_Init(&m, TICK_HZ, MAX_TICKS, 50.0f, 20.0f);
+	motion_Retarget(&m, 20);
+	run(&m, &r, 1000, -1, NULL);
+	CHECK(m.position == 20);
+	CHECK(r.vpeak >= TICK_HZ / MAX_TICKS);
+}
+
+int main(void){
+	test_moves();
+	test_retarget();
+	test_queue();
+	test_slow();
+
+	if (failures){
+		printf("motion_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("motion_test: ok\n");
+	return 0;
+}
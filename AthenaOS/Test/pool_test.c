@@ -0,0 +1,100 @@
+/*
+ * pool_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs Tools/pool.c over ranges big and small and checks every job
+ * number in [0, n) runs exactly once: no jobs at all, one, fewer jobs
+ * than threads, and a range whose first worker's share is all slow
+ * jobs so the others have to steal from it to finish.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pool.h"
+
+#define MAX_JOBS	4096
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+struct jobs {
+	uint32_t	runs[MAX_JOBS];
+	pthread_t	by[MAX_JOBS];
+	uint32_t	slow;			/* jobs below this sleep a while */
+	uint32_t	out_of_range;
+};
+
+static struct jobs jobs;
+
+static void job(void *arg, uint32_t i){
+	struct jobs *j = arg;
+
+	if (i >= MAX_JOBS){
+		__atomic_fetch_add(&j->out_of_range, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (i < j->slow)
+		usleep(2000);
+	j->by[i] = pthread_self();
+	__atomic_fetch_add(&j->runs[i], 1, __ATOMIC_RELAXED);
+}
+
+/* Run n jobs on threads workers; returns how many ran other than once */
+static uint32_t run(unsigned threads, uint32_t n, uint32_t slow){
+	uint32_t i, wrong = 0;
+
+	memset(&jobs, 0, sizeof (jobs));
+	jobs.slow = slow;
+	CHECK(pool_run(threads, n, job, &jobs) == 0);
+	for (i = 0; i < MAX_JOBS; i++)
+		if (jobs.runs[i] != (i < n))
+			wrong++;
+	CHECK(jobs.out_of_range == 0);
+	return wrong;
+}
+
+static void test_sizes(void){
+	CHECK(pool_cores() >= 1);
+	CHECK(run(4, 0, 0) == 0);
+	CHECK(run(4, 1, 0) == 0);
+	CHECK(run(1, 1, 0) == 0);
+	CHECK(run(16, 3, 0) == 0);
+	CHECK(run(0, 100, 0) == 0);
+	CHECK(run(3, MAX_JOBS, 0) == 0);
+	CHECK(run(7, 1000, 0) == 0);
+}
+
+/*
+ * The calling thread is worker 0 and starts with the bottom quarter;
+ * make all of that slow and the rest instant. Unless someone steals,
+ * it runs every slow job itself.
+ */
+static void test_steal(void){
+	pthread_t self = pthread_self();
+	uint32_t i, stolen = 0, n = 64;
+
+	CHECK(run(4, n, n / 4) == 0);
+	for (i = 0; i < n / 4; i++)
+		stolen += !pthread_equal(jobs.by[i], self);
+	printf("pool: %u of %u slow jobs stolen from the first worker\n", stolen, n / 4);
+	CHECK(stolen > 0);
+}
+
+int main(void){
+	test_sizes();
+	test_steal();
+
+	if (failures){
+		printf("pool_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("pool_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * predict_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Benchmarks the apogee predictor against a double precision RK4
+ * reference at a 0.1 ms step, over a spread of coast states with a
+ * drag curve that has a transonic bump in it. Prints the worst error
+ * and the Cd evaluations per prediction for each method and step, and
+ * the host time per prediction; the evaluation count is what scales
+ * to the target, each one being a table lookup plus an expf.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "predict.h"
+
+#define REF_DT		1e-4
+
+static int failures;
+static unsigned evals;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static double cd_curve(double speed){
+	double mach = speed / 340.0;
+
+	return 0.45 + 0.3 * exp(-(mach - 1) * (mach - 1) * 20);
+}
+
+static float cd(void *arg, float speed, float height){
+	(void) arg;
+	(void) height;
+	evals++;
+	return (float) cd_curve(speed);
+}
+
+static const struct predict_model model = {
+	.mass = 20.0f,
+	.area = 0.0182f,
+	.brake_cda = 0.012f,
+	.rho0 = 1.05f,
+	.cd = cd,
+};
+
+static double accel(double h, double v, double extension){
+	double rho = model.rho0 * exp(-h / PREDICT_H_RHO);
+	double k = 0.5 * rho * (cd_curve(v) * model.area + extension * model.brake_cda) / model.mass;
+
+	return -PREDICT_G - k * v * fabs(v);
+}
+
+/* Fine RK4 until v crosses zero, then back up to the crossing */
+static double reference(double h, double v, double extension){
+	double a1, a2, a3, a4, v2, v3, v4, nh, nv;
+
+	for (;;){
+		a1 = accel(h, v, extension);
+		v2 = v + a1 * REF_DT / 2;
+		a2 = accel(h + v * REF_DT / 2, v2, extension);
+		v3 = v + a2 * REF_DT / 2;
+		a3 = accel(h + v2 * REF_DT / 2, v3, extension);
+		v4 = v + a3 * REF_DT;
+		a4 = accel(h + v3 * REF_DT, v4, extension);
+		nh = h + (v + 2 * v2 + 2 * v3 + v4) * REF_DT / 6;
+		nv = v + (a1 + 2 * a2 + 2 * a3 + a4) * REF_DT / 6;
+		if (nv <= 0)
+			return h + v * v / (2 * (v - nv) / REF_DT);
+		h = nh;
+		v = nv;
+	}
+}
+
+struct coast {
+	double	h, v, extension;
+	double	apogee;
+};
+
+static struct coast coasts[64];
+static int ncoasts;
+
+static void make_coasts(void){
+	static const double heights[] = { 300, 900, 1500, 2500 };
+	static const double speeds[] = { 40, 150, 280, 340, 420 };
+	static const double extensions[] = { 0, 0.5, 1 };
+	unsigned i, j, k;
+
+	for (i = 0; i < sizeof (heights) / sizeof (heights[0]); i++)
+		for (j = 0; j < sizeof (speeds) / sizeof (speeds[0]); j++)
+			for (k = 0; k < sizeof (extensions) / sizeof (extensions[0]); k++){
+				struct coast *c = &coasts[ncoasts++];
+
+				c->h = heights[i];
+				c->v = speeds[j];
+				c->extension = extensions[k];
+				c->apogee = reference(c->h, c->v, c->extension);
+			}
+}
+
+/* Worst error over all the coasts, and Cd evaluations per prediction */
+static double worst(uint8_t method, float dt, double *per){
+	double err, w = 0;
+	int n;
+
+	evals = 0;
+	for (n = 0; n < ncoasts; n++){
+		err = fabs(predict_Apogee(&model, method, dt, coasts[n].h, coasts[n].v, coasts[n].extension) -
+			   coasts[n].apogee);
+		if (err > w)
+			w = err;
+	}
+	*per = (double) evals / ncoasts;
+	return w;
+}
+
+static void test_accuracy(void){
+	static const float steps[] = { 0.05f, 0.1f, 0.25f, 0.5f, 1.0f };
+	static const char *const names[] = { "closed", "rk2", "rk4" };
+	double err[3][5], per[3][5];
+	unsigned m, i;
+
+	printf("predict: worst error, m (Cd evaluations)\n");
+	printf("predict: %6s", "dt");
+	for (m = 0; m < 3; m++)
+		printf(" %16s", names[m]);
+	printf("\n");
+	for (i = 0; i < sizeof (steps) / sizeof (steps[0]); i++){
+		printf("predict: %6.2f", steps[i]);
+		for (m = 0; m < 3; m++){
+			err[m][i] = worst(m, steps[i], &per[m][i]);
+			printf(" %9.2f (%4.0f)", err[m][i], per[m][i]);
+		}
+		printf("\n");
+	}
+
+	/* What control.c runs by default, and the cheaper fallback */
+	CHECK(err[PREDICT_RK4][3] < 1.0);
+	CHECK(err[PREDICT_RK2][2] < 3.0);
+	/* and the integrators do better than the closed form through the bump */
+	CHECK(err[PREDICT_RK4][3] < err[PREDICT_CLOSED][3]);
+	CHECK(per[PREDICT_RK4][3] < 4 * 40);
+
+	/* Nothing left to climb */
+	CHECK(predict_Apogee(&model, PREDICT_RK4, 0.5f, 1000, 0, 0) == 1000);
+	CHECK(predict_Apogee(&model, PREDICT_RK4, 0.5f, 1000, -20, 0) == 1000);
+	/* Brakes out never predicts higher */
+	CHECK(predict_Apogee(&model, PREDICT_RK4, 0.5f, 900, 280, 1) <
+	      predict_Apogee(&model, PREDICT_RK4, 0.5f, 900, 280, 0));
+}
+
+static void test_speed(uint8_t method, float dt, int count){
+	struct timespec t0, t1;
+	double secs;
+	float sum = 0;
+	int n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (n = 0; n < count; n++)
+		sum += predict_Apogee(&model, method, dt, 900 + (n & 255), 280 - (n & 127), 0.5f);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("predict: method %u dt %.2f: %.1f ns/prediction (%d)\n",
+	       method, dt, secs * 1e9 / count, (int) sum & 1);
+}
+
+int main(void){
+	make_coasts();
+
+	test_accuracy();
+	test_speed(PREDICT_RK4, 0.5f, 100000);
+	test_speed(PREDICT_RK2, 0.25f, 100000);
+	test_speed(PREDICT_CLOSED, 0.5f, 1000000);
+
+	if (failures){
+		printf("predict_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("predict_test: ok\n");
+	return 0;
+}
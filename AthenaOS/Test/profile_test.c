@@ -0,0 +1,123 @@
+/*
+ * profile_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Checks the per-probe statistics and histogram bins against known
+ * inputs, that a reset requested from outside takes effect on the
+ * next add and not before, and the UPLOAD_PROFILE payload round trip.
+ * Also times profile_Add, which sits in every interrupt it measures.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+
+static struct profile prof;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static double now(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void test_stats(void){
+	struct profile_probe *p = &prof.probe[PROFILE_CONTROL];
+	struct profile_probe copy;
+	uint32_t total = 0;
+	int i;
+
+	profile_Init(&prof);
+	profile_Read(p, &copy);
+	CHECK(copy.count == 0 && copy.max == 0);
+
+	/* Bin n holds 2^(n-1) .. 2^n - 1 */
+	profile_Add(p, 0);
+	profile_Add(p, 1);
+	profile_Add(p, 2);
+	profile_Add(p, 3);
+	profile_Add(p, 4);
+	profile_Add(p, 1023);
+	profile_Add(p, 1024);
+	profile_Add(p, UINT32_MAX);
+	CHECK(p->hist[0] == 1 && p->hist[1] == 1 && p->hist[2] == 2 && p->hist[3] == 1);
+	CHECK(p->hist[10] == 1 && p->hist[11] == 1 && p->hist[PROFILE_BINS - 1] == 1);
+	CHECK(p->count == 8 && p->min == 0 && p->max == UINT32_MAX);
+	CHECK(p->sum == 0 + 1 + 2 + 3 + 4 + 1023 + 1024 + (uint64_t) UINT32_MAX);
+	for (i = 0; i < PROFILE_BINS; i++)
+		total += p->hist[i];
+	CHECK(total == p->count);
+
+	/* Reset is the writer's job: still there until the next add */
+	p->reset = 1;
+	CHECK(p->count == 8);
+	profile_Read(p, &copy);
+	CHECK(copy.count == 0);
+	profile_Add(p, 500);
+	CHECK(p->reset == 0 && p->count == 1 && p->min == 500 && p->max == 500 && p->hist[9] == 1);
+}
+
+static void test_encode(void){
+	struct profile_probe *p = &prof.probe[PROFILE_LATENCY];
+	struct profile_probe d;
+	uint8_t buf[PROFILE_SIZE];
+	char name[PROFILE_NAME + 1];
+	uint32_t hz;
+	uint8_t id;
+	int i;
+
+	profile_Init(&prof);
+	for (i = 0; i < 100000; i++)
+		profile_Add(p, 7200 + (i % 1000) * 97);
+
+	CHECK(profile_Encode(buf, PROFILE_LATENCY, 72000000, p) == PROFILE_SIZE);
+	CHECK(profile_Decode(buf, PROFILE_SIZE - 1, &id, &hz, name, &d) == -1);
+	CHECK(profile_Decode(buf, PROFILE_SIZE, &id, &hz, name, &d) == 0);
+	CHECK(id == PROFILE_LATENCY && hz == 72000000 && strcmp(name, "latency") == 0);
+	CHECK(d.count == p->count && d.min == p->min && d.max == p->max && d.sum == p->sum);
+	CHECK(d.sum > UINT32_MAX);
+	CHECK(memcmp(d.hist, p->hist, sizeof (d.hist)) == 0);
+
+	/* An empty probe goes out with min 0 rather than UINT32_MAX */
+	profile_Encode(buf, PROFILE_STEPPER, 72000000, &prof.probe[PROFILE_STEPPER]);
+	profile_Decode(buf, PROFILE_SIZE, &id, &hz, name, &d);
+	CHECK(d.count == 0 && d.min == 0);
+}
+
+static void bench(void){
+	struct profile_probe *p = &prof.probe[PROFILE_STEPPER];
+	uint32_t i, n = 10000000, x = 1;
+	double t0, t;
+
+	profile_Init(&prof);
+	t0 = now();
+	for (i = 0; i < n; i++){
+		x = x * 1103515245 + 12345;
+		profile_Add(p, x >> 16);
+	}
+	t = now() - t0;
+	printf("profile: %u adds in %.3f s, %.1f ns/add\n", (unsigned) n, t, t / n * 1e9);
+	CHECK(p->count == n);
+}
+
+int main(void){
+	test_stats();
+	test_encode();
+	bench();
+
+	if (failures){
+		printf("profile_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("profile_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * recorder_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs the flight recorder against a RAM flash that behaves like NOR,
+ * with page writes that take a few main loop passes to complete the
+ * way a page program does. Checks that every record staged comes back
+ * off the flash in order, that a stalled flash costs records rather
+ * than blocking, and that the boot scan finds the end of the log.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "recorder.h"
+
+#define START		0x1000
+#define PAGES		64
+#define END			(START + PAGES * RECORDER_PAGE_SIZE)
+
+static uint8_t flash[END + RECORDER_PAGE_SIZE];
+static struct recorder r;
+
+static const uint8_t *pending;
+static uint32_t pending_addr;
+static int write_delay, busy;
+static int stalled;
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static int ram_write(uint32_t addr, const uint8_t *data, uint32_t len){
+	CHECK(len == RECORDER_PAGE_SIZE && addr % RECORDER_PAGE_SIZE == 0);
+	CHECK(addr >= START && addr + len <= END);
+	if (stalled || pending)
+		return -1;
+	pending = data;
+	pending_addr = addr;
+	busy = write_delay;
+	return 0;
+}
+
+static int ram_read(uint32_t addr, uint8_t *data, uint32_t len){
+	memcpy(data, flash + addr, len);
+	return 0;
+}
+
+/* One main loop pass: the page in flight may finish, then the recorder polls */
+static void poll(void){
+	uint32_t i;
+
+	if (pending && busy-- == 0){
+		for (i = 0; i < RECORDER_PAGE_SIZE; i++)
+			flash[pending_addr + i] &= pending[i];
+		pending = NULL;
+		recorder_WriteDone(&r);
+	}
+	recorder_Poll(&r);
+}
+
+static void control(uint32_t n, struct recorder_control *c){
+	memset(c, 0, sizeof (*c));
+	c->tick = 1000 + n * 10;
+	c->flight_state = 5;
+	c->mode = n & 3;
+	c->companion_tick = (uint16_t) n;
+	c->height = (int16_t) (n * 3);
+	c->speed = (int16_t) (4000 - n);
+	c->accel = -160;
+	c->cd = 0.4567f;
+	c->predicted = 3100.4f - n;
+	c->commanded = (int32_t) n;
+	c->position = (int32_t) n - 7;
+	c->exec = 180;
+	c->period = 10000;
+	c->overruns = n >> 8;
+	c->drops = 0;
+}
+
+static void add(uint32_t n){
+	struct recorder_control c;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	control(n, &c);
+	recorder_EncodeControl(rec, &c);
+	recorder_Add(&r, rec);
+}
+
+static void test_format(void){
+	struct recorder_boot b = { .tick = 1234, .method = 2, .lut_crc = 0xdeadbeef, .target = 3048,
+				   .brake_steps = 2000, .kp = 0.004f, .ki = 0.002f, .dt = 500 }, b2;
+	struct recorder_control c, c2;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	recorder_EncodeBoot(rec, &b);
+	CHECK(recorder_Check(rec) == RECORDER_BOOT);
+	recorder_DecodeBoot(rec, &b2);
+	CHECK(b2.tick == b.tick && b2.method == b.method && b2.lut_crc == b.lut_crc);
+	CHECK(b2.target == b.target && b2.brake_steps == b.brake_steps && b2.dt == b.dt);
+	CHECK(b2.kp == b.kp && b2.ki == b.ki);
+
+	control(77, &c);
+	recorder_EncodeControl(rec, &c);
+	CHECK(recorder_Check(rec) == RECORDER_CONTROL);
+	recorder_DecodeControl(rec, &c2);
+	CHECK(c2.tick == c.tick && c2.flight_state == c.flight_state && c2.mode == c.mode);
+	CHECK(c2.height == c.height && c2.speed == c.speed && c2.accel == c.accel);
+	CHECK(fabsf(c2.cd - c.cd) < 0.0001f && fabsf(c2.predicted - c.predicted) <= 0.5f);
+	CHECK(c2.commanded == c.commanded && c2.position == c.position);
+	CHECK(c2.exec == c.exec && c2.period == c.period);
+
+	/* Out of range values saturate rather than wrap */
+	c.predicted = 1e6f;
+	c.period = 100000;
+	c.cd = -1;
+	recorder_EncodeControl(rec, &c);
+	recorder_DecodeControl(rec, &c2);
+	CHECK(c2.predicted == 32767 && c2.period == 0xffff && c2.cd == 0);
+
+	/* HIL ticks carry raw cycle counts, which mustn't lose their top bits */
+	{
+		struct recorder_hil h = { .tick = 99, .mode = 1, .flags = RECORDER_HIL_FRAME, .companion_tick = 4321,
+					  .height = -12, .speed = 280 * 16, .commanded = 1500, .position = -3,
+					  .frame_cycles = 0xfffffff0, .start_cycles = 0x80000001, .done_cycles = 12345,
+					  .mhz = 180 }, h2;
+
+		recorder_EncodeHil(rec, &h);
+		CHECK(recorder_Check(rec) == RECORDER_HIL);
+		recorder_DecodeHil(rec, &h2);
+		CHECK(h2.tick == h.tick && h2.mode == h.mode && h2.flags == h.flags);
+		CHECK(h2.companion_tick == h.companion_tick && h2.height == h.height && h2.speed == h.speed);
+		CHECK(h2.commanded == h.commanded && h2.position == h.position && h2.mhz == h.mhz);
+		CHECK(h2.frame_cycles == h.frame_cycles && h2.start_cycles == h.start_cycles);
+		CHECK(h2.done_cycles == h.done_cycles);
+	}
+
+	/* A flipped bit fails the checksum; erased flash is empty */
+	rec[9] ^= 0x10;
+	CHECK(recorder_Check(rec) == RECORDER_BAD);
+	memset(rec, 0xff, sizeof (rec));
+	CHECK(recorder_Check(rec) == RECORDER_EMPTY);
+}
+
+/* Every good record in the log, in order: returns how many matched n0, n0 + 1, ... */
+static uint32_t verify(uint32_t start, uint32_t n0){
+	struct recorder_control c, want;
+	uint32_t addr, n = n0;
+	int i, type;
+
+	for (addr = start; addr < END; addr += RECORDER_PAGE_SIZE)
+		for (i = 0; i < RECORDER_PER_PAGE; i++){
+			const uint8_t *rec = flash + addr + i * RECORDER_RECORD_SIZE;
+
+			type = recorder_Check(rec);
+			if (type == RECORDER_EMPTY)
+				continue;
+			CHECK(type == RECORDER_CONTROL);
+			if (type != RECORDER_CONTROL)
+				return n - n0;
+			recorder_DecodeControl(rec, &c);
+			control(n, &want);
+			if (c.tick != want.tick || c.commanded != want.commanded)
+				return n - n0;
+			n++;
+		}
+	return n - n0;
+}
+
+static void test_stream(void){
+	uint32_t n;
+
+	memset(flash, 0xff, sizeof (flash));
+	recorder_Init(&r, START, END, ram_write);
+	write_delay = 3;
+
+	/* A control tick for every two main loop passes */
+	for (n = 0; n < 300; n++){
+		add(n);
+		poll();
+		poll();
+	}
+	recorder_Pad(&r);
+	for (n = 0; n < 20; n++)
+		poll();
+	CHECK(r.drops == 0);
+	CHECK(r.records == 300);
+	CHECK(r.pages == (300 + RECORDER_PER_PAGE - 1) / RECORDER_PER_PAGE);
+	CHECK(verify(START, 0) == 300);
+	CHECK(recorder_FindEnd(START, END, ram_read) == START + r.pages * RECORDER_PAGE_SIZE);
+}
+
+static void test_stall(void){
+	uint32_t n, kept;
+
+	memset(flash, 0xff, sizeof (flash));
+	recorder_Init(&r, START, END, ram_write);
+	write_delay = 0;
+
+	/* Flash wedged: the ring fills, then records are dropped, never waited on */
+	stalled = 1;
+	for (n = 0; n < 200; n++){
+		add(n);
+		poll();
+	}
+	kept = r.records;
+	CHECK(kept == RECORDER_PAGES * RECORDER_PER_PAGE);
+	CHECK(r.drops == 200 - kept);
+
+	/* Comes back: what was kept goes out in order */
+	stalled = 0;
+	for (n = 0; n < 20; n++)
+		poll();
+	recorder_Pad(&r);
+	for (n = 0; n < 5; n++)
+		poll();
+	CHECK(verify(START, 0) == kept);
+	CHECK(r.tail == r.head);
+}
+
+static void test_full(void){
+	uint32_t n;
+
+	memset(flash, 0xff, sizeof (flash));
+	recorder_Init(&r, END - 2 * RECORDER_PAGE_SIZE, END, ram_write);
+	write_delay = 0;
+	for (n = 0; n < 5 * RECORDER_PER_PAGE; n++){
+		add(n);
+		poll();
+	}
+	poll();
+	CHECK(r.pages == 2);
+	CHECK(r.lost == 3);
+	CHECK(recorder_FindEnd(END - 2 * RECORDER_PAGE_SIZE, END, ram_read) == END);
+}
+
+static void test_find_end(void){
+	uint32_t k;
+
+	for (k = 0; k <= PAGES; k++){
+		memset(flash, 0xff, sizeof (flash));
+		memset(flash + START, 0x00, k * RECORDER_PAGE_SIZE);
+		CHECK(recorder_FindEnd(START, END, ram_read) == START + k * RECORDER_PAGE_SIZE);
+	}
+
+	/* Torn last page, one byte programmed, counts as used */
+	memset(flash, 0xff, sizeof (flash));
+	memset(flash + START, 0x00, 10 * RECORDER_PAGE_SIZE);
+	flash[START + 10 * RECORDER_PAGE_SIZE + 200] = 0x7f;
+	CHECK(recorder_FindEnd(START, END, ram_read) == START + 11 * RECORDER_PAGE_SIZE);
+
+	/* Reboot mid-log: new records carry on after the old ones */
+	memset(flash, 0xff, sizeof (flash));
+	recorder_Init(&r, START, END, ram_write);
+	write_delay = 1;
+	for (k = 0; k < 5 * RECORDER_PER_PAGE; k++){
+		add(k);
+		poll();
+	}
+	for (k = 0; k < 10; k++)
+		poll();
+	recorder_Init(&r, recorder_FindEnd(START, END, ram_read), END, ram_write);
+	CHECK(r.addr == START + 5 * RECORDER_PAGE_SIZE);
+	for (k = 5 * RECORDER_PER_PAGE; k < 9 * RECORDER_PER_PAGE; k++){
+		add(k);
+		poll();
+	}
+	for (k = 0; k < 10; k++)
+		poll();
+	CHECK(verify(START, 0) == 9 * RECORDER_PER_PAGE);
+}
+
+int main(void){
+	test_format();
+	test_stream();
+	test_stall();
+	test_full();
+	test_find_end();
+
+	if (failures){
+		printf("recorder_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("recorder_test: ok\n");
+	return 0;
+}
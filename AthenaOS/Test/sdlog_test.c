@@ -0,0 +1,457 @@
+/*
+ * sdlog_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Formats RAM disks the way a card comes from the shop (FAT32 behind
+ * an MBR) and the way a small one might (unpartitioned FAT16), then
+ * has fat.c create log files on them: checks the directory entry, that
+ * the clusters are one chain in every FAT, that the run steps around
+ * clusters already in use, and the ways it can fail. Then runs the SD
+ * log ring into a created file through a card that takes a block every
+ * few polls, and reads the log back the way a host would, with the
+ * last boot's log still in the clusters past it.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fat.h"
+#include "sdlog.h"
+
+#define FAT32_PART		2048
+#define FAT32_SECTORS	81920			/* 40 MB, enough clusters to be FAT32 */
+#define FAT32_FATSZ		640
+#define FAT16_SECTORS	8192
+#define FAT16_FATSZ		32
+#define FAT16_ROOT		512
+
+static uint8_t *image;
+static uint32_t image_sectors;
+static uint32_t reads, writes;
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static uint16_t get16(const uint8_t *p){
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v & 0xffff);
+	put16(p + 2, v >> 16);
+}
+
+static uint8_t *sector(uint32_t lba){
+	return image + (size_t) lba * FAT_SECTOR_SIZE;
+}
+
+static int ram_read(uint32_t lba, uint8_t *data){
+	if (lba >= image_sectors)
+		return -1;
+	memcpy(data, sector(lba), FAT_SECTOR_SIZE);
+	reads++;
+	return 0;
+}
+
+static int ram_write(uint32_t lba, const uint8_t *data){
+	if (lba >= image_sectors)
+		return -1;
+	memcpy(sector(lba), data, FAT_SECTOR_SIZE);
+	writes++;
+	return 0;
+}
+
+static void new_image(uint32_t sectors){
+	free(image);
+	image_sectors = sectors;
+	image = calloc(sectors, FAT_SECTOR_SIZE);
+}
+
+/* Like mkfs.vfat: one sector clusters, two FATs, root directory in cluster 2 */
+static void format_fat32(void){
+	uint8_t *mbr, *b, *fsinfo;
+	uint32_t fat, i;
+
+	new_image(FAT32_PART + FAT32_SECTORS);
+	mbr = sector(0);
+	mbr[0x1be + 4] = 0x0c;
+	put32(mbr + 0x1be + 8, FAT32_PART);
+	put32(mbr + 0x1be + 12, FAT32_SECTORS);
+	put16(mbr + 510, 0xaa55);
+
+	b = sector(FAT32_PART);
+	b[0] = 0xeb;
+	b[1] = 0x58;
+	b[2] = 0x90;
+	put16(b + 11, FAT_SECTOR_SIZE);
+	b[13] = 1;
+	put16(b + 14, 32);
+	b[16] = 2;
+	b[21] = 0xf8;
+	put32(b + 32, FAT32_SECTORS);
+	put32(b + 36, FAT32_FATSZ);
+	put32(b + 44, 2);
+	put16(b + 48, 1);
+	put16(b + 510, 0xaa55);
+
+	fsinfo = sector(FAT32_PART + 1);
+	put32(fsinfo, 0x41615252);
+	put32(fsinfo + 484, 0x61417272);
+	put32(fsinfo + 488, 12345);
+	put32(fsinfo + 492, 3);
+	put32(fsinfo + 508, 0xaa550000);
+
+	for (i = 0; i < 2; i++){
+		fat = FAT32_PART + 32 + i * FAT32_FATSZ;
+		put32(sector(fat), 0x0ffffff8);
+		put32(sector(fat) + 4, 0x0fffffff);
+		put32(sector(fat) + 8, 0x0fffffff);
+	}
+}
+
+/* No partition table, fixed root directory */
+static void format_fat16(void){
+	uint8_t *b;
+	uint32_t i;
+
+	new_image(FAT16_SECTORS);
+	b = sector(0);
+	b[0] = 0xeb;
+	b[1] = 0x3c;
+	b[2] = 0x90;
+	put16(b + 11, FAT_SECTOR_SIZE);
+	b[13] = 1;
+	put16(b + 14, 1);
+	b[16] = 2;
+	put16(b + 17, FAT16_ROOT);
+	put16(b + 19, FAT16_SECTORS);
+	b[21] = 0xf8;
+	put16(b + 22, FAT16_FATSZ);
+	put16(b + 510, 0xaa55);
+
+	for (i = 0; i < 2; i++){
+		put16(sector(1 + i * FAT16_FATSZ), 0xfff8);
+		put16(sector(1 + i * FAT16_FATSZ) + 2, 0xffff);
+	}
+}
+
+static uint32_t entry(const struct fat *f, int copy, uint32_t c){
+	const uint8_t *p = sector(f->fat_start + copy * f->sectors_per_fat);
+
+	return f->fat32 ? get32(p + c * 4) & 0x0fffffff : get16(p + c * 2);
+}
+
+static void set_entry(const struct fat *f, uint32_t c, uint32_t v){
+	int i;
+
+	for (i = 0; i < f->number_fat; i++){
+		uint8_t *p = sector(f->fat_start + i * f->sectors_per_fat);
+
+		if (f->fat32)
+			put32(p + c * 4, v);
+		else
+			put16(p + c * 2, (uint16_t) v);
+	}
+}
+
+/* The root directory entry called name, or NULL */
+static const uint8_t *find(const struct fat *f, const char *name){
+	uint32_t lba = f->fat32 ? f->data_start + (f->root_cluster - 2) * f->sectors_per_cluster : f->root_start;
+	uint32_t i;
+
+	for (i = 0; i < FAT16_ROOT; i++){
+		const uint8_t *d = sector(lba) + i * FAT_DIRENT_SIZE;
+
+		if (d[0] == 0)
+			return NULL;
+		if (memcmp(d, name, 11) == 0)
+			return d;
+	}
+	return NULL;
+}
+
+/* Walk the chain from the directory entry: contiguous, the right length, the same in each FAT */
+static uint32_t check_file(const struct fat *f, const char *name, uint32_t size, uint32_t lba){
+	const uint8_t *d = find(f, name);
+	uint32_t first, c, n = 1, last = f->fat32 ? 0x0ffffff8 : 0xfff8;
+	uint32_t need = (size + FAT_SECTOR_SIZE * f->sectors_per_cluster - 1) / (FAT_SECTOR_SIZE * f->sectors_per_cluster);
+
+	CHECK(d != NULL);
+	if (!d)
+		return 0;
+	first = ((uint32_t) get16(d + 20) << 16) | get16(d + 26);
+	CHECK(get32(d + 28) == size);
+	CHECK(d[11] == 0x20);
+	CHECK(lba == f->data_start + (first - 2) * f->sectors_per_cluster);
+	for (c = first; entry(f, 0, c) < last; c++, n++){
+		CHECK(entry(f, 0, c) == c + 1);
+		CHECK(entry(f, 1, c) == entry(f, 0, c));
+		if (n > need)
+			break;
+	}
+	CHECK(entry(f, 1, c) == entry(f, 0, c));
+	CHECK(n == need);
+	return first;
+}
+
+static void test_fat32(void){
+	struct fat f;
+	char name[11];
+	uint32_t lba, first, size = 1000 * FAT_SECTOR_SIZE - 17;
+	uint8_t *d;
+
+	format_fat32();
+	CHECK(fat_Mount(&f, ram_read, ram_write) == FAT_OK);
+	CHECK(f.fat32);
+	CHECK(f.fat_start == FAT32_PART + 32);
+	CHECK(f.data_start == FAT32_PART + 32 + 2 * FAT32_FATSZ);
+	CHECK(f.fsinfo == FAT32_PART + 1);
+	CHECK(fat_NextNumber(&f, SDLOG_PREFIX, SDLOG_EXT) == 0);
+
+	/* Someone's files: a long name, a deleted one, and clusters in use at 10 and 500 */
+	d = sector(f.data_start);
+	memcpy(d, "A\0B\0C\0D\0E\0\x0f", 12);
+	memcpy(d + 32, "ATHN0007LOG", 11);
+	d[32] = 0xe5;
+	memcpy(d + 64, "ATHN0003LOG", 11);
+	memcpy(d + 96, "ATHNTEMPLOG", 11);
+	memcpy(d + 128, "ATHN0005TXT", 11);
+	set_entry(&f, 10, 0x0fffffff);
+	set_entry(&f, 500, 0x0fffffff);
+	f.cached = FAT_NONE;
+
+	CHECK(fat_NextNumber(&f, SDLOG_PREFIX, SDLOG_EXT) == 4);
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, 4);
+	CHECK(memcmp(name, "ATHN0004LOG", 11) == 0);
+
+	/* 1000 clusters don't fit below 500, so the run starts after it */
+	CHECK(fat_Create(&f, name, size, &lba) == FAT_OK);
+	first = check_file(&f, name, size, lba);
+	CHECK(first == 501);
+	CHECK(entry(&f, 0, 11) == 0 && entry(&f, 0, 499) == 0);
+
+	/* Into the deleted entry's slot */
+	CHECK(memcmp(d + 32, name, 11) == 0);
+	CHECK(get32(sector(f.fsinfo) + 488) == 0xffffffff);
+	CHECK(get32(sector(f.fsinfo) + 492) == 1501);
+
+	/* A small one fits in the first gap, after the root directory */
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, fat_NextNumber(&f, SDLOG_PREFIX, SDLOG_EXT));
+	CHECK(memcmp(name, "ATHN0005LOG", 11) == 0);
+	CHECK(fat_Create(&f, name, 7 * FAT_SECTOR_SIZE, &lba) == FAT_OK);
+	CHECK(check_file(&f, name, 7 * FAT_SECTOR_SIZE, lba) == 3);
+
+	CHECK(fat_Create(&f, name, 1, &lba) == FAT_EXISTS);
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, 6);
+	CHECK(fat_Create(&f, name, f.clusters * FAT_SECTOR_SIZE, &lba) == FAT_FULL);
+	CHECK(find(&f, name) == NULL);
+
+	/* The same again, written to and read back from the card */
+	CHECK(fat_Mount(&f, ram_read, ram_write) == FAT_OK);
+	CHECK(fat_NextNumber(&f, SDLOG_PREFIX, SDLOG_EXT) == 6);
+}
+
+static void test_fat16(void){
+	struct fat f;
+	char name[11];
+	uint32_t lba, i;
+
+	format_fat16();
+	CHECK(fat_Mount(&f, ram_read, ram_write) == FAT_OK);
+	CHECK(!f.fat32);
+	CHECK(f.root_start == 1 + 2 * FAT16_FATSZ);
+	CHECK(f.data_start == f.root_start + FAT16_ROOT * FAT_DIRENT_SIZE / FAT_SECTOR_SIZE);
+	CHECK(f.fsinfo == 0);
+
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, 0);
+	CHECK(fat_Create(&f, name, 3000 * FAT_SECTOR_SIZE, &lba) == FAT_OK);
+	CHECK(check_file(&f, name, 3000 * FAT_SECTOR_SIZE, lba) == 2);
+
+	/* The fixed root directory fills up; nothing gets allocated for the one that didn't fit */
+	for (i = 1; i < FAT16_ROOT; i++){
+		fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, (int) i);
+		CHECK(fat_Create(&f, name, 0, &lba) == FAT_OK);
+	}
+	CHECK(fat_NextNumber(&f, SDLOG_PREFIX, SDLOG_EXT) == FAT16_ROOT);
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, FAT16_ROOT);
+	CHECK(fat_Create(&f, name, FAT_SECTOR_SIZE, &lba) == FAT_DIR_FULL);
+	CHECK(entry(&f, 0, 3002) == 0);
+
+	/* Not a filesystem */
+	memset(sector(0), 0, FAT_SECTOR_SIZE);
+	CHECK(fat_Mount(&f, ram_read, ram_write) == FAT_NOFS);
+}
+
+/* A card that takes one block every card_polls main loop passes */
+static struct sdlog s;
+static const uint8_t *card_data;
+static uint32_t card_lba, card_left, card_busy, card_polls = 3, card_max;
+static int card_stalled;
+
+static int card_write(uint32_t lba, const uint8_t *data, uint32_t count){
+	if (card_left)
+		return -1;
+	CHECK(count > 0 && count <= SDLOG_BLOCKS);
+	card_lba = lba;
+	card_data = data;
+	card_left = count;
+	card_busy = card_polls;
+	if (count > card_max)
+		card_max = count;
+	return 0;
+}
+
+static void poll(void){
+	if (card_left && !card_stalled && --card_busy == 0){
+		memcpy(sector(card_lba), card_data, SDLOG_BLOCK_SIZE);
+		card_lba++;
+		card_data += SDLOG_BLOCK_SIZE;
+		card_left--;
+		card_busy = card_polls;
+		sdlog_WriteDone(&s);
+	}
+	sdlog_Poll(&s);
+}
+
+static void add(uint32_t n){
+	struct recorder_control c;
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	memset(&c, 0, sizeof (c));
+	c.tick = 1000 + n * 10;
+	c.commanded = (int32_t) (n & 0x7fff);
+	recorder_EncodeControl(rec, &c);
+	sdlog_Add(&s, rec);
+}
+
+/* Read the log back like a host: blocks in order until one isn't the next, records in sequence */
+static uint32_t read_log(uint32_t lba, uint32_t blocks, uint32_t *records){
+	struct recorder_control c;
+	uint32_t session = 0, n;
+	const uint8_t *rec;
+	int i;
+
+	*records = 0;
+	for (n = 0; n < blocks; n++){
+		if (sdlog_Check(sector(lba + n), &session, n) != 0)
+			break;
+		for (i = 1; i < SDLOG_PER_BLOCK; i++){
+			rec = sector(lba + n) + i * RECORDER_RECORD_SIZE;
+			if (recorder_Check(rec) == RECORDER_EMPTY)
+				continue;
+			CHECK(recorder_Check(rec) == RECORDER_CONTROL);
+			recorder_DecodeControl(rec, &c);
+			CHECK(c.tick == 1000 + *records * 10);
+			(*records)++;
+		}
+	}
+	return n;
+}
+
+static void test_stream(void){
+	struct fat f;
+	char name[11];
+	uint32_t lba, n, blocks, records, total = 20000;
+	uint32_t file_blocks = 4000;
+
+	format_fat32();
+	CHECK(fat_Mount(&f, ram_read, ram_write) == FAT_OK);
+	fat_Name(name, SDLOG_PREFIX, SDLOG_EXT, 0);
+	CHECK(fat_Create(&f, name, file_blocks * SDLOG_BLOCK_SIZE, &lba) == FAT_OK);
+
+	/* Last boot's log, longer than this one will be, where this one goes */
+	sdlog_Init(&s, lba, lba + file_blocks, 0x1234, card_write);
+	card_max = 0;
+	for (n = 0; n < 2 * total; n++){
+		add(n);
+		poll();
+	}
+	sdlog_Pad(&s);
+	for (n = 0; n < 100; n++)
+		poll();
+	CHECK(read_log(lba, file_blocks, &records) == s.blocks);
+	CHECK(records == 2 * total);
+
+	/* This boot: a card that's slower than the log for a while */
+	sdlog_Init(&s, lba, lba + file_blocks, 0x5678, card_write);
+	card_max = 0;
+	for (n = 0; n < total; n++){
+		add(n);
+		card_stalled = n >= 1000 && n < 1100;
+		poll();
+	}
+	sdlog_Pad(&s);
+	for (n = 0; n < 100; n++)
+		poll();
+	CHECK(s.drops == 0 && s.lost == 0);
+	CHECK(s.writing == 0 && s.tail == s.head);
+	CHECK(card_max > 1);
+
+	/* Stops at the old session's blocks, not at their end */
+	blocks = read_log(lba, file_blocks, &records);
+	CHECK(blocks == s.blocks);
+	CHECK(records == total);
+	CHECK(blocks == (total + SDLOG_PER_BLOCK - 2) / (SDLOG_PER_BLOCK - 1));
+
+	/* Stalled for longer than the ring lasts: records drop, the blocks that go out stay in order */
+	sdlog_Init(&s, lba, lba + file_blocks, 0x9abc, card_write);
+	card_stalled = 1;
+	for (n = 0; n < (SDLOG_BLOCKS + 4) * (SDLOG_PER_BLOCK - 1); n++){
+		add(n);
+		poll();
+	}
+	CHECK(s.drops > 0);
+	CHECK(s.records == SDLOG_BLOCKS * (SDLOG_PER_BLOCK - 1));
+	card_stalled = 0;
+	for (n = 0; n < 1000; n++)
+		poll();
+	sdlog_Pad(&s);
+	for (n = 0; n < 100; n++)
+		poll();
+	CHECK(read_log(lba, file_blocks, &records) == SDLOG_BLOCKS);
+	CHECK(records == s.records);
+	CHECK(s.tail == s.head);
+
+	/* Past the end of the file blocks are thrown away and counted */
+	sdlog_Init(&s, lba, lba + 10, 0xdef0, card_write);
+	for (n = 0; n < 30 * (SDLOG_PER_BLOCK - 1); n++){
+		add(n);
+		poll();
+	}
+	for (n = 0; n < 1000; n++)
+		poll();
+	CHECK(s.blocks == 10);
+	CHECK(s.lost > 0);
+	CHECK(read_log(lba, file_blocks, &records) == 10);
+
+	/* No card: nothing staged */
+	sdlog_Init(&s, 0, 0, 0, NULL);
+	add(0);
+	CHECK(s.records == 0 && s.drops == 0);
+}
+
+int main(void){
+	test_fat32();
+	test_fat16();
+	test_stream();
+
+	free(image);
+	if (failures){
+		printf("sdlog_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("sdlog_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * sensor_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Runs sensor.c against models of an MS5607 and an MPU-6050 on a bus
+ * where every transaction finishes at once, through a flight whose
+ * truth is known. Checks the parts come up, the baro compensation
+ * against the datasheet, and that the estimate holds close enough to
+ * fly the brakes on once the companion frames stop.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sensor.h"
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+/* The datasheet's example part */
+static uint16_t prom[8] = { 0, 46372, 43981, 29059, 27842, 31553, 28165, 0 };
+
+#define D2			8077636		/* 20.00 C */
+#define PAD_ALT		1400.0f		/* m, standard atmosphere */
+
+struct world {
+	float		height;			/* truth, above the pad */
+	float		speed;
+	float		accel;			/* less gravity */
+	uint8_t		baro;			/* answering */
+	uint8_t		imu;
+	uint8_t		imu_id;
+	uint8_t		converting;		/* last conversion command */
+	uint32_t	converted;		/* ms it started */
+	uint32_t	d1;
+	uint32_t	d2;
+	uint32_t	imu_reads;
+};
+
+static float pressure(float alt){
+	return 101325.0f * powf(1.0f - alt / 44330.77f, 1.0f / 0.190263f);
+}
+
+/* The D1 that sensor_BaroConvert() turns into pa, at D2 */
+static uint32_t raw_pressure(float pa){
+	int64_t dt = (int64_t) D2 - ((int64_t) prom[5] << 8);
+	int64_t off = ((int64_t) prom[2] << 17) + ((int64_t) prom[4] * dt >> 6);
+	int64_t sens = ((int64_t) prom[1] << 16) + ((int64_t) prom[3] * dt >> 7);
+
+	return (uint32_t) (((((int64_t) lrintf(pa) << 15) + off) << 21) / sens);
+}
+
+/* Run one transaction against the models; returns 0 for a NACK */
+static int bus(struct world *w, const struct sensor_op *op, uint8_t *data, uint32_t now){
+	int i;
+
+	if (op->addr == SENSOR_BARO_ADDR){
+		if (!w->baro)
+			return 0;
+		if (op->read == 2){
+			i = (op->reg - SENSOR_BARO_PROM) / 2;
+			data[0] = prom[i] >> 8;
+			data[1] = prom[i] & 0xff;
+		}
+		else if (op->read == 3){
+			uint32_t adc = 0;
+
+			if (now - w->converted >= 5)
+				adc = w->converting == SENSOR_BARO_D2 ? D2 : raw_pressure(pressure(PAD_ALT + w->height));
+			data[0] = adc >> 16;
+			data[1] = adc >> 8;
+			data[2] = adc;
+			w->converting = 0;
+		}
+		else if (op->reg == SENSOR_BARO_D1 || op->reg == SENSOR_BARO_D2){
+			w->converting = op->reg;
+			w->converted = now;
+			if (op->reg == SENSOR_BARO_D1)
+				w->d1++;
+			else
+				w->d2++;
+		}
+		return 1;
+	}
+	if (op->addr == SENSOR_IMU_ADDR){
+		if (!w->imu)
+			return 0;
+		if (op->reg == SENSOR_IMU_WHO_AM_I)
+			data[0] = w->imu_id;
+		else if (op->reg == SENSOR_IMU_DATA){
+			int16_t raw[7] = { 12, -30, 0, 0, 0, 0, 0 };
+
+			raw[2] = (int16_t) lrintf((w->accel + SENSOR_G) / SENSOR_G * SENSOR_IMU_LSB_G);
+			for (i = 0; i < 7; i++){
+				data[2 * i] = (uint16_t) raw[i] >> 8;
+				data[2 * i + 1] = raw[i] & 0xff;
+			}
+			w->imu_reads++;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+/* Everything due this ms */
+static void poll(struct sensor *s, struct world *w, uint32_t now){
+	struct sensor_op op;
+	uint8_t data[SENSOR_READ_MAX];
+	int n;
+
+	for (n = 0; n < 8 && sensor_Next(s, now, &op); n++)
+		sensor_Done(s, data, bus(w, &op, data, now), now);
+}
+
+static void frame(struct sensor *s, const struct world *w, uint8_t state, uint32_t now){
+	struct companion_state c = { 0 };
+
+	c.flight_state = state;
+	c.height = (int16_t) lrintf(w->height);
+	c.speed = (int16_t) lrintf(w->speed * 16);
+	c.accel = (int16_t) lrintf(w->accel * 16);
+	c.rx_tick = now;
+	sensor_Companion(s, &c);
+}
+
+static void crc(void){
+	int n;
+
+	for (n = 0; n < 16; n++){
+		prom[7] = (uint16_t) (0x5A00 | n);
+		if (sensor_BaroCrc(prom))
+			return;
+	}
+	CHECK(0);
+}
+
+static void test_baro(void){
+	static const uint16_t blank[8] = { 0 };
+	int32_t temp;
+
+	/* MS5607 datasheet, "typical" values */
+	CHECK(sensor_BaroConvert(prom, 6465444, 8077636, &temp) == 110002);
+	CHECK(temp == 2000);
+
+	/* Colder than 20 C: second order, still about right */
+	CHECK(abs(sensor_BaroConvert(prom, 6465444, 7900000, &temp) - 106000) < 3000);
+	CHECK(temp < 2000 && temp > 1000);
+
+	CHECK(sensor_BaroCrc(prom));
+	prom[3] ^= 0x0100;
+	CHECK(!sensor_BaroCrc(prom));
+	prom[3] ^= 0x0100;
+	CHECK(!sensor_BaroCrc(blank));
+
+	CHECK(fabsf(sensor_Altitude(101325.0f)) < 0.01f);
+	CHECK(fabsf(sensor_Altitude(pressure(PAD_ALT)) - PAD_ALT) < 0.5f);
+}
+
+static void test_bringup(void){
+	static const struct sensor_config cfg = SENSOR_CONFIG_DEFAULT;
+	struct sensor s;
+	struct world w = { .baro = 1, .imu = 1, .imu_id = SENSOR_IMU_ID };
+	uint32_t t;
+
+	sensor_Init(&s, &cfg, 0);
+	for (t = 0; t < 1000; t++)
+		poll(&s, &w, t);
+	CHECK(s.baro_state == SENSOR_BARO_RUN);
+	CHECK(s.imu_state == SENSOR_IMU_RUN);
+	CHECK(s.errors == 0);
+	CHECK(labs(s.pressure - lrintf(pressure(PAD_ALT))) <= 1);
+	CHECK(s.temp == 2000);
+
+	/* One temperature per temp_every conversions, and the IMU at its rate */
+	CHECK(w.d2 >= 2);
+	CHECK(w.d1 / w.d2 >= cfg.temp_every - 2u);
+	CHECK(w.d1 > 100);
+	CHECK(w.imu_reads > 400 && w.imu_reads <= 1000 / cfg.imu_ms);
+
+	/* Nothing's published until the TeleMega has said pad */
+	CHECK(!sensor_Latest(&s)->valid);
+
+	/* No IMU, or the wrong one: retried, and the baro carries on regardless */
+	sensor_Init(&s, &cfg, 0);
+	w = (struct world) { .baro = 1, .imu = 1, .imu_id = 0x70 };
+	for (t = 0; t < 2000; t++)
+		poll(&s, &w, t);
+	CHECK(s.imu_state != SENSOR_IMU_RUN);
+	CHECK(s.restarts >= 3 && s.restarts <= 5);
+	CHECK(s.baro_state == SENSOR_BARO_RUN);
+	w.imu_id = SENSOR_IMU_ID;
+	for (; t < 3000; t++)
+		poll(&s, &w, t);
+	CHECK(s.imu_state == SENSOR_IMU_RUN);
+
+	/* Baro gone mid-run */
+	w.baro = 0;
+	for (; t < 3100; t++)
+		poll(&s, &w, t);
+	CHECK(s.baro_state == SENSOR_BARO_START);
+	w.baro = 1;
+	for (; t < 4000; t++)
+		poll(&s, &w, t);
+	CHECK(s.baro_state == SENSOR_BARO_RUN);
+}
+
+/*
+ * Pad, a 3 s burn at 10 g, then coast under gravity and drag. Frames
+ * every 10 ms until lost_at; returns the worst height and speed error
+ * of the estimate over the second after that.
+ */
+static void fly(const struct sensor_config *cfg, struct world *w, uint32_t lost_at,
+		float *height_err, float *speed_err){
+	struct sensor s;
+	struct companion_state c;
+	uint32_t t;
+	uint8_t state = COMPANION_STATE_PAD;
+	float dt = 0.001f;
+
+	sensor_Init(&s, cfg, 0);
+	*height_err = *speed_err = 0;
+	for (t = 0; t < lost_at + 1000; t++){
+		if (t >= 5000 && t < 8000)
+			w->accel = 100.0f;
+		else if (t >= 8000)
+			w->accel = -SENSOR_G - 0.0004f * w->speed * w->speed;
+		w->speed += w->accel * dt;
+		w->height += w->speed * dt;
+		if (t >= 5000)
+			state = t < 8000 ? COMPANION_STATE_BOOST : COMPANION_STATE_COAST;
+		if (t % 10 == 0 && t < lost_at)
+			frame(&s, w, state, t);
+		poll(&s, w, t);
+
+		if (t == lost_at - 1){
+			/* The TeleMega's data is fresh: nothing to do */
+			c = (struct companion_state) { .flight_state = state, .rx_tick = t - 9 };
+			CHECK(!sensor_Cover(sensor_Latest(&s), &c, t, 100));
+		}
+		if (t > lost_at + 100){
+			const struct sensor_estimate *e = sensor_Latest(&s);
+
+			c = (struct companion_state) { .flight_state = state, .rx_tick = lost_at - 10 };
+			CHECK(sensor_Cover(e, &c, t, 100));
+			CHECK(c.flight_state == COMPANION_STATE_COAST);
+			CHECK(c.rx_tick == e->tick);
+			CHECK(abs(c.height - (int) lrintf(e->height)) <= 1);
+			if (fabsf(e->height - w->height) > *height_err)
+				*height_err = fabsf(e->height - w->height);
+			if (fabsf(e->speed - w->speed) > *speed_err)
+				*speed_err = fabsf(e->speed - w->speed);
+		}
+	}
+}
+
+static void test_flight(void){
+	static const struct sensor_config cfg = SENSOR_CONFIG_DEFAULT;
+	struct sensor_config baro_only = cfg;
+	struct world w;
+	float h, v;
+
+	/* Frames lost in coast, a second before apogee's anywhere near */
+	w = (struct world) { .baro = 1, .imu = 1, .imu_id = SENSOR_IMU_ID };
+	fly(&cfg, &w, 12000, &h, &v);
+	printf("imu and baro: %.2f m, %.2f m/s\n", h, v);
+	CHECK(h < 2.0f);
+	CHECK(v < 1.0f);
+
+	/* No IMU at all: the baro alone lags the deceleration, but not by much */
+	w = (struct world) { .baro = 1, .imu = 0 };
+	baro_only.imu_addr = 0x69;
+	fly(&baro_only, &w, 12000, &h, &v);
+	printf("baro only: %.2f m, %.2f m/s\n", h, v);
+	CHECK(h < 10.0f);
+	CHECK(v < 15.0f);
+
+	/* Lost in the transonic part: the baro's ignored, the IMU holds on */
+	w = (struct world) { .baro = 1, .imu = 1, .imu_id = SENSOR_IMU_ID };
+	fly(&cfg, &w, 8100, &h, &v);
+	printf("imu, fast: %.2f m, %.2f m/s\n", h, v);
+	CHECK(h < 5.0f);
+	CHECK(v < 2.0f);
+}
+
+static void test_cover(void){
+	struct sensor_estimate e = { .height = 1234.4f, .speed = -3.5f, .accel = 40000.0f, .tick = 500, .valid = 1 };
+	struct companion_state c = { .height = 1, .speed = 2, .accel = 3, .rx_tick = 450 };
+
+	/* Fresh companion data wins */
+	CHECK(!sensor_Cover(&e, &c, 520, 100));
+	CHECK(c.height == 1);
+
+	/* Stale: ours, clamped to what fits */
+	CHECK(sensor_Cover(&e, &c, 560, 100));
+	CHECK(c.height == 1234);
+	CHECK(c.speed == -56);
+	CHECK(c.accel == 32767);
+	CHECK(c.rx_tick == 500);
+
+	/* Both stale, or ours not there */
+	c.rx_tick = 0;
+	CHECK(!sensor_Cover(&e, &c, 601, 100));
+	e.valid = 0;
+	CHECK(!sensor_Cover(&e, &c, 520, 100));
+}
+
+int main(void){
+	crc();
+	test_baro();
+	test_bringup();
+	test_flight();
+	test_cover();
+
+	if (failures){
+		printf("sensor_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("sensor_test: ok\n");
+	return 0;
+}
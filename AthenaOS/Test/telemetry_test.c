@@ -0,0 +1,191 @@
+/*
+ * telemetry_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Feeds control records through the telemetry queue into a byte
+ * stream that fills up like the CDC TX ring does, then decodes the
+ * stream the way Tools/telem does, with line noise mixed in. Checks
+ * the divisor, that a full queue or a full ring drops records rather
+ * than reordering them, and the status frame round trip.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry.h"
+
+#define STREAM_SIZE	(64 * 1024)
+
+static struct telemetry t;
+static uint8_t stream[STREAM_SIZE];
+static uint32_t stream_len;
+static uint32_t room;			/* bytes the "ring" will still take */
+
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+/* All of the frame or none of it, like cdc_Send */
+static int send(const uint8_t *frame, uint16_t len){
+	if (len > room || stream_len + len > STREAM_SIZE)
+		return -1;
+	memcpy(stream + stream_len, frame, len);
+	stream_len += len;
+	room -= len;
+	return 0;
+}
+
+static void noise(uint32_t n){
+	while (n-- && stream_len < STREAM_SIZE)
+		stream[stream_len++] = (uint8_t) (rand() & 0xff);
+}
+
+static void tick(uint32_t n){
+	struct recorder_control c = { .tick = n, .flight_state = 5, .height = (int16_t) n, .cd = 0.5f };
+	uint8_t rec[RECORDER_RECORD_SIZE];
+
+	recorder_EncodeControl(rec, &c);
+	telemetry_Add(&t, rec);
+}
+
+/* Decode the stream: control record ticks in order into ticks[], returns how many */
+static uint32_t decode(uint32_t *ticks, uint32_t max, struct telemetry_status *st, int *statuses){
+	struct frame_rx rx;
+	struct recorder_control c;
+	uint32_t i, n = 0;
+
+	frame_Reset(&rx);
+	*statuses = 0;
+	for (i = 0; i < stream_len; i++){
+		if (!frame_Input(&rx, stream[i]))
+			continue;
+		if (rx.type == TELEMETRY_CONTROL){
+			CHECK(rx.len == RECORDER_RECORD_SIZE);
+			CHECK(recorder_Check(rx.payload) == RECORDER_CONTROL);
+			recorder_DecodeControl(rx.payload, &c);
+			if (n < max)
+				ticks[n] = c.tick;
+			n++;
+		}
+		else if (rx.type == TELEMETRY_STATUS){
+			CHECK(rx.len == TELEMETRY_STATUS_WORDS * 4);
+			telemetry_DecodeStatus(rx.payload, st);
+			(*statuses)++;
+		}
+	}
+	return n;
+}
+
+static void test_stream(void){
+	uint32_t ticks[1000], n, i, got;
+	struct telemetry_status st;
+	int statuses;
+
+	telemetry_Init(&t);
+	stream_len = 0;
+	room = STREAM_SIZE;
+
+	/* Off until the host asks */
+	tick(0);
+	telemetry_Send(&t, send);
+	CHECK(stream_len == 0);
+
+	/* Every tick, main loop after every few, noise on the line */
+	telemetry_Rate(&t, 1);
+	for (n = 1; n <= 300; n++){
+		tick(n);
+		if (n % 5 == 0){
+			telemetry_Send(&t, send);
+			noise(3);
+		}
+	}
+	telemetry_Send(&t, send);
+	got = decode(ticks, 1000, &st, &statuses);
+	CHECK(got == 300);
+	for (i = 0; i < got && i < 300; i++)
+		CHECK(ticks[i] == i + 1);
+	CHECK(t.drops == 0 && t.sent == 300);
+
+	/* Every fourth */
+	stream_len = 0;
+	telemetry_Rate(&t, 4);
+	t.count = 0;
+	for (n = 1; n <= 40; n++){
+		tick(n);
+		telemetry_Send(&t, send);
+	}
+	got = decode(ticks, 1000, &st, &statuses);
+	CHECK(got == 10);
+	CHECK(ticks[0] == 4 && ticks[9] == 40);
+}
+
+static void test_backpressure(void){
+	uint32_t ticks[1000], n, got, i;
+	struct telemetry_status st;
+	int statuses;
+
+	telemetry_Init(&t);
+	telemetry_Rate(&t, 1);
+	stream_len = 0;
+
+	/* Host not reading: the ring is full, the queue fills, then records drop */
+	room = 0;
+	for (n = 1; n <= 50; n++){
+		tick(n);
+		telemetry_Send(&t, send);
+	}
+	CHECK(t.drops == 50 - (TELEMETRY_QUEUE - 1));
+	CHECK(stream_len == 0);
+
+	/* Room for a frame and a half: one goes, the rest wait their turn */
+	room = (FRAME_OVERHEAD + RECORDER_RECORD_SIZE) * 3 / 2;
+	telemetry_Send(&t, send);
+	CHECK(t.sent == 1);
+	room = STREAM_SIZE;
+	telemetry_Send(&t, send);
+
+	got = decode(ticks, 1000, &st, &statuses);
+	CHECK(got == TELEMETRY_QUEUE - 1);
+	for (i = 0; i < got; i++)
+		CHECK(ticks[i] == i + 1);
+}
+
+static void test_status(void){
+	struct telemetry_status s, d;
+	uint8_t frame[FRAME_OVERHEAD + TELEMETRY_STATUS_WORDS * 4];
+	uint32_t i, *w = (uint32_t *) &s;
+	int statuses;
+	uint16_t len;
+
+	for (i = 0; i < TELEMETRY_STATUS_WORDS; i++)
+		w[i] = 0x01020304u * (i + 1);
+	len = telemetry_EncodeStatus(frame + FRAME_HEADER_SIZE, &s);
+	CHECK(len == TELEMETRY_STATUS_WORDS * 4);
+	len = frame_Encode(frame, TELEMETRY_STATUS, frame + FRAME_HEADER_SIZE, len);
+
+	stream_len = 0;
+	room = STREAM_SIZE;
+	send(frame, len);
+	memset(&d, 0, sizeof (d));
+	decode(NULL, 0, &d, &statuses);
+	CHECK(statuses == 1);
+	CHECK(memcmp(&s, &d, sizeof (s)) == 0);
+}
+
+int main(void){
+	srand(1);
+
+	test_stream();
+	test_backpressure();
+	test_status();
+
+	if (failures){
+		printf("telemetry_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("telemetry_test: ok\n");
+	return 0;
+}
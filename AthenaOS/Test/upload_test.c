@@ -0,0 +1,371 @@
+/*
+ * upload_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Stands in for the board on a pty: a child process runs upload.c
+ * against a RAM flash that behaves like NOR (erase to 0xff, program
+ * only clears bits), while the parent drives it with the same link
+ * code lutload uses. Compiles a CSV table, uploads it, and checks
+ * what lands in the child's flash.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "crc.h"
+#include "lut.h"
+#include "upload.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "companion.h"
+#include "link.h"
+#include "lut_compile.h"
+
+#define FLASH_BYTES	(1024 * 1024)
+#define FLASH_PAGE	512		/* not UPLOAD_MAX_DATA, so PING can't mix them up */
+#define RESERVED	(FLASH_BYTES - 2 * UPLOAD_SECTOR)	/* like the fault sector */
+
+static uint8_t flash[FLASH_BYTES];
+static struct telemetry board_telemetry;
+static struct profile board_profile;
+static struct companion_decoder board_companion;
+static uint8_t board_hil;
+static int device_fd;
+static int failures;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failures++; } } while (0)
+
+static int ram_erase(uint32_t addr, uint32_t len){
+	memset(flash + addr, 0xff, len);
+	return 0;
+}
+
+static int ram_write(uint32_t addr, const uint8_t *data, uint32_t len){
+	while (len--)
+		flash[addr++] &= *data++;
+	return 0;
+}
+
+static int ram_read(uint32_t addr, uint8_t *data, uint32_t len){
+	memcpy(data, flash + addr, len);
+	return 0;
+}
+
+static int ram_reload(void){
+	struct lut_header h;
+
+	return lut_ParseHeader(&h, flash, LUT_HEADER_SIZE);
+}
+
+static int ram_telemetry(uint8_t divisor){
+	telemetry_Rate(&board_telemetry, divisor);
+	return 0;
+}
+
+static int ram_profile(uint8_t probe, uint8_t flags, uint8_t *out){
+	struct profile_probe p;
+	uint16_t len;
+
+	if (probe >= PROFILE_PROBES)
+		return -1;
+	profile_Read(&board_profile.probe[probe], &p);
+	len = profile_Encode(out, probe, 72000000, &p);
+	if (flags & PROFILE_RESET)
+		board_profile.probe[probe].reset = 1;
+	return len;
+}
+
+static int ram_hil(uint8_t on){
+	companion_Reset(&board_companion, COMPANION_CHANNELS);
+	board_hil = on;
+	return 0;
+}
+
+static int ram_inject(const uint8_t *data, uint16_t len){
+	if (!board_hil)
+		return -1;
+	return companion_Decode(&board_companion, data, 0xffff, 0, len, 0);
+}
+
+static void ram_send(const uint8_t *frame, uint16_t len){
+	while (len){
+		ssize_t r = write(device_fd, frame, len);
+
+		if (r <= 0)
+			exit(0);
+		frame += r;
+		len -= r;
+	}
+}
+
+static int ram_frame(const uint8_t *frame, uint16_t len){
+	ram_send(frame, len);
+	return 0;
+}
+
+static const struct upload_ops ram_ops = {
+	.size = FLASH_BYTES,
+	.page = FLASH_PAGE,
+	.reserved = RESERVED,
+	.reserved_len = UPLOAD_SECTOR,
+	.erase = ram_erase,
+	.write = ram_write,
+	.read = ram_read,
+	.reload = ram_reload,
+	.telemetry = ram_telemetry,
+	.profile = ram_profile,
+	.hil = ram_hil,
+	.inject = ram_inject,
+	.send = ram_send,
+};
+
+/* The board: CDC packets in, upload_Input, replies out, with telemetry between */
+static void device(int fd){
+	static struct upload u;
+	struct recorder_control c = { .tick = 1, .flight_state = 5 };
+	uint8_t buf[64], rec[RECORDER_RECORD_SIZE];
+	ssize_t n;
+
+	device_fd = fd;
+	memset(flash, 0x5a, sizeof (flash));
+	upload_Init(&u, &ram_ops);
+	telemetry_Init(&board_telemetry);
+	profile_Init(&board_profile);
+	profile_Add(&board_profile.probe[PROFILE_LUT], 720);
+	profile_Add(&board_profile.probe[PROFILE_LUT], 1440);
+	while ((n = read(fd, buf, sizeof (buf))) > 0){
+		recorder_EncodeControl(rec, &c);
+		telemetry_Add(&board_telemetry, rec);
+		telemetry_Send(&board_telemetry, ram_frame);
+		c.tick++;
+		upload_Input(&u, buf, n);
+	}
+	exit(0);
+}
+
+static const char csv[] =
+	"# Time (s),Altitude (m),Vertical velocity (m/s),Drag coefficient ()\n";
+
+/* OpenRocket style export of a full grid, rows in scrambled order */
+static char *make_csv(int nx, int ny){
+	size_t size = sizeof (csv) + (size_t) nx * ny * 64;
+	char *s = malloc(size), *p = s;
+	int i, j, k;
+
+	p += sprintf(p, "%s", csv);
+	for (k = 0; k < nx * ny; k++){
+		int idx = (k * 7919) % (nx * ny);
+
+		i = idx % nx;
+		j = idx / nx;
+		p += sprintf(p, "%d.5,%d,%g,%.5f\n", k, j * 25, i * 2.5, 0.4 + i * 0.002 + j * 0.0001);
+	}
+	return s;
+}
+
+static uint8_t *compile(const char *text, uint32_t *len){
+	struct lut_columns cols = LUT_COLUMNS_DEFAULT;
+	FILE *f = fmemopen((void *) text, strlen(text), "r");
+	uint8_t *bin;
+	char err[256];
+
+	if (lut_compile(f, &cols, &bin, len, err, sizeof (err)) != 0){
+		printf("compile: %s\n", err);
+		bin = NULL;
+	}
+	fclose(f);
+	return bin;
+}
+
+static void test_compile(void){
+	struct lut_header h;
+	uint32_t len;
+	uint8_t *bin;
+	char *text = make_csv(128, 160);
+
+	bin = compile(text, &len);
+	CHECK(bin != NULL);
+	if (!bin)
+		return;
+	CHECK(lut_ParseHeader(&h, bin, len) == 0);
+	CHECK(h.nx == 128 && h.ny == 160);
+	CHECK(h.x0 == 0 && h.dx == 40 && h.y0 == 0 && h.dy == 25);
+	CHECK(h.crc32 == crc32(CRC32_INIT, bin + h.data_offset, h.data_size));
+	/* cell (3, 2): 0.4 + 0.006 + 0.0002 */
+	CHECK((int16_t) (bin[h.data_offset + 2 * h.row_stride + 6] | (bin[h.data_offset + 2 * h.row_stride + 7] << 8)) ==
+	      (int16_t) lrint(0.4062 * (1 << 14)));
+	free(bin);
+	free(text);
+
+	/* Holes, ragged spacing and overflow are refused */
+	CHECK(compile("velocity,altitude,drag\n0,0,1\n1,0,1\n0,10,1\n", &len) == NULL);
+	CHECK(compile("velocity,altitude,drag\n0,0,1\n1,0,1\n3,0,1\n0,10,1\n1,10,1\n3,10,1\n", &len) == NULL);
+	CHECK(compile("velocity,altitude,drag\n0,0,1\n1,0,1\n0,10,1\n1,10,9\n", &len) == NULL);
+	CHECK(compile("speed,height,cd\n0,0,1\n1,0,1\n0,10,1\n1,10,1\n", &len) == NULL);
+	/* No header: first three columns */
+	bin = compile("0,0,1\n1,0,1\n0,10,1\n1,10,1\n", &len);
+	CHECK(bin != NULL);
+	free(bin);
+}
+
+static double now(void){
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void test_upload(struct link *l){
+	struct link_info info;
+	uint8_t back[UPLOAD_MAX_DATA * 3], cmd[8];
+	uint32_t len, crc, erase;
+	uint8_t *bin;
+	char *text = make_csv(128, 160);
+	double t0;
+
+	CHECK(link_ping(l, &info) == 0);
+	CHECK(info.version == UPLOAD_VERSION && info.size == FLASH_BYTES && info.sector == UPLOAD_SECTOR);
+	CHECK(info.page == FLASH_PAGE && info.max_data == UPLOAD_MAX_DATA);
+
+	/* Line noise and a corrupted frame in front of a command don't stop it */
+	write(l->fd, "\xa5\x00\x5a\xa5\x5a\x01\x00\x00\x12\x34junk", 14);
+	CHECK(link_ping(l, &info) == 0);
+
+	bin = compile(text, &len);
+	CHECK(bin != NULL);
+	if (!bin)
+		return;
+
+	t0 = now();
+	erase = (len + UPLOAD_SECTOR - 1) / UPLOAD_SECTOR * UPLOAD_SECTOR;
+	CHECK(link_erase(l, 0, erase) == UPLOAD_OK);
+	CHECK(link_write(l, 0, bin, len) == UPLOAD_OK);
+	CHECK(link_crc(l, 0, len, &crc) == UPLOAD_OK);
+	CHECK(crc == crc32(CRC32_INIT, bin, len));
+	CHECK(link_reload(l) == UPLOAD_OK);
+	printf("upload: %u bytes in %.3f s over the pty\n", (unsigned) len, now() - t0);
+
+	/* Unaligned read back across pages */
+	CHECK(link_read(l, 100, back, sizeof (back)) == UPLOAD_OK);
+	CHECK(memcmp(back, bin + 100, sizeof (back)) == 0);
+
+	/* Programming over programmed data can only clear bits, so the CRC catches it */
+	CHECK(link_write(l, 0, (const uint8_t *) "\xff\x00", 2) == UPLOAD_OK);
+	CHECK(link_crc(l, 0, len, &crc) == UPLOAD_OK);
+	CHECK(crc != crc32(CRC32_INIT, bin, len));
+
+	/* Bad requests get a status, not silence */
+	CHECK(link_erase(l, 100, UPLOAD_SECTOR) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_erase(l, FLASH_BYTES, UPLOAD_SECTOR) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_read(l, FLASH_BYTES - 1, back, 2) == UPLOAD_BAD_ADDRESS);
+
+	/* The reserved sector can be read and cleared, but not written or erased in passing */
+	CHECK(link_erase(l, RESERVED - UPLOAD_SECTOR, 2 * UPLOAD_SECTOR) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_erase(l, RESERVED - UPLOAD_SECTOR, 3 * UPLOAD_SECTOR) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_write(l, RESERVED + 10, (const uint8_t *) "\x00", 1) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_write(l, RESERVED - 1, (const uint8_t *) "\x00\x00", 2) == UPLOAD_BAD_ADDRESS);
+	CHECK(link_read(l, RESERVED, back, 16) == UPLOAD_OK);
+	CHECK(back[0] == 0x5a && back[10] == 0x5a);		/* as the board started */
+	CHECK(link_erase(l, RESERVED, UPLOAD_SECTOR) == UPLOAD_OK);
+	CHECK(link_read(l, RESERVED, back, 16) == UPLOAD_OK && back[10] == 0xff);
+	CHECK(link_erase(l, RESERVED - UPLOAD_SECTOR, UPLOAD_SECTOR) == UPLOAD_OK);
+	CHECK(link_erase(l, RESERVED + UPLOAD_SECTOR, UPLOAD_SECTOR) == UPLOAD_OK);
+	CHECK(link_command(l, 0x42, NULL, 0) == UPLOAD_BAD_COMMAND);
+	CHECK(link_command(l, UPLOAD_ERASE, cmd, 3) == UPLOAD_BAD_LENGTH);
+
+	/* Commands still get their replies with telemetry streaming in between */
+	CHECK(link_telemetry(l, 1) == UPLOAD_OK);
+	CHECK(link_crc(l, 0, len, &crc) == UPLOAD_OK);
+	CHECK(link_read(l, 100, back, sizeof (back)) == UPLOAD_OK);
+	CHECK(link_telemetry(l, 0) == UPLOAD_OK);
+	CHECK(link_command(l, UPLOAD_TELEMETRY, cmd, 2) == UPLOAD_BAD_LENGTH);
+
+	/* Profile probes by number until there are no more, reset on request */
+	{
+		struct profile_probe p;
+		char name[PROFILE_NAME + 1];
+		uint32_t hz;
+
+		CHECK(link_profile(l, PROFILE_LUT, PROFILE_RESET, &hz, name, &p) == UPLOAD_OK);
+		CHECK(hz == 72000000 && strcmp(name, "lut") == 0);
+		CHECK(p.count == 2 && p.min == 720 && p.max == 1440 && p.sum == 2160);
+		CHECK(link_profile(l, PROFILE_LUT, 0, &hz, name, &p) == UPLOAD_OK);
+		CHECK(p.count == 0);
+		CHECK(link_profile(l, PROFILE_PROBES, 0, &hz, name, &p) == UPLOAD_BAD_ADDRESS);
+	}
+
+	/* Companion transactions from the host go through the decoder once HIL is on */
+	{
+		uint8_t t[COMPANION_COMMAND_SIZE + 2 * COMPANION_CHANNELS];
+
+		memset(t, 0, sizeof (t));
+		t[0] = COMPANION_SETUP;
+		t[1] = COMPANION_STATE_PAD;
+		CHECK(link_inject(l, t, COMPANION_COMMAND_SIZE + COMPANION_SETUP_SIZE) == UPLOAD_FAILED);
+		CHECK(link_hil(l, 1) == UPLOAD_OK);
+		CHECK(link_inject(l, t, COMPANION_COMMAND_SIZE + COMPANION_SETUP_SIZE) == UPLOAD_OK);
+		CHECK(l->rx.len == 2 && l->rx.payload[1] == COMPANION_SETUP);
+		t[0] = COMPANION_FETCH;
+		CHECK(link_inject(l, t, sizeof (t)) == UPLOAD_OK);
+		CHECK(link_inject(l, t, sizeof (t) - 1) == UPLOAD_FAILED);
+		CHECK(link_command(l, UPLOAD_INJECT, NULL, 0) == UPLOAD_BAD_LENGTH);
+		CHECK(link_hil(l, 0) == UPLOAD_OK);
+		CHECK(link_inject(l, t, sizeof (t)) == UPLOAD_FAILED);
+	}
+
+	/* Erased table doesn't reload */
+	CHECK(link_erase(l, 0, UPLOAD_SECTOR) == UPLOAD_OK);
+	CHECK(link_reload(l) == UPLOAD_FAILED);
+
+	free(bin);
+	free(text);
+}
+
+int main(void){
+	struct link l;
+	pid_t pid;
+	int master;
+
+	test_compile();
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0){
+		perror("pty");
+		return 1;
+	}
+	if (link_open(&l, ptsname(master)) != 0){
+		perror(ptsname(master));
+		return 1;
+	}
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0){
+		link_close(&l);
+		device(master);
+	}
+	close(master);
+
+	test_upload(&l);
+
+	link_close(&l);
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+
+	if (failures){
+		printf("upload_test: %d failures\n", failures);
+		return 1;
+	}
+	printf("upload_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * faultdump.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Read the fault records off Athena over USB and say what happened:
+ *
+ *	faultdump [--tty /dev/ttyACM0] [--in fault.bin] [--raw fault.bin]
+ *	          [--elf AthenaOS.elf] [--addr2line arm-none-eabi-addr2line]
+ *	          [--hz 72000000] [--erase]
+ *
+ * Each record prints the fault status registers spelled out, the
+ * stacked registers, anything on the stack that looks like a return
+ * address, and the profiler probes that ran last. With --elf, code
+ * addresses are looked up with addr2line. --in decodes a sector saved
+ * earlier with --raw instead of asking the board; --erase clears the
+ * sector once the records are safely off.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flash.h"
+#include "upload.h"
+#include "fault.h"
+#include "link.h"
+
+/* Where code can be on the F446 */
+#define CODE_START	0x08000000
+#define CODE_END	0x08080000
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "in", .has_arg = 1, .val = 'i' },
+	{ .name = "raw", .has_arg = 1, .val = 'r' },
+	{ .name = "elf", .has_arg = 1, .val = 'E' },
+	{ .name = "addr2line", .has_arg = 1, .val = 'A' },
+	{ .name = "hz", .has_arg = 1, .val = 'h' },
+	{ .name = "erase", .has_arg = 0, .val = 'e' },
+	{ 0, 0, 0, 0},
+};
+
+static const char *elf;
+static const char *addr2line = "arm-none-eabi-addr2line";
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--in=<file>] [--raw=<file>] [--elf=<elf>] "
+		"[--addr2line=<program>] [--hz=<core clock>] [--erase]\n", program);
+	exit(1);
+}
+
+static int fail(const char *what, int status){
+	if (status < 0)
+		fprintf(stderr, "%s: %s\n", what, strerror(errno));
+	else
+		fprintf(stderr, "%s: status %d\n", what, status);
+	return 1;
+}
+
+/* "function at file:line" for a code address, or nothing without an ELF */
+static const char *where(uint32_t addr){
+	static char line[512];
+	char cmd[1024];
+	FILE *p;
+
+	line[0] = '\0';
+	if (!elf)
+		return line;
+	snprintf(cmd, sizeof (cmd), "%s -f -p -C -e '%s' 0x%08x", addr2line, elf, (unsigned) (addr & ~1u));
+	if (!(p = popen(cmd, "r")))
+		return line;
+	line[0] = ' ';
+	if (!fgets(line + 1, sizeof (line) - 1, p))
+		line[0] = '\0';
+	line[strcspn(line, "\n")] = '\0';
+	pclose(p);
+	return line;
+}
+
+struct bit {
+	uint32_t	mask;
+	const char	*name;
+	const char	*what;
+};
+
+static const struct bit cfsr_bits[] = {
+	{ 1u << 0, "IACCVIOL", "instruction fetch from a protected region" },
+	{ 1u << 1, "DACCVIOL", "data access to a protected region" },
+	{ 1u << 3, "MUNSTKERR", "MPU fault unstacking on return" },
+	{ 1u << 4, "MSTKERR", "MPU fault stacking for an exception" },
+	{ 1u << 5, "MLSPERR", "MPU fault saving FPU state" },
+	{ 1u << 7, "MMARVALID", "MMFAR holds the address" },
+	{ 1u << 8, "IBUSERR", "bus error on instruction fetch" },
+	{ 1u << 9, "PRECISERR", "bus error on data access, at the stacked pc" },
+	{ 1u << 10, "IMPRECISERR", "bus error on a buffered write, somewhere before the stacked pc" },
+	{ 1u << 11, "UNSTKERR", "bus error unstacking on return" },
+	{ 1u << 12, "STKERR", "bus error stacking for an exception (stack overflow?)" },
+	{ 1u << 13, "LSPERR", "bus error saving FPU state" },
+	{ 1u << 15, "BFARVALID", "BFAR holds the address" },
+	{ 1u << 16, "UNDEFINSTR", "undefined instruction" },
+	{ 1u << 17, "INVSTATE", "not in Thumb state (bad function pointer?)" },
+	{ 1u << 18, "INVPC", "bad EXC_RETURN" },
+	{ 1u << 19, "NOCP", "coprocessor access with it off (FPU not enabled?)" },
+	{ 1u << 24, "UNALIGNED", "unaligned access" },
+	{ 1u << 25, "DIVBYZERO", "divide by zero" },
+	{ 0, NULL, NULL },
+};
+
+static const struct bit hfsr_bits[] = {
+	{ 1u << 1, "VECTTBL", "bus fault reading the vector table" },
+	{ 1u << 30, "FORCED", "escalated from a configurable fault, see CFSR" },
+	{ 1u << 31, "DEBUGEVT", "debug event" },
+	{ 0, NULL, NULL },
+};
+
+static void print_bits(const char *reg, uint32_t v, const struct bit *bits){
+	int i;
+
+	printf("  %-5s %08x\n", reg, (unsigned) v);
+	for (i = 0; bits[i].name; i++)
+		if (v & bits[i].mask)
+			printf("        %-11s %s\n", bits[i].name, bits[i].what);
+}
+
+static void print_fault(int slot, const struct fault *f, double hz){
+	static const char *const regs[FAULT_FRAME] = { "r0", "r1", "r2", "r3", "r12", "lr", "pc", "xpsr" };
+	const struct profile_event *e;
+	int i;
+
+	printf("fault %d: %s at %u ms, %s stack\n", slot, fault_Name(f->type), (unsigned) f->tick,
+	       f->exc_return & 4 ? "process" : "main");
+	print_bits("cfsr", f->cfsr, cfsr_bits);
+	print_bits("hfsr", f->hfsr, hfsr_bits);
+	if (f->cfsr & (1u << 7))
+		printf("  mmfar %08x\n", (unsigned) f->mmfar);
+	if (f->cfsr & (1u << 15))
+		printf("  bfar  %08x\n", (unsigned) f->bfar);
+
+	printf("  sp    %08x\n", (unsigned) f->sp);
+	for (i = 0; i < FAULT_FRAME; i++)
+		printf("  %-5s %08x%s\n", regs[i], (unsigned) f->frame[i],
+		       i == FAULT_PC || i == FAULT_LR ? where(f->frame[i]) : "");
+
+	/* Odd words in flash are most likely return addresses */
+	printf("  stack, %d words:\n", f->stack_words);
+	for (i = 0; i < f->stack_words; i++)
+		if ((f->stack[i] & 1) && f->stack[i] >= CODE_START && f->stack[i] < CODE_END)
+			printf("    [%2d] %08x%s\n", i, (unsigned) f->stack[i], where(f->stack[i]));
+
+	printf("  last %d of %u probe events, most recent last:\n", f->trace_count, (unsigned) f->trace_head);
+	for (i = 0; i < f->trace_count; i++){
+		e = &f->trace[i];
+		printf("    %10.1f us before  %-10.*s %8.1f us\n",
+		       (double) (f->cycles - e->at) * 1e6 / hz,
+		       PROFILE_NAME, PROFILE_EVENT_ID(e) < PROFILE_PROBES ? profile_names[PROFILE_EVENT_ID(e)] : "?",
+		       PROFILE_EVENT_CYCLES(e) * 1e6 / hz);
+	}
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0";
+	const char *in = NULL, *raw = NULL;
+	uint8_t sector[FLASH_SECTOR_SIZE];
+	struct link_info info;
+	struct link l;
+	struct fault f;
+	double hz = 72e6;
+	uint32_t off;
+	int erase = 0, c, status, slot, faults = 0;
+	FILE *file;
+
+	while ((c = getopt_long(argc, argv, "T:i:r:E:A:h:e", options, NULL)) != -1){
+		switch (c){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'i':
+			in = optarg;
+			break;
+		case 'r':
+			raw = optarg;
+			break;
+		case 'E':
+			elf = optarg;
+			break;
+		case 'A':
+			addr2line = optarg;
+			break;
+		case 'h':
+			hz = strtod(optarg, NULL);
+			break;
+		case 'e':
+			erase = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc != optind || hz <= 0 || (in && erase))
+		usage(argv[0]);
+
+	if (in){
+		if (!(file = fopen(in, "rb"))){
+			perror(in);
+			return 1;
+		}
+		if (fread(sector, 1, sizeof (sector), file) != sizeof (sector)){
+			fprintf(stderr, "%s: short\n", in);
+			return 1;
+		}
+		fclose(file);
+	}
+	else {
+		if (link_open(&l, tty) != 0){
+			perror(tty);
+			return 1;
+		}
+		if ((status = link_ping(&l, &info)) != 0)
+			return fail("ping", status);
+		if (info.version != UPLOAD_VERSION){
+			fprintf(stderr, "board speaks upload version %d, need %d\n", info.version, UPLOAD_VERSION);
+			return 1;
+		}
+		for (off = 0; off < sizeof (sector); off += UPLOAD_MAX_DATA)
+			if ((status = link_read(&l, FLASH_FAULT_ADDR + off, sector + off, UPLOAD_MAX_DATA)) != 0)
+				return fail("read", status);
+	}
+
+	if (raw){
+		if (!(file = fopen(raw, "wb")) || fwrite(sector, 1, sizeof (sector), file) != sizeof (sector)){
+			perror(raw);
+			return 1;
+		}
+		fclose(file);
+	}
+
+	for (slot = 0; slot < FAULT_SLOTS; slot++){
+		switch (fault_Decode(sector + slot * FAULT_RECORD_SIZE, &f)){
+		case 0:
+			print_fault(slot, &f, hz);
+			faults++;
+			break;
+		case FAULT_EMPTY:
+			break;
+		default:
+			printf("fault %d: bad record\n", slot);
+			faults++;
+			break;
+		}
+	}
+	if (!faults)
+		printf("no faults\n");
+
+	if (erase && faults){
+		if ((status = link_erase(&l, FLASH_FAULT_ADDR, FLASH_SECTOR_SIZE)) != 0)
+			return fail("erase", status);
+		fprintf(stderr, "erased\n");
+	}
+	if (!in)
+		link_close(&l);
+	return 0;
+}
@@ -0,0 +1,427 @@
+/*
+ * flight_log.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * TeleMega flights for the replay, from either of the two files AltOS
+ * leaves us:
+ *
+ *	.csv	AltosUI export. Height, speed and acceleration are the
+ *			TeleMega's own filtered numbers, which is exactly what it
+ *			sends over the companion link.
+ *	.eeprom	ao-dumplog/ao-eeprom format: a JSON config followed by the
+ *			raw log in hex, see altos/ao-tools/lib/ao-eeprom-read.c.
+ *			Only the sensors are in there, so height comes from the
+ *			MS5607 and a small baro/accel filter stands in for the
+ *			TeleMega's Kalman filter.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "companion.h"
+#include "flight_log.h"
+
+#define GRAVITY		9.80665
+
+/* struct ao_log_mega, AO_LOG_FORMAT_TELEMEGA_OLD and later */
+#define MEGA_RECORD		32
+#define MEGA_FLIGHT		'F'
+#define MEGA_SENSOR		'A'
+#define MEGA_STATE		'S'
+
+static int fail(char *err, size_t err_len, const char *fmt, ...){
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(err, err_len, fmt, ap);
+	va_end(ap);
+	return -1;
+}
+
+static int add(struct flight_log *log, const struct flight_sample *s){
+	struct flight_sample *n;
+
+	if (log->n == log->size){
+		log->size = log->size ? log->size * 2 : 1024;
+		n = realloc(log->s, log->size * sizeof (*n));
+		if (!n)
+			return -1;
+		log->s = n;
+	}
+	log->s[log->n++] = *s;
+	return 0;
+}
+
+void flight_log_free(struct flight_log *log){
+	free(log->s);
+	memset(log, 0, sizeof (*log));
+}
+
+static char *trim(char *s){
+	char *e;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	e = s + strlen(s);
+	while (e > s && isspace((unsigned char) e[-1]))
+		*--e = '\0';
+	return s;
+}
+
+/* Split a CSV line in place; returns the number of fields */
+static int split(char *line, char **field, int max){
+	int n = 0;
+	char *p = line, *c;
+
+	while (n < max){
+		c = strchr(p, ',');
+		if (c)
+			*c = '\0';
+		field[n++] = trim(p);
+		if (!c)
+			break;
+		p = c + 1;
+	}
+	return n;
+}
+
+static int column(char **field, int n, const char *name){
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (strcmp(field[i], name) == 0)
+			return i;
+	return -1;
+}
+
+#define CSV_FIELDS	128
+#define CSV_MISSING	0x7fffffff
+
+int flight_log_read_csv(struct flight_log *log, FILE *in, char *err, size_t err_len){
+	char line[4096], *field[CSV_FIELDS];
+	int n, time = -1, state = -1, height = -1, speed = -1, baro = -1, accel = -1, serial = -1, flight = -1;
+	int max = 0;
+	struct flight_sample s;
+
+	memset(log, 0, sizeof (*log));
+	while (fgets(line, sizeof (line), in)){
+		if (line[0] == '#' || !isdigit((unsigned char) *trim(line))){
+			n = split(line[0] == '#' ? line + 1 : line, field, CSV_FIELDS);
+			if (column(field, n, "version") != 0)
+				continue;
+			time = column(field, n, "time");
+			state = column(field, n, "state");
+			height = column(field, n, "height");
+			baro = column(field, n, "baro_speed");
+			if ((speed = column(field, n, "speed")) < 0 && (speed = column(field, n, "accel_speed")) < 0)
+				speed = baro;
+			accel = column(field, n, "acceleration");
+			serial = column(field, n, "serial");
+			flight = column(field, n, "flight");
+			continue;
+		}
+		if (time < 0 || state < 0 || height < 0 || speed < 0 || accel < 0){
+			flight_log_free(log);
+			return fail(err, err_len, "no time, state, height, speed and acceleration columns");
+		}
+		max = time > max ? time : max;
+		max = state > max ? state : max;
+		max = height > max ? height : max;
+		max = speed > max ? speed : max;
+		max = accel > max ? accel : max;
+		max = baro > max ? baro : max;
+		if (split(line, field, CSV_FIELDS) <= max)
+			continue;
+		s.t = strtod(field[time], NULL);
+		s.state = (uint8_t) atoi(field[state]);
+		s.height = strtod(field[height], NULL);
+		s.speed = strtod(field[speed], NULL);
+		/* Boards without an accelerometer write AltosLib.MISSING */
+		if (s.speed >= CSV_MISSING && baro >= 0)
+			s.speed = strtod(field[baro], NULL);
+		s.accel = strtod(field[accel], NULL);
+		if (log->n == 0 && serial >= 0 && flight >= 0){
+			log->serial = (uint16_t) atoi(field[serial]);
+			log->flight = (uint16_t) atoi(field[flight]);
+		}
+		if (add(log, &s) != 0){
+			flight_log_free(log);
+			return fail(err, err_len, "%s", strerror(errno));
+		}
+	}
+	if (log->n == 0)
+		return fail(err, err_len, "no samples");
+
+	/* AltosUI times are from boost; replay from the first sample */
+	for (n = (int) log->n - 1; n >= 0; n--)
+		log->s[n].t -= log->s[0].t;
+	return 0;
+}
+
+/* Integer value of "key" in a flat bit of JSON, or def */
+static long json_int(const char *json, const char *key, long def){
+	char quoted[64];
+	const char *p;
+
+	snprintf(quoted, sizeof (quoted), "\"%s\"", key);
+	if (!(p = strstr(json, quoted)))
+		return def;
+	p += strlen(quoted);
+	while (isspace((unsigned char) *p))
+		p++;
+	if (*p != ':')
+		return def;
+	return strtol(p + 1, NULL, 0);
+}
+
+/* The config object: lines until the braces balance */
+static char *read_json(FILE *in){
+	char line[1024], *json = NULL, *n;
+	size_t len = 0;
+	int depth = 0, started = 0, quoted = 0;
+	char *c;
+
+	while (fgets(line, sizeof (line), in)){
+		for (c = line; *c; c++){
+			if (*c == '"' && (c == line || c[-1] != '\\'))
+				quoted = !quoted;
+			else if (!quoted && *c == '{'){
+				depth++;
+				started = 1;
+			}
+			else if (!quoted && *c == '}')
+				depth--;
+		}
+		n = realloc(json, len + strlen(line) + 1);
+		if (!n){
+			free(json);
+			return NULL;
+		}
+		json = n;
+		strcpy(json + len, line);
+		len += strlen(line);
+		if (started && depth == 0)
+			return json;
+	}
+	free(json);
+	return NULL;
+}
+
+struct ms5607_prom {
+	int64_t		sens, off, tcs, tco, tref, tempsens;
+};
+
+/* MS5607 datasheet first and second order compensation, pressure only; Pa */
+static double ms5607_pressure(const struct ms5607_prom *p, uint32_t d1, uint32_t d2){
+	int64_t dt, temp, off, sens, off2 = 0, sens2 = 0, tm, tp;
+
+	dt = (int64_t) d2 - (p->tref << 8);
+	temp = 2000 + ((dt * p->tempsens) >> 23);
+	off = (p->off << 17) + ((p->tco * dt) >> 6);
+	sens = (p->sens << 16) + ((p->tcs * dt) >> 7);
+	if (temp < 2000){
+		tm = temp - 2000;
+		off2 = 61 * tm * tm / 16;
+		sens2 = 2 * tm * tm;
+		if (temp < -1500){
+			tp = temp + 1500;
+			off2 += 15 * tp * tp;
+			sens2 += 8 * tp * tp;
+		}
+	}
+	off -= off2;
+	sens -= sens2;
+	return (double) (((((int64_t) d1 * sens) >> 21) - off) >> 15);
+}
+
+/* Troposphere of the standard atmosphere, plenty for a height above the pad */
+static double altitude(double pa){
+	return 44330.77 * (1 - pow(pa / 101325.0, 0.190263));
+}
+
+static uint16_t get16(const uint8_t *p){
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static int mega_valid(const uint8_t *r){
+	uint8_t sum = 0x5a;
+	int i;
+
+	for (i = 0; i < MEGA_RECORD; i++)
+		sum += r[i];
+	return sum == 0;
+}
+
+int flight_log_read_eeprom(struct flight_log *log, FILE *in, char *err, size_t err_len){
+	struct ms5607_prom prom;
+	struct flight_sample s;
+	uint8_t *data = NULL, *r, *n;
+	size_t len = 0, size = 0, pos;
+	unsigned byte;
+	char *json, *ms;
+	long format, plus_g, minus_g;
+	int64_t tick = 0, first = 0;
+	int16_t ground_accel = 0;
+	double ground = 0, scale, t, dt, h, v, resid;
+	int have_ground = 0, have_tick = 0, have_sample = 0;
+	uint8_t state = COMPANION_STATE_STARTUP;
+
+	memset(log, 0, sizeof (*log));
+	if (!(json = read_json(in)))
+		return fail(err, err_len, "no config at the start of the file");
+	format = json_int(json, "log_format", 0);
+	log->serial = (uint16_t) json_int(json, "serial", 0);
+	plus_g = json_int(json, "accel_cal_plus", 0);
+	minus_g = json_int(json, "accel_cal_minus", 0);
+	ms = strstr(json, "\"ms5607\"");
+	if (!ms || minus_g == plus_g){
+		free(json);
+		return fail(err, err_len, "config has no ms5607 or accelerometer calibration");
+	}
+	prom.sens = json_int(ms, "sens", 0);
+	prom.off = json_int(ms, "off", 0);
+	prom.tcs = json_int(ms, "tcs", 0);
+	prom.tco = json_int(ms, "tco", 0);
+	prom.tref = json_int(ms, "tref", 0);
+	prom.tempsens = json_int(ms, "tempsens", 0);
+	free(json);
+
+	switch (format){
+	case 5:		/* AO_LOG_FORMAT_TELEMEGA_OLD */
+	case 10:	/* AO_LOG_FORMAT_TELEMEGA */
+	case 15:	/* AO_LOG_FORMAT_TELEMEGA_3 */
+	case 16:	/* AO_LOG_FORMAT_EASYMEGA_2 */
+	case 19:	/* AO_LOG_FORMAT_TELEMEGA_4 */
+	case 21:	/* AO_LOG_FORMAT_TELEMEGA_5 */
+		break;
+	default:
+		return fail(err, err_len, "log format %ld is not a TeleMega log", format);
+	}
+
+	while (fscanf(in, "%x", &byte) == 1){
+		if (len == size){
+			size = size ? size * 2 : 65536;
+			if (!(n = realloc(data, size))){
+				free(data);
+				return fail(err, err_len, "%s", strerror(errno));
+			}
+			data = n;
+		}
+		data[len++] = (uint8_t) byte;
+	}
+
+	scale = GRAVITY * 2.0 / (double) (minus_g - plus_g);
+	h = v = 0;
+	for (pos = 0; pos + MEGA_RECORD <= len; pos += MEGA_RECORD){
+		r = data + pos;
+		if (!mega_valid(r))
+			continue;
+
+		/* 100 Hz ticks, unwrapped */
+		if (!have_tick){
+			tick = first = get16(r + 2);
+			have_tick = 1;
+		}
+		else
+			tick += (int16_t) (get16(r + 2) - (uint16_t) tick);
+		t = (tick - first) / 100.0;
+
+		switch (r[0]){
+		case MEGA_FLIGHT:
+			log->flight = get16(r + 4);
+			ground_accel = (int16_t) get16(r + 6);
+			ground = altitude((double) get32(r + 8));
+			have_ground = 1;
+			break;
+		case MEGA_STATE:
+			state = (uint8_t) get16(r + 4);
+			break;
+		case MEGA_SENSOR:
+			if (!have_ground)
+				break;
+			s.t = t;
+			s.state = state;
+			s.accel = (ground_accel - (int16_t) get16(r + 30)) * scale;
+
+			/* Accelerometer carries the speed, the baro pulls it back */
+			dt = have_sample ? t - log->s[log->n - 1].t : 0;
+			h += v * dt + s.accel * dt * dt / 2;
+			v += s.accel * dt;
+			resid = altitude(ms5607_pressure(&prom, get32(r + 4), get32(r + 8))) - ground - h;
+			if (!have_sample)
+				h += resid;
+			else {
+				h += 0.05 * resid;
+				v += 0.5 * resid * dt;
+			}
+			s.height = h;
+			s.speed = v;
+			if (add(log, &s) != 0){
+				free(data);
+				flight_log_free(log);
+				return fail(err, err_len, "%s", strerror(errno));
+			}
+			have_sample = 1;
+			break;
+		}
+	}
+	free(data);
+	if (log->n == 0)
+		return fail(err, err_len, "no sensor records");
+	return 0;
+}
+
+int flight_log_read(struct flight_log *log, const char *path, char *err, size_t err_len){
+	const char *ext = strrchr(path, '.');
+	FILE *in;
+	int ret;
+
+	if (!(in = fopen(path, "r")))
+		return fail(err, err_len, "%s", strerror(errno));
+	if (ext && strcmp(ext, ".eeprom") == 0)
+		ret = flight_log_read_eeprom(log, in, err, err_len);
+	else
+		ret = flight_log_read_csv(log, in, err, err_len);
+	fclose(in);
+	return ret;
+}
+
+void flight_log_at(const struct flight_log *log, double t, struct flight_sample *out){
+	size_t lo = 0, hi = log->n - 1, mid;
+	const struct flight_sample *a, *b;
+	double f;
+
+	if (t <= log->s[0].t){
+		*out = log->s[0];
+		return;
+	}
+	if (t >= log->s[hi].t){
+		*out = log->s[hi];
+		return;
+	}
+	while (hi - lo > 1){
+		mid = (lo + hi) / 2;
+		if (log->s[mid].t <= t)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	a = &log->s[lo];
+	b = &log->s[hi];
+	f = b->t > a->t ? (t - a->t) / (b->t - a->t) : 0;
+	out->t = t;
+	out->state = a->state;
+	out->height = a->height + (b->height - a->height) * f;
+	out->speed = a->speed + (b->speed - a->speed) * f;
+	out->accel = a->accel + (b->accel - a->accel) * f;
+}
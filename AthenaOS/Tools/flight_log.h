@@ -0,0 +1,45 @@
+/*
+ * flight_log.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef FLIGHT_LOG_H_
+#define FLIGHT_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * A TeleMega flight as the companion link would have seen it: what
+ * its flight filter knew at each sample, in SI units, time from the
+ * first sample.
+ */
+struct flight_sample {
+	double		t;			/* s */
+	uint8_t		state;		/* COMPANION_STATE_x */
+	double		height;		/* m above the pad */
+	double		speed;		/* m/s */
+	double		accel;		/* m/s^2 */
+};
+
+struct flight_log {
+	struct flight_sample	*s;
+	size_t					n;
+	size_t					size;
+	uint16_t				serial;
+	uint16_t				flight;
+};
+
+/* By extension: .eeprom (ao-eeprom-read.c layout) or AltosUI .csv */
+int flight_log_read(struct flight_log *log, const char *path, char *err, size_t err_len);
+int flight_log_read_csv(struct flight_log *log, FILE *in, char *err, size_t err_len);
+int flight_log_read_eeprom(struct flight_log *log, FILE *in, char *err, size_t err_len);
+void flight_log_free(struct flight_log *log);
+
+/* Linear between samples, state from the last sample at or before t */
+void flight_log_at(const struct flight_log *log, double t, struct flight_sample *out);
+
+#endif /* FLIGHT_LOG_H_ */
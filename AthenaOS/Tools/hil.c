@@ -0,0 +1,359 @@
+/*
+ * hil.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Fly a recorded TeleMega flight through the board on the bench:
+ *
+ *	hil [--tty /dev/ttyACM0] [--rate x] [--csv out.csv] [--save capture.bin]
+ *	    flight.{csv,eeprom}
+ *	hil --capture capture.bin [--csv out.csv]
+ *
+ * Puts the board in HIL mode and sends the flight as the SPI1
+ * transactions the TeleMega would clock, a SETUP and then a FETCH
+ * every 10 ms (--rate 2 sends them twice as fast, flight time and all),
+ * which the firmware decodes with the same code as the real link.
+ * Every control tick comes back as a RECORDER_HIL record with its
+ * cycle timestamps, so this reports frame to stepper latency, tick
+ * execution time and frames that never made it to a tick, and --csv
+ * writes the ticks out. --save keeps everything the board sent, and
+ * --capture reads that back in place of a board for the same report.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "companion.h"
+#include "upload.h"
+#include "telemetry.h"
+#include "link.h"
+#include "flight_log.h"
+
+#define HIL_DRAIN	0.2		/* s, listening after the last frame */
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "rate", .has_arg = 1, .val = 'r' },
+	{ .name = "csv", .has_arg = 1, .val = 'c' },
+	{ .name = "save", .has_arg = 1, .val = 's' },
+	{ .name = "capture", .has_arg = 1, .val = 'C' },
+	{ 0, 0, 0, 0},
+};
+
+struct series {
+	uint32_t	*v;
+	size_t		n;
+	size_t		size;
+};
+
+struct stats {
+	struct series	latency;	/* us, frame decoded to stepper retargeted */
+	struct series	exec;		/* us, tick start to stepper retargeted */
+	uint32_t	ticks;
+	uint32_t	frames;			/* ticks on a new frame */
+	uint32_t	skipped;		/* companion ticks no control tick saw */
+	uint32_t	local;
+	uint32_t	injected;
+	uint32_t	rejected;
+	uint32_t	bad;
+	uint16_t	last_tick;
+	int			have_status;
+	struct telemetry_status	status;
+};
+
+static volatile sig_atomic_t done;
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--rate=<x>] [--csv=<out.csv>] [--save=<capture>] <flight>\n"
+		"       %s --capture=<capture> [--csv=<out.csv>]\n", program, program);
+	exit(1);
+}
+
+static void stop(int sig){
+	(void) sig;
+	done = 1;
+}
+
+static double now(void){
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static int16_t clamp16(double v){
+	v = round(v);
+	return (int16_t) (v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+/* One chip select of bytes, as ao_companion.c clocks them out; returns the length */
+static uint16_t transaction(uint8_t *buf, uint8_t command, const struct flight_log *log,
+		const struct flight_sample *s, uint16_t tick){
+	uint16_t reply = command == COMPANION_SETUP ? COMPANION_SETUP_SIZE : 2 * COMPANION_CHANNELS;
+
+	buf[0] = command;
+	buf[1] = s->state;
+	put16(buf + 2, tick);
+	put16(buf + 4, log->serial);
+	put16(buf + 6, log->flight);
+	put16(buf + 8, (uint16_t) clamp16(s->accel * 16));
+	put16(buf + 10, (uint16_t) clamp16(s->speed * 16));
+	put16(buf + 12, (uint16_t) clamp16(s->height));
+	put16(buf + 14, 0);
+	memset(buf + COMPANION_COMMAND_SIZE, 0xff, reply);
+	return COMPANION_COMMAND_SIZE + reply;
+}
+
+static void series_add(struct series *s, uint32_t x){
+	if (s->n == s->size){
+		s->size = s->size ? s->size * 2 : 4096;
+		s->v = realloc(s->v, s->size * sizeof (*s->v));
+		if (!s->v){
+			perror("realloc");
+			exit(1);
+		}
+	}
+	s->v[s->n++] = x;
+}
+
+static void hil_record(struct stats *st, const uint8_t *rec, FILE *csv){
+	struct recorder_hil h;
+	uint32_t latency = 0, exec;
+
+	recorder_DecodeHil(rec, &h);
+	if (h.mhz == 0){
+		st->bad++;
+		return;
+	}
+	st->ticks++;
+	exec = (h.done_cycles - h.start_cycles) / h.mhz;
+	series_add(&st->exec, exec);
+	if (h.flags & RECORDER_HIL_FRAME){
+		latency = (h.done_cycles - h.frame_cycles) / h.mhz;
+		series_add(&st->latency, latency);
+		if (st->frames && (uint16_t) (h.companion_tick - st->last_tick) > 1)
+			st->skipped += (uint16_t) (h.companion_tick - st->last_tick) - 1;
+		st->last_tick = h.companion_tick;
+		st->frames++;
+	}
+	if (h.flags & RECORDER_HIL_LOCAL)
+		st->local++;
+	if (csv)
+		fprintf(csv, "%u,%u,%u,%u,%d,%.4f,%d,%d,%u,%u\n", (unsigned) h.tick, h.mode, h.flags,
+			h.companion_tick, h.height, h.speed / 16.0, (int) h.commanded, (int) h.position,
+			(unsigned) latency, (unsigned) exec);
+}
+
+/* Whatever the board sent, into the capture and the stats */
+static void hil_frame(struct stats *st, const struct frame_rx *rx, FILE *csv, FILE *save){
+	uint8_t buf[FRAME_MAX];
+
+	if (save)
+		fwrite(buf, 1, frame_Encode(buf, rx->type, rx->payload, rx->len), save);
+	switch (rx->type){
+	case TELEMETRY_CONTROL:
+		if (rx->len != RECORDER_RECORD_SIZE)
+			st->bad++;
+		else if (recorder_Check(rx->payload) == RECORDER_HIL)
+			hil_record(st, rx->payload, csv);
+		else if (recorder_Check(rx->payload) != RECORDER_CONTROL)
+			st->bad++;
+		break;
+	case TELEMETRY_STATUS:
+		if (rx->len != TELEMETRY_STATUS_WORDS * 4){
+			st->bad++;
+			break;
+		}
+		telemetry_DecodeStatus(rx->payload, &st->status);
+		st->have_status = 1;
+		break;
+	case UPLOAD_INJECT | UPLOAD_REPLY:
+		if (rx->len < 1 || rx->payload[0] != UPLOAD_OK)
+			st->rejected++;
+		break;
+	}
+}
+
+static int compare(const void *a, const void *b){
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *what, struct series *s){
+	if (s->n == 0){
+		printf("%s: none\n", what);
+		return;
+	}
+	qsort(s->v, s->n, sizeof (*s->v), compare);
+	printf("%s: %zu, p50 %u p99 %u max %u us\n", what, s->n, (unsigned) s->v[s->n / 2],
+	       (unsigned) s->v[(uint64_t) s->n * 99 / 100], (unsigned) s->v[s->n - 1]);
+}
+
+/* Listen until when, or for good with when 0; returns -1 once the link is gone */
+static int hil_listen(struct link *l, struct stats *st, double when, FILE *csv, FILE *save){
+	double left;
+
+	for (;;){
+		left = when - now();
+		if (when && left <= 0)
+			return 0;
+		l->timeout = when ? (int) ceil(left * 1000) : 1000;
+		if (link_recv(l) != 0){
+			if (errno == ETIMEDOUT || errno == EINTR){
+				if (done)
+					return 0;
+				continue;
+			}
+			return -1;
+		}
+		hil_frame(st, &l->rx, csv, save);
+	}
+}
+
+static int hil_fly(struct link *l, const struct flight_log *log, double rate, struct stats *st,
+		FILE *csv, FILE *save){
+	uint8_t buf[COMPANION_COMMAND_SIZE + 2 * COMPANION_CHANNELS + COMPANION_SETUP_SIZE];
+	struct flight_sample s;
+	double end = log->s[log->n - 1].t, start;
+	uint16_t tick = 0;
+	uint32_t n;
+	int status;
+
+	if ((status = link_telemetry(l, 1)) != UPLOAD_OK || (status = link_hil(l, 1)) != UPLOAD_OK){
+		if (status < 0)
+			fprintf(stderr, "hil: %s\n", strerror(errno));
+		else
+			fprintf(stderr, "hil: status %d%s\n", status,
+				status == UPLOAD_FAILED ? " (the TeleMega says it's flying)" : "");
+		return -1;
+	}
+
+	flight_log_at(log, 0, &s);
+	status = link_inject(l, buf, transaction(buf, COMPANION_SETUP, log, &s, tick));
+	if (status != UPLOAD_OK){
+		fprintf(stderr, "hil: setup rejected (%d)\n", status);
+		link_hil(l, 0);
+		return -1;
+	}
+
+	start = now();
+	for (n = 0; !done && n * 0.01 <= end; n++){
+		flight_log_at(log, n * 0.01, &s);
+		if (link_send(l, UPLOAD_INJECT, buf, transaction(buf, COMPANION_FETCH, log, &s, ++tick)) != 0)
+			break;
+		st->injected++;
+		if (hil_listen(l, st, start + (n + 1) * 0.01 / rate, csv, save) != 0)
+			break;
+	}
+	hil_listen(l, st, now() + HIL_DRAIN, csv, save);
+
+	l->timeout = 5000;
+	link_hil(l, 0);
+	link_telemetry(l, 0);
+	return 0;
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0", *csv_path = NULL, *save_path = NULL, *capture = NULL;
+	struct flight_log log;
+	struct stats st;
+	struct sigaction sa;
+	struct link l;
+	FILE *csv = NULL, *save = NULL;
+	double rate = 1;
+	char err[256];
+	int c;
+
+	while ((c = getopt_long(argc, argv, "T:r:c:s:C:", options, NULL)) != -1){
+		switch (c){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'r':
+			rate = strtod(optarg, NULL);
+			if (!(rate > 0))
+				usage(argv[0]);
+			break;
+		case 'c':
+			csv_path = optarg;
+			break;
+		case 's':
+			save_path = optarg;
+			break;
+		case 'C':
+			capture = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != (capture ? 0 : 1) || (capture && save_path))
+		usage(argv[0]);
+
+	if (!capture && flight_log_read(&log, argv[optind], err, sizeof (err)) != 0){
+		fprintf(stderr, "%s: %s\n", argv[optind], err);
+		return 1;
+	}
+	if (link_open(&l, capture ? capture : tty) != 0){
+		perror(capture ? capture : tty);
+		return 1;
+	}
+	if (csv_path){
+		if (!(csv = fopen(csv_path, "w"))){
+			perror(csv_path);
+			return 1;
+		}
+		fprintf(csv, "tick,mode,flags,companion_tick,height,speed,commanded,position,latency_us,exec_us\n");
+	}
+	if (save_path && !(save = fopen(save_path, "wb"))){
+		perror(save_path);
+		return 1;
+	}
+
+	memset(&sa, 0, sizeof (sa));
+	sa.sa_handler = stop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	memset(&st, 0, sizeof (st));
+	if (capture)
+		hil_listen(&l, &st, 0, csv, NULL);
+	else {
+		if (hil_fly(&l, &log, rate, &st, csv, save) != 0)
+			return 1;
+		printf("flight: serial %u flight %u, %u frames at %gx\n", log.serial, log.flight,
+		       (unsigned) st.injected, rate);
+		flight_log_free(&log);
+	}
+	link_close(&l);
+	if (csv)
+		fclose(csv);
+	if (save)
+		fclose(save);
+
+	printf("ticks: %u, %u on a new frame, %u frames never seen, %u on local sensors, "
+	       "%u transactions rejected, %u bad records\n", (unsigned) st.ticks, (unsigned) st.frames,
+	       (unsigned) st.skipped, (unsigned) st.local, (unsigned) st.rejected, (unsigned) st.bad);
+	report("frame to stepper", &st.latency);
+	report("tick", &st.exec);
+	if (st.have_status)
+		printf("board: period %u-%u us, exec max %u us, %u overruns, %u telemetry drops\n",
+		       (unsigned) st.status.period_min, (unsigned) st.status.period_max,
+		       (unsigned) st.status.exec_max, (unsigned) st.status.overruns,
+		       (unsigned) st.status.telemetry_drops);
+	free(st.latency.v);
+	free(st.exec.v);
+	return 0;
+}
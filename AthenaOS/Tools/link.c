@@ -0,0 +1,258 @@
+/*
+ * link.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Talks the upload protocol to Athena over its CDC tty, using the
+ * same frame code as the firmware. Writes are pipelined: up to
+ * LINK_WINDOW are sent before waiting on the first reply, so the
+ * board is never idle waiting for the host.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "upload.h"
+#include "link.h"
+
+static uint32_t get32(const uint8_t *p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+int link_open(struct link *l, const char *tty){
+	struct termios t;
+
+	l->fd = open(tty, O_RDWR | O_NOCTTY);
+	if (l->fd < 0)
+		return -1;
+	if (tcgetattr(l->fd, &t) == 0){
+		cfmakeraw(&t);
+		tcsetattr(l->fd, TCSANOW, &t);
+	}
+	tcflush(l->fd, TCIOFLUSH);
+	l->timeout = 5000;
+	frame_Reset(&l->rx);
+	return 0;
+}
+
+void link_close(struct link *l){
+	close(l->fd);
+}
+
+int link_send(struct link *l, uint8_t type, const uint8_t *payload, uint16_t len){
+	uint8_t buf[FRAME_MAX];
+	uint16_t n = frame_Encode(buf, type, payload, len);
+	uint16_t off = 0;
+	ssize_t r;
+
+	while (off < n){
+		r = write(l->fd, buf + off, n - off);
+		if (r < 0){
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		off += r;
+	}
+	return 0;
+}
+
+/* Wait for the next good frame, which lands in l->rx */
+int link_recv(struct link *l){
+	struct pollfd p = { .fd = l->fd, .events = POLLIN };
+	uint8_t c;
+	ssize_t r;
+
+	for (;;){
+		r = poll(&p, 1, l->timeout);
+		if (r == 0){
+			errno = ETIMEDOUT;
+			return -1;
+		}
+		if (r < 0){
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		r = read(l->fd, &c, 1);
+		if (r <= 0){
+			if (r < 0 && errno == EINTR)
+				continue;
+			errno = r == 0 ? EPIPE : errno;
+			return -1;
+		}
+		if (frame_Input(&l->rx, c))
+			return 0;
+	}
+}
+
+static int link_reply(struct link *l, uint8_t type){
+	/* Telemetry may be streaming too; anything that isn't a reply is skipped */
+	do {
+		if (link_recv(l) != 0)
+			return -1;
+	} while (!(l->rx.type & UPLOAD_REPLY));
+	if (l->rx.type != (type | UPLOAD_REPLY) || l->rx.len < 1){
+		errno = EPROTO;
+		return -1;
+	}
+	return l->rx.payload[0];
+}
+
+/* Send one command and return the status byte of its reply */
+int link_command(struct link *l, uint8_t type, const uint8_t *payload, uint16_t len){
+	if (link_send(l, type, payload, len) != 0)
+		return -1;
+	return link_reply(l, type);
+}
+
+int link_ping(struct link *l, struct link_info *info){
+	int status = link_command(l, UPLOAD_PING, NULL, 0);
+	const uint8_t *p = l->rx.payload + 1;
+
+	if (status != UPLOAD_OK)
+		return status;
+	if (l->rx.len < 12){
+		errno = EPROTO;
+		return -1;
+	}
+	info->version = p[0];
+	info->size = get32(p + 1);
+	info->page = p[5] | (p[6] << 8);
+	info->sector = p[7] | (p[8] << 8);
+	info->max_data = p[9] | (p[10] << 8);
+	return 0;
+}
+
+int link_erase(struct link *l, uint32_t addr, uint32_t len){
+	uint8_t cmd[8];
+
+	put32(cmd, addr);
+	put32(cmd + 4, len);
+	return link_command(l, UPLOAD_ERASE, cmd, sizeof (cmd));
+}
+
+/* Page sized pieces, never crossing a page */
+static uint32_t link_chunk(uint32_t addr, uint32_t len){
+	uint32_t n = UPLOAD_MAX_DATA - (addr & (UPLOAD_MAX_DATA - 1));
+
+	return n < len ? n : len;
+}
+
+int link_write(struct link *l, uint32_t addr, const uint8_t *data, uint32_t len){
+	uint8_t cmd[4 + UPLOAD_MAX_DATA];
+	uint32_t sent = 0, acked = 0, ack_addr = addr, n;
+	int status;
+
+	while (acked < len){
+		while (sent < len && sent - acked < LINK_WINDOW * UPLOAD_MAX_DATA){
+			n = link_chunk(addr + sent, len - sent);
+			put32(cmd, addr + sent);
+			memcpy(cmd + 4, data + sent, n);
+			if (link_send(l, UPLOAD_WRITE, cmd, 4 + n) != 0)
+				return -1;
+			sent += n;
+		}
+		status = link_reply(l, UPLOAD_WRITE);
+		if (status != UPLOAD_OK)
+			return status;
+		if (l->rx.len < 5 || get32(l->rx.payload + 1) != ack_addr){
+			errno = EPROTO;
+			return -1;
+		}
+		n = link_chunk(ack_addr, len - acked);
+		ack_addr += n;
+		acked += n;
+	}
+	return 0;
+}
+
+int link_read(struct link *l, uint32_t addr, uint8_t *data, uint32_t len){
+	uint8_t cmd[6];
+	uint32_t n;
+	int status;
+
+	while (len){
+		n = len < UPLOAD_MAX_DATA ? len : UPLOAD_MAX_DATA;
+		put32(cmd, addr);
+		put16(cmd + 4, n);
+		status = link_command(l, UPLOAD_READ, cmd, sizeof (cmd));
+		if (status != UPLOAD_OK)
+			return status;
+		if (l->rx.len != 5 + n || get32(l->rx.payload + 1) != addr){
+			errno = EPROTO;
+			return -1;
+		}
+		memcpy(data, l->rx.payload + 5, n);
+		addr += n;
+		data += n;
+		len -= n;
+	}
+	return 0;
+}
+
+int link_crc(struct link *l, uint32_t addr, uint32_t len, uint32_t *crc){
+	uint8_t cmd[8];
+	int status;
+
+	put32(cmd, addr);
+	put32(cmd + 4, len);
+	status = link_command(l, UPLOAD_CRC, cmd, sizeof (cmd));
+	if (status != UPLOAD_OK)
+		return status;
+	if (l->rx.len != 5){
+		errno = EPROTO;
+		return -1;
+	}
+	*crc = get32(l->rx.payload + 1);
+	return 0;
+}
+
+int link_reload(struct link *l){
+	return link_command(l, UPLOAD_RELOAD, NULL, 0);
+}
+
+int link_telemetry(struct link *l, uint8_t divisor){
+	return link_command(l, UPLOAD_TELEMETRY, &divisor, 1);
+}
+
+/* name gets PROFILE_NAME + 1 bytes; UPLOAD_BAD_ADDRESS past the last probe */
+int link_profile(struct link *l, uint8_t probe, uint8_t flags, uint32_t *hz, char *name,
+		struct profile_probe *p){
+	uint8_t cmd[2] = { probe, flags };
+	uint8_t id;
+	int status;
+
+	status = link_command(l, UPLOAD_PROFILE, cmd, sizeof (cmd));
+	if (status != UPLOAD_OK)
+		return status;
+	if (profile_Decode(l->rx.payload + 1, l->rx.len - 1, &id, hz, name, p) != 0 || id != probe){
+		errno = EPROTO;
+		return -1;
+	}
+	return 0;
+}
+
+int link_hil(struct link *l, uint8_t on){
+	return link_command(l, UPLOAD_HIL, &on, 1);
+}
+
+/* One companion transaction; hil streams these without waiting on each */
+int link_inject(struct link *l, const uint8_t *data, uint16_t len){
+	return link_command(l, UPLOAD_INJECT, data, len);
+}
@@ -0,0 +1,50 @@
+/*
+ * link.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include <stdint.h>
+#include "frame.h"
+#include "profile.h"
+
+/* Host end of the upload protocol in upload.h */
+struct link {
+	int				fd;
+	int				timeout;	/* ms */
+	struct frame_rx	rx;
+};
+
+struct link_info {
+	uint8_t		version;
+	uint32_t	size;
+	uint16_t	page;
+	uint16_t	sector;
+	uint16_t	max_data;
+};
+
+#define LINK_WINDOW	8	/* writes in flight */
+
+int link_open(struct link *l, const char *tty);
+void link_close(struct link *l);
+int link_send(struct link *l, uint8_t type, const uint8_t *payload, uint16_t len);
+int link_recv(struct link *l);
+int link_command(struct link *l, uint8_t type, const uint8_t *payload, uint16_t len);
+
+int link_ping(struct link *l, struct link_info *info);
+int link_erase(struct link *l, uint32_t addr, uint32_t len);
+int link_write(struct link *l, uint32_t addr, const uint8_t *data, uint32_t len);
+int link_read(struct link *l, uint32_t addr, uint8_t *data, uint32_t len);
+int link_crc(struct link *l, uint32_t addr, uint32_t len, uint32_t *crc);
+int link_reload(struct link *l);
+int link_telemetry(struct link *l, uint8_t divisor);
+int link_profile(struct link *l, uint8_t probe, uint8_t flags, uint32_t *hz, char *name,
+		struct profile_probe *p);
+int link_hil(struct link *l, uint8_t on);
+int link_inject(struct link *l, const uint8_t *data, uint16_t len);
+
+#endif /* LINK_H_ */
@@ -0,0 +1,189 @@
+/*
+ * logdump.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Pull the flight log off Athena over USB and print it as CSV:
+ *
+ *	logdump [--tty /dev/ttyACM0] [--raw log.bin] [--erase]
+ *	logdump --sd ATHN0000.LOG
+ *
+ * Reads the storage region a page at a time until it finds one that
+ * was never written. Boot records come out as comment lines ahead of
+ * the flight they belong to. --raw also keeps the bytes as read, and
+ * --erase clears the pages that were used once they're safely off.
+ * --sd prints a log file off the microSD card instead, up to the
+ * first block that isn't the next one of that boot's log.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flash.h"
+#include "upload.h"
+#include "recorder.h"
+#include "sdlog.h"
+#include "link.h"
+#include "record_csv.h"
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "raw", .has_arg = 1, .val = 'r' },
+	{ .name = "erase", .has_arg = 0, .val = 'e' },
+	{ .name = "sd", .has_arg = 1, .val = 's' },
+	{ 0, 0, 0, 0},
+};
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--raw=<file>] [--erase]\n"
+		"       %s --sd=<file>\n", program, program);
+	exit(1);
+}
+
+static int fail(const char *what, int status){
+	if (status < 0)
+		fprintf(stderr, "%s: %s\n", what, strerror(errno));
+	else
+		fprintf(stderr, "%s: status %d\n", what, status);
+	return 1;
+}
+
+static int erased(const uint8_t *page){
+	int i;
+
+	for (i = 0; i < RECORDER_PAGE_SIZE; i++)
+		if (page[i] != 0xff)
+			return 0;
+	return 1;
+}
+
+static void print_page(const uint8_t *page, uint32_t addr, unsigned *bad){
+	struct recorder_boot b;
+	struct recorder_control c;
+	const uint8_t *rec;
+	int i;
+
+	for (i = 0; i < RECORDER_PER_PAGE; i++){
+		rec = page + i * RECORDER_RECORD_SIZE;
+		switch (recorder_Check(rec)){
+		case RECORDER_BOOT:
+			recorder_DecodeBoot(rec, &b);
+			printf("# boot at 0x%06x: tick %u lut %08x target %d steps %d kp %g ki %g method %u dt %u\n",
+			       (unsigned) addr, (unsigned) b.tick, (unsigned) b.lut_crc, b.target, b.brake_steps,
+			       b.kp, b.ki, b.method, b.dt);
+			record_csv_header(stdout);
+			break;
+		case RECORDER_CONTROL:
+			recorder_DecodeControl(rec, &c);
+			record_csv(stdout, &c);
+			break;
+		case RECORDER_FRAME:
+		case RECORDER_BLOCK:
+		case RECORDER_EMPTY:
+			break;
+		default:
+			(*bad)++;
+			break;
+		}
+	}
+}
+
+static int dump_sd(const char *path){
+	uint8_t block[SDLOG_BLOCK_SIZE];
+	uint32_t session = 0, n;
+	unsigned bad = 0;
+	FILE *in;
+
+	if (!(in = fopen(path, "rb"))){
+		perror(path);
+		return 1;
+	}
+	for (n = 0; fread(block, 1, sizeof (block), in) == sizeof (block); n++){
+		if (sdlog_Check(block, &session, n) != 0)
+			break;
+		print_page(block, n * SDLOG_BLOCK_SIZE, &bad);
+		print_page(block + RECORDER_PAGE_SIZE, n * SDLOG_BLOCK_SIZE + RECORDER_PAGE_SIZE, &bad);
+	}
+	fclose(in);
+	fprintf(stderr, "%u blocks of log, %u bad records\n", (unsigned) n, bad);
+	return 0;
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0";
+	const char *raw = NULL, *sd = NULL;
+	uint8_t page[RECORDER_PAGE_SIZE];
+	struct link_info info;
+	struct link l;
+	uint32_t addr;
+	unsigned bad = 0;
+	FILE *out = NULL;
+	int erase = 0, c, status;
+
+	while ((c = getopt_long(argc, argv, "T:r:es:", options, NULL)) != -1){
+		switch (c){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'r':
+			raw = optarg;
+			break;
+		case 'e':
+			erase = 1;
+			break;
+		case 's':
+			sd = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc != optind || (sd && (raw || erase)))
+		usage(argv[0]);
+	if (sd)
+		return dump_sd(sd);
+
+	if (raw && !(out = fopen(raw, "wb"))){
+		perror(raw);
+		return 1;
+	}
+	if (link_open(&l, tty) != 0){
+		perror(tty);
+		return 1;
+	}
+	if ((status = link_ping(&l, &info)) != 0)
+		return fail("ping", status);
+	if (info.version != UPLOAD_VERSION){
+		fprintf(stderr, "board speaks upload version %d, need %d\n", info.version, UPLOAD_VERSION);
+		return 1;
+	}
+
+	for (addr = FLASH_STORAGE_ADDR; addr < info.size; addr += RECORDER_PAGE_SIZE){
+		if ((status = link_read(&l, addr, page, sizeof (page))) != 0)
+			return fail("read", status);
+		if (erased(page))
+			break;
+		if (out && fwrite(page, 1, sizeof (page), out) != sizeof (page)){
+			perror(raw);
+			return 1;
+		}
+		print_page(page, addr, &bad);
+	}
+	if (out)
+		fclose(out);
+	fprintf(stderr, "%u bytes of log, %u bad records\n", (unsigned) (addr - FLASH_STORAGE_ADDR), bad);
+
+	if (erase && addr > FLASH_STORAGE_ADDR){
+		/* The board erases in the background as the next log needs it */
+		if ((status = link_erase(&l, FLASH_STORAGE_ADDR,
+				(addr - FLASH_STORAGE_ADDR + info.sector - 1) / info.sector * info.sector)) != 0)
+			return fail("erase", status);
+		fprintf(stderr, "erased\n");
+	}
+
+	link_close(&l);
+	return 0;
+}
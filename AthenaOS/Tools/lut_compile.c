@@ -0,0 +1,297 @@
+/*
+ * lut_compile.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Turns a CSV drag table into the on-flash format in lut.h. The CSV
+ * has to be a full regular grid of (speed, height, Cd) points in any
+ * order; the columns are picked out of the header line by name, which
+ * also works for OpenRocket exports with their "# Name (unit)," header.
+ * With no header the first three columns are used.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "crc.h"
+#include "lut.h"
+#include "lut_compile.h"
+
+#define MAX_COLUMNS	64
+#define MAX_AXIS	4096
+
+struct point {
+	double	x, y, z;
+};
+
+static void error(char *err, size_t err_len, const char *fmt, ...){
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(err, err_len, fmt, ap);
+	va_end(ap);
+}
+
+static int split(char *line, char **fields){
+	int n = 0;
+	char *s = line, *e;
+
+	for (;;){
+		while (isspace((unsigned char) *s))
+			s++;
+		if (n == MAX_COLUMNS)
+			break;
+		fields[n++] = s;
+		e = strchr(s, ',');
+		if (!e){
+			e = s + strlen(s);
+			while (e > s && isspace((unsigned char) e[-1]))
+				*--e = '\0';
+			break;
+		}
+		*e = '\0';
+		s = e + 1;
+	}
+	return n;
+}
+
+static int find_column(char **fields, int n, const char *name){
+	size_t len = strlen(name);
+	int i;
+	const char *f;
+
+	for (i = 0; i < n; i++)
+		for (f = fields[i]; *f; f++)
+			if (strncasecmp(f, name, len) == 0)
+				return i;
+	return -1;
+}
+
+static int numeric(const char *s){
+	char *end;
+
+	strtod(s, &end);
+	return end != s;
+}
+
+static int compare(const void *a, const void *b){
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sorted distinct values of one axis, which have to be evenly spaced */
+static int axis(const struct point *p, size_t n, size_t off, double *v, int *count, double *step,
+		const char *name, char *err, size_t err_len){
+	double *all = malloc(n * sizeof (double));
+	size_t i;
+	int c = 0;
+
+	if (!all){
+		error(err, err_len, "out of memory");
+		return -1;
+	}
+	for (i = 0; i < n; i++)
+		all[i] = *(const double *) ((const char *) &p[i] + off);
+	qsort(all, n, sizeof (double), compare);
+	for (i = 0; i < n; i++)
+		if (i == 0 || all[i] != all[i - 1]){
+			if (c == MAX_AXIS){
+				free(all);
+				error(err, err_len, "too many %s values", name);
+				return -1;
+			}
+			v[c++] = all[i];
+		}
+	free(all);
+	if (c < 2){
+		error(err, err_len, "need at least two %s values", name);
+		return -1;
+	}
+	*step = (v[c - 1] - v[0]) / (c - 1);
+	for (i = 0; i < (size_t) c; i++)
+		if (fabs(v[i] - (v[0] + i * *step)) > *step * 1e-3){
+			error(err, err_len, "%s values are not evenly spaced (%g)", name, v[i]);
+			return -1;
+		}
+	*count = c;
+	return 0;
+}
+
+/* Axis value in table units, which have to come out whole */
+static int units(double v, double scale, int32_t *out, const char *name, char *err, size_t err_len){
+	double u = v * scale;
+
+	if (fabs(u - lrint(u)) > 1e-3 || fabs(u) > INT32_MAX){
+		error(err, err_len, "%s %g is not a whole number of table units", name, v);
+		return -1;
+	}
+	*out = (int32_t) lrint(u);
+	return 0;
+}
+
+static void put16(uint8_t *p, uint16_t v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v){
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+int lut_compile(FILE *in, const struct lut_columns *cols, uint8_t **out, uint32_t *out_len,
+		char *err, size_t err_len){
+	char line[4096], raw[4096], header[4096] = "";
+	char *fields[MAX_COLUMNS];
+	int n, cx = 0, cy = 1, cz = 2, have_columns = 0, lineno = 0;
+	struct point *p = NULL, *np;
+	size_t npoints = 0, alloc = 0, k;
+	static double xv[MAX_AXIS], yv[MAX_AXIS];
+	int nx, ny, i, j;
+	double xstep, ystep;
+	int32_t x0, dx, y0, dy;
+	uint32_t stride, size;
+	uint8_t *bin, *filled;
+	long cell;
+
+	*out = NULL;
+	if (cols->frac_bits < 0 || cols->frac_bits > 15){
+		error(err, err_len, "fraction bits must be 0 to 15");
+		return -1;
+	}
+	while (fgets(line, sizeof (line), in)){
+		lineno++;
+		if (line[0] == '#'){
+			/* OpenRocket puts the column names in a comment */
+			if (strchr(line, ','))
+				strcpy(header, line + 1);
+			continue;
+		}
+		strcpy(raw, line);
+		n = split(line, fields);
+		if (n == 1 && fields[0][0] == '\0')
+			continue;
+		if (!numeric(fields[0])){
+			strcpy(header, raw);
+			continue;
+		}
+		if (!have_columns){
+			if (header[0]){
+				char *names[MAX_COLUMNS];
+				int nn = split(header, names);
+
+				cx = find_column(names, nn, cols->x);
+				cy = find_column(names, nn, cols->y);
+				cz = find_column(names, nn, cols->z);
+				if (cx < 0 || cy < 0 || cz < 0){
+					error(err, err_len, "no column named %s", cx < 0 ? cols->x : cy < 0 ? cols->y : cols->z);
+					goto fail;
+				}
+			}
+			have_columns = 1;
+		}
+		if (cx >= n || cy >= n || cz >= n){
+			error(err, err_len, "line %d: not enough columns", lineno);
+			goto fail;
+		}
+		if (npoints == alloc){
+			alloc = alloc ? alloc * 2 : 1024;
+			np = realloc(p, alloc * sizeof (*p));
+			if (!np){
+				error(err, err_len, "out of memory");
+				goto fail;
+			}
+			p = np;
+		}
+		p[npoints].x = strtod(fields[cx], NULL);
+		p[npoints].y = strtod(fields[cy], NULL);
+		p[npoints].z = strtod(fields[cz], NULL);
+		npoints++;
+	}
+	if (npoints == 0){
+		error(err, err_len, "no data");
+		goto fail;
+	}
+
+	if (axis(p, npoints, offsetof(struct point, x), xv, &nx, &xstep, cols->x, err, err_len) ||
+	    axis(p, npoints, offsetof(struct point, y), yv, &ny, &ystep, cols->y, err, err_len))
+		goto fail;
+	if ((size_t) nx * ny != npoints){
+		error(err, err_len, "%zu points is not a full %d x %d grid", npoints, nx, ny);
+		goto fail;
+	}
+	if (units(xv[0], 16, &x0, cols->x, err, err_len) || units(xstep, 16, &dx, cols->x, err, err_len) ||
+	    units(yv[0], 1, &y0, cols->y, err, err_len) || units(ystep, 1, &dy, cols->y, err, err_len))
+		goto fail;
+
+	stride = nx * 2;
+	size = LUT_HEADER_SIZE + ny * stride;
+	bin = calloc(1, size);
+	filled = calloc(1, (size_t) nx * ny);
+	if (!bin || !filled){
+		free(bin);
+		free(filled);
+		error(err, err_len, "out of memory");
+		goto fail;
+	}
+
+	for (k = 0; k < npoints; k++){
+		i = (int) lrint((p[k].x - xv[0]) / xstep);
+		j = (int) lrint((p[k].y - yv[0]) / ystep);
+		cell = lrint(p[k].z * (1 << cols->frac_bits));
+		if (filled[j * nx + i]){
+			error(err, err_len, "duplicate point at %g, %g", p[k].x, p[k].y);
+			goto fail_bin;
+		}
+		if (cell < INT16_MIN || cell > INT16_MAX){
+			error(err, err_len, "%g at %g, %g does not fit with %d fraction bits", p[k].z, p[k].x, p[k].y, cols->frac_bits);
+			goto fail_bin;
+		}
+		filled[j * nx + i] = 1;
+		put16(bin + LUT_HEADER_SIZE + j * stride + i * 2, (uint16_t) cell);
+	}
+
+	put32(bin + 0, LUT_MAGIC);
+	put16(bin + 4, LUT_VERSION);
+	put16(bin + 6, LUT_HEADER_SIZE);
+	put32(bin + 8, x0);
+	put32(bin + 12, dx);
+	put16(bin + 16, nx);
+	put16(bin + 18, ny);
+	put32(bin + 20, y0);
+	put32(bin + 24, dy);
+	put32(bin + 28, stride);
+	put32(bin + 32, LUT_HEADER_SIZE);
+	bin[36] = 2;
+	bin[37] = cols->frac_bits;
+	put32(bin + 40, ny * stride);
+	put32(bin + 44, crc32(CRC32_INIT, bin + LUT_HEADER_SIZE, ny * stride));
+
+	{
+		struct lut_header h;
+
+		if (lut_ParseHeader(&h, bin, size) != 0){
+			error(err, err_len, "%d x %d table with steps %d, %d can't be used by the firmware", nx, ny, dx, dy);
+			goto fail_bin;
+		}
+	}
+
+	free(filled);
+	free(p);
+	*out = bin;
+	*out_len = size;
+	return 0;
+
+fail_bin:
+	free(bin);
+	free(filled);
+fail:
+	free(p);
+	return -1;
+}
@@ -0,0 +1,26 @@
+/*
+ * lut_compile.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef LUT_COMPILE_H_
+#define LUT_COMPILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct lut_columns {
+	const char	*x;		/* speed, m/s */
+	const char	*y;		/* height, m */
+	const char	*z;		/* drag coefficient */
+	int			frac_bits;
+};
+
+#define LUT_COLUMNS_DEFAULT	{ "velocity", "altitude", "drag", 14 }
+
+int lut_compile(FILE *in, const struct lut_columns *cols, uint8_t **out, uint32_t *out_len,
+		char *err, size_t err_len);
+
+#endif /* LUT_COMPILE_H_ */
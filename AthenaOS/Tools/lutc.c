@@ -0,0 +1,84 @@
+/*
+ * lutc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Compile a CSV drag table for the flash:
+ *
+ *	lutc [--frac bits] [--speed col] [--height col] [--cd col] table.csv table.bin
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "lut.h"
+#include "lut_compile.h"
+
+static const struct option options[] = {
+	{ .name = "frac", .has_arg = 1, .val = 'f' },
+	{ .name = "speed", .has_arg = 1, .val = 'x' },
+	{ .name = "height", .has_arg = 1, .val = 'y' },
+	{ .name = "cd", .has_arg = 1, .val = 'z' },
+	{ 0, 0, 0, 0},
+};
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--frac=<bits>] [--speed=<column>] [--height=<column>] [--cd=<column>] <table.csv> <table.bin>\n", program);
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	struct lut_columns cols = LUT_COLUMNS_DEFAULT;
+	struct lut_header h;
+	char err[256];
+	uint8_t *bin;
+	uint32_t len;
+	FILE *in, *out;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "f:x:y:z:", options, NULL)) != -1){
+		switch (c){
+		case 'f':
+			cols.frac_bits = atoi(optarg);
+			break;
+		case 'x':
+			cols.x = optarg;
+			break;
+		case 'y':
+			cols.y = optarg;
+			break;
+		case 'z':
+			cols.z = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2)
+		usage(argv[0]);
+
+	in = fopen(argv[optind], "r");
+	if (!in){
+		perror(argv[optind]);
+		return 1;
+	}
+	if (lut_compile(in, &cols, &bin, &len, err, sizeof (err)) != 0){
+		fprintf(stderr, "%s: %s\n", argv[optind], err);
+		return 1;
+	}
+	fclose(in);
+
+	out = fopen(argv[optind + 1], "wb");
+	if (!out || fwrite(bin, 1, len, out) != len || fclose(out) != 0){
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	lut_ParseHeader(&h, bin, len);
+	printf("%s: %u x %u cells, speed %g + %g m/s, height %d + %d m, %u bytes, crc %08x\n",
+	       argv[optind + 1], h.nx, h.ny, h.x0 / 16.0, h.dx / 16.0, (int) h.y0, (int) h.dy,
+	       (unsigned) len, (unsigned) h.crc32);
+	free(bin);
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * lutload.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Put a compiled drag table on Athena's flash over USB:
+ *
+ *	lutload [--tty /dev/ttyACM0] [--addr addr] [--no-reload] table.bin
+ *
+ * Erases just the sectors the table needs, streams it in, checks the
+ * CRC the board computes from flash and has it reopen the table.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+#include "flash.h"
+#include "lut.h"
+#include "upload.h"
+#include "link.h"
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "addr", .has_arg = 1, .val = 'a' },
+	{ .name = "no-reload", .has_arg = 0, .val = 'n' },
+	{ 0, 0, 0, 0},
+};
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--addr=<addr>] [--no-reload] <table.bin>\n", program);
+	exit(1);
+}
+
+static int fail(const char *what, int status){
+	if (status < 0)
+		fprintf(stderr, "%s: %s\n", what, strerror(errno));
+	else
+		fprintf(stderr, "%s: status %d\n", what, status);
+	return 1;
+}
+
+static double now(void){
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0";
+	uint32_t addr = FLASH_LOOKUP_ADDR, len, crc;
+	struct lut_header h;
+	struct link_info info;
+	struct link l;
+	uint8_t *bin;
+	FILE *in;
+	long size;
+	int reload = 1, c, status;
+	double t0;
+
+	while ((c = getopt_long(argc, argv, "T:a:n", options, NULL)) != -1){
+		switch (c){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'a':
+			addr = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			reload = 0;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != 1)
+		usage(argv[0]);
+
+	in = fopen(argv[optind], "rb");
+	if (!in || fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) <= 0){
+		perror(argv[optind]);
+		return 1;
+	}
+	rewind(in);
+	len = size;
+	bin = malloc(len);
+	if (!bin || fread(bin, 1, len, in) != len){
+		perror(argv[optind]);
+		return 1;
+	}
+	fclose(in);
+	if (lut_ParseHeader(&h, bin, len) != 0 || h.data_offset + h.data_size > len ||
+	    crc32(CRC32_INIT, bin + h.data_offset, h.data_size) != h.crc32){
+		fprintf(stderr, "%s: not a drag table\n", argv[optind]);
+		return 1;
+	}
+	if (len > FLASH_FAULT_ADDR - addr){
+		fprintf(stderr, "%s: %u bytes won't fit below the fault sector at 0x%x\n", argv[optind],
+			(unsigned) len, FLASH_FAULT_ADDR);
+		return 1;
+	}
+
+	if (link_open(&l, tty) != 0){
+		perror(tty);
+		return 1;
+	}
+	if ((status = link_ping(&l, &info)) != 0)
+		return fail("ping", status);
+	if (info.version != UPLOAD_VERSION){
+		fprintf(stderr, "board speaks upload version %d, need %d\n", info.version, UPLOAD_VERSION);
+		return 1;
+	}
+	if (addr % info.sector || addr + len > info.size){
+		fprintf(stderr, "table doesn't fit at 0x%06x\n", (unsigned) addr);
+		return 1;
+	}
+
+	t0 = now();
+	if ((status = link_erase(&l, addr, (len + info.sector - 1) / info.sector * info.sector)) != 0)
+		return fail("erase", status);
+	printf("erased in %.2f s\n", now() - t0);
+
+	t0 = now();
+	if ((status = link_write(&l, addr, bin, len)) != 0)
+		return fail("write", status);
+	printf("wrote %u bytes in %.2f s\n", (unsigned) len, now() - t0);
+
+	if ((status = link_crc(&l, addr, len, &crc)) != 0)
+		return fail("crc", status);
+	if (crc != crc32(CRC32_INIT, bin, len)){
+		fprintf(stderr, "verify failed: flash crc %08x, file %08x\n", (unsigned) crc,
+			(unsigned) crc32(CRC32_INIT, bin, len));
+		return 1;
+	}
+	printf("verified, crc %08x\n", (unsigned) crc);
+
+	if (reload && (status = link_reload(&l)) != 0)
+		return fail("reload", status);
+
+	link_close(&l);
+	free(bin);
+	return 0;
+}
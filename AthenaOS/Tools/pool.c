@@ -0,0 +1,139 @@
+/*
+ * pool.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Work stealing over a range of job numbers. A worker's queue is just
+ * [lo, hi) under its own lock: the owner pops from hi, thieves take
+ * the lower half. Jobs here are whole simulated flights, milliseconds
+ * each, so a lock per pop costs nothing next to them and keeps it
+ * obviously right.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+struct pool_queue {
+	pthread_mutex_t	lock;
+	uint32_t		lo;
+	uint32_t		hi;
+};
+
+struct pool {
+	struct pool_queue	*q;
+	unsigned			workers;
+	void				(*fn)(void *arg, uint32_t i);
+	void				*arg;
+};
+
+struct pool_worker {
+	struct pool		*p;
+	unsigned		id;
+	pthread_t		thread;
+};
+
+unsigned pool_cores(void){
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (unsigned) n : 1;
+}
+
+static int pool_pop(struct pool_queue *q, uint32_t *i){
+	int got = 0;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->lo < q->hi){
+		*i = --q->hi;
+		got = 1;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return got;
+}
+
+/* Half of the victim's jobs, rounded up, into q */
+static int pool_steal(struct pool_queue *victim, struct pool_queue *q){
+	uint32_t lo, hi;
+
+	pthread_mutex_lock(&victim->lock);
+	lo = victim->lo;
+	hi = lo + (victim->hi - lo + 1) / 2;
+	victim->lo = hi;
+	pthread_mutex_unlock(&victim->lock);
+	if (lo == hi)
+		return 0;
+
+	pthread_mutex_lock(&q->lock);
+	q->lo = lo;
+	q->hi = hi;
+	pthread_mutex_unlock(&q->lock);
+	return 1;
+}
+
+static void *pool_work(void *arg){
+	struct pool_worker *w = arg;
+	struct pool *p = w->p;
+	struct pool_queue *q = &p->q[w->id];
+	unsigned k;
+	uint32_t i;
+
+	for (;;){
+		while (pool_pop(q, &i))
+			p->fn(p->arg, i);
+		/* Dry: try everyone else once, starting with the next along */
+		for (k = 1; k < p->workers; k++)
+			if (pool_steal(&p->q[(w->id + k) % p->workers], q))
+				break;
+		if (k == p->workers)
+			return NULL;
+	}
+}
+
+int pool_run(unsigned threads, uint32_t n, void (*fn)(void *arg, uint32_t i), void *arg){
+	struct pool p = { .fn = fn, .arg = arg };
+	struct pool_worker *w;
+	unsigned k, started;
+	int r = 0;
+
+	if (threads == 0)
+		threads = pool_cores();
+	if (threads > n)
+		threads = n ? n : 1;
+	p.workers = threads;
+	p.q = calloc(threads, sizeof (*p.q));
+	w = calloc(threads, sizeof (*w));
+	if (!p.q || !w){
+		free(p.q);
+		free(w);
+		return -1;
+	}
+	for (k = 0; k < threads; k++){
+		pthread_mutex_init(&p.q[k].lock, NULL);
+		p.q[k].lo = (uint32_t) ((uint64_t) n * k / threads);
+		p.q[k].hi = (uint32_t) ((uint64_t) n * (k + 1) / threads);
+		w[k].p = &p;
+		w[k].id = k;
+	}
+
+	/* The calling thread is worker 0 */
+	for (started = 1; started < threads; started++)
+		if (pthread_create(&w[started].thread, NULL, pool_work, &w[started]) != 0){
+			r = -1;
+			break;
+		}
+	pool_work(&w[0]);
+	for (k = 1; k < started; k++)
+		pthread_join(w[k].thread, NULL);
+
+	/* Anything a worker that never started was holding */
+	for (k = started; k < threads; k++)
+		pool_work(&w[k]);
+
+	for (k = 0; k < threads; k++)
+		pthread_mutex_destroy(&p.q[k].lock);
+	free(p.q);
+	free(w);
+	return r;
+}
@@ -0,0 +1,24 @@
+/*
+ * pool.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+/*
+ * Run fn(arg, i) for every i in [0, n) on threads workers, 0 for one
+ * per core. Each worker starts with an even share of the range and
+ * takes from its own end; one that runs dry steals half of whatever a
+ * busy worker has left, so long and short jobs even out. Returns once
+ * every job is done: 0, or -1 if some threads couldn't be started and
+ * the rest had to do without them.
+ */
+int pool_run(unsigned threads, uint32_t n, void (*fn)(void *arg, uint32_t i), void *arg);
+unsigned pool_cores(void);
+
+#endif /* POOL_H_ */
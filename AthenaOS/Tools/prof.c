@@ -0,0 +1,111 @@
+/*
+ * prof.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Dump the profiler probes over USB:
+ *
+ *	prof [--tty /dev/ttyACM0] [--reset] [--histogram]
+ *
+ * Prints count, min, mean and max for every probe in microseconds.
+ * --histogram adds the log2 buckets that have anything in them, and
+ * --reset starts each probe over once it has been read.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "upload.h"
+#include "profile.h"
+#include "link.h"
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "reset", .has_arg = 0, .val = 'r' },
+	{ .name = "histogram", .has_arg = 0, .val = 'H' },
+	{ 0, 0, 0, 0},
+};
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--reset] [--histogram]\n", program);
+	exit(1);
+}
+
+static void print_histogram(const struct profile_probe *p, double mhz){
+	uint32_t peak = 0;
+	int i, bar;
+
+	for (i = 0; i < PROFILE_BINS; i++)
+		if (p->hist[i] > peak)
+			peak = p->hist[i];
+	for (i = 0; i < PROFILE_BINS; i++){
+		if (!p->hist[i])
+			continue;
+		bar = (int) ((uint64_t) p->hist[i] * 50 / peak);
+		printf("    < %10.2f us %10u %.*s\n", (double) (1ull << i) / mhz, (unsigned) p->hist[i],
+		       bar ? bar : 1, "##################################################");
+	}
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0";
+	char name[PROFILE_NAME + 1];
+	struct profile_probe p;
+	struct link l;
+	uint32_t hz;
+	uint8_t flags = 0;
+	double mhz;
+	int histogram = 0, c, status, probe;
+
+	while ((c = getopt_long(argc, argv, "T:rH", options, NULL)) != -1){
+		switch (c){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'r':
+			flags |= PROFILE_RESET;
+			break;
+		case 'H':
+			histogram = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc != optind)
+		usage(argv[0]);
+
+	if (link_open(&l, tty) != 0){
+		perror(tty);
+		return 1;
+	}
+
+	printf("%-12s %10s %10s %10s %10s\n", "probe", "count", "min us", "mean us", "max us");
+	for (probe = 0; probe < 256; probe++){
+		status = link_profile(&l, (uint8_t) probe, flags, &hz, name, &p);
+		if (status == UPLOAD_BAD_ADDRESS)
+			break;
+		if (status != 0){
+			if (status < 0)
+				fprintf(stderr, "profile: %s\n", strerror(errno));
+			else
+				fprintf(stderr, "profile: status %d\n", status);
+			return 1;
+		}
+		mhz = hz / 1e6;
+		if (!p.count){
+			printf("%-12s %10u\n", name, 0);
+			continue;
+		}
+		printf("%-12s %10u %10.2f %10.2f %10.2f\n", name, (unsigned) p.count, p.min / mhz,
+		       (double) p.sum / p.count / mhz, p.max / mhz);
+		if (histogram)
+			print_histogram(&p, mhz);
+	}
+
+	link_close(&l);
+	return 0;
+}
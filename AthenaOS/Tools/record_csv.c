@@ -0,0 +1,20 @@
+/*
+ * record_csv.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#include "record_csv.h"
+
+void record_csv_header(FILE *f){
+	fprintf(f, "tick,state,mode,companion_tick,height,speed,accel,cd,predicted,"
+		"commanded,position,exec_us,period_us,overruns,drops\n");
+}
+
+void record_csv(FILE *f, const struct recorder_control *c){
+	fprintf(f, "%u,%u,%u,%u,%d,%.4f,%.3f,%.4f,%.0f,%d,%d,%u,%u,%u,%u\n",
+		(unsigned) c->tick, c->flight_state, c->mode, c->companion_tick, c->height,
+		c->speed / 16.0, c->accel / 16.0, c->cd, c->predicted, (int) c->commanded, (int) c->position,
+		(unsigned) c->exec, (unsigned) c->period, (unsigned) c->overruns, (unsigned) c->drops);
+}
@@ -0,0 +1,18 @@
+/*
+ * record_csv.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ */
+
+#ifndef RECORD_CSV_H_
+#define RECORD_CSV_H_
+
+#include <stdio.h>
+#include "recorder.h"
+
+/* Control records as CSV, the same columns from the log and from telemetry */
+void record_csv_header(FILE *f);
+void record_csv(FILE *f, const struct recorder_control *c);
+
+#endif /* RECORD_CSV_H_ */
@@ -0,0 +1,334 @@
+/*
+ * replay.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Fly a recorded TeleMega flight through the firmware's own control
+ * stack on the host:
+ *
+ *	replay [--lut table.bin] [--target m] [--no-brakes] [--csv out.csv]
+ *	       [--repeat n] flight.{csv,eeprom}
+ *
+ * Every 10 ms the flight state is clocked through companion_Decode as
+ * the SPI transaction the TeleMega would send, estimate.c carries it
+ * to each of the control ticks in between, control_Step runs on what
+ * comes out, and the step planner moves the brakes toward the command
+ * in simulated time. These are the Core/Src files unchanged;
+ * only the HAL glue around them is left out. The flight itself is
+ * what was recorded, so the brakes don't change it: this checks what
+ * the controller would have commanded and how well it predicted
+ * apogee (--no-brakes keeps them in so the prediction can be compared
+ * with the real apogee), and times every step. --repeat runs it again
+ * and again for a steadier benchmark.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "companion.h"
+#include "control.h"
+#include "estimate.h"
+#include "motion.h"
+#include "Stepper.h"
+#include "flight_log.h"
+
+#define RING_SIZE	256
+#define RING_MASK	(RING_SIZE - 1)
+#define TICK_MS		(1000 / CONTROL_HZ)
+
+static const struct option options[] = {
+	{ .name = "lut", .has_arg = 1, .val = 'l' },
+	{ .name = "target", .has_arg = 1, .val = 't' },
+	{ .name = "no-brakes", .has_arg = 0, .val = 'n' },
+	{ .name = "csv", .has_arg = 1, .val = 'c' },
+	{ .name = "repeat", .has_arg = 1, .val = 'r' },
+	{ 0, 0, 0, 0},
+};
+
+struct lut lut;				/* lut_flash.c on the board */
+static uint8_t *table;
+static uint32_t table_len;
+
+static uint8_t ring[RING_SIZE];
+static uint16_t ring_head;
+
+struct result {
+	uint32_t	ticks;
+	double		apogee;				/* recorded */
+	double		predicted_first;	/* at the first active tick */
+	double		max_extension;
+	uint32_t	lut_misses;
+	uint64_t	*ns;				/* per control_Step */
+	uint64_t	total_ns;			/* decode + step + planner */
+};
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--lut=<table.bin>] [--target=<m>] [--no-brakes] [--csv=<file>] "
+		"[--repeat=<n>] <flight.csv|flight.eeprom>\n", program);
+	exit(1);
+}
+
+static uint64_t now_ns(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int table_read(uint32_t addr, uint8_t *buf, uint32_t len){
+	if (addr > table_len || len > table_len - addr)
+		return -1;
+	memcpy(buf, table + addr, len);
+	return 0;
+}
+
+static int fetch(uint32_t addr, uint8_t *buf, uint32_t len){
+	if (table_read(addr, buf, len) != 0)
+		return -1;
+	lut_FetchDone(&lut);
+	return 0;
+}
+
+static int load_lut(const char *path){
+	FILE *f = fopen(path, "rb");
+	long size;
+
+	if (!f)
+		return -1;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	table = malloc(size);
+	if (!table || fread(table, 1, size, f) != (size_t) size){
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	table_len = (uint32_t) size;
+	return lut_Open(&lut, table, table_len, 0, table_read, fetch);
+}
+
+static void put(uint8_t b){
+	ring[ring_head & RING_MASK] = b;
+	ring_head++;
+}
+
+static void put16(uint16_t v){
+	put(v & 0xff);
+	put(v >> 8);
+}
+
+static int16_t clamp16(double v){
+	v = round(v);
+	return (int16_t) (v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+/* One chip select of bytes, as ao_companion.c clocks them out */
+static void transaction(struct companion_decoder *c, uint8_t command, const struct flight_log *log,
+		const struct flight_sample *s, uint32_t ms){
+	uint16_t start = ring_head;
+	int i, reply = command == COMPANION_SETUP ? COMPANION_SETUP_SIZE : 2 * c->channels;
+
+	put(command);
+	put(s->state);
+	put16((uint16_t) (ms / 10));
+	put16(log->serial);
+	put16(log->flight);
+	put16((uint16_t) clamp16(s->accel * 16));
+	put16((uint16_t) clamp16(s->speed * 16));
+	put16((uint16_t) clamp16(s->height));
+	put16(0);
+	for (i = 0; i < reply; i++)
+		put(0xff);
+	companion_Decode(c, ring, RING_MASK, start, (uint16_t) (ring_head - start), ms);
+}
+
+/* Run the step planner for one control tick's worth of timer ticks */
+static void stepper(struct motion *m, double *carry){
+	uint32_t ticks;
+
+	*carry += STEPPER_TICK_HZ / CONTROL_HZ;
+	while (*carry > 0 && motion_Next(m, &ticks)){
+		if (ticks < 2 * STEPPER_PULSE_TICKS)
+			ticks = 2 * STEPPER_PULSE_TICKS;
+		*carry -= ticks;
+	}
+	if (*carry > 0)
+		*carry = 0;
+}
+
+static void replay(const struct flight_log *log, const struct control_config *cfg, int brakes,
+		FILE *csv, struct result *r){
+	static const struct estimate_config est_cfg = ESTIMATE_CONFIG_DEFAULT;
+	struct companion_decoder dec;
+	struct estimate est;
+	struct companion_state cs;
+	struct control c;
+	struct motion m;
+	struct flight_sample s;
+	double end = log->s[log->n - 1].t, carry = 0;
+	uint64_t t0, t1, start = now_ns();
+	uint32_t ms = 1000, tick, frames = 0;
+	int32_t target, position;
+	int active = 0;
+
+	companion_Reset(&dec, 0);
+	control_Init(&c, cfg, table ? &lut : NULL);
+	estimate_Init(&est, &est_cfg);
+	motion_Init(&m, STEPPER_TICK_HZ, 0x10000, STEPPER_MAX_SPEED, STEPPER_ACCEL);
+	if (table)
+		lut_Poll(&lut);
+
+	flight_log_at(log, 0, &s);
+	transaction(&dec, COMPANION_SETUP, log, &s, ms);
+
+	r->apogee = 0;
+	r->max_extension = 0;
+	r->predicted_first = NAN;
+	for (tick = 0; tick * (double) TICK_MS / 1000 <= end; tick++){
+		flight_log_at(log, tick * (double) TICK_MS / 1000, &s);
+		if (s.height > r->apogee)
+			r->apogee = s.height;
+		ms += TICK_MS;
+
+		if (tick % CONTROL_RECORD_EVERY == 0)
+			transaction(&dec, COMPANION_FETCH, log, &s, ms);
+		cs = *companion_Latest(&dec);
+		position = brakes ? m.position : 0;
+
+		if (dec.frames != frames){
+			frames = dec.frames;
+			estimate_Frame(&est, &cs, ms * 1000);
+		}
+		estimate_Step(&est, &cs, ms * 1000);
+
+		t0 = now_ns();
+		target = control_Step(&c, &cs, position, ms);
+		t1 = now_ns();
+		r->ns[tick] = t1 - t0;
+
+		if (brakes && target != m.target)
+			motion_Retarget(&m, target);
+		stepper(&m, &carry);
+		if (table)
+			lut_Poll(&lut);
+
+		if (c.mode == CONTROL_ACTIVE && !active){
+			active = 1;
+			r->predicted_first = c.predicted;
+		}
+		if ((double) m.position / cfg->brake_steps > r->max_extension)
+			r->max_extension = (double) m.position / cfg->brake_steps;
+		if (csv)
+			fprintf(csv, "%.3f,%u,%d,%d,%d,%u,%.4f,%.1f,%d,%d\n", s.t, cs.flight_state, cs.height,
+				cs.speed, cs.accel, c.mode, c.cd, c.predicted, (int) target, (int) m.position);
+	}
+	r->ticks = tick;
+	r->lut_misses = table ? lut.misses : 0;
+	r->total_ns = now_ns() - start;
+}
+
+static int compare(const void *a, const void *b){
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv){
+	struct control_config cfg = CONTROL_CONFIG_DEFAULT;
+	struct flight_log log;
+	struct result r;
+	const char *lut_path = NULL, *csv_path = NULL;
+	uint64_t *all, sum = 0, total = 0;
+	uint32_t n = 0, ticks, i;
+	char err[256];
+	FILE *csv = NULL;
+	int brakes = 1, repeat = 1, c, k;
+
+	while ((c = getopt_long(argc, argv, "l:t:nc:r:", options, NULL)) != -1){
+		switch (c){
+		case 'l':
+			lut_path = optarg;
+			break;
+		case 't':
+			cfg.target = strtof(optarg, NULL);
+			break;
+		case 'n':
+			brakes = 0;
+			break;
+		case 'c':
+			csv_path = optarg;
+			break;
+		case 'r':
+			repeat = atoi(optarg);
+			if (repeat < 1)
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != 1)
+		usage(argv[0]);
+
+	if (flight_log_read(&log, argv[optind], err, sizeof (err)) != 0){
+		fprintf(stderr, "%s: %s\n", argv[optind], err);
+		return 1;
+	}
+	if (lut_path && load_lut(lut_path) != 0){
+		fprintf(stderr, "%s: not a drag table\n", lut_path);
+		return 1;
+	}
+	if (csv_path){
+		if (!(csv = fopen(csv_path, "w"))){
+			perror(csv_path);
+			return 1;
+		}
+		fprintf(csv, "time,state,height,speed,accel,mode,cd,predicted,commanded,position\n");
+	}
+
+	ticks = (uint32_t) (log.s[log.n - 1].t * CONTROL_HZ) + 2;
+	r.ns = malloc(ticks * sizeof (*r.ns));
+	all = malloc((size_t) ticks * repeat * sizeof (*all));
+	if (!r.ns || !all){
+		perror("malloc");
+		return 1;
+	}
+	for (k = 0; k < repeat; k++){
+		replay(&log, &cfg, brakes, k == 0 ? csv : NULL, &r);
+		for (i = 0; i < r.ticks; i++){
+			all[n++] = r.ns[i];
+			sum += r.ns[i];
+		}
+		total += r.total_ns;
+	}
+	if (csv)
+		fclose(csv);
+
+	printf("flight: serial %u flight %u, %zu samples over %.1f s, apogee %.1f m\n",
+	       log.serial, log.flight, log.n, log.s[log.n - 1].t, r.apogee);
+	if (isnan(r.predicted_first))
+		printf("control: never active (no coast, or it never got above the pad)\n");
+	else
+		printf("control: target %.0f m, predicted %.1f m at the start of coast (%+.1f m), "
+		       "peak extension %.2f%s\n", cfg.target, r.predicted_first, r.predicted_first - r.apogee,
+		       r.max_extension, brakes ? "" : " (brakes held in)");
+	if (table)
+		printf("lut: %u approximate lookups\n", (unsigned) r.lut_misses);
+
+	qsort(all, n, sizeof (*all), compare);
+	printf("bench: %u steps, control_Step mean %.0f ns p50 %llu p99 %llu max %llu ns\n",
+	       (unsigned) n, (double) sum / n, (unsigned long long) all[n / 2],
+	       (unsigned long long) all[(uint64_t) n * 99 / 100], (unsigned long long) all[n - 1]);
+	printf("bench: %.0f ticks/s including the companion decode and step planner\n", n / (total / 1e9));
+
+	free(all);
+	free(r.ns);
+	free(table);
+	flight_log_free(&log);
+	return 0;
+}
@@ -0,0 +1,614 @@
+/*
+ * sim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Monte Carlo of the airbrake against flights that didn't go to plan:
+ *
+ *	sim [--lut table.bin] [--flights n] [--threads n] [--seed n]
+ *	    [--target m] [--kp a,b,...] [--ki a,b,...] [--no-brakes]
+ *	    [--impulse-sd f] [--cd-sd f] [--wind m/s] [--latency ms]
+ *	    [--noise f] [--csv out.csv]
+ *
+ * Each flight is a point mass in the vertical plane, launched off the
+ * rail into a steady crosswind it weathercocks into, with its own motor
+ * impulse, Cd, brake effectiveness, mass, pad air density and companion
+ * latency drawn around the nominal rocket below. The truth's air gets
+ * thinner the way the standard atmosphere does, not the exponential the
+ * predictor assumes, and its Cd comes from the table when there is one.
+ * Every 10 ms the TeleMega's view of it (noisy, quantized, sometimes
+ * lost) lands after the flight's latency and goes through estimate.c,
+ * control_Step and the step planner exactly as in replay, and the
+ * brakes it moves change the flight. Runs until apogee.
+ *
+ * Flights are shared out over every core by pool.c. A flight's draws
+ * come from its own seed, so a run is the same whatever the threads
+ * did, and every kp x ki in the grid flies the same flights.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "companion.h"
+#include "control.h"
+#include "estimate.h"
+#include "motion.h"
+#include "Stepper.h"
+#include "pool.h"
+
+#define G			9.80665
+#define STEP_US		1000						/* truth step */
+#define TICK_US		(CONTROL_TICK_HZ / CONTROL_HZ)
+#define FRAME_US	(1000000 / COMPANION_HZ)
+#define MAX_GAINS	16
+#define PENDING		16							/* frames on their way, a power of two */
+#define MAX_US		120000000u					/* give up on a flight after this */
+
+static const struct option options[] = {
+	{ .name = "lut", .has_arg = 1, .val = 'l' },
+	{ .name = "flights", .has_arg = 1, .val = 'f' },
+	{ .name = "threads", .has_arg = 1, .val = 'j' },
+	{ .name = "seed", .has_arg = 1, .val = 's' },
+	{ .name = "target", .has_arg = 1, .val = 't' },
+	{ .name = "kp", .has_arg = 1, .val = 'p' },
+	{ .name = "ki", .has_arg = 1, .val = 'i' },
+	{ .name = "no-brakes", .has_arg = 0, .val = 'n' },
+	{ .name = "impulse-sd", .has_arg = 1, .val = 'I' },
+	{ .name = "cd-sd", .has_arg = 1, .val = 'C' },
+	{ .name = "wind", .has_arg = 1, .val = 'w' },
+	{ .name = "latency", .has_arg = 1, .val = 'L' },
+	{ .name = "noise", .has_arg = 1, .val = 'N' },
+	{ .name = "csv", .has_arg = 1, .val = 'c' },
+	{ 0, 0, 0, 0},
+};
+
+/* The nominal rocket and how far real ones stray from it */
+struct sim_config {
+	double		impulse;		/* N s */
+	double		burn;			/* s */
+	double		propellant;		/* kg, on top of the control config's burnout mass */
+	double		rail;			/* m */
+	double		fast;			/* m/s, the TeleMega stays in FAST above this */
+	double		impulse_sd;		/* fractions of nominal, 1 sigma */
+	double		cd_sd;
+	double		brake_sd;
+	double		mass_sd;
+	double		rho_sd;
+	double		wind;			/* m/s, uniform from calm to this */
+	double		latency_min;	/* ms, uniform */
+	double		latency_max;
+	double		drop;			/* frames lost */
+	double		height_sd;		/* m, per frame at noise 1 */
+	double		speed_sd;		/* m/s */
+	double		accel_sd;		/* m/s^2 */
+	double		noise;
+};
+
+#define SIM_CONFIG_DEFAULT {	\
+	.impulse = 8500,			\
+	.burn = 3.5,				\
+	.propellant = 5.0,			\
+	.rail = 5.0,				\
+	.fast = 270,				\
+	.impulse_sd = 0.03,			\
+	.cd_sd = 0.05,				\
+	.brake_sd = 0.10,			\
+	.mass_sd = 0.01,			\
+	.rho_sd = 0.03,				\
+	.wind = 8,					\
+	.latency_min = 1,			\
+	.latency_max = 8,			\
+	.drop = 0.005,				\
+	.height_sd = 1.5,			\
+	.speed_sd = 0.5,			\
+	.accel_sd = 1.0,			\
+	.noise = 1,					\
+}
+
+/* What one flight drew, as multiples of nominal where that makes sense */
+struct sim_draw {
+	double		impulse;
+	double		cd;
+	double		brake;
+	double		mass;
+	double		rho;
+	double		wind;			/* m/s */
+	double		latency;		/* ms */
+	double		noise;
+};
+
+struct sim_result {
+	struct sim_draw	d;
+	double			apogee;
+	double			extension;	/* the furthest the brakes got */
+	uint32_t		frames;		/* delivered */
+};
+
+struct sim {
+	struct sim_config		cfg;
+	struct control_config	control[MAX_GAINS];
+	unsigned				gains;
+	uint32_t				flights;
+	uint64_t				seed;
+	int						brakes;
+	struct sim_result		*r;		/* gains * flights */
+};
+
+/* The table once, read only; each thread has its own window onto it */
+static uint8_t *table;
+static uint32_t table_len;
+static struct lut_header table_h;
+static _Thread_local struct lut sim_lut;
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--lut=<table.bin>] [--flights=<n>] [--threads=<n>] [--seed=<n>] "
+		"[--target=<m>] [--kp=<a,b,...>] [--ki=<a,b,...>] [--no-brakes] [--impulse-sd=<f>] "
+		"[--cd-sd=<f>] [--wind=<m/s>] [--latency=<ms>] [--noise=<f>] [--csv=<file>]\n", program);
+	exit(1);
+}
+
+static double now_s(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t splitmix(uint64_t *s){
+	uint64_t z = (*s += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static double uniform(uint64_t *s){
+	return (splitmix(s) >> 11) * 0x1p-53;
+}
+
+/* Always two draws, so a frame's noise doesn't depend on what came before */
+static double gauss(uint64_t *s){
+	double u = uniform(s), v = uniform(s);
+
+	return sqrt(-2 * log(1 - u)) * cos(2 * M_PI * v);
+}
+
+static int table_read(uint32_t addr, uint8_t *buf, uint32_t len){
+	if (addr > table_len || len > table_len - addr)
+		return -1;
+	memcpy(buf, table + addr, len);
+	return 0;
+}
+
+static int fetch(uint32_t addr, uint8_t *buf, uint32_t len){
+	if (table_read(addr, buf, len) != 0)
+		return -1;
+	lut_FetchDone(&sim_lut);
+	return 0;
+}
+
+static int load_lut(const char *path){
+	FILE *f = fopen(path, "rb");
+	long size;
+
+	if (!f)
+		return -1;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	table = malloc(size);
+	if (!table || fread(table, 1, size, f) != (size_t) size){
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	table_len = (uint32_t) size;
+	if (lut_ParseHeader(&table_h, table, table_len) != 0 ||
+	    table_h.data_offset + table_h.data_size > table_len)
+		return -1;
+	/* Also catches a bad CRC before any thread relies on it */
+	return lut_Open(&sim_lut, table, table_len, 0, table_read, fetch);
+}
+
+static double cell(uint32_t row, uint32_t col){
+	const uint8_t *p = table + table_h.data_offset + row * table_h.row_stride + col * 2;
+
+	return (int16_t) (p[0] | p[1] << 8) / (double) (1 << table_h.frac_bits);
+}
+
+/* The truth's Cd: bilinear in the whole table, clamped at its edges */
+static double table_cd(double speed, double height, double fallback){
+	double fx, fy;
+	uint32_t c, r;
+
+	if (!table)
+		return fallback;
+	fx = (speed * 16 - table_h.x0) / table_h.dx;
+	fy = (height - table_h.y0) / table_h.dy;
+	fx = fx < 0 ? 0 : fx > table_h.nx - 1 ? table_h.nx - 1 : fx;
+	fy = fy < 0 ? 0 : fy > table_h.ny - 1 ? table_h.ny - 1 : fy;
+	c = (uint32_t) fx;
+	r = (uint32_t) fy;
+	if (c > table_h.nx - 2u)
+		c = table_h.nx > 1 ? table_h.nx - 2u : 0;
+	if (r > table_h.ny - 2u)
+		r = table_h.ny > 1 ? table_h.ny - 2u : 0;
+	fx -= c;
+	fy -= r;
+	if (table_h.nx < 2 || table_h.ny < 2)
+		return cell(r, c);
+	return (cell(r, c) * (1 - fx) + cell(r, c + 1) * fx) * (1 - fy) +
+	       (cell(r + 1, c) * (1 - fx) + cell(r + 1, c + 1) * fx) * fy;
+}
+
+/* Standard atmosphere troposphere, relative to the pad */
+static double density(double rho0, double height){
+	double k = 1 - 2.25577e-5 * (height > 0 ? height : 0);
+
+	return rho0 * pow(k > 0.1 ? k : 0.1, 4.2559);
+}
+
+static void draw(const struct sim_config *cfg, uint64_t *rng, struct sim_draw *d){
+	d->impulse = 1 + cfg->impulse_sd * gauss(rng);
+	d->cd = 1 + cfg->cd_sd * gauss(rng);
+	d->brake = 1 + cfg->brake_sd * gauss(rng);
+	d->mass = 1 + cfg->mass_sd * gauss(rng);
+	d->rho = 1 + cfg->rho_sd * gauss(rng);
+	d->wind = cfg->wind * uniform(rng);
+	d->latency = cfg->latency_min + (cfg->latency_max - cfg->latency_min) * uniform(rng);
+	d->noise = cfg->noise;
+}
+
+static int16_t clamp16(double v){
+	v = round(v);
+	return (int16_t) (v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+/* Run the step planner for one control tick's worth of timer ticks */
+static void stepper(struct motion *m, double *carry){
+	uint32_t ticks;
+
+	*carry += STEPPER_TICK_HZ / CONTROL_HZ;
+	while (*carry > 0 && motion_Next(m, &ticks)){
+		if (ticks < 2 * STEPPER_PULSE_TICKS)
+			ticks = 2 * STEPPER_PULSE_TICKS;
+		*carry -= ticks;
+	}
+	if (*carry > 0)
+		*carry = 0;
+}
+
+struct pending {
+	struct companion_state	s;
+	uint32_t				due;	/* us */
+};
+
+/* Launch to apogee with the draws in d; rng is this flight's for the frame noise */
+static void fly(const struct sim *sim, const struct control_config *ccfg, const struct sim_draw *d,
+		uint64_t rng, struct sim_result *r){
+	static const struct estimate_config est_cfg = ESTIMATE_CONFIG_DEFAULT;
+	const struct sim_config *cfg = &sim->cfg;
+	struct pending pending[PENDING];
+	struct companion_state cs = {0};
+	struct estimate est;
+	struct control c;
+	struct motion m;
+	double z = 0, vx = 0, vz = 0, carry = 0;
+	double dry = ccfg->mass * d->mass, thrust = cfg->impulse * d->impulse / cfg->burn;
+	double rho0 = ccfg->rho0 * d->rho, cda, extension = 0, dt = STEP_US * 1e-6;
+	double t, mass, ax, az = 0, rx, rz, air, f, rho, drag;
+	uint32_t us, latency = (uint32_t) lrint(d->latency * 1000), head = 0, tail = 0;
+	int32_t target;
+	uint16_t tick = 0;
+	int coast = 0;
+
+	control_Init(&c, ccfg, table ? &sim_lut : NULL);
+	estimate_Init(&est, &est_cfg);
+	motion_Init(&m, STEPPER_TICK_HZ, 0x10000, STEPPER_MAX_SPEED, STEPPER_ACCEL);
+	if (table){
+		lut_Open(&sim_lut, table, table_len, 0, table_read, fetch);
+		lut_Poll(&sim_lut);
+	}
+	r->d = *d;
+	r->apogee = 0;
+	r->extension = 0;
+	r->frames = 0;
+
+	for (us = 0; us < MAX_US; us += STEP_US){
+		t = us * 1e-6;
+
+		/* What the TeleMega sees now, on its way to us */
+		if (us % FRAME_US == 0){
+			double n_h = gauss(&rng), n_v = gauss(&rng), n_a = gauss(&rng);
+			struct pending *p = &pending[head % PENDING];
+			int lost = uniform(&rng) < cfg->drop;
+
+			if (t < cfg->burn + 0.1)
+				p->s.flight_state = COMPANION_STATE_BOOST;
+			else if (!coast && vz > cfg->fast)
+				p->s.flight_state = COMPANION_STATE_FAST;
+			else {
+				p->s.flight_state = COMPANION_STATE_COAST;
+				coast = 1;
+			}
+			p->s.tick = tick++;
+			p->s.height = clamp16(z + d->noise * cfg->height_sd * n_h);
+			p->s.speed = clamp16((vz + d->noise * cfg->speed_sd * n_v) * 16);
+			p->s.accel = clamp16((az + d->noise * cfg->accel_sd * n_a) * 16);
+			p->due = us + latency;
+			if (!lost && head - tail < PENDING)
+				head++;
+		}
+		while (tail != head && pending[tail % PENDING].due <= us){
+			struct pending *p = &pending[tail % PENDING];
+
+			p->s.rx_tick = 1000 + us / 1000;
+			cs = p->s;
+			estimate_Frame(&est, &cs, p->due);
+			tail++;
+			r->frames++;
+		}
+
+		if (us % TICK_US == 0){
+			struct companion_state s = cs;
+
+			if (r->frames)
+				estimate_Step(&est, &s, us);
+			target = control_Step(&c, &s, m.position, 1000 + us / 1000);
+			if (sim->brakes && target != m.target)
+				motion_Retarget(&m, target);
+			stepper(&m, &carry);
+			if (table)
+				lut_Poll(&sim_lut);
+			extension = (double) m.position / ccfg->brake_steps;
+			if (extension > r->extension)
+				r->extension = extension;
+		}
+
+		/* Truth: thrust along the relative wind once off the rail, drag against it */
+		mass = dry + (t < cfg->burn ? cfg->propellant * (1 - t / cfg->burn) : 0);
+		rx = vx - d->wind;
+		rz = vz;
+		air = sqrt(rx * rx + rz * rz);
+		rho = density(rho0, z);
+		cda = table_cd(air, z, ccfg->cd_default) * d->cd * ccfg->area +
+		      extension * ccfg->brake_cda * d->brake;
+		drag = 0.5 * rho * air * cda;
+		f = t < cfg->burn ? thrust : 0;
+		if (z < cfg->rail){
+			az = f / mass - G - drag * rz / mass;
+			ax = 0;
+			if (az < 0 && z <= 0)
+				az = 0;
+		} else {
+			az = (air > 1 ? f * rz / air : f) / mass - G - drag * rz / mass;
+			ax = (air > 1 ? f * rx / air : 0) / mass - drag * rx / mass;
+		}
+		vx += ax * dt;
+		vz += az * dt;
+		z += vz * dt;
+		if (z > r->apogee)
+			r->apogee = z;
+		if (t > cfg->burn && vz <= 0)
+			break;
+	}
+}
+
+static void job(void *arg, uint32_t i){
+	struct sim *sim = arg;
+	uint32_t flight = i % sim->flights, gain = i / sim->flights;
+	uint64_t rng = sim->seed ^ (0x9e3779b97f4a7c15ull * (flight + 1));
+	struct sim_draw d;
+
+	splitmix(&rng);
+	draw(&sim->cfg, &rng, &d);
+	fly(sim, &sim->control[gain], &d, rng, &sim->r[i]);
+}
+
+static int compare(const void *a, const void *b){
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, uint32_t n, double p){
+	uint32_t i = (uint32_t) (p / 100 * (n - 1) + 0.5);
+
+	return sorted[i < n ? i : n - 1];
+}
+
+static void report(const struct sim *sim, unsigned gain, double target){
+	const struct sim_result *r = &sim->r[(size_t) gain * sim->flights];
+	uint32_t n = sim->flights, i, in10 = 0, in30 = 0;
+	double *e = malloc(n * sizeof (*e)), sum = 0, sum2 = 0, ext = 0, mean, sd;
+
+	if (!e){
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < n; i++){
+		e[i] = r[i].apogee - target;
+		sum += e[i];
+		sum2 += e[i] * e[i];
+		ext += r[i].extension;
+		in10 += fabs(e[i]) <= 10;
+		in30 += fabs(e[i]) <= 30;
+	}
+	mean = sum / n;
+	sd = n > 1 ? sqrt(fmax(0, (sum2 - sum * mean) / (n - 1))) : 0;
+	qsort(e, n, sizeof (*e), compare);
+
+	if (sim->brakes)
+		printf("kp %.4f ki %.4f: ", sim->control[gain].kp, sim->control[gain].ki);
+	else
+		printf("no brakes: ");
+	printf("error mean %+.1f sd %.1f m, p1 %+.1f p5 %+.1f p50 %+.1f p95 %+.1f p99 %+.1f, "
+	       "worst %+.1f %+.1f m, within 10 m %.1f%% 30 m %.1f%%, mean peak extension %.2f\n",
+	       mean, sd, percentile(e, n, 1), percentile(e, n, 5), percentile(e, n, 50),
+	       percentile(e, n, 95), percentile(e, n, 99), e[0], e[n - 1],
+	       100.0 * in10 / n, 100.0 * in30 / n, ext / n);
+	free(e);
+}
+
+/* Comma separated values into list; returns how many */
+static unsigned parse_list(const char *s, float *list, unsigned max){
+	unsigned n = 0;
+	char *end;
+
+	while (n < max){
+		list[n++] = strtof(s, &end);
+		if (end == s)
+			return 0;
+		if (*end != ',')
+			return *end ? 0 : n;
+		s = end + 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv){
+	struct control_config base = CONTROL_CONFIG_DEFAULT;
+	static struct sim sim = { .cfg = SIM_CONFIG_DEFAULT, .flights = 1000, .seed = 1, .brakes = 1 };
+	struct sim_draw nominal;
+	struct sim_result free_flight;
+	float kp[MAX_GAINS] = { base.kp }, ki[MAX_GAINS] = { base.ki };
+	unsigned nkp = 1, nki = 1, threads = 0, a, b;
+	const char *lut_path = NULL, *csv_path = NULL;
+	double t0, wall;
+	uint32_t total, i;
+	FILE *csv = NULL;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "l:f:j:s:t:p:i:nI:C:w:L:N:c:", options, NULL)) != -1){
+		switch (c){
+		case 'l':
+			lut_path = optarg;
+			break;
+		case 'f':
+			sim.flights = (uint32_t) strtoul(optarg, NULL, 0);
+			if (sim.flights == 0)
+				usage(argv[0]);
+			break;
+		case 'j':
+			threads = (unsigned) strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sim.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			base.target = strtof(optarg, NULL);
+			break;
+		case 'p':
+			if (!(nkp = parse_list(optarg, kp, MAX_GAINS)))
+				usage(argv[0]);
+			break;
+		case 'i':
+			if (!(nki = parse_list(optarg, ki, MAX_GAINS)))
+				usage(argv[0]);
+			break;
+		case 'n':
+			sim.brakes = 0;
+			break;
+		case 'I':
+			sim.cfg.impulse_sd = strtod(optarg, NULL);
+			break;
+		case 'C':
+			sim.cfg.cd_sd = strtod(optarg, NULL);
+			break;
+		case 'w':
+			sim.cfg.wind = strtod(optarg, NULL);
+			break;
+		case 'L':
+			sim.cfg.latency_max = strtod(optarg, NULL);
+			if (sim.cfg.latency_max < sim.cfg.latency_min)
+				sim.cfg.latency_min = sim.cfg.latency_max;
+			/* A frame a period is in flight per 10 ms of latency */
+			if (sim.cfg.latency_max * 1000 >= (PENDING - 1) * FRAME_US)
+				usage(argv[0]);
+			break;
+		case 'N':
+			sim.cfg.noise = strtod(optarg, NULL);
+			break;
+		case 'c':
+			csv_path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc != optind)
+		usage(argv[0]);
+	if (!sim.brakes)
+		nkp = nki = 1;
+	if (nkp * nki > MAX_GAINS){
+		fprintf(stderr, "%s: at most %d gain pairs\n", argv[0], MAX_GAINS);
+		return 1;
+	}
+	if (lut_path && load_lut(lut_path) != 0){
+		fprintf(stderr, "%s: not a drag table\n", lut_path);
+		return 1;
+	}
+
+	for (a = 0; a < nkp; a++)
+		for (b = 0; b < nki; b++){
+			sim.control[sim.gains] = base;
+			sim.control[sim.gains].kp = kp[a];
+			sim.control[sim.gains].ki = ki[b];
+			sim.gains++;
+		}
+	total = sim.flights * sim.gains;
+	if (total / sim.gains != sim.flights || !(sim.r = calloc(total, sizeof (*sim.r)))){
+		fprintf(stderr, "%s: too many flights\n", argv[0]);
+		return 1;
+	}
+
+	/* The rocket as drawn, with nothing going wrong and the brakes left in */
+	nominal = (struct sim_draw) { .impulse = 1, .cd = 1, .brake = 1, .mass = 1, .rho = 1,
+		.latency = sim.cfg.latency_min };
+	{
+		struct sim quiet = sim;
+
+		quiet.brakes = 0;
+		fly(&quiet, &base, &nominal, 0, &free_flight);
+	}
+
+	if (threads == 0)
+		threads = pool_cores();
+	t0 = now_s();
+	if (pool_run(threads, total, job, &sim) != 0)
+		fprintf(stderr, "%s: couldn't start every thread, carried on with fewer\n", argv[0]);
+	wall = now_s() - t0;
+
+	printf("sim: %u flights x %u gain%s on %u threads in %.1f s (%.0f flights/s)\n",
+	       (unsigned) sim.flights, sim.gains, sim.gains == 1 ? "" : "s", threads, wall, total / wall);
+	printf("nominal: %.0f N s over %.1f s, %.1f m with no brakes against a target of %.0f m%s\n",
+	       sim.cfg.impulse, sim.cfg.burn, free_flight.apogee, base.target, table ? "" : " (Cd fixed)");
+	for (a = 0; a < sim.gains; a++)
+		report(&sim, a, base.target);
+
+	if (csv_path){
+		if (!(csv = fopen(csv_path, "w"))){
+			perror(csv_path);
+			return 1;
+		}
+		fprintf(csv, "kp,ki,flight,impulse,cd,brake,mass,rho,wind,latency,frames,apogee,error,extension\n");
+		for (i = 0; i < total; i++){
+			const struct sim_result *r = &sim.r[i];
+			const struct control_config *g = &sim.control[i / sim.flights];
+
+			fprintf(csv, "%.5f,%.5f,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f,%u,%.2f,%.2f,%.3f\n",
+				g->kp, g->ki, (unsigned) (i % sim.flights), r->d.impulse, r->d.cd, r->d.brake,
+				r->d.mass, r->d.rho, r->d.wind, r->d.latency, (unsigned) r->frames, r->apogee,
+				r->apogee - g->target, r->extension);
+		}
+		fclose(csv);
+	}
+
+	free(sim.r);
+	free(table);
+	return 0;
+}
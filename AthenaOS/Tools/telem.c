@@ -0,0 +1,146 @@
+/*
+ * telem.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Dylan
+ *
+ * Watch the control loop live over USB:
+ *
+ *	telem [--tty /dev/ttyACM0] [--divisor n] [--seconds s]
+ *
+ * Turns telemetry on, prints every control record as CSV on stdout
+ * and the once a second status on stderr, and turns it back off on
+ * ^C or when the time is up. --divisor 10 sends every tenth tick.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "upload.h"
+#include "telemetry.h"
+#include "link.h"
+#include "record_csv.h"
+
+static const struct option options[] = {
+	{ .name = "tty", .has_arg = 1, .val = 'T' },
+	{ .name = "divisor", .has_arg = 1, .val = 'd' },
+	{ .name = "seconds", .has_arg = 1, .val = 's' },
+	{ 0, 0, 0, 0},
+};
+
+static volatile sig_atomic_t done;
+
+static void usage(char *program){
+	fprintf(stderr, "usage: %s [--tty=<tty>] [--divisor=<n>] [--seconds=<s>]\n", program);
+	exit(1);
+}
+
+static void stop(int sig){
+	(void) sig;
+	done = 1;
+}
+
+static void print_status(const struct telemetry_status *s){
+	fprintf(stderr, "status %u ms: companion %u/%u bad, period %u-%u us, exec max %u us, overruns %u, "
+		"lut %u lookups %u misses %u fetches, log at 0x%06x %u pages %u drops, telemetry drops %u, "
+		"battery %u mV (min %u, %u brownouts), %.1f C\n",
+		(unsigned) s->tick, (unsigned) s->companion_frames, (unsigned) s->companion_errors,
+		(unsigned) s->period_min, (unsigned) s->period_max, (unsigned) s->exec_max,
+		(unsigned) s->overruns, (unsigned) s->lut_lookups, (unsigned) s->lut_misses,
+		(unsigned) s->lut_fetches, (unsigned) s->recorder_addr, (unsigned) s->recorder_pages,
+		(unsigned) s->recorder_drops, (unsigned) s->telemetry_drops, (unsigned) s->battery_mv,
+		(unsigned) s->battery_min_mv, (unsigned) s->brownouts, (int32_t) s->temp / 10.0);
+}
+
+int main(int argc, char **argv){
+	const char *tty = "/dev/ttyACM0";
+	struct telemetry_status st;
+	struct recorder_control c;
+	struct sigaction sa;
+	struct link l;
+	unsigned records = 0, bad = 0;
+	long divisor = 1;
+	double seconds = 0;
+	time_t end = 0;
+	int ch, status;
+
+	while ((ch = getopt_long(argc, argv, "T:d:s:", options, NULL)) != -1){
+		switch (ch){
+		case 'T':
+			tty = optarg;
+			break;
+		case 'd':
+			divisor = strtol(optarg, NULL, 0);
+			if (divisor < 1 || divisor > 255)
+				usage(argv[0]);
+			break;
+		case 's':
+			seconds = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc != optind)
+		usage(argv[0]);
+
+	memset(&sa, 0, sizeof (sa));
+	sa.sa_handler = stop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (link_open(&l, tty) != 0){
+		perror(tty);
+		return 1;
+	}
+	if ((status = link_telemetry(&l, (uint8_t) divisor)) != UPLOAD_OK){
+		if (status < 0)
+			fprintf(stderr, "telemetry: %s\n", strerror(errno));
+		else
+			fprintf(stderr, "telemetry: status %d\n", status);
+		return 1;
+	}
+	if (seconds > 0)
+		end = time(NULL) + (time_t) seconds;
+
+	record_csv_header(stdout);
+	l.timeout = 1000;
+	while (!done && (!end || time(NULL) < end)){
+		if (link_recv(&l) != 0){
+			if (errno == EINTR || errno == ETIMEDOUT)
+				continue;
+			perror(tty);
+			break;
+		}
+		switch (l.rx.type){
+		case TELEMETRY_CONTROL:
+			if (l.rx.len != RECORDER_RECORD_SIZE || recorder_Check(l.rx.payload) != RECORDER_CONTROL){
+				bad++;
+				break;
+			}
+			recorder_DecodeControl(l.rx.payload, &c);
+			record_csv(stdout, &c);
+			records++;
+			break;
+		case TELEMETRY_STATUS:
+			if (l.rx.len != TELEMETRY_STATUS_WORDS * 4){
+				bad++;
+				break;
+			}
+			telemetry_DecodeStatus(l.rx.payload, &st);
+			print_status(&st);
+			break;
+		}
+	}
+	fflush(stdout);
+
+	l.timeout = 5000;
+	link_telemetry(&l, 0);
+	link_close(&l);
+	fprintf(stderr, "%u records, %u bad, %u frame errors\n", records, bad, (unsigned) l.rx.errors);
+	return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <ao.h>
+#include <ao_exti.h>
+#include <ao_log.h>
+#include "ao_athena.h"
+
+int
+main(void)
+{
+	ao_clock_init();
+
+	ao_task_init();
+	ao_led_init();
+	ao_led_on(LEDS_AVAILABLE);
+	ao_timer_init();
+
+	ao_spi_init();
+	ao_exti_init();
+
+	ao_usb_init();
+	ao_cmd_init();
+
+	ao_storage_init();
+	ao_log_init();
+	ao_config_init();
+
+	ao_athena_companion_init();
+	ao_athena_control_init();
+
+	ao_led_off(LEDS_AVAILABLE);
+
+	ao_start_scheduler();
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _AO_ATHENA_H_
+#define _AO_ATHENA_H_
+
+/*
+ * The airbrake itself is the HAL-free code from AthenaOS/Core/Src
+ * (companion.c, control.c, predict.c, lut.c, motion.c), built
+ * unchanged; these files are just the AltOS side of it.
+ */
+#include "companion.h"
+#include "control.h"
+#include "motion.h"
+
+#define AO_ATHENA_STEPPER_HZ	1000000		/* TIM3 counts microseconds */
+#define AO_ATHENA_PULSE_TICKS	10		/* Step_PWM low time */
+#define AO_ATHENA_MAX_SPEED	5000.0f		/* steps/s */
+#define AO_ATHENA_ACCEL		20000.0f	/* steps/s^2 */
+
+/* One control tick, handed from the control task to the log task */
+struct ao_athena_sample {
+	AO_TICK_TYPE		tick;
+	struct companion_state	companion;
+	uint8_t			mode;
+	float			cd;
+	float			predicted;
+	int32_t			commanded;
+	int32_t			position;
+};
+
+#define AO_ATHENA_RING		64	/* power of two, 640ms of ticks */
+#define ao_athena_ring_next(n)	(((n) + 1) & (AO_ATHENA_RING - 1))
+
+extern struct ao_athena_sample	ao_athena_ring[AO_ATHENA_RING];
+extern volatile uint8_t		ao_athena_head;
+extern uint16_t			ao_athena_stale;
+
+/* ao_athena_companion.c */
+extern struct companion_decoder	companion;
+
+static inline uint32_t
+ao_athena_ms(void)
+{
+	return (uint32_t) ao_time() * (1000 / AO_HERTZ);
+}
+
+void
+ao_athena_companion_init(void);
+
+/* ao_athena_control.c */
+extern struct control	control;
+extern struct lut	lut;
+extern struct motion	ao_stepper;
+
+int32_t
+ao_stepper_position(void);
+
+void
+ao_athena_control_init(void);
+
+#endif /* _AO_ATHENA_H_ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * SPI1 slave side of the TeleMega companion link. The TeleMega
+ * clocks at 200kHz, so bytes are taken one interrupt at a time into
+ * a ring and the next reply byte goes out the same way. Altus_CS is
+ * the only framing: its rising edge decodes the transaction out of
+ * the ring, resets the SPI unit so a glitch can't leave us a bit out
+ * of step, and wakes the control task.
+ */
+
+#include <ao.h>
+#include <ao_exti.h>
+#include "ao_athena.h"
+
+#define AO_COMPANION_RING	256	/* power of two */
+#define AO_COMPANION_MASK	(AO_COMPANION_RING - 1)
+
+struct companion_decoder	companion;
+
+static uint8_t		ao_companion_ring[AO_COMPANION_RING];
+static uint16_t		ao_companion_head;
+static uint16_t		ao_companion_start;
+
+/* Replies are clocked out while the TeleMega is still sending its command */
+static uint8_t		ao_companion_setup_tx[COMPANION_COMMAND_SIZE + COMPANION_SETUP_SIZE];
+static uint8_t		ao_companion_data_tx[COMPANION_COMMAND_SIZE + 2 * COMPANION_MAX_CHANNELS];
+
+static const uint8_t	*ao_companion_tx;
+static uint16_t		ao_companion_tx_len;
+static uint16_t		ao_companion_tx_pos;
+
+static uint8_t
+ao_companion_tx_next(void)
+{
+	if (ao_companion_tx_pos < ao_companion_tx_len)
+		return ao_companion_tx[ao_companion_tx_pos++];
+	return 0xff;
+}
+
+void
+stm_spi1_isr(void)
+{
+	if (stm_spi1.sr & (1 << STM_SPI_SR_RXNE)) {
+		ao_companion_ring[ao_companion_head++ & AO_COMPANION_MASK] = (uint8_t) stm_spi1.dr;
+		stm_spi1.dr = ao_companion_tx_next();
+	}
+}
+
+/* Fresh SPI unit with the first byte of the next reply already loaded */
+static void
+ao_companion_resync(void)
+{
+	stm_rcc.apb2rstr |= (1 << STM_RCC_APB2RSTR_SPI1RST);
+	stm_rcc.apb2rstr &= ~(1 << STM_RCC_APB2RSTR_SPI1RST);
+
+	if (companion.reply == COMPANION_REPLY_SETUP) {
+		ao_companion_tx = ao_companion_setup_tx;
+		ao_companion_tx_len = sizeof (ao_companion_setup_tx);
+	} else {
+		ao_companion_tx = ao_companion_data_tx;
+		ao_companion_tx_len = COMPANION_COMMAND_SIZE + 2 * companion.channels;
+	}
+	ao_companion_tx_pos = 0;
+
+	/* Mode 0, slave, selected by software so Altus_CS can stay a GPIO */
+	stm_spi1.cr1 = ((1 << STM_SPI_CR1_SSM) |
+			(0 << STM_SPI_CR1_SSI) |
+			(0 << STM_SPI_CR1_MSTR) |
+			(0 << STM_SPI_CR1_CPOL) |
+			(0 << STM_SPI_CR1_CPHA));
+	stm_spi1.cr2 = (1 << STM_SPI_CR2_RXNEIE);
+	stm_spi1.dr = ao_companion_tx_next();
+	stm_spi1.cr1 |= (1 << STM_SPI_CR1_SPE);
+}
+
+static void
+ao_companion_cs(void)
+{
+	uint16_t	head = ao_companion_head;
+	uint32_t	frames = companion.frames;
+
+	if (!ao_gpio_get(AO_ATHENA_CS_PORT, AO_ATHENA_CS_PIN)) {
+		ao_companion_start = head;
+		return;
+	}
+
+	companion_Decode(&companion, ao_companion_ring, AO_COMPANION_MASK, ao_companion_start,
+			 (uint16_t) (head - ao_companion_start), ao_athena_ms());
+	ao_companion_start = head;
+	ao_companion_resync();
+	if (companion.frames != frames)
+		ao_wakeup(&companion);
+}
+
+void
+ao_athena_companion_init(void)
+{
+	uint8_t	*setup = &ao_companion_setup_tx[COMPANION_COMMAND_SIZE];
+
+	companion_Reset(&companion, 0);
+
+	setup[0] = COMPANION_BOARD_ID & 0xff;
+	setup[1] = COMPANION_BOARD_ID >> 8;
+	setup[2] = ~COMPANION_BOARD_ID & 0xff;
+	setup[3] = (~COMPANION_BOARD_ID >> 8) & 0xff;
+	setup[4] = COMPANION_UPDATE_PERIOD;
+	setup[5] = companion.channels;
+
+	ao_companion_resync();
+	stm_nvic_set_priority(STM_ISR_SPI1_POS, AO_STM_NVIC_HIGH_PRIORITY);
+	stm_nvic_set_enable(STM_ISR_SPI1_POS);
+
+	ao_enable_port(AO_ATHENA_CS_PORT);
+	ao_exti_setup(AO_ATHENA_CS_PORT, AO_ATHENA_CS_PIN,
+		      AO_EXTI_MODE_RISING | AO_EXTI_MODE_FALLING | AO_EXTI_MODE_PULL_UP |
+		      AO_EXTI_PRIORITY_HIGH,
+		      ao_companion_cs);
+	ao_exti_enable(AO_ATHENA_CS_PORT, AO_ATHENA_CS_PIN);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Control task and stepper. The task sleeps until the companion link
+ * has a new FETCH, or 20ms without one so the controller can see the
+ * data go stale, then runs one control_Step and retargets the step
+ * planner. Steps come out of TIM3 exactly as in AthenaOS/Core/Src/
+ * Stepper.c: one timer period per step, Step_PWM low for the last
+ * few microseconds of it.
+ */
+
+#include <ao.h>
+#include <ao_log.h>
+#include "ao_athena.h"
+
+struct control			control;
+struct lut			lut;
+struct motion			ao_stepper;
+
+struct ao_athena_sample		ao_athena_ring[AO_ATHENA_RING];
+volatile uint8_t		ao_athena_head;
+uint16_t			ao_athena_stale;	/* control ticks without a FETCH */
+
+static struct ao_task		ao_control_task;
+
+static int
+ao_stepper_update(void)
+{
+	uint32_t	ticks;
+	int		dir = motion_Next(&ao_stepper, &ticks);
+
+	if (dir == 0) {
+		stm_tim3.cr1 &= ~(1 << STM_TIM234_CR1_CEN);
+		stm_tim3.cnt = 0;
+		ao_gpio_set(AO_STEPPER_EN_PORT, AO_STEPPER_EN_PIN, 1);
+		return 0;
+	}
+
+	if (ticks < 2 * AO_ATHENA_PULSE_TICKS)
+		ticks = 2 * AO_ATHENA_PULSE_TICKS;
+
+	ao_gpio_set(AO_STEPPER_DIR_PORT, AO_STEPPER_DIR_PIN, dir < 0);
+	stm_tim3.arr = ticks - 1;
+	stm_tim3.ccr1 = ticks - AO_ATHENA_PULSE_TICKS;
+	return dir;
+}
+
+void
+stm_tim3_isr(void)
+{
+	if (stm_tim3.sr & (1 << STM_TIM234_SR_UIF)) {
+		stm_tim3.sr = ~(1 << STM_TIM234_SR_UIF);
+		ao_stepper_update();
+	}
+}
+
+int32_t
+ao_stepper_position(void)
+{
+	return ao_stepper.position;
+}
+
+/* Drop whatever was planned and head for position from wherever we are */
+static void
+ao_stepper_retarget(int32_t position)
+{
+	stm_nvic_clear_enable(STM_ISR_TIM3_POS);
+	motion_Retarget(&ao_stepper, position);
+	if (!(stm_tim3.cr1 & (1 << STM_TIM234_CR1_CEN))) {
+		ao_gpio_set(AO_STEPPER_EN_PORT, AO_STEPPER_EN_PIN, 0);
+		if (ao_stepper_update()) {
+			stm_tim3.cnt = 0;
+			stm_tim3.cr1 |= (1 << STM_TIM234_CR1_CEN);
+		}
+	}
+	stm_nvic_set_enable(STM_ISR_TIM3_POS);
+}
+
+static void
+ao_stepper_init(void)
+{
+	motion_Init(&ao_stepper, AO_ATHENA_STEPPER_HZ, 0x10000, AO_ATHENA_MAX_SPEED, AO_ATHENA_ACCEL);
+
+	ao_enable_output(AO_STEPPER_EN_PORT, AO_STEPPER_EN_PIN, 1);
+	ao_enable_output(AO_STEPPER_DIR_PORT, AO_STEPPER_DIR_PIN, 0);
+	ao_enable_output(AO_STEPPER_PWM_PORT, AO_STEPPER_PWM_PIN, 1);
+
+	stm_rcc.apb1enr |= (1 << STM_RCC_APB1ENR_TIM3EN);
+
+	stm_tim3.cr1 = 0;
+	/* APB1 timers run at twice the bus clock when it's divided */
+	stm_tim3.psc = AO_P1CLK * 2 / AO_ATHENA_STEPPER_HZ - 1;
+	stm_tim3.arr = 0xffff;
+	stm_tim3.ccr1 = 0xffff;
+
+	/*
+	 * Low once the counter passes CCR1, high again at the update. Period
+	 * and compare are rewritten right after each update, so no preload.
+	 */
+	stm_tim3.ccmr1 = (STM_TIM234_CCMR1_OC1M_PWM_MODE_2 << STM_TIM234_CCMR1_OC1M);
+	stm_tim3.ccer = ((1 << STM_TIM234_CCER_CC1E) |
+			 (1 << STM_TIM234_CCER_CC1P));
+	stm_tim3.egr = (1 << STM_TIM234_EGR_UG);
+	stm_tim3.sr = 0;
+	stm_tim3.dier = (1 << STM_TIM234_DIER_UIE);
+
+	stm_afr_set(AO_STEPPER_PWM_PORT, AO_STEPPER_PWM_PIN, AO_STEPPER_PWM_AFR);
+
+	stm_nvic_set_priority(STM_ISR_TIM3_POS, AO_STM_NVIC_HIGH_PRIORITY);
+	stm_nvic_set_enable(STM_ISR_TIM3_POS);
+}
+
+/* The table's crc check reads straight through before it's flown */
+static int
+ao_athena_lut_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+	return ao_storage_read(addr, buf, (uint16_t) len) ? 0 : -1;
+}
+
+/* Drag table fetches are plain storage reads from task context */
+static int
+ao_athena_lut_fetch(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+	if (!ao_storage_read(addr, buf, (uint16_t) len))
+		return -1;
+	lut_FetchDone(&lut);
+	return 0;
+}
+
+static struct lut *
+ao_athena_lut_open(void)
+{
+	uint8_t	header[LUT_HEADER_SIZE];
+
+	if (!ao_storage_read(AO_ATHENA_LUT_ADDR, header, sizeof (header)))
+		return NULL;
+	if (lut_Open(&lut, header, sizeof (header), AO_ATHENA_LUT_ADDR,
+		     ao_athena_lut_read, ao_athena_lut_fetch) != 0)
+		return NULL;
+	lut_Poll(&lut);
+	return &lut;
+}
+
+static void
+ao_athena_record(const struct companion_state *s, int32_t target)
+{
+	struct ao_athena_sample	*a = &ao_athena_ring[ao_athena_head];
+
+	a->tick = ao_time();
+	a->companion = *s;
+	a->mode = control.mode;
+	a->cd = control.cd;
+	a->predicted = control.predicted;
+	a->commanded = target;
+	a->position = ao_stepper_position();
+	ao_arch_critical(
+		ao_athena_head = ao_athena_ring_next(ao_athena_head);
+		ao_wakeup((void *) &ao_athena_head);
+		);
+}
+
+static void
+ao_athena_control(void)
+{
+	struct control_config		cfg = CONTROL_CONFIG_DEFAULT;
+	uint32_t			frames;
+	int32_t				target;
+
+	/* One step per companion frame here, not per AthenaOS control tick */
+	cfg.hz = COMPANION_HZ;
+	ao_storage_setup();
+	control_Init(&control, &cfg, ao_athena_lut_open());
+
+	frames = companion.frames;
+	for (;;) {
+		ao_arch_block_interrupts();
+		while (companion.frames == frames)
+			if (ao_sleep_for(&companion, AO_MS_TO_TICKS(20)))
+				break;
+		ao_arch_release_interrupts();
+
+		if (companion.frames == frames)
+			ao_athena_stale++;
+		frames = companion.frames;
+
+		target = control_Step(&control, companion_Latest(&companion), ao_stepper_position(),
+				      ao_athena_ms());
+		ao_stepper_retarget(target);
+		if (control.lut)
+			lut_Poll(&lut);
+		ao_athena_record(companion_Latest(&companion), target);
+	}
+}
+
+static void
+ao_athena_show(void)
+{
+	const struct companion_state	*s = companion_Latest(&companion);
+
+	printf("companion: %lu frames %lu errors, state %d height %d speed %d\n",
+	       (unsigned long) companion.frames, (unsigned long) companion.errors,
+	       s->flight_state, s->height, s->speed / 16);
+	printf("control: mode %d cd %d predicted %d target %ld position %ld%s\n",
+	       control.mode, (int) (control.cd * 10000), (int) control.predicted,
+	       (long) control.output, (long) ao_stepper_position(),
+	       control.lut ? "" : " (no drag table)");
+}
+
+static void
+ao_athena_move(void)
+{
+	int32_t	position = (int32_t) ao_cmd_decimal();
+
+	if (ao_cmd_status != ao_cmd_success)
+		return;
+	if (control.mode == CONTROL_ACTIVE) {
+		printf("flying\n");
+		return;
+	}
+	ao_stepper_retarget(position);
+}
+
+const struct ao_cmds ao_athena_cmds[] = {
+	{ ao_athena_show,	"a\0Show airbrake state" },
+	{ ao_athena_move,	"m <steps>\0Move brakes (not in flight)" },
+	{ 0,	NULL },
+};
+
+void
+ao_athena_control_init(void)
+{
+	ao_stepper_init();
+	ao_cmd_register(&ao_athena_cmds[0]);
+	ao_add_task(&ao_control_task, ao_athena_control, "control");
+}
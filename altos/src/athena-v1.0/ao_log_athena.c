@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <ao.h>
+#include <ao_log.h>
+#include "ao_athena.h"
+
+/*
+ * There's no flight state machine here; the TeleMega's, as it comes
+ * over the companion link, decides when a flight starts and ends.
+ */
+
+static uint8_t	ao_log_athena_pos;
+
+/* a hack to make sure that ao_log_athenas fill the eeprom block in even units */
+typedef uint8_t check_log_size[1-(256 % sizeof(struct ao_log_athena))] ;
+
+static uint8_t
+ao_log_athena_state(void)
+{
+	return companion_Latest(&companion)->flight_state;
+}
+
+static void
+ao_log_athena_sensor(const struct ao_athena_sample *a)
+{
+	ao_log_data.type = AO_LOG_SENSOR;
+	ao_log_data.tick = (uint16_t) a->tick;
+	ao_log_data.u.sensor.flight_state = a->companion.flight_state;
+	ao_log_data.u.sensor.mode = a->mode;
+	ao_log_data.u.sensor.companion_tick = a->companion.tick;
+	ao_log_data.u.sensor.height = a->companion.height;
+	ao_log_data.u.sensor.speed = a->companion.speed;
+	ao_log_data.u.sensor.accel = a->companion.accel;
+	ao_log_data.u.sensor.cd = (uint16_t) (a->cd * 10000.0f + 0.5f);
+	ao_log_data.u.sensor.predicted = (int32_t) (a->predicted * 100.0f);
+	ao_log_data.u.sensor.commanded = a->commanded;
+	ao_log_data.u.sensor.position = a->position;
+	ao_log_data.u.sensor.errors = (uint16_t) companion.errors;
+	ao_log_data.u.sensor.stale = ao_athena_stale;
+	ao_log_write(&ao_log_data);
+}
+
+void
+ao_log(void)
+{
+	const struct companion_state	*s;
+	uint8_t				state;
+
+	ao_storage_setup();
+
+	ao_log_scan();
+
+	for (;;) {
+		/* Sit on the pad until the TeleMega says we're flying */
+		while (!ao_log_running) {
+			state = ao_log_athena_state();
+			if (COMPANION_STATE_BOOST <= state && state < COMPANION_STATE_LANDED &&
+			    !ao_log_full())
+				ao_log_start();
+			else
+				ao_sleep_for((void *) &ao_athena_head, AO_MS_TO_TICKS(100));
+		}
+
+		s = companion_Latest(&companion);
+		ao_log_data.type = AO_LOG_FLIGHT;
+		ao_log_data.tick = (uint16_t) ao_time();
+		ao_log_data.u.flight.flight = ao_flight_number;
+		ao_log_data.u.flight.serial = s->serial;
+		ao_log_data.u.flight.telemega_flight = s->flight;
+		ao_log_write(&ao_log_data);
+
+		/* Write the whole ring to catch the pad and the launch */
+		ao_log_athena_pos = ao_athena_ring_next(ao_athena_head);
+		ao_log_state = ao_flight_startup;
+		while (ao_log_running) {
+			while (ao_log_athena_pos != ao_athena_head) {
+				ao_log_athena_sensor(&ao_athena_ring[ao_log_athena_pos]);
+				ao_log_athena_pos = ao_athena_ring_next(ao_log_athena_pos);
+			}
+
+			state = ao_log_athena_state();
+			if (state != ao_log_state) {
+				ao_log_state = state;
+				ao_log_data.type = AO_LOG_STATE;
+				ao_log_data.tick = (uint16_t) ao_time();
+				ao_log_data.u.state.state = ao_log_state;
+				ao_log_data.u.state.reason = 0;
+				ao_log_write(&ao_log_data);
+
+				if (ao_log_state == ao_flight_landed)
+					ao_log_stop();
+			}
+
+			ao_log_flush();
+
+			/* Wait for a while */
+			ao_delay(AO_MS_TO_TICKS(100));
+		}
+	}
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Athena airbrake: STM32F446 companion board for TeleMega. Same pins
+ * as the CubeMX build in AthenaOS/Core/Inc/main.h.
+ */
+
+#ifndef _AO_PINS_H_
+#define _AO_PINS_H_
+
+#define HAS_TASK_QUEUE		1
+#define IS_FLASH_LOADER		0
+
+/* Clock tree configuration: 16MHz crystal, 72MHz core as before */
+#define AO_HSE		16000000
+#define AO_HSE_BYPASS	0
+
+#define AO_PLL_M	16	/* down to 1MHz */
+
+#define AO_PLL1_R	2
+#define AO_PLL1_N	144	/* up to 144MHz */
+#define AO_PLL1_P	2	/* down to 72MHz */
+#define AO_PLL1_Q	3	/* down to 48MHz for USB */
+
+#define AO_AHB_PRESCALER	1
+#define AO_RCC_CFGR_HPRE_DIV	STM_RCC_CFGR_HPRE_DIV_1
+
+#define AO_APB1_PRESCALER	2
+#define AO_RCC_CFGR_PPRE1_DIV	STM_RCC_CFGR_PPRE1_DIV_2
+
+#define AO_APB2_PRESCALER	1
+#define AO_RCC_CFGR_PPRE2_DIV	STM_RCC_CFGR_PPRE2_DIV_1
+
+/* LEDs */
+
+#define HAS_LED		1
+
+#define LED_0_PORT	(&stm_gpiob)
+#define LED_0_PIN	12
+#define LED_GREEN	AO_LED_0
+#define AO_LED_PANIC	LED_GREEN
+#define LEDS_AVAILABLE	LED_GREEN
+
+#define HAS_BEEP	0	/* no TIM2 beeper driver for this port yet */
+
+#define AO_CMD_LEN	128
+
+/* USB */
+
+#define HAS_USB			1
+#define USE_USB_STDIO		1
+
+/* Logging */
+
+#define HAS_FLIGHT		0
+#define HAS_ADC			0
+#define LOG_ADC			1	/* still start the log task */
+#define HAS_LOG			1
+#define HAS_EEPROM		1
+#define USE_INTERNAL_FLASH	0
+#define USE_EEPROM_CONFIG	0
+#define USE_STORAGE_CONFIG	1
+#define AO_CONFIG_MAX_SIZE	1024
+#define AO_LOG_FORMAT		AO_LOG_FORMAT_ATHENA
+#define LOG_ERASE_MARK		0x55
+#define LOG_MAX_ERASE		128
+
+/*
+ * Two 7MB flight logs from the bottom of the W25Q128, the drag table
+ * in the next 1MB and the config block at the top.
+ */
+#define AO_CONFIG_DEFAULT_FLIGHT_LOG_MAX	(7 * 1024 * 1024)
+#define AO_ATHENA_LUT_ADDR			(14 * 1024 * 1024)
+
+#define HAS_RADIO		0
+#define HAS_TELEMETRY		0
+#define HAS_APRS		0
+#define HAS_COMPANION		0	/* we are the companion */
+#define HAS_GPS			0
+#define HAS_MS5607		0
+#define HAS_ACCEL		0
+#define HAS_IGNITE		0
+#define HAS_MONITOR		0
+
+/* SPI */
+
+#define HAS_SPI_1		1	/* TeleMega companion, slave */
+#define SPI_1_PA5_PA6_PA7	1
+#define SPI_1_OSPEEDR		STM_OSPEEDR_HIGH
+
+#define HAS_SPI_2		1	/* W25Q128 */
+#define SPI_2_PB10_PC2_PC1	1
+#define SPI_2_OSPEEDR		STM_OSPEEDR_HIGH
+
+/* W25Q128 */
+
+#define M25_MAX_CHIPS		1
+#define AO_M25_SPI_CS_PORT	(&stm_gpioc)
+#define AO_M25_SPI_CS_MASK	(1 << 3)
+#define AO_M25_SPI_BUS		AO_SPI_2_PB10_PC2_PC1
+
+/* Companion link, Altus_CS on PC4 */
+
+#define AO_ATHENA_CS_PORT	(&stm_gpioc)
+#define AO_ATHENA_CS_PIN	4
+
+/* Stepper: Step_PWM is TIM3_CH1 on PB4 */
+
+#define AO_STEPPER_PWM_PORT	(&stm_gpiob)
+#define AO_STEPPER_PWM_PIN	4
+#define AO_STEPPER_PWM_AFR	STM_AFR_AF2
+#define AO_STEPPER_DIR_PORT	(&stm_gpiob)
+#define AO_STEPPER_DIR_PIN	15
+#define AO_STEPPER_EN_PORT	(&stm_gpioc)	/* low to enable */
+#define AO_STEPPER_EN_PIN	9
+
+#endif /* _AO_PINS_H_ */
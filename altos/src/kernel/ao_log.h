@@ -61,6 +61,7 @@ extern enum ao_flight_state ao_log_state;
 #define AO_LOG_FORMAT_TELEMEGA_4	19	/* 32 byte typed telemega records with 32 bit gyro cal and Bmx160 */
 #define AO_LOG_FORMAT_EASYMOTOR		20	/* ? byte typed easymotor records with pressure sensor and adxl375 */
 #define AO_LOG_FORMAT_TELEMEGA_5	21	/* 32 byte typed telemega records with 32 bit gyro cal, mpu6000 and mmc5983 */
+#define AO_LOG_FORMAT_ATHENA		22	/* 32 byte typed athena airbrake records */
 #define AO_LOG_FORMAT_NONE		127	/* No log at all */
 
 /* Return the flight number from the given log slot, 0 if none, -slot on failure */
@@ -354,6 +355,41 @@ struct ao_log_firetwo {
 	} u;	/* 32 */
 };
 
+struct ao_log_athena {
+	char			type;			/* 0 */
+	uint8_t			csum;			/* 1 */
+	uint16_t		tick;			/* 2 */
+	union {						/* 4 */
+		/* AO_LOG_FLIGHT */
+		struct {
+			uint16_t	flight;		/* 4 */
+			uint16_t	serial;		/* 6 TeleMega serial */
+			uint16_t	telemega_flight;	/* 8 TeleMega flight number */
+		} flight;	/* 10 */
+		/* AO_LOG_STATE */
+		struct {
+			uint16_t	state;		/* 4 */
+			uint16_t	reason;		/* 6 */
+		} state;	/* 8 */
+		/* AO_LOG_SENSOR */
+		struct {
+			uint8_t		flight_state;	/* 4 from the TeleMega */
+			uint8_t		mode;		/* 5 CONTROL_x */
+			uint16_t	companion_tick;	/* 6 */
+			int16_t		height;		/* 8 m */
+			int16_t		speed;		/* 10 m/s * 16 */
+			int16_t		accel;		/* 12 m/s^2 * 16 */
+			uint16_t	cd;		/* 14 * 10000 */
+			int32_t		predicted;	/* 16 apogee, cm */
+			int32_t		commanded;	/* 20 steps */
+			int32_t		position;	/* 24 steps */
+			uint16_t	errors;		/* 28 companion rejects */
+			uint16_t	stale;		/* 30 ticks without companion data */
+		} sensor;	/* 32 */
+		uint8_t		align[28];		/* 4 */
+	} u;	/* 32 */
+};
+
 struct ao_log_telestatic {
 	char			type;			/* 0 */
 	uint8_t			csum;			/* 1 */
@@ -565,6 +601,10 @@ typedef struct ao_log_firetwo ao_log_type;
 typedef struct ao_log_mini ao_log_type;
 #endif
 
+#if AO_LOG_FORMAT == AO_LOG_FORMAT_ATHENA
+typedef struct ao_log_athena ao_log_type;
+#endif
+
 #if AO_LOG_FORMAT == AO_LOG_FORMAT_EASYMOTOR
 typedef struct ao_log_motor ao_log_type;
 #endif 
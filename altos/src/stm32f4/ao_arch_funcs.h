@@ -330,6 +330,89 @@ static inline void ao_disable_port(struct stm_gpio *port)
 		ao_gpio_set_mode(port, bit, mode);			\
 	} while (0)
 
+/* ao_spi_stm32f4.c
+ */
+
+#define AO_SPI_NUM		2
+
+#define AO_SPI_CPOL_BIT		4
+#define AO_SPI_CPHA_BIT		5
+
+#define AO_SPI_INDEX_MASK	0x07
+
+#define AO_SPI_1_PA5_PA6_PA7	STM_SPI_INDEX(1)
+#define AO_SPI_2_PB13_PB14_PB15	STM_SPI_INDEX(2)
+#define AO_SPI_2_PB10_PC2_PC1	STM_SPI_INDEX(2)
+
+#define AO_SPI_INDEX(id)	((id) & AO_SPI_INDEX_MASK)
+#define AO_SPI_CPOL(id)		((uint32_t) (((id) >> AO_SPI_CPOL_BIT) & 1))
+#define AO_SPI_CPHA(id)		((uint32_t) (((id) >> AO_SPI_CPHA_BIT) & 1))
+
+#define AO_SPI_MAKE_MODE(pol,pha)	(((pol) << AO_SPI_CPOL_BIT) | ((pha) << AO_SPI_CPHA_BIT))
+#define AO_SPI_MODE_0		AO_SPI_MAKE_MODE(0,0)
+#define AO_SPI_MODE_1		AO_SPI_MAKE_MODE(0,1)
+#define AO_SPI_MODE_2		AO_SPI_MAKE_MODE(1,0)
+#define AO_SPI_MODE_3		AO_SPI_MAKE_MODE(1,1)
+
+/*
+ * Slowest divider that still reaches hz, from the APB1 clock. SPI1
+ * sits on APB2 and runs twice as fast for the same setting.
+ */
+static inline uint32_t
+ao_spi_speed(uint32_t hz)
+{
+	uint32_t	br;
+
+	for (br = STM_SPI_CR1_BR_PCLK_2; br < STM_SPI_CR1_BR_PCLK_256; br++)
+		if ((AO_P1CLK >> (br + 1)) <= hz)
+			break;
+	return br;
+}
+
+void
+ao_spi_get(uint8_t spi_index, uint32_t speed);
+
+void
+ao_spi_put(uint8_t spi_index);
+
+void
+ao_spi_send(const void *block, uint16_t len, uint8_t spi_index);
+
+void
+ao_spi_send_fixed(uint8_t value, uint16_t len, uint8_t spi_index);
+
+void
+ao_spi_recv(void *block, uint16_t len, uint8_t spi_index);
+
+void
+ao_spi_duplex(const void *out, void *in, uint16_t len, uint8_t spi_index);
+
+void
+ao_spi_init(void);
+
+#define ao_spi_set_cs(reg,mask) ((reg)->bsrr = ((uint32_t) (mask)) << 16)
+#define ao_spi_clr_cs(reg,mask) ((reg)->bsrr = (mask))
+
+#define ao_spi_get_mask(reg,mask,bus, speed) do {		\
+		ao_spi_get(bus, speed);				\
+		ao_spi_set_cs(reg,mask);			\
+	} while (0)
+
+#define ao_spi_put_mask(reg,mask,bus) do {	\
+		ao_spi_clr_cs(reg,mask);	\
+		ao_spi_put(bus);		\
+	} while (0)
+
+#define ao_spi_get_bit(reg,bit,bus,speed) ao_spi_get_mask(reg,1<<(bit),bus,speed)
+#define ao_spi_put_bit(reg,bit,bus) ao_spi_put_mask(reg,1<<(bit),bus)
+
+#define ao_spi_init_cs(port, mask) do {					\
+		uint8_t __bit;						\
+		for (__bit = 0; __bit < 16; __bit++)			\
+			if ((mask) & (1 << __bit))			\
+				ao_enable_output(port, __bit, 1);	\
+	} while (0)
+
 /* usart */
 
 void
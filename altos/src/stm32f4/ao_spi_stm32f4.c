@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2026 Dylan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * SPI master for the STM32F4. There's no DMA driver for this port
+ * yet, so transfers are polled a byte at a time; each bus is held
+ * under its mutex for the whole transfer so other tasks only wait on
+ * the bus they need. Each bus has a single pin configuration, chosen
+ * in ao_pins.h.
+ */
+
+#include <ao.h>
+
+static uint8_t		ao_spi_mutex[AO_SPI_NUM];
+
+static struct stm_spi * const ao_spi_stm[AO_SPI_NUM] = {
+	&stm_spi1,
+	&stm_spi2,
+};
+
+static void
+ao_spi_wait(struct stm_spi *stm_spi)
+{
+	/* Let the last byte out before anyone touches chip select */
+	while (!(stm_spi->sr & (1 << STM_SPI_SR_TXE)))
+		;
+	while (stm_spi->sr & (1 << STM_SPI_SR_BSY))
+		;
+}
+
+void
+ao_spi_send(const void *block, uint16_t len, uint8_t spi_index)
+{
+	struct stm_spi	*stm_spi = ao_spi_stm[AO_SPI_INDEX(spi_index)];
+	const uint8_t	*b = block;
+
+	while (len--) {
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_TXE)))
+			;
+		stm_spi->dr = *b++;
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_RXNE)))
+			;
+		(void) stm_spi->dr;
+	}
+	ao_spi_wait(stm_spi);
+}
+
+void
+ao_spi_send_fixed(uint8_t value, uint16_t len, uint8_t spi_index)
+{
+	struct stm_spi	*stm_spi = ao_spi_stm[AO_SPI_INDEX(spi_index)];
+
+	while (len--) {
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_TXE)))
+			;
+		stm_spi->dr = value;
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_RXNE)))
+			;
+		(void) stm_spi->dr;
+	}
+	ao_spi_wait(stm_spi);
+}
+
+void
+ao_spi_recv(void *block, uint16_t len, uint8_t spi_index)
+{
+	struct stm_spi	*stm_spi = ao_spi_stm[AO_SPI_INDEX(spi_index)];
+	uint8_t		*b = block;
+
+	while (len--) {
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_TXE)))
+			;
+		stm_spi->dr = 0xff;
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_RXNE)))
+			;
+		*b++ = (uint8_t) stm_spi->dr;
+	}
+	ao_spi_wait(stm_spi);
+}
+
+void
+ao_spi_duplex(const void *out, void *in, uint16_t len, uint8_t spi_index)
+{
+	struct stm_spi	*stm_spi = ao_spi_stm[AO_SPI_INDEX(spi_index)];
+	const uint8_t	*o = out;
+	uint8_t		*i = in;
+
+	while (len--) {
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_TXE)))
+			;
+		stm_spi->dr = *o++;
+		while (!(stm_spi->sr & (1 << STM_SPI_SR_RXNE)))
+			;
+		*i++ = (uint8_t) stm_spi->dr;
+	}
+	ao_spi_wait(stm_spi);
+}
+
+void
+ao_spi_get(uint8_t spi_index, uint32_t speed)
+{
+	uint8_t		id = AO_SPI_INDEX(spi_index);
+	struct stm_spi	*stm_spi = ao_spi_stm[id];
+
+	ao_mutex_get(&ao_spi_mutex[id]);
+	stm_spi->cr2 = 0;
+	stm_spi->cr1 = ((0 << STM_SPI_CR1_BIDIMODE) |
+			(0 << STM_SPI_CR1_BIDIOE) |
+			(0 << STM_SPI_CR1_CRCEN) |
+			(0 << STM_SPI_CR1_CRCNEXT) |
+			(0 << STM_SPI_CR1_DFF) |
+			(0 << STM_SPI_CR1_RXONLY) |
+			(1 << STM_SPI_CR1_SSM) |	/* Software SS handling */
+			(1 << STM_SPI_CR1_SSI) |	/*  ... */
+			(0 << STM_SPI_CR1_LSBFIRST) |	/* Big endian */
+			(1 << STM_SPI_CR1_SPE) |	/* Enable SPI unit */
+			(speed << STM_SPI_CR1_BR) |	/* baud rate to pclk/4 */
+			(1 << STM_SPI_CR1_MSTR) |
+			(AO_SPI_CPOL(spi_index) << STM_SPI_CR1_CPOL) |
+			(AO_SPI_CPHA(spi_index) << STM_SPI_CR1_CPHA));
+
+	/* Clear any stale data and error flags */
+	(void) stm_spi->dr;
+	(void) stm_spi->sr;
+}
+
+void
+ao_spi_put(uint8_t spi_index)
+{
+	uint8_t		id = AO_SPI_INDEX(spi_index);
+
+	ao_spi_stm[id]->cr1 = 0;
+	ao_mutex_put(&ao_spi_mutex[id]);
+}
+
+static void
+ao_spi_pin(struct stm_gpio *gpio, int pin, uint32_t af, uint32_t speed)
+{
+	ao_enable_port(gpio);
+	stm_ospeedr_set(gpio, pin, speed);
+	stm_afr_set(gpio, pin, af);
+}
+
+void
+ao_spi_init(void)
+{
+#if HAS_SPI_1
+# if SPI_1_PA5_PA6_PA7
+	ao_spi_pin(&stm_gpioa, 5, STM_AFR_AF5, SPI_1_OSPEEDR);
+	ao_spi_pin(&stm_gpioa, 6, STM_AFR_AF5, SPI_1_OSPEEDR);
+	ao_spi_pin(&stm_gpioa, 7, STM_AFR_AF5, SPI_1_OSPEEDR);
+# else
+#  error "No SPI_1 pins"
+# endif
+	stm_rcc.apb2enr |= (1 << STM_RCC_APB2ENR_SPI1EN);
+	stm_spi1.cr1 = 0;
+#endif
+
+#if HAS_SPI_2
+# if SPI_2_PB13_PB14_PB15
+	ao_spi_pin(&stm_gpiob, 13, STM_AFR_AF5, SPI_2_OSPEEDR);
+	ao_spi_pin(&stm_gpiob, 14, STM_AFR_AF5, SPI_2_OSPEEDR);
+	ao_spi_pin(&stm_gpiob, 15, STM_AFR_AF5, SPI_2_OSPEEDR);
+# elif SPI_2_PB10_PC2_PC1
+	ao_spi_pin(&stm_gpiob, 10, STM_AFR_AF5, SPI_2_OSPEEDR);
+	ao_spi_pin(&stm_gpioc, 2, STM_AFR_AF5, SPI_2_OSPEEDR);
+	ao_spi_pin(&stm_gpioc, 1, STM_AFR_AF7, SPI_2_OSPEEDR);
+# else
+#  error "No SPI_2 pins"
+# endif
+	stm_rcc.apb1enr |= (1 << STM_RCC_APB1ENR_SPI2EN);
+	stm_spi2.cr1 = 0;
+#endif
+}
@@ -1038,6 +1038,127 @@ extern struct stm_usart	stm_usart6;
 #define STM_USART_CR3_IREN	(1)	/* IrDA mode enable */
 #define STM_USART_CR3_EIE	(0)	/* Error interrupt enable */
 
+/* SPI */
+struct stm_spi {
+	vuint32_t	cr1;
+	vuint32_t	cr2;
+	vuint32_t	sr;
+	vuint32_t	dr;
+	vuint32_t	crcpr;
+	vuint32_t	rxcrcr;
+	vuint32_t	txcrcr;
+	vuint32_t	i2scfgr;
+	vuint32_t	i2spr;
+};
+
+extern struct stm_spi stm_spi1, stm_spi2;
+
+#define stm_spi1	(*((struct stm_spi *) 0x40013000))
+#define stm_spi2	(*((struct stm_spi *) 0x40003800))
+
+/* SPI channels go from 1 to 5, instead of 0 to 4 (sigh)
+ */
+
+#define STM_SPI_INDEX(channel)		((channel) - 1)
+
+#define STM_SPI_CR1_BIDIMODE		15
+#define STM_SPI_CR1_BIDIOE		14
+#define STM_SPI_CR1_CRCEN		13
+#define STM_SPI_CR1_CRCNEXT		12
+#define STM_SPI_CR1_DFF			11
+#define STM_SPI_CR1_RXONLY		10
+#define STM_SPI_CR1_SSM			9
+#define STM_SPI_CR1_SSI			8
+#define STM_SPI_CR1_LSBFIRST		7
+#define STM_SPI_CR1_SPE			6
+#define STM_SPI_CR1_BR			3
+#define  STM_SPI_CR1_BR_PCLK_2			0
+#define  STM_SPI_CR1_BR_PCLK_4			1
+#define  STM_SPI_CR1_BR_PCLK_8			2
+#define  STM_SPI_CR1_BR_PCLK_16			3
+#define  STM_SPI_CR1_BR_PCLK_32			4
+#define  STM_SPI_CR1_BR_PCLK_64			5
+#define  STM_SPI_CR1_BR_PCLK_128		6
+#define  STM_SPI_CR1_BR_PCLK_256		7
+#define  STM_SPI_CR1_BR_MASK			7UL
+
+#define STM_SPI_CR1_MSTR		2
+#define STM_SPI_CR1_CPOL		1
+#define STM_SPI_CR1_CPHA		0
+
+#define STM_SPI_CR2_TXEIE	7
+#define STM_SPI_CR2_RXNEIE	6
+#define STM_SPI_CR2_ERRIE	5
+#define STM_SPI_CR2_FRF		4
+#define STM_SPI_CR2_SSOE	2
+#define STM_SPI_CR2_TXDMAEN	1
+#define STM_SPI_CR2_RXDMAEN	0
+
+#define STM_SPI_SR_FRE		8
+#define STM_SPI_SR_BSY		7
+#define STM_SPI_SR_OVR		6
+#define STM_SPI_SR_MODF		5
+#define STM_SPI_SR_CRCERR	4
+#define STM_SPI_SR_UDR		3
+#define STM_SPI_SR_CHSIDE	2
+#define STM_SPI_SR_TXE		1
+#define STM_SPI_SR_RXNE		0
+
+#define STM_RCC_APB2RSTR_SPI1RST	12
+#define STM_RCC_APB1RSTR_SPI2RST	14
+
+/* General purpose timers */
+struct stm_tim234 {
+	vuint32_t	cr1;
+	vuint32_t	cr2;
+	vuint32_t	smcr;
+	vuint32_t	dier;
+
+	vuint32_t	sr;
+	vuint32_t	egr;
+	vuint32_t	ccmr1;
+	vuint32_t	ccmr2;
+
+	vuint32_t	ccer;
+	vuint32_t	cnt;
+	vuint32_t	psc;
+	vuint32_t	arr;
+
+	uint32_t	reserved_30;
+	vuint32_t	ccr1;
+	vuint32_t	ccr2;
+	vuint32_t	ccr3;
+
+	vuint32_t	ccr4;
+	uint32_t	reserved_44;
+	vuint32_t	dcr;
+	vuint32_t	dmar;
+};
+
+extern struct stm_tim234 stm_tim3;
+
+#define stm_tim3	(*((struct stm_tim234 *) 0x40000400))
+
+#define STM_TIM234_CR1_ARPE	7
+#define STM_TIM234_CR1_OPM	3
+#define STM_TIM234_CR1_URS	2
+#define STM_TIM234_CR1_UDIS	1
+#define STM_TIM234_CR1_CEN	0
+
+#define STM_TIM234_DIER_UIE	0
+
+#define STM_TIM234_SR_UIF	0
+
+#define STM_TIM234_EGR_UG	0
+
+#define STM_TIM234_CCMR1_OC1M	4
+#define  STM_TIM234_CCMR1_OC1M_PWM_MODE_1	6
+#define  STM_TIM234_CCMR1_OC1M_PWM_MODE_2	7
+#define STM_TIM234_CCMR1_OC1PE	3
+
+#define STM_TIM234_CCER_CC1P	1
+#define STM_TIM234_CCER_CC1E	0
+
 /* USB */
 struct stm_usb {
 	vuint32_t	gotgctl;